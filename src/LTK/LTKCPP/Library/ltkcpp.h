@@ -33,10 +33,27 @@
 #ifndef _LTKCPP_H
 #define _LTKCPP_H
 
+/*
+ * The standard headers the LTKCPP headers below use. They come
+ * first because ltkcpp_platform.h includes <stdint.h> inside
+ * namespace LLRP, which breaks any of them included after it.
+ */
+#include <stdio.h>
+#include <time.h>
+#include <iosfwd>
+#include <string>
+
+#if defined(linux)
+#include <stdint.h>              // required for linux
+#endif
+
 #include "ltkcpp_platform.h"
 #include "ltkcpp_base.h"
 #include "ltkcpp_frame.h"
+#include "ltkcpp_capture.h"
+#include "ltkcpp_batch.h"
 #include "ltkcpp_xmltext.h"
+#include "ltkcpp_jsontext.h"
 #include "ltkcpp_connection.h"
 
 /* for passing version information as a define */
@@ -49,7 +66,13 @@
 ** @brief The Namespace for the LLRP LTK Library */
 namespace LLRP
 {
+/* A selection built in its own directory names its out_ltkcpp.h,
+** see LTKCPP_OUTDIR in the Makefile */
+#ifdef LTKCPP_OUT_H
+#include LTKCPP_OUT_H
+#else
 #include "out_ltkcpp.h"
+#endif
 
 /* @brief Gets a new type registry and enrolls the core LLRP types
 **
@@ -63,6 +86,21 @@ namespace LLRP
 extern CTypeRegistry *
 getTheTypeRegistry (void);
 
+/* @brief Gets the process-wide registry of the core LLRP types
+**
+** The registry is built on the first call and never changes or goes
+** away after that. Lookups don't modify it, so every connection and
+** decoder in every thread can share it. Do not delete it.
+** Applications that enroll custom types need a registry of their
+** own from getTheTypeRegistry().
+**
+** @return CTypeRegistry The shared type registry
+**
+** @ingroup LTKCoreElement
+*/
+extern const CTypeRegistry *
+getTheSharedTypeRegistry (void);
+
 }; /* namespace LLRP */
 
 #endif /* !_LTKCPP_H */
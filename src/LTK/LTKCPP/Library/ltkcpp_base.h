@@ -56,6 +56,7 @@ class CTypeDescriptor;
 class CFieldDescriptor;
 struct SEnumTableEntry;
 class CTypeRegistry;
+class CElementPool;
 class CElement;
 class CMessage;
 class CParameter;
@@ -900,6 +901,10 @@ class CTypeRegistry
     std::list<const CTypeDescriptor *> m_listCustomMessageTypeDescriptors;
     /** @brief List of custom parameters types */
     std::list<const CTypeDescriptor *> m_listCustomParameterTypeDescriptors;
+    /** @brief Decode standard types that aren't enrolled as
+     ** COpaqueMessage/COpaqueParameter instead of failing.
+     ** FALSE unless the types were generated selectively. */
+    llrp_bool_t                 m_bOpaqueUnknownTypes;
 
     CTypeRegistry(void);
     ~CTypeRegistry(void);
@@ -936,6 +941,128 @@ class CTypeRegistry
     lookupByName (
       char *                    pName) const;
 
+  private:
+    /*
+     * Open addressing (linear probe) hash indexes, kept
+     * at most half full and maintained by enroll(). An
+     * empty slot is NULL. The lists and arrays above stay
+     * the authority; the indexes only make lookups O(1).
+     *
+     * m_apCustomIndex is keyed on (message/parameter,
+     * VendorID, subtype). m_apNameIndex is keyed on the
+     * name and holds the descriptor the original linear
+     * search would have found first.
+     */
+    std::vector<const CTypeDescriptor *> m_apCustomIndex;
+    unsigned int                m_nCustomIndex;
+    std::vector<const CTypeDescriptor *> m_apNameIndex;
+    unsigned int                m_nNameIndex;
+
+    void
+    indexCustom (
+      const CTypeDescriptor *   pTypeDescriptor);
+
+    void
+    indexName (
+      const CTypeDescriptor *   pTypeDescriptor);
+
+    const CTypeDescriptor *
+    lookupCustom (
+      llrp_bool_t               bIsMessage,
+      unsigned int              VendorID,
+      unsigned int              SubTypeNum) const;
+};
+
+
+/**
+ *****************************************************************************
+ ** CElementPool
+ **
+ ** @brief A free list of released element objects of one class.
+ **
+ ** Tag reports decode into the same handful of small parameter
+ ** types over and over (TagReportData, EPC_96, AntennaID,
+ ** timestamps, ...). The generated classes for those types
+ ** declare a static CElementPool and route their class
+ ** operator new/delete through it. Released objects are kept
+ ** on the free list, up to m_nMaxFree, and handed back on the
+ ** next allocation instead of going to the heap. This covers
+ ** both s_construct() during decode and the deletes done by
+ ** ~CElement() when a message is destructed.
+ **
+ ** Every pool links itself onto a process-wide chain at
+ ** construction so the counters can be inspected with
+ ** getFirstPool()/m_pNextPool. getCounters() adds up every
+ ** thread's counts, including threads that have exited.
+ **
+ ** The free lists and counters are kept per thread, so
+ ** threads decoding at the same time never touch the same
+ ** list and need no lock. An element may be deleted on a
+ ** different thread than the one that created it; its memory
+ ** just joins the deleting thread's list. When a thread exits
+ ** its lists are freed back to the heap, and elements deleted
+ ** on it after that, e.g. by other thread_local destructors,
+ ** go straight to the heap.
+ **
+ ** @ingroup LTKCoreElement
+ *****************************************************************************
+ */
+class CElementPool
+{
+  public:
+    /** @brief Name of the pooled type, for reporting */
+    const char *                m_pName;
+    /** @brief Size of the objects this pool hands out */
+    unsigned int                m_nObjectSize;
+    /** @brief Most released objects kept on each thread's free list */
+    unsigned int                m_nMaxFree;
+    /** @brief Next pool on the process-wide chain */
+    CElementPool *              m_pNextPool;
+
+  private:
+    /** @brief Slot of this pool in each thread's free list table */
+    unsigned int                m_iSlot;
+
+  public:
+    CElementPool (
+      const char *              pName,
+      unsigned int              nObjectSize,
+      unsigned int              nMaxFree = 256u);
+
+    /** @brief Get an object's worth of memory, from the free list if one is there */
+    void *
+    allocate (
+      size_t                    nByte);
+
+    /** @brief Put an object's memory back on the free list, or to the heap */
+    void
+    release (
+      void *                    pObject,
+      size_t                    nByte);
+
+    /** @brief Free everything on this thread's free list back to the heap */
+    void
+    trim (void);
+
+    /** @brief Get the free count and hit/miss/release counters, summed over all threads */
+    void
+    getCounters (
+      unsigned int *            pnFree,
+      unsigned long *           pnHit,
+      unsigned long *           pnMiss,
+      unsigned long *           pnRelease) const;
+
+    /** @brief Start the hit/miss/release counters, for all threads, again from zero */
+    void
+    resetCounters (void);
+
+    /** @brief Head of the chain of all pools in the process */
+    static CElementPool *
+    getFirstPool (void);
+
+  private:
+    static CElementPool *       s_pFirstPool;
+    static unsigned int         s_nSlot;
 };
 
 
@@ -1067,7 +1194,10 @@ class CElement
      ** this assimilateSubParameters() function is called to
      ** create parameter refrences from the primary member variables.
      **
-     ** @param[out] pError Error details for encoded stream
+     ** @param[out] pError Error details for encoded stream.
+     **                   NULL for a trusted decode: sub-parameters
+     **                   are taken in any order and nothing is an
+     **                   error (see CFrameDecoder::DECODE_TRUSTED).
      **/
     virtual void
     assimilateSubParameters (
@@ -1155,6 +1285,105 @@ class CParameter : public CElement
       const CTypeDescriptor *   pEnclosingTypeDescriptor);
 };
 
+/**
+ *****************************************************************************
+ **
+ ** @brief  A message of a type the registry doesn't have
+ **
+ ** A library generated with only some types selected (see
+ ** ltkcpp_gen_select.xslt) sets the registry's
+ ** m_bOpaqueUnknownTypes. The frame decoder then decodes an
+ ** unknown message into one of these instead of failing with
+ ** RC_UnknownMessageType. The body is kept, unparsed, in m_Data
+ ** and encodes back byte for byte.
+ **
+ ** Each instance has its own copy of the type descriptor with
+ ** the real type number and a name like "OpaqueMessage_47".
+ ** The name only exists for LTK-XML output; the XML decoder
+ ** does not know it.
+ **
+ ** @ingroup LTKCoreElement
+ *****************************************************************************
+ **/
+class COpaqueMessage : public CMessage
+{
+  public:
+    COpaqueMessage (
+      llrp_u16_t                TypeNum);
+
+    /** @brief The message body after the header */
+    llrp_bytesToEnd_t           m_Data;
+
+    static const CFieldDescriptor
+    s_fdData;
+
+    static const CFieldDescriptor * const
+    s_apFieldDescriptorTable[];
+
+    void
+    decodeFields (
+      CDecoderStream *          pDecoderStream);
+
+    void
+    assimilateSubParameters (
+      CErrorDetails *           pError);
+
+    void
+    encode (
+      CEncoderStream *          pEncoderStream) const;
+
+  private:
+    CTypeDescriptor             m_OpaqueType;
+    char                        m_aOpaqueName[32];
+};
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  A TLV parameter of a type the registry doesn't have
+ **
+ ** The parameter counterpart of COpaqueMessage. It is accepted
+ ** wherever a generic Custom parameter is, the extension point
+ ** at the end of the enclosing element, so it goes into the
+ ** enclosing element's Custom list. A TV parameter of unknown
+ ** type can't be kept this way, its length isn't known; the
+ ** decode still fails with RC_UnknownParameterType.
+ **
+ ** @ingroup LTKCoreElement
+ *****************************************************************************
+ **/
+class COpaqueParameter : public CParameter
+{
+  public:
+    COpaqueParameter (
+      llrp_u16_t                TypeNum);
+
+    /** @brief The parameter body after the TLV header */
+    llrp_bytesToEnd_t           m_Data;
+
+    static const CFieldDescriptor
+    s_fdData;
+
+    static const CFieldDescriptor * const
+    s_apFieldDescriptorTable[];
+
+    void
+    decodeFields (
+      CDecoderStream *          pDecoderStream);
+
+    void
+    assimilateSubParameters (
+      CErrorDetails *           pError);
+
+    void
+    encode (
+      CEncoderStream *          pEncoderStream) const;
+
+  private:
+    CTypeDescriptor             m_OpaqueType;
+    char                        m_aOpaqueName[32];
+};
+
 /**
  **
  ** @brief LTK LLRP Decoder class
@@ -1416,8 +1645,69 @@ class CDecoderStream
     virtual void
     get_reserved (
       unsigned int          nBits) = 0;
+
+    /** @brief Claims the whole fixed-size part of an element at once
+     **
+     ** Used by the generated s_decodeFields() of elements whose
+     ** fields are all fixed size. On success the nByte bytes have
+     ** been bounds checked and consumed, and the return points to
+     ** them. NULL means the stream can't (or won't) hand out raw
+     ** bytes and the caller must decode field by field. No error
+     ** is recorded for a NULL return; the field-by-field decode
+     ** reports it against the right field.
+     **
+     ** @param[in] nByte Size of the fixed part in bytes
+     ** @return Pointer to the raw bytes, or NULL
+     **/
+    virtual const llrp_u8_t *
+    getFixedFields (
+      unsigned int          nByte)
+    {
+        return NULL;
+    }
 };
 
+/*
+ * Big-endian loads used by the generated fixed part decoders.
+ * pFixed points into the frame, so no alignment is assumed.
+ */
+
+inline llrp_u16_t
+loadFixedU16 (
+  const llrp_u8_t *             pFixed)
+{
+    return (llrp_u16_t)((pFixed[0] << 8u) | pFixed[1]);
+}
+
+inline llrp_u32_t
+loadFixedU32 (
+  const llrp_u8_t *             pFixed)
+{
+    return ((llrp_u32_t)pFixed[0] << 24u) |
+           ((llrp_u32_t)pFixed[1] << 16u) |
+           ((llrp_u32_t)pFixed[2] << 8u) |
+           ((llrp_u32_t)pFixed[3]);
+}
+
+inline llrp_u64_t
+loadFixedU64 (
+  const llrp_u8_t *             pFixed)
+{
+    return ((llrp_u64_t)loadFixedU32(&pFixed[0]) << 32u) |
+            (llrp_u64_t)loadFixedU32(&pFixed[4]);
+}
+
+inline llrp_u96_t
+loadFixedU96 (
+  const llrp_u8_t *             pFixed)
+{
+    llrp_u96_t                  Value;
+
+    memcpy(Value.m_aValue, pFixed, sizeof Value.m_aValue);
+
+    return Value;
+}
+
 /**
  *****************************************************************************
  ** @brief LTK LLRP Encoder class
@@ -0,0 +1,348 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+/**
+ *****************************************************************************
+ **
+ ** @file   ltkcpp_batch.cpp
+ **
+ ** @brief  Multi-threaded decode of capture files
+ **
+ *****************************************************************************/
+
+
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "ltkcpp_platform.h"
+#include "ltkcpp_base.h"
+#include "ltkcpp_frame.h"
+#include "ltkcpp_capture.h"
+#include "ltkcpp_batch.h"
+
+
+namespace LLRP
+{
+
+/* Default frames per chunk, enough to make the hand-off cheap */
+#define BATCH_CHUNK_FRAMES      256u
+
+/* Chunks in flight per worker */
+#define BATCH_CHUNKS_PER_THREAD 4u
+
+/*
+ * A run of consecutive frames, decoded by one worker.
+ * aItem is reused from chunk to chunk so the strings keep
+ * their capacity.
+ */
+struct SBatchChunk
+{
+    std::vector<CBatchItem>     aItem;
+    unsigned int                nItem;
+    bool                        bDone;
+};
+
+/*
+ * What the calling thread and the workers share during one
+ * decode(). Everything is guarded by Mutex.
+ */
+struct SBatchQueue
+{
+    std::mutex                  Mutex;
+    std::condition_variable     WorkReady;
+    std::condition_variable     ChunkDone;
+    std::deque<SBatchChunk *>   Pending;
+    bool                        bStop;
+};
+
+
+CBatchHandler::~CBatchHandler (void)
+{
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Per-frame work on a worker thread
+ **
+ ** The default does nothing; the message goes to deliver()
+ ** as decoded.
+ **
+ *****************************************************************************/
+
+void
+CBatchHandler::decoded (
+  CBatchItem *                  pItem)
+{
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Construct a batch decoder
+ **
+ ** @param[in]  pTypeRegistry   Shared by all the workers. Must not
+ **                             be changed while decode() runs.
+ **
+ *****************************************************************************/
+
+CBatchDecoder::CBatchDecoder (
+  const CTypeRegistry *         pTypeRegistry)
+{
+    m_pTypeRegistry = pTypeRegistry;
+    m_nThread = 1u;
+    m_nFramePerChunk = BATCH_CHUNK_FRAMES;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Set how many threads decode
+ **
+ ** @param[in]  nThread         1 decodes on the calling thread,
+ **                             0 uses one per hardware thread
+ **
+ *****************************************************************************/
+
+void
+CBatchDecoder::setThreadCount (
+  unsigned int                  nThread)
+{
+    if(0 == nThread)
+    {
+        nThread = std::thread::hardware_concurrency();
+    }
+
+    m_nThread = (0 == nThread) ? 1u : nThread;
+}
+
+unsigned int
+CBatchDecoder::getThreadCount (void) const
+{
+    return m_nThread;
+}
+
+void
+CBatchDecoder::setChunkSize (
+  unsigned int                  nFramePerChunk)
+{
+    m_nFramePerChunk = (0 == nFramePerChunk) ? 1u : nFramePerChunk;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Decode every frame the cursor returns
+ **
+ ** Returns when the cursor is exhausted and every frame has
+ ** been delivered. Frames that fail to decode are delivered
+ ** too, with m_pMessage NULL.
+ **
+ ** @param[in]  pCursor         Frames to decode, filters applied.
+ **                             Only used on the calling thread.
+ ** @param[in]  pHandler        Gets decoded() on the workers and
+ **                             deliver() here, in frame order
+ **
+ *****************************************************************************/
+
+void
+CBatchDecoder::decode (
+  CCaptureCursor *              pCursor,
+  CBatchHandler *               pHandler)
+{
+    unsigned int                nChunk = 1u;
+    std::vector<SBatchChunk>    aChunk;
+    SBatchQueue                 Queue;
+    std::vector<std::thread>    aWorker;
+    unsigned int                iFill = 0;
+    unsigned int                iDeliver = 0;
+    bool                        bEnd = false;
+
+    if(1u < m_nThread)
+    {
+        nChunk = m_nThread * BATCH_CHUNKS_PER_THREAD;
+    }
+
+    aChunk.resize(nChunk);
+    for(unsigned int i = 0; i < nChunk; i++)
+    {
+        aChunk[i].aItem.resize(m_nFramePerChunk);
+        aChunk[i].nItem = 0;
+        aChunk[i].bDone = false;
+    }
+    Queue.bStop = false;
+
+    /*
+     * Workers take the oldest pending chunk, decode it
+     * and mark it done.
+     */
+    for(unsigned int i = 0; 1u < m_nThread && i < m_nThread; i++)
+    {
+        aWorker.push_back(std::thread([this, &Queue, pHandler]()
+        {
+            for(;;)
+            {
+                SBatchChunk *   pChunk;
+
+                {
+                    std::unique_lock<std::mutex> Lock(Queue.Mutex);
+
+                    while(Queue.Pending.empty() && !Queue.bStop)
+                    {
+                        Queue.WorkReady.wait(Lock);
+                    }
+                    if(Queue.Pending.empty())
+                    {
+                        break;
+                    }
+                    pChunk = Queue.Pending.front();
+                    Queue.Pending.pop_front();
+                }
+
+                for(unsigned int j = 0; j < pChunk->nItem; j++)
+                {
+                    decodeItem(&pChunk->aItem[j], pHandler);
+                }
+
+                {
+                    std::lock_guard<std::mutex> Lock(Queue.Mutex);
+
+                    pChunk->bDone = true;
+                }
+                Queue.ChunkDone.notify_all();
+            }
+        }));
+    }
+
+    for(;;)
+    {
+        SBatchChunk *           pChunk;
+
+        /*
+         * Keep the window full: fill the free chunks from
+         * the cursor and queue them for the workers.
+         */
+        while(!bEnd && iFill - iDeliver < nChunk)
+        {
+            pChunk = &aChunk[iFill % nChunk];
+            pChunk->nItem = 0;
+            pChunk->bDone = false;
+
+            while(pChunk->nItem < m_nFramePerChunk)
+            {
+                CBatchItem *    pItem = &pChunk->aItem[pChunk->nItem];
+
+                if(!pCursor->next(&pItem->m_Frame))
+                {
+                    bEnd = true;
+                    break;
+                }
+                pItem->m_pMessage = NULL;
+                pItem->m_ErrorDetails.clear();
+                pItem->m_Text.clear();
+                pChunk->nItem++;
+            }
+
+            if(0 == pChunk->nItem)
+            {
+                break;
+            }
+
+            if(aWorker.empty())
+            {
+                for(unsigned int j = 0; j < pChunk->nItem; j++)
+                {
+                    decodeItem(&pChunk->aItem[j], pHandler);
+                }
+                pChunk->bDone = true;
+            }
+            else
+            {
+                std::lock_guard<std::mutex> Lock(Queue.Mutex);
+
+                Queue.Pending.push_back(pChunk);
+                Queue.WorkReady.notify_one();
+            }
+            iFill++;
+        }
+
+        if(iDeliver == iFill)
+        {
+            break;
+        }
+
+        /*
+         * Deliver the oldest chunk once it's decoded.
+         */
+        pChunk = &aChunk[iDeliver % nChunk];
+        if(!aWorker.empty())
+        {
+            std::unique_lock<std::mutex> Lock(Queue.Mutex);
+
+            while(!pChunk->bDone)
+            {
+                Queue.ChunkDone.wait(Lock);
+            }
+        }
+
+        for(unsigned int j = 0; j < pChunk->nItem; j++)
+        {
+            CBatchItem *        pItem = &pChunk->aItem[j];
+
+            pHandler->deliver(pItem);
+            delete pItem->m_pMessage;
+            pItem->m_pMessage = NULL;
+        }
+        iDeliver++;
+    }
+
+    {
+        std::lock_guard<std::mutex> Lock(Queue.Mutex);
+
+        Queue.bStop = true;
+    }
+    Queue.WorkReady.notify_all();
+
+    for(unsigned int i = 0; i < aWorker.size(); i++)
+    {
+        aWorker[i].join();
+    }
+}
+
+void
+CBatchDecoder::decodeItem (
+  CBatchItem *                  pItem,
+  CBatchHandler *               pHandler) const
+{
+    /* The decoder only reads the frame, the mapping is read-only */
+    CFrameDecoder               MyFrameDecoder(m_pTypeRegistry,
+                                    (unsigned char *) pItem->m_Frame.m_pFrame,
+                                    pItem->m_Frame.m_nFrame);
+
+    pItem->m_pMessage = MyFrameDecoder.decodeMessage();
+    pItem->m_ErrorDetails = MyFrameDecoder.m_ErrorDetails;
+
+    pHandler->decoded(pItem);
+}
+
+}; /* namespace LLRP */
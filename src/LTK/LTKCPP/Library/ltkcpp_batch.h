@@ -0,0 +1,155 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+/**
+ *****************************************************************************
+ **
+ ** @file   ltkcpp_batch.h
+ **
+ ** @brief  Decode the frames of a capture file on several threads
+ **
+ ** Once a capture file has been indexed every frame's boundaries
+ ** are known and frames decode independently. CBatchDecoder
+ ** reads frames off a CCaptureCursor in chunks, decodes the
+ ** chunks on a pool of worker threads and hands the results
+ ** back on the calling thread in the original frame order.
+ **
+ ** Which LTKCPP objects may be used from several threads:
+ **
+ **   Shared, read-only, by any number of threads
+ **     - CTypeRegistry once enrollment is done, including the one
+ **       from getTheSharedTypeRegistry(). Lookups don't modify it.
+ **     - Type, field, enum, vendor and namespace descriptors.
+ **     - CCaptureReader once open() has returned.
+ **     - CFrameTemplate once compiled (instantiate() is const).
+ **
+ **   One thread at a time, may be handed between threads
+ **     - Messages and parameters (a whole element tree).
+ **       Pooled elements may be created on one thread and
+ **       deleted on another, see CElementPool.
+ **     - Encoders, decoders, sinks and CCaptureCursor.
+ **     - CConnection, CCaptureWriter.
+ **
+ ** Nothing in the library keeps static mutable state other than
+ ** the element pools, and those are per thread. Threads that
+ ** decode LTK-XML need xmlInitParser() called once beforehand,
+ ** as libxml2 requires.
+ **
+ *****************************************************************************/
+
+
+#include <string>
+
+
+namespace LLRP
+{
+
+class CBatchItem;
+class CBatchHandler;
+class CBatchDecoder;
+
+/*
+ * CBatchItem
+ *
+ * One frame and what became of it. m_pMessage is NULL when
+ * the decode failed and m_ErrorDetails says why. m_Text is
+ * for the handler, e.g. the message rendered as XML by a
+ * worker so the calling thread only has to write it out.
+ */
+class CBatchItem
+{
+  public:
+    CCaptureFrame               m_Frame;
+    CMessage *                  m_pMessage;
+    CErrorDetails               m_ErrorDetails;
+    std::string                 m_Text;
+};
+
+/*
+ * CBatchHandler
+ *
+ * decoded() runs on a worker thread right after each frame
+ * is decoded, possibly on several threads at once. It may
+ * do per-message work that is worth spreading out, like
+ * rendering m_Text, and may delete m_pMessage (set it NULL).
+ *
+ * deliver() runs on the thread that called decode(), once
+ * per frame, in frame order. A handler that keeps m_pMessage
+ * sets it to NULL; otherwise the message is deleted after
+ * deliver() returns.
+ */
+class CBatchHandler
+{
+  public:
+    virtual
+    ~CBatchHandler (void);
+
+    virtual void
+    decoded (
+      CBatchItem *              pItem);
+
+    virtual void
+    deliver (
+      CBatchItem *              pItem) = 0;
+};
+
+/*
+ * CBatchDecoder
+ *
+ * With one thread everything happens on the calling thread,
+ * no workers are started. With more, the calling thread fills
+ * chunks and delivers results while the workers decode; at
+ * most four chunks per worker are in flight, so memory use
+ * doesn't grow with the size of the capture.
+ */
+class CBatchDecoder
+{
+  public:
+    CBatchDecoder (
+      const CTypeRegistry *     pTypeRegistry);
+
+    void
+    setThreadCount (
+      unsigned int              nThread);
+
+    unsigned int
+    getThreadCount (void) const;
+
+    void
+    setChunkSize (
+      unsigned int              nFramePerChunk);
+
+    void
+    decode (
+      CCaptureCursor *          pCursor,
+      CBatchHandler *           pHandler);
+
+  private:
+    const CTypeRegistry *       m_pTypeRegistry;
+    unsigned int                m_nThread;
+    unsigned int                m_nFramePerChunk;
+
+    void
+    decodeItem (
+      CBatchItem *              pItem,
+      CBatchHandler *           pHandler) const;
+};
+
+}; /* namespace LLRP */
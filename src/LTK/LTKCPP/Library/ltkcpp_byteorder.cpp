@@ -0,0 +1,635 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+/**
+ *****************************************************************************
+ **
+ ** @file   ltkcpp_byteorder.cpp
+ **
+ ** @brief  Bulk byte order conversion for the vector field codecs
+ **
+ *****************************************************************************/
+
+
+#include <string.h>
+#include <atomic>
+
+#if defined(linux)
+#include <stdint.h>              // required for linux
+#endif
+
+/*
+ * The SIMD kernels are built for x86 only. GCC and clang
+ * compile each one for its instruction set with a target
+ * attribute, so the library itself needs no -m flags and
+ * still runs on CPUs without them. x86 is little endian,
+ * so there converting either way is the same byte swap.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LTKCPP_X86_SIMD
+#define LTKCPP_TARGET(Isa)  __attribute__((target(Isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define LTKCPP_X86_SIMD
+#define LTKCPP_TARGET(Isa)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#include "ltkcpp_platform.h"
+#include "ltkcpp_base.h"
+#include "ltkcpp_frame.h"
+
+
+namespace LLRP
+{
+
+typedef void    (*tConvertFunc) (
+                    void *              pDst,
+                    const void *        pSrc,
+                    unsigned int        nValue);
+
+struct SByteOrderKernel
+{
+    const char *                pName;
+
+    tConvertFunc                pfGetU16v;
+    tConvertFunc                pfGetU32v;
+    tConvertFunc                pfGetU64v;
+    tConvertFunc                pfPutU16v;
+    tConvertFunc                pfPutU32v;
+    tConvertFunc                pfPutU64v;
+};
+
+
+/*
+ * Portable kernels. These shift bytes exactly the way
+ * CFrameDecoder::next_uN() and CFrameEncoder::next_uN()
+ * do, so they are right whatever the host byte order.
+ */
+
+static void
+portableGetU16v (
+  void *                        pDst,
+  const void *                  pSrc,
+  unsigned int                  nValue)
+{
+    llrp_u16_t *                pValue = (llrp_u16_t *) pDst;
+    const llrp_byte_t *         pByte = (const llrp_byte_t *) pSrc;
+
+    for(unsigned int Ix = 0; Ix < nValue; Ix++, pByte += 2)
+    {
+        pValue[Ix] = (llrp_u16_t)((pByte[0] << 8u) | pByte[1]);
+    }
+}
+
+static void
+portableGetU32v (
+  void *                        pDst,
+  const void *                  pSrc,
+  unsigned int                  nValue)
+{
+    llrp_u32_t *                pValue = (llrp_u32_t *) pDst;
+    const llrp_byte_t *         pByte = (const llrp_byte_t *) pSrc;
+
+    for(unsigned int Ix = 0; Ix < nValue; Ix++, pByte += 4)
+    {
+        pValue[Ix] = ((llrp_u32_t)pByte[0] << 24u) |
+                     ((llrp_u32_t)pByte[1] << 16u) |
+                     ((llrp_u32_t)pByte[2] << 8u) |
+                     ((llrp_u32_t)pByte[3] << 0u);
+    }
+}
+
+static void
+portableGetU64v (
+  void *                        pDst,
+  const void *                  pSrc,
+  unsigned int                  nValue)
+{
+    llrp_u64_t *                pValue = (llrp_u64_t *) pDst;
+    const llrp_byte_t *         pByte = (const llrp_byte_t *) pSrc;
+
+    for(unsigned int Ix = 0; Ix < nValue; Ix++, pByte += 8)
+    {
+        llrp_u64_t              Value = 0;
+
+        for(unsigned int iByte = 0; iByte < 8u; iByte++)
+        {
+            Value <<= 8u;
+            Value |= pByte[iByte];
+        }
+        pValue[Ix] = Value;
+    }
+}
+
+static void
+portablePutU16v (
+  void *                        pDst,
+  const void *                  pSrc,
+  unsigned int                  nValue)
+{
+    llrp_byte_t *               pByte = (llrp_byte_t *) pDst;
+    const llrp_u16_t *          pValue = (const llrp_u16_t *) pSrc;
+
+    for(unsigned int Ix = 0; Ix < nValue; Ix++)
+    {
+        *pByte++ = (llrp_byte_t)(pValue[Ix] >> 8u);
+        *pByte++ = (llrp_byte_t)(pValue[Ix] >> 0u);
+    }
+}
+
+static void
+portablePutU32v (
+  void *                        pDst,
+  const void *                  pSrc,
+  unsigned int                  nValue)
+{
+    llrp_byte_t *               pByte = (llrp_byte_t *) pDst;
+    const llrp_u32_t *          pValue = (const llrp_u32_t *) pSrc;
+
+    for(unsigned int Ix = 0; Ix < nValue; Ix++)
+    {
+        *pByte++ = (llrp_byte_t)(pValue[Ix] >> 24u);
+        *pByte++ = (llrp_byte_t)(pValue[Ix] >> 16u);
+        *pByte++ = (llrp_byte_t)(pValue[Ix] >> 8u);
+        *pByte++ = (llrp_byte_t)(pValue[Ix] >> 0u);
+    }
+}
+
+static void
+portablePutU64v (
+  void *                        pDst,
+  const void *                  pSrc,
+  unsigned int                  nValue)
+{
+    llrp_byte_t *               pByte = (llrp_byte_t *) pDst;
+    const llrp_u64_t *          pValue = (const llrp_u64_t *) pSrc;
+
+    for(unsigned int Ix = 0; Ix < nValue; Ix++)
+    {
+        for(int iShift = 56; iShift >= 0; iShift -= 8)
+        {
+            *pByte++ = (llrp_byte_t)(pValue[Ix] >> iShift);
+        }
+    }
+}
+
+#ifdef LTKCPP_X86_SIMD
+
+/*
+ * Reverse the bytes of each nWidth byte element, the tail
+ * the vector loops leave over.
+ */
+static void
+swapTail (
+  llrp_byte_t *                 pDst,
+  const llrp_byte_t *           pSrc,
+  unsigned int                  nValue,
+  unsigned int                  nWidth)
+{
+    for(unsigned int Ix = 0; Ix < nValue; Ix++)
+    {
+        for(unsigned int iByte = 0; iByte < nWidth; iByte++)
+        {
+            pDst[iByte] = pSrc[nWidth - 1u - iByte];
+        }
+        pDst += nWidth;
+        pSrc += nWidth;
+    }
+}
+
+/*
+ * pshufb masks that reverse each 2, 4 or 8 byte element
+ * of a 16 byte block, named for the number of elements.
+ * _mm_set_epi8() takes its bytes from high to low.
+ */
+#define SWAP_MASK_8 \
+    14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1
+#define SWAP_MASK_4 \
+    12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3
+#define SWAP_MASK_2 \
+    8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7
+
+static LTKCPP_TARGET("ssse3") void
+swapSSSE3 (
+  void *                        pDst,
+  const void *                  pSrc,
+  unsigned int                  nValue,
+  unsigned int                  nWidth)
+{
+    llrp_byte_t *               pD = (llrp_byte_t *) pDst;
+    const llrp_byte_t *         pS = (const llrp_byte_t *) pSrc;
+    unsigned int                nByte = nValue * nWidth;
+    unsigned int                iByte = 0;
+    __m128i                     Mask;
+
+    switch(nWidth)
+    {
+    case 2u:
+        Mask = _mm_set_epi8(SWAP_MASK_8);
+        break;
+    case 4u:
+        Mask = _mm_set_epi8(SWAP_MASK_4);
+        break;
+    default:
+        Mask = _mm_set_epi8(SWAP_MASK_2);
+        break;
+    }
+
+    for(; iByte + 16u <= nByte; iByte += 16u)
+    {
+        __m128i                 Block;
+
+        Block = _mm_loadu_si128((const __m128i *)(pS + iByte));
+        Block = _mm_shuffle_epi8(Block, Mask);
+        _mm_storeu_si128((__m128i *)(pD + iByte), Block);
+    }
+
+    swapTail(pD + iByte, pS + iByte, (nByte - iByte) / nWidth, nWidth);
+}
+
+static LTKCPP_TARGET("avx2") void
+swapAVX2 (
+  void *                        pDst,
+  const void *                  pSrc,
+  unsigned int                  nValue,
+  unsigned int                  nWidth)
+{
+    llrp_byte_t *               pD = (llrp_byte_t *) pDst;
+    const llrp_byte_t *         pS = (const llrp_byte_t *) pSrc;
+    unsigned int                nByte = nValue * nWidth;
+    unsigned int                iByte = 0;
+    __m256i                     Mask;
+
+    /* vpshufb works within each 128 bit lane, same mask twice */
+    switch(nWidth)
+    {
+    case 2u:
+        Mask = _mm256_set_epi8(SWAP_MASK_8, SWAP_MASK_8);
+        break;
+    case 4u:
+        Mask = _mm256_set_epi8(SWAP_MASK_4, SWAP_MASK_4);
+        break;
+    default:
+        Mask = _mm256_set_epi8(SWAP_MASK_2, SWAP_MASK_2);
+        break;
+    }
+
+    for(; iByte + 32u <= nByte; iByte += 32u)
+    {
+        __m256i                 Block;
+
+        Block = _mm256_loadu_si256((const __m256i *)(pS + iByte));
+        Block = _mm256_shuffle_epi8(Block, Mask);
+        _mm256_storeu_si256((__m256i *)(pD + iByte), Block);
+    }
+
+    swapTail(pD + iByte, pS + iByte, (nByte - iByte) / nWidth, nWidth);
+}
+
+static void
+ssse3Swap16 (void *pDst, const void *pSrc, unsigned int nValue)
+{
+    swapSSSE3(pDst, pSrc, nValue, 2u);
+}
+
+static void
+ssse3Swap32 (void *pDst, const void *pSrc, unsigned int nValue)
+{
+    swapSSSE3(pDst, pSrc, nValue, 4u);
+}
+
+static void
+ssse3Swap64 (void *pDst, const void *pSrc, unsigned int nValue)
+{
+    swapSSSE3(pDst, pSrc, nValue, 8u);
+}
+
+static void
+avx2Swap16 (void *pDst, const void *pSrc, unsigned int nValue)
+{
+    swapAVX2(pDst, pSrc, nValue, 2u);
+}
+
+static void
+avx2Swap32 (void *pDst, const void *pSrc, unsigned int nValue)
+{
+    swapAVX2(pDst, pSrc, nValue, 4u);
+}
+
+static void
+avx2Swap64 (void *pDst, const void *pSrc, unsigned int nValue)
+{
+    swapAVX2(pDst, pSrc, nValue, 8u);
+}
+
+#endif /* LTKCPP_X86_SIMD */
+
+
+/*
+ * Indexed by CFrameByteOrder::EKernel. Kernels not built
+ * for this target use the portable functions and are
+ * never reported as supported.
+ */
+static const SByteOrderKernel
+s_aKernel[CFrameByteOrder::KERNEL_COUNT] =
+{
+    {
+        "portable",
+        portableGetU16v, portableGetU32v, portableGetU64v,
+        portablePutU16v, portablePutU32v, portablePutU64v,
+    },
+#ifdef LTKCPP_X86_SIMD
+    {
+        "ssse3",
+        ssse3Swap16, ssse3Swap32, ssse3Swap64,
+        ssse3Swap16, ssse3Swap32, ssse3Swap64,
+    },
+    {
+        "avx2",
+        avx2Swap16, avx2Swap32, avx2Swap64,
+        avx2Swap16, avx2Swap32, avx2Swap64,
+    },
+#else
+    {
+        "ssse3",
+        portableGetU16v, portableGetU32v, portableGetU64v,
+        portablePutU16v, portablePutU32v, portablePutU64v,
+    },
+    {
+        "avx2",
+        portableGetU16v, portableGetU32v, portableGetU64v,
+        portablePutU16v, portablePutU32v, portablePutU64v,
+    },
+#endif
+};
+
+/*
+ * NULL until the first conversion picks the best kernel
+ * the CPU has. Threads racing to do that all store the
+ * same pointer. The kernels are constant, so relaxed
+ * loads and stores are enough to share the pointer.
+ */
+static std::atomic<const SByteOrderKernel *> s_pKernel(NULL);
+
+static const SByteOrderKernel *
+currentKernel (void)
+{
+    const SByteOrderKernel *    pKernel;
+
+    pKernel = s_pKernel.load(std::memory_order_relaxed);
+    if(NULL == pKernel)
+    {
+        CFrameByteOrder::EKernel    eKernel;
+
+        if(CFrameByteOrder::isKernelSupported(CFrameByteOrder::KERNEL_AVX2))
+        {
+            eKernel = CFrameByteOrder::KERNEL_AVX2;
+        }
+        else if(CFrameByteOrder::isKernelSupported(
+                                        CFrameByteOrder::KERNEL_SSSE3))
+        {
+            eKernel = CFrameByteOrder::KERNEL_SSSE3;
+        }
+        else
+        {
+            eKernel = CFrameByteOrder::KERNEL_PORTABLE;
+        }
+        pKernel = &s_aKernel[eKernel];
+        s_pKernel.store(pKernel, std::memory_order_relaxed);
+    }
+
+    return pKernel;
+}
+
+
+void
+CFrameByteOrder::getU16v (
+  llrp_u16_t *                  pValue,
+  const llrp_byte_t *           pBuffer,
+  unsigned int                  nValue)
+{
+    (*currentKernel()->pfGetU16v)(pValue, pBuffer, nValue);
+}
+
+void
+CFrameByteOrder::getU32v (
+  llrp_u32_t *                  pValue,
+  const llrp_byte_t *           pBuffer,
+  unsigned int                  nValue)
+{
+    (*currentKernel()->pfGetU32v)(pValue, pBuffer, nValue);
+}
+
+void
+CFrameByteOrder::getU64v (
+  llrp_u64_t *                  pValue,
+  const llrp_byte_t *           pBuffer,
+  unsigned int                  nValue)
+{
+    (*currentKernel()->pfGetU64v)(pValue, pBuffer, nValue);
+}
+
+void
+CFrameByteOrder::putU16v (
+  llrp_byte_t *                 pBuffer,
+  const llrp_u16_t *            pValue,
+  unsigned int                  nValue)
+{
+    (*currentKernel()->pfPutU16v)(pBuffer, pValue, nValue);
+}
+
+void
+CFrameByteOrder::putU32v (
+  llrp_byte_t *                 pBuffer,
+  const llrp_u32_t *            pValue,
+  unsigned int                  nValue)
+{
+    (*currentKernel()->pfPutU32v)(pBuffer, pValue, nValue);
+}
+
+void
+CFrameByteOrder::putU64v (
+  llrp_byte_t *                 pBuffer,
+  const llrp_u64_t *            pValue,
+  unsigned int                  nValue)
+{
+    (*currentKernel()->pfPutU64v)(pBuffer, pValue, nValue);
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Get the kernel conversions are done with
+ **
+ ** @return     The kernel, chosen now if no conversion has
+ **             been done yet
+ **
+ *****************************************************************************/
+
+CFrameByteOrder::EKernel
+CFrameByteOrder::getKernel (void)
+{
+    return (EKernel)(currentKernel() - s_aKernel);
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Use a particular kernel from now on
+ **
+ ** @param[in]  eKernel         The kernel
+ **
+ ** @return     TRUE            The kernel is in use
+ **             FALSE           This CPU or build doesn't have it,
+ **                             the kernel in use is unchanged
+ **
+ *****************************************************************************/
+
+llrp_bool_t
+CFrameByteOrder::setKernel (
+  EKernel                       eKernel)
+{
+    if(!isKernelSupported(eKernel))
+    {
+        return FALSE;
+    }
+
+    s_pKernel.store(&s_aKernel[eKernel], std::memory_order_relaxed);
+
+    return TRUE;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Find out whether a kernel runs on this CPU
+ **
+ ** @param[in]  eKernel         The kernel
+ **
+ ** @return     TRUE            It is built in and the CPU (and for
+ **                             AVX2 the OS) supports it
+ **             FALSE           It isn't or eKernel is out of range
+ **
+ *****************************************************************************/
+
+llrp_bool_t
+CFrameByteOrder::isKernelSupported (
+  EKernel                       eKernel)
+{
+    switch(eKernel)
+    {
+    case KERNEL_PORTABLE:
+        return TRUE;
+
+#if defined(LTKCPP_X86_SIMD) && defined(__GNUC__)
+    case KERNEL_SSSE3:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("ssse3") ? TRUE : FALSE;
+
+    case KERNEL_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? TRUE : FALSE;
+#elif defined(LTKCPP_X86_SIMD)
+    case KERNEL_SSSE3:
+    {
+        int                     aInfo[4];
+
+        __cpuid(aInfo, 1);
+        return (aInfo[2] & (1 << 9)) ? TRUE : FALSE;
+    }
+
+    case KERNEL_AVX2:
+    {
+        int                     aInfo[4];
+
+        /* OSXSAVE and AVX, and the OS saves the YMM registers */
+        __cpuid(aInfo, 1);
+        if((aInfo[2] & (3 << 27)) != (3 << 27) ||
+           (_xgetbv(0) & 6u) != 6u)
+        {
+            return FALSE;
+        }
+        __cpuidex(aInfo, 7, 0);
+        return (aInfo[1] & (1 << 5)) ? TRUE : FALSE;
+    }
+#endif
+
+    default:
+        return FALSE;
+    }
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Get the name of a kernel, e.g. for a benchmark report
+ **
+ ** @param[in]  eKernel         The kernel
+ **
+ ** @return     "portable", "ssse3" or "avx2", "?" when out of range
+ **
+ *****************************************************************************/
+
+const char *
+CFrameByteOrder::getKernelName (
+  EKernel                       eKernel)
+{
+    if(0 > (int)eKernel || KERNEL_COUNT <= eKernel)
+    {
+        return "?";
+    }
+
+    return s_aKernel[eKernel].pName;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Find a kernel by the name getKernelName() gives it
+ **
+ ** @param[in]  pName           The name
+ ** @param[out] peKernel        The kernel, when found
+ **
+ ** @return     TRUE            Found
+ **             FALSE           No kernel has that name
+ **
+ *****************************************************************************/
+
+llrp_bool_t
+CFrameByteOrder::lookupKernel (
+  const char *                  pName,
+  EKernel *                     peKernel)
+{
+    for(int iKernel = 0; iKernel < KERNEL_COUNT; iKernel++)
+    {
+        if(0 == strcmp(pName, s_aKernel[iKernel].pName))
+        {
+            *peKernel = (EKernel)iKernel;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+}; /* namespace LLRP */
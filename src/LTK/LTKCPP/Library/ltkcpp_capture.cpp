@@ -0,0 +1,1244 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+/**
+ *****************************************************************************
+ **
+ ** @file   ltkcpp_capture.cpp
+ **
+ ** @brief  Writer, reader and cursor for LLRP capture files
+ **
+ ** See ltkcpp_capture.h for the file layout.
+ **
+ *****************************************************************************/
+
+
+#include <stdio.h>
+
+
+#if defined(linux) || defined(__APPLE__)
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#endif
+#ifdef WIN32
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#include "ltkcpp_platform.h"
+#include "ltkcpp_base.h"
+#include "ltkcpp_frame.h"
+#include "ltkcpp_capture.h"
+
+
+namespace LLRP
+{
+
+/* Sizes of the fixed parts of the file, see ltkcpp_capture.h */
+#define CAPTURE_HEADER_SIZE     32u
+#define CAPTURE_RECORD_SIZE     16u
+#define CAPTURE_INDEX_SIZE      168u
+#define CAPTURE_TRAILER_SIZE    32u
+#define CAPTURE_VERSION         1u
+
+/* Default block limits. The reader uses these when it rebuilds
+ * the index of a file that was never closed. */
+#define CAPTURE_BLOCK_FRAMES    4096u
+#define CAPTURE_BLOCK_BYTES     (4u*1024u*1024u)
+
+/* stdio buffer for the writer */
+#define CAPTURE_WRITE_BUF_SIZE  (256u*1024u)
+
+static const char       s_aHeaderMagic[8] =
+                            { 'L','L','R','P','C','A','P','T' };
+static const char       s_aTrailerMagic[8] =
+                            { 'L','L','R','P','C','I','D','X' };
+
+static llrp_u16_t
+getU16 (
+  const llrp_byte_t *           p)
+{
+    return (llrp_u16_t)((p[0] << 8u) | p[1]);
+}
+
+static llrp_u32_t
+getU32 (
+  const llrp_byte_t *           p)
+{
+    return ((llrp_u32_t)p[0] << 24u) | ((llrp_u32_t)p[1] << 16u) |
+           ((llrp_u32_t)p[2] << 8u)  | (llrp_u32_t)p[3];
+}
+
+static llrp_u64_t
+getU64 (
+  const llrp_byte_t *           p)
+{
+    return ((llrp_u64_t)getU32(p) << 32u) | getU32(p + 4);
+}
+
+static void
+putU16 (
+  llrp_byte_t *                 p,
+  llrp_u16_t                    Value)
+{
+    p[0] = (llrp_byte_t)(Value >> 8u);
+    p[1] = (llrp_byte_t)Value;
+}
+
+static void
+putU32 (
+  llrp_byte_t *                 p,
+  llrp_u32_t                    Value)
+{
+    p[0] = (llrp_byte_t)(Value >> 24u);
+    p[1] = (llrp_byte_t)(Value >> 16u);
+    p[2] = (llrp_byte_t)(Value >> 8u);
+    p[3] = (llrp_byte_t)Value;
+}
+
+static void
+putU64 (
+  llrp_byte_t *                 p,
+  llrp_u64_t                    Value)
+{
+    putU32(p, (llrp_u32_t)(Value >> 32u));
+    putU32(p + 4, (llrp_u32_t)Value);
+}
+
+/*
+ * Does a record of nRecord bytes go in a new block?
+ * The writer and the index rebuild must agree on this.
+ */
+static llrp_bool_t
+startsNewBlock (
+  const CCaptureBlock *         pBlock,
+  unsigned int                  nRecord,
+  unsigned int                  nMaxFrame,
+  unsigned int                  nMaxByte)
+{
+    if(0 == pBlock->m_nFrame)
+    {
+        return FALSE;
+    }
+
+    return pBlock->m_nFrame >= nMaxFrame ||
+           pBlock->m_nByte + nRecord > nMaxByte;
+}
+
+
+CCaptureBlock::CCaptureBlock (void)
+{
+    clear();
+}
+
+void
+CCaptureBlock::clear (void)
+{
+    memset(this, 0, sizeof *this);
+}
+
+void
+CCaptureBlock::noteFrame (
+  llrp_u64_t                    Timestamp,
+  llrp_u16_t                    MessageType)
+{
+    if(0 == m_nFrame || Timestamp < m_MinTimestamp)
+    {
+        m_MinTimestamp = Timestamp;
+    }
+    if(0 == m_nFrame || Timestamp > m_MaxTimestamp)
+    {
+        m_MaxTimestamp = Timestamp;
+    }
+
+    MessageType &= 0x3FFu;
+    m_aTypeMap[MessageType >> 3u] |= (llrp_u8_t)(1u << (MessageType & 7u));
+    m_nFrame++;
+}
+
+llrp_bool_t
+CCaptureBlock::hasMessageType (
+  llrp_u16_t                    MessageType) const
+{
+    MessageType &= 0x3FFu;
+    return 0 != (m_aTypeMap[MessageType >> 3u] & (1u << (MessageType & 7u)));
+}
+
+
+CCaptureWriter::CCaptureWriter (void)
+{
+    m_pFile = NULL;
+    m_Offset = 0;
+    m_nFrame = 0;
+    m_nMaxBlockFrame = CAPTURE_BLOCK_FRAMES;
+    m_nMaxBlockByte = CAPTURE_BLOCK_BYTES;
+}
+
+CCaptureWriter::~CCaptureWriter (void)
+{
+    close();
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Open a capture file for writing
+ **
+ ** With bAppend an existing capture is continued. Its index is
+ ** loaded (or rebuilt if it was never closed), the file is cut
+ ** back to the end of its last whole record and new frames go
+ ** after that. A file that exists but isn't a capture is left
+ ** alone and the open fails. A missing file is created either way.
+ **
+ ** @param[in]  pFileName       Path of the capture file
+ ** @param[in]  bAppend         TRUE to continue an existing capture,
+ **                             FALSE to start over
+ **
+ ** @return     RC_OK           Ready for appendFrame()
+ **             RC_MiscError    See m_ErrorDetails
+ **
+ *****************************************************************************/
+
+EResultCode
+CCaptureWriter::open (
+  const char *                  pFileName,
+  llrp_bool_t                   bAppend)
+{
+    CErrorDetails *             pError = &m_ErrorDetails;
+    FILE *                      pProbe = NULL;
+
+    pError->clear();
+
+    if(NULL != m_pFile)
+    {
+        pError->resultCodeAndWhatStr(RC_MiscError, "already open");
+        return pError->m_eResultCode;
+    }
+
+    m_Offset = 0;
+    m_nFrame = 0;
+    m_aBlock.clear();
+    m_CurBlock.clear();
+
+    if(bAppend)
+    {
+        pProbe = fopen(pFileName, "rb");
+    }
+
+    if(NULL != pProbe)
+    {
+        CCaptureReader          OldCapture;
+        int                     rc;
+
+        fclose(pProbe);
+
+        if(RC_OK != OldCapture.open(pFileName))
+        {
+            *pError = OldCapture.m_ErrorDetails;
+            return pError->m_eResultCode;
+        }
+
+        m_aBlock = OldCapture.m_aBlock;
+        m_nFrame = OldCapture.m_nFrame;
+        m_Offset = OldCapture.m_EndOfRecords;
+        OldCapture.close();
+
+        /*
+         * Drop the old index, or a partial record left
+         * by a capture that died, and append after the
+         * last whole record.
+         */
+#ifdef WIN32
+        {
+            int                 fd = _open(pFileName, _O_RDWR | _O_BINARY);
+
+            rc = -1;
+            if(0 <= fd)
+            {
+                rc = _chsize_s(fd, (__int64) m_Offset);
+                _close(fd);
+            }
+        }
+#else
+        rc = truncate(pFileName, (off_t) m_Offset);
+#endif
+        if(0 != rc)
+        {
+            pError->resultCodeAndWhatStr(RC_MiscError,
+                "can't truncate capture file");
+            return pError->m_eResultCode;
+        }
+
+        m_pFile = fopen(pFileName, "ab");
+        if(NULL == m_pFile)
+        {
+            pError->resultCodeAndWhatStr(RC_MiscError,
+                "can't open capture file");
+            return pError->m_eResultCode;
+        }
+        setvbuf(m_pFile, NULL, _IOFBF, CAPTURE_WRITE_BUF_SIZE);
+    }
+    else
+    {
+        llrp_byte_t             aHeader[CAPTURE_HEADER_SIZE];
+
+        m_pFile = fopen(pFileName, "wb");
+        if(NULL == m_pFile)
+        {
+            pError->resultCodeAndWhatStr(RC_MiscError,
+                "can't create capture file");
+            return pError->m_eResultCode;
+        }
+        setvbuf(m_pFile, NULL, _IOFBF, CAPTURE_WRITE_BUF_SIZE);
+
+        memset(aHeader, 0, sizeof aHeader);
+        memcpy(&aHeader[0], s_aHeaderMagic, 8u);
+        putU16(&aHeader[8], CAPTURE_VERSION);
+        putU16(&aHeader[10], CAPTURE_HEADER_SIZE);
+        putU64(&aHeader[16], getTimeNowUSec());
+
+        if(1u != fwrite(aHeader, sizeof aHeader, 1u, m_pFile))
+        {
+            return writeFailed();
+        }
+        m_Offset = CAPTURE_HEADER_SIZE;
+    }
+
+    return RC_OK;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Set when the writer starts a new block
+ **
+ ** Smaller blocks make seeks and filters skip more finely at
+ ** the cost of a bigger index. The defaults are 4096 frames or
+ ** 4MB, whichever comes first. The limits only affect blocks
+ ** started after the call.
+ **
+ ** @param[in]  nMaxFrame       Most frames in a block, >0
+ ** @param[in]  nMaxByte        Most record bytes in a block, a single
+ **                             bigger record still gets a block
+ **
+ *****************************************************************************/
+
+void
+CCaptureWriter::setBlockLimits (
+  unsigned int                  nMaxFrame,
+  unsigned int                  nMaxByte)
+{
+    m_nMaxBlockFrame = (0 == nMaxFrame) ? 1u : nMaxFrame;
+    m_nMaxBlockByte = nMaxByte;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Append one received frame
+ **
+ ** The frame must be exactly one whole LLRP frame, as checked
+ ** by CFrameExtract. It is copied into the stdio buffer, so the
+ ** caller may reuse its buffer right away.
+ **
+ ** @param[in]  pFrame          The frame
+ ** @param[in]  nFrame          Its length, must equal MessageLength
+ ** @param[in]  Timestamp       Receive time, usec since 1970
+ ** @param[in]  ReaderID        Which reader it came from
+ **
+ ** @return     RC_OK               Appended
+ **             RC_RecvFramingError Not an LLRP frame
+ **             RC_InvalidLength    Frame and nFrame disagree
+ **             RC_MiscError        Not open, or write failed
+ **
+ *****************************************************************************/
+
+EResultCode
+CCaptureWriter::appendFrame (
+  const llrp_byte_t *           pFrame,
+  unsigned int                  nFrame,
+  llrp_u64_t                    Timestamp,
+  llrp_u16_t                    ReaderID)
+{
+    CErrorDetails *             pError = &m_ErrorDetails;
+    CFrameExtract               MyFrameExtract(pFrame, nFrame);
+    llrp_byte_t                 aRecord[CAPTURE_RECORD_SIZE];
+    unsigned int                nRecord = CAPTURE_RECORD_SIZE + nFrame;
+
+    if(NULL == m_pFile)
+    {
+        pError->resultCodeAndWhatStr(RC_MiscError, "not open");
+        return pError->m_eResultCode;
+    }
+
+    if(CFrameExtract::READY != MyFrameExtract.m_eStatus &&
+       CFrameExtract::NEED_MORE != MyFrameExtract.m_eStatus)
+    {
+        pError->resultCodeAndWhatStr(RC_RecvFramingError,
+            "not an LLRP frame");
+        return pError->m_eResultCode;
+    }
+
+    if(MyFrameExtract.m_MessageLength != nFrame)
+    {
+        pError->resultCodeAndWhatStr(RC_InvalidLength,
+            "frame length does not match MessageLength");
+        return pError->m_eResultCode;
+    }
+
+    if(startsNewBlock(&m_CurBlock, nRecord,
+                      m_nMaxBlockFrame, m_nMaxBlockByte))
+    {
+        endBlock();
+    }
+
+    putU64(&aRecord[0], Timestamp);
+    putU16(&aRecord[8], ReaderID);
+    putU16(&aRecord[10], 0);
+    putU32(&aRecord[12], nFrame);
+
+    if(1u != fwrite(aRecord, sizeof aRecord, 1u, m_pFile) ||
+       1u != fwrite(pFrame, nFrame, 1u, m_pFile))
+    {
+        return writeFailed();
+    }
+
+    if(0 == m_CurBlock.m_nFrame)
+    {
+        m_CurBlock.m_Offset = m_Offset;
+        m_CurBlock.m_iFirstFrame = m_nFrame;
+    }
+    m_CurBlock.noteFrame(Timestamp, MyFrameExtract.m_MessageType);
+    m_CurBlock.m_nByte += nRecord;
+
+    m_Offset += nRecord;
+    m_nFrame++;
+
+    return RC_OK;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Push buffered records to the file
+ **
+ ** Records that are flushed survive the process dying. The
+ ** index only gets written by close().
+ **
+ *****************************************************************************/
+
+EResultCode
+CCaptureWriter::flush (void)
+{
+    if(NULL != m_pFile && 0 != fflush(m_pFile))
+    {
+        return writeFailed();
+    }
+
+    return RC_OK;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Write the index and trailer and close the file
+ **
+ ** Does nothing if not open.
+ **
+ *****************************************************************************/
+
+EResultCode
+CCaptureWriter::close (void)
+{
+    llrp_byte_t                 aEntry[CAPTURE_INDEX_SIZE];
+    llrp_byte_t                 aTrailer[CAPTURE_TRAILER_SIZE];
+    llrp_bool_t                 bFailed = FALSE;
+
+    if(NULL == m_pFile)
+    {
+        return RC_OK;
+    }
+
+    endBlock();
+
+    for(unsigned int i = 0; i < m_aBlock.size() && !bFailed; i++)
+    {
+        const CCaptureBlock *   pBlock = &m_aBlock[i];
+
+        putU64(&aEntry[0], pBlock->m_Offset);
+        putU64(&aEntry[8], pBlock->m_nByte);
+        putU32(&aEntry[16], pBlock->m_iFirstFrame);
+        putU32(&aEntry[20], pBlock->m_nFrame);
+        putU64(&aEntry[24], pBlock->m_MinTimestamp);
+        putU64(&aEntry[32], pBlock->m_MaxTimestamp);
+        memcpy(&aEntry[40], pBlock->m_aTypeMap, sizeof pBlock->m_aTypeMap);
+
+        bFailed = (1u != fwrite(aEntry, sizeof aEntry, 1u, m_pFile));
+    }
+
+    memset(aTrailer, 0, sizeof aTrailer);
+    memcpy(&aTrailer[0], s_aTrailerMagic, 8u);
+    putU64(&aTrailer[8], m_Offset);
+    putU32(&aTrailer[16], (llrp_u32_t) m_aBlock.size());
+    putU32(&aTrailer[20], m_nFrame);
+
+    if(!bFailed)
+    {
+        bFailed = (1u != fwrite(aTrailer, sizeof aTrailer, 1u, m_pFile));
+    }
+
+    if(0 != fclose(m_pFile))
+    {
+        bFailed = TRUE;
+    }
+    m_pFile = NULL;
+    m_aBlock.clear();
+
+    if(bFailed)
+    {
+        m_ErrorDetails.resultCodeAndWhatStr(RC_MiscError,
+            "capture index write failed");
+        return m_ErrorDetails.m_eResultCode;
+    }
+
+    return RC_OK;
+}
+
+llrp_bool_t
+CCaptureWriter::isOpen (void) const
+{
+    return NULL != m_pFile;
+}
+
+llrp_u32_t
+CCaptureWriter::getFrameCount (void) const
+{
+    return m_nFrame;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Wall clock time in the units of a capture timestamp
+ **
+ ** @return     usec since 1970
+ **
+ *****************************************************************************/
+
+llrp_u64_t
+CCaptureWriter::getTimeNowUSec (void)
+{
+#ifdef WIN32
+    FILETIME                    ft;
+    llrp_u64_t                  Now;
+
+    /* 100ns units since 1601 */
+    GetSystemTimeAsFileTime(&ft);
+    Now = ((llrp_u64_t) ft.dwHighDateTime << 32u) | ft.dwLowDateTime;
+    return (Now - 116444736000000000ull) / 10u;
+#else
+    struct timeval              tv;
+
+    gettimeofday(&tv, NULL);
+    return (llrp_u64_t) tv.tv_sec * 1000000u + tv.tv_usec;
+#endif
+}
+
+void
+CCaptureWriter::endBlock (void)
+{
+    if(0 != m_CurBlock.m_nFrame)
+    {
+        m_aBlock.push_back(m_CurBlock);
+        m_CurBlock.clear();
+    }
+}
+
+EResultCode
+CCaptureWriter::writeFailed (void)
+{
+    m_ErrorDetails.resultCodeAndWhatStr(RC_MiscError,
+        "capture write failed");
+    return m_ErrorDetails.m_eResultCode;
+}
+
+
+CCaptureReader::CCaptureReader (void)
+{
+    m_pMap = NULL;
+    m_nMap = 0;
+    m_nFrame = 0;
+    m_EndOfRecords = 0;
+    m_bIndexed = FALSE;
+}
+
+CCaptureReader::~CCaptureReader (void)
+{
+    close();
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Map a capture file and load its index
+ **
+ ** The index written by CCaptureWriter::close() is used when it
+ ** checks out. Otherwise the records are walked, each checked
+ ** with CFrameExtract, and the index is rebuilt in memory. The
+ ** walk stops at the first record that is cut short or does not
+ ** hold a frame; everything before it is readable.
+ **
+ ** @param[in]  pFileName       Path of the capture file
+ **
+ ** @return     RC_OK           Ready
+ **             RC_MiscError    Can't map it or not a capture file.
+ **                             See m_ErrorDetails.
+ **
+ *****************************************************************************/
+
+EResultCode
+CCaptureReader::open (
+  const char *                  pFileName)
+{
+    CErrorDetails *             pError = &m_ErrorDetails;
+
+    close();
+    pError->clear();
+
+    if(RC_OK != mapFile(pFileName))
+    {
+        return pError->m_eResultCode;
+    }
+
+    if(CAPTURE_HEADER_SIZE > m_nMap ||
+       0 != memcmp(m_pMap, s_aHeaderMagic, 8u) ||
+       CAPTURE_VERSION != getU16(&m_pMap[8]) ||
+       CAPTURE_HEADER_SIZE != getU16(&m_pMap[10]))
+    {
+        close();
+        pError->resultCodeAndWhatStr(RC_MiscError, "not a capture file");
+        return pError->m_eResultCode;
+    }
+
+    if(loadIndex())
+    {
+        m_bIndexed = TRUE;
+        return RC_OK;
+    }
+
+    return scanRecords();
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Unmap the file
+ **
+ ** Frames handed out earlier are no longer valid.
+ **
+ *****************************************************************************/
+
+void
+CCaptureReader::close (void)
+{
+    if(NULL != m_pMap)
+    {
+#ifdef WIN32
+        UnmapViewOfFile((LPCVOID) m_pMap);
+#else
+        munmap((void *) m_pMap, (size_t) m_nMap);
+#endif
+    }
+
+    m_pMap = NULL;
+    m_nMap = 0;
+    m_aBlock.clear();
+    m_nFrame = 0;
+    m_EndOfRecords = 0;
+    m_bIndexed = FALSE;
+}
+
+llrp_u32_t
+CCaptureReader::getFrameCount (void) const
+{
+    return m_nFrame;
+}
+
+unsigned int
+CCaptureReader::getBlockCount (void) const
+{
+    return (unsigned int) m_aBlock.size();
+}
+
+const CCaptureBlock *
+CCaptureReader::getBlock (
+  unsigned int                  iBlock) const
+{
+    if(iBlock >= m_aBlock.size())
+    {
+        return NULL;
+    }
+
+    return &m_aBlock[iBlock];
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Did the index come from the file?
+ **
+ ** @return     TRUE            Read from the file's index
+ **             FALSE           Rebuilt, the file was never closed
+ **
+ *****************************************************************************/
+
+llrp_bool_t
+CCaptureReader::isIndexed (void) const
+{
+    return m_bIndexed;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Get frame number iFrame
+ **
+ ** Finds the block in the index, then walks that block's
+ ** records. Frames are numbered from 0 in file order.
+ **
+ ** @param[in]  iFrame          Frame number
+ ** @param[out] pFrame          The frame, pointing into the mapping
+ **
+ ** @return     TRUE            Got it
+ **             FALSE           No such frame
+ **
+ *****************************************************************************/
+
+llrp_bool_t
+CCaptureReader::getFrame (
+  llrp_u32_t                    iFrame,
+  CCaptureFrame *               pFrame) const
+{
+    unsigned int                iLo = 0;
+    unsigned int                iHi = (unsigned int) m_aBlock.size();
+    const CCaptureBlock *       pBlock;
+    llrp_u64_t                  Offset;
+
+    if(iFrame >= m_nFrame)
+    {
+        return FALSE;
+    }
+
+    /* Last block whose first frame is <= iFrame */
+    while(iHi - iLo > 1u)
+    {
+        unsigned int            iMid = (iLo + iHi) / 2u;
+
+        if(m_aBlock[iMid].m_iFirstFrame <= iFrame)
+        {
+            iLo = iMid;
+        }
+        else
+        {
+            iHi = iMid;
+        }
+    }
+
+    pBlock = &m_aBlock[iLo];
+    Offset = pBlock->m_Offset;
+    for(llrp_u32_t i = pBlock->m_iFirstFrame; ; i++)
+    {
+        Offset = readRecord(Offset, pFrame);
+        if(0 == Offset)
+        {
+            return FALSE;
+        }
+        if(i == iFrame)
+        {
+            pFrame->m_iFrame = iFrame;
+            return TRUE;
+        }
+    }
+}
+
+EResultCode
+CCaptureReader::mapFile (
+  const char *                  pFileName)
+{
+    CErrorDetails *             pError = &m_ErrorDetails;
+
+#ifdef WIN32
+    HANDLE                      hFile;
+    HANDLE                      hMapping;
+    LARGE_INTEGER               Size;
+
+    hFile = CreateFileA(pFileName, GENERIC_READ,
+                FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(INVALID_HANDLE_VALUE == hFile)
+    {
+        pError->resultCodeAndWhatStr(RC_MiscError,
+            "can't open capture file");
+        return pError->m_eResultCode;
+    }
+
+    if(!GetFileSizeEx(hFile, &Size) || 0 == Size.QuadPart)
+    {
+        CloseHandle(hFile);
+        pError->resultCodeAndWhatStr(RC_MiscError, "not a capture file");
+        return pError->m_eResultCode;
+    }
+
+    hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(NULL != hMapping)
+    {
+        m_pMap = (const llrp_byte_t *)
+                        MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(hMapping);
+    }
+    CloseHandle(hFile);
+
+    if(NULL == m_pMap)
+    {
+        pError->resultCodeAndWhatStr(RC_MiscError,
+            "can't map capture file");
+        return pError->m_eResultCode;
+    }
+    m_nMap = Size.QuadPart;
+#else
+    struct stat                 st;
+    void *                      pMap;
+    int                         fd;
+
+    fd = ::open(pFileName, O_RDONLY);
+    if(0 > fd)
+    {
+        pError->resultCodeAndWhatStr(RC_MiscError,
+            "can't open capture file");
+        return pError->m_eResultCode;
+    }
+
+    if(0 != fstat(fd, &st) || 0 == st.st_size)
+    {
+        ::close(fd);
+        pError->resultCodeAndWhatStr(RC_MiscError, "not a capture file");
+        return pError->m_eResultCode;
+    }
+
+    pMap = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if(MAP_FAILED == pMap)
+    {
+        pError->resultCodeAndWhatStr(RC_MiscError,
+            "can't map capture file");
+        return pError->m_eResultCode;
+    }
+    m_pMap = (const llrp_byte_t *) pMap;
+    m_nMap = (llrp_u64_t) st.st_size;
+#endif
+
+    return RC_OK;
+}
+
+/*
+ * Read the index at the end of the file. Every entry must
+ * line up with the one before it and the trailer must agree,
+ * else the file is treated as not closed.
+ */
+llrp_bool_t
+CCaptureReader::loadIndex (void)
+{
+    const llrp_byte_t *         pTrailer;
+    llrp_u64_t                  IndexOffset;
+    llrp_u32_t                  nBlock;
+    llrp_u32_t                  nFrame;
+    llrp_u64_t                  Offset = CAPTURE_HEADER_SIZE;
+    llrp_u32_t                  iFrame = 0;
+
+    if(CAPTURE_HEADER_SIZE + CAPTURE_TRAILER_SIZE > m_nMap)
+    {
+        return FALSE;
+    }
+
+    pTrailer = &m_pMap[m_nMap - CAPTURE_TRAILER_SIZE];
+    if(0 != memcmp(pTrailer, s_aTrailerMagic, 8u))
+    {
+        return FALSE;
+    }
+
+    IndexOffset = getU64(&pTrailer[8]);
+    nBlock = getU32(&pTrailer[16]);
+    nFrame = getU32(&pTrailer[20]);
+
+    if(IndexOffset < CAPTURE_HEADER_SIZE ||
+       IndexOffset + (llrp_u64_t) nBlock * CAPTURE_INDEX_SIZE +
+            CAPTURE_TRAILER_SIZE != m_nMap)
+    {
+        return FALSE;
+    }
+
+    m_aBlock.resize(nBlock);
+    for(llrp_u32_t i = 0; i < nBlock; i++)
+    {
+        const llrp_byte_t *     pEntry;
+        CCaptureBlock *         pBlock = &m_aBlock[i];
+
+        pEntry = &m_pMap[IndexOffset + (llrp_u64_t) i * CAPTURE_INDEX_SIZE];
+
+        pBlock->m_Offset = getU64(&pEntry[0]);
+        pBlock->m_nByte = getU64(&pEntry[8]);
+        pBlock->m_iFirstFrame = getU32(&pEntry[16]);
+        pBlock->m_nFrame = getU32(&pEntry[20]);
+        pBlock->m_MinTimestamp = getU64(&pEntry[24]);
+        pBlock->m_MaxTimestamp = getU64(&pEntry[32]);
+        memcpy(pBlock->m_aTypeMap, &pEntry[40], sizeof pBlock->m_aTypeMap);
+
+        if(pBlock->m_Offset != Offset || pBlock->m_iFirstFrame != iFrame ||
+           0 == pBlock->m_nFrame || pBlock->m_nByte > IndexOffset - Offset)
+        {
+            m_aBlock.clear();
+            return FALSE;
+        }
+
+        Offset += pBlock->m_nByte;
+        iFrame += pBlock->m_nFrame;
+    }
+
+    if(Offset != IndexOffset || iFrame != nFrame)
+    {
+        m_aBlock.clear();
+        return FALSE;
+    }
+
+    m_nFrame = nFrame;
+    m_EndOfRecords = IndexOffset;
+
+    return TRUE;
+}
+
+/*
+ * Rebuild the index by walking the records, for a file that
+ * was never closed.
+ */
+EResultCode
+CCaptureReader::scanRecords (void)
+{
+    CCaptureBlock               CurBlock;
+    CCaptureFrame               Frame;
+    llrp_u64_t                  Offset = CAPTURE_HEADER_SIZE;
+
+    m_aBlock.clear();
+    m_nFrame = 0;
+    m_EndOfRecords = m_nMap;
+
+    for(;;)
+    {
+        llrp_u64_t              NextOffset = readRecord(Offset, &Frame);
+        unsigned int            nRecord;
+
+        if(0 == NextOffset)
+        {
+            break;
+        }
+        nRecord = (unsigned int)(NextOffset - Offset);
+
+        if(startsNewBlock(&CurBlock, nRecord,
+                          CAPTURE_BLOCK_FRAMES, CAPTURE_BLOCK_BYTES))
+        {
+            m_aBlock.push_back(CurBlock);
+            CurBlock.clear();
+        }
+
+        if(0 == CurBlock.m_nFrame)
+        {
+            CurBlock.m_Offset = Offset;
+            CurBlock.m_iFirstFrame = m_nFrame;
+        }
+        CurBlock.noteFrame(Frame.m_Timestamp, Frame.m_MessageType);
+        CurBlock.m_nByte += nRecord;
+
+        m_nFrame++;
+        Offset = NextOffset;
+    }
+
+    if(0 != CurBlock.m_nFrame)
+    {
+        m_aBlock.push_back(CurBlock);
+    }
+
+    m_EndOfRecords = Offset;
+    m_bIndexed = FALSE;
+
+    return RC_OK;
+}
+
+/*
+ * Decode the record at Offset. Returns the offset of the next
+ * record, or 0 if there isn't a whole, sane record at Offset.
+ * Doesn't set m_iFrame, the caller knows it.
+ */
+llrp_u64_t
+CCaptureReader::readRecord (
+  llrp_u64_t                    Offset,
+  CCaptureFrame *               pFrame) const
+{
+    const llrp_byte_t *         pRecord;
+    llrp_u32_t                  nFrame;
+
+    if(Offset > m_EndOfRecords ||
+       CAPTURE_RECORD_SIZE > m_EndOfRecords - Offset)
+    {
+        return 0;
+    }
+
+    pRecord = &m_pMap[Offset];
+    nFrame = getU32(&pRecord[12]);
+
+    if(nFrame > m_EndOfRecords - Offset - CAPTURE_RECORD_SIZE)
+    {
+        return 0;
+    }
+
+    CFrameExtract               MyFrameExtract(
+                                    &pRecord[CAPTURE_RECORD_SIZE], nFrame);
+
+    if(CFrameExtract::READY != MyFrameExtract.m_eStatus ||
+       MyFrameExtract.m_MessageLength != nFrame)
+    {
+        return 0;
+    }
+
+    pFrame->m_pFrame = &pRecord[CAPTURE_RECORD_SIZE];
+    pFrame->m_nFrame = nFrame;
+    pFrame->m_Timestamp = getU64(&pRecord[0]);
+    pFrame->m_ReaderID = getU16(&pRecord[8]);
+    pFrame->m_MessageType = MyFrameExtract.m_MessageType;
+    pFrame->m_MessageID = MyFrameExtract.m_MessageID;
+
+    return Offset + CAPTURE_RECORD_SIZE + nFrame;
+}
+
+
+CCaptureCursor::CCaptureCursor (
+  const CCaptureReader *        pReader)
+{
+    m_pReader = pReader;
+    m_FromTimestamp = 0;
+    m_ToTimestamp = ~(llrp_u64_t)0;
+    m_bTypeFilter = FALSE;
+    memset(m_aTypeMap, 0, sizeof m_aTypeMap);
+    seekFrame(0);
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Only return frames received in [From, To]
+ **
+ ** @param[in]  FromTimestamp   Earliest, usec since 1970, inclusive
+ ** @param[in]  ToTimestamp     Latest, usec since 1970, inclusive
+ **
+ *****************************************************************************/
+
+void
+CCaptureCursor::setTimeRange (
+  llrp_u64_t                    FromTimestamp,
+  llrp_u64_t                    ToTimestamp)
+{
+    m_FromTimestamp = FromTimestamp;
+    m_ToTimestamp = ToTimestamp;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Only return frames of the given message types
+ **
+ ** Call once per type. With no calls every type is returned.
+ **
+ ** @param[in]  MessageType     LLRP message type number, e.g. 61
+ **                             for RO_ACCESS_REPORT
+ **
+ *****************************************************************************/
+
+void
+CCaptureCursor::addMessageType (
+  llrp_u16_t                    MessageType)
+{
+    MessageType &= 0x3FFu;
+    m_aTypeMap[MessageType >> 3u] |= (llrp_u8_t)(1u << (MessageType & 7u));
+    m_bTypeFilter = TRUE;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Continue from frame number iFrame
+ **
+ ** Past the last frame the cursor is at the end.
+ **
+ *****************************************************************************/
+
+void
+CCaptureCursor::seekFrame (
+  llrp_u32_t                    iFrame)
+{
+    const CCaptureBlock *       pBlock;
+    CCaptureFrame               Frame;
+
+    m_iBlock = 0;
+    m_iFrame = 0;
+    m_Offset = 0;
+
+    while(NULL != (pBlock = m_pReader->getBlock(m_iBlock)) &&
+          pBlock->m_iFirstFrame + pBlock->m_nFrame <= iFrame)
+    {
+        m_iBlock++;
+    }
+
+    if(NULL == pBlock)
+    {
+        return;
+    }
+
+    m_iFrame = pBlock->m_iFirstFrame;
+    m_Offset = pBlock->m_Offset;
+    while(m_iFrame < iFrame)
+    {
+        m_Offset = m_pReader->readRecord(m_Offset, &Frame);
+        if(0 == m_Offset)
+        {
+            /* Damaged, treat as the end */
+            m_iBlock = m_pReader->getBlockCount();
+            return;
+        }
+        m_iFrame++;
+    }
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Get the next frame that passes the filters
+ **
+ ** @param[out] pFrame          The frame, pointing into the
+ **                             reader's mapping
+ **
+ ** @return     TRUE            Got one
+ **             FALSE           No more
+ **
+ *****************************************************************************/
+
+llrp_bool_t
+CCaptureCursor::next (
+  CCaptureFrame *               pFrame)
+{
+    for(;;)
+    {
+        const CCaptureBlock *   pBlock = m_pReader->getBlock(m_iBlock);
+
+        if(NULL == pBlock)
+        {
+            return FALSE;
+        }
+
+        if(m_iFrame >= pBlock->m_iFirstFrame + pBlock->m_nFrame ||
+           !blockMatches(pBlock))
+        {
+            /* Done with this block, or nothing in it for us */
+            m_iBlock++;
+            pBlock = m_pReader->getBlock(m_iBlock);
+            if(NULL != pBlock)
+            {
+                m_iFrame = pBlock->m_iFirstFrame;
+                m_Offset = pBlock->m_Offset;
+            }
+            continue;
+        }
+
+        m_Offset = m_pReader->readRecord(m_Offset, pFrame);
+        if(0 == m_Offset)
+        {
+            m_iBlock = m_pReader->getBlockCount();
+            return FALSE;
+        }
+        pFrame->m_iFrame = m_iFrame++;
+
+        if(frameMatches(pFrame))
+        {
+            return TRUE;
+        }
+    }
+}
+
+llrp_bool_t
+CCaptureCursor::blockMatches (
+  const CCaptureBlock *         pBlock) const
+{
+    if(pBlock->m_MaxTimestamp < m_FromTimestamp ||
+       pBlock->m_MinTimestamp > m_ToTimestamp)
+    {
+        return FALSE;
+    }
+
+    if(m_bTypeFilter)
+    {
+        for(unsigned int i = 0; i < sizeof m_aTypeMap; i++)
+        {
+            if(0 != (pBlock->m_aTypeMap[i] & m_aTypeMap[i]))
+            {
+                return TRUE;
+            }
+        }
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+llrp_bool_t
+CCaptureCursor::frameMatches (
+  const CCaptureFrame *         pFrame) const
+{
+    llrp_u16_t                  MessageType = pFrame->m_MessageType;
+
+    if(pFrame->m_Timestamp < m_FromTimestamp ||
+       pFrame->m_Timestamp > m_ToTimestamp)
+    {
+        return FALSE;
+    }
+
+    if(m_bTypeFilter &&
+       0 == (m_aTypeMap[MessageType >> 3u] & (1u << (MessageType & 7u))))
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+}; /* namespace LLRP */
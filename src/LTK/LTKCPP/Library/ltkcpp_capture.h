@@ -0,0 +1,328 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+/**
+ *****************************************************************************
+ **
+ ** @file   ltkcpp_capture.h
+ **
+ ** @brief  Indexed capture files of received LLRP frames
+ **
+ ** A capture file holds LLRP frames exactly as they came off the
+ ** wire, each with its receive time and the ID of the reader it
+ ** came from. Frames are grouped in blocks. Each block has an
+ ** index entry with the block's time range and a bitmap of the
+ ** message types in it, so seeking by time or picking out a few
+ ** message types skips whole blocks without touching them.
+ **
+ ** All integers are big-endian, same as LLRP itself.
+ **
+ **     File header (32 bytes)
+ **         "LLRPCAPT"          magic
+ **         u16                 version, 1
+ **         u16                 header length, 32
+ **         u32                 reserved, 0
+ **         u64                 creation time, usec since 1970
+ **         u64                 reserved, 0
+ **
+ **     Record, repeated (16 bytes + frame)
+ **         u64                 receive time, usec since 1970
+ **         u16                 reader ID
+ **         u16                 reserved, 0
+ **         u32                 frame length, same as MessageLength
+ **         frame               the LLRP frame
+ **
+ **     Index entry, one per block (168 bytes)
+ **         u64                 file offset of the block's first record
+ **         u64                 bytes of records in the block
+ **         u32                 frame number of the first frame
+ **         u32                 frame count
+ **         u64                 earliest receive time
+ **         u64                 latest receive time
+ **         u8[128]             message type bitmap, bit (T%8) of
+ **                             byte (T/8) set if type T is present
+ **
+ **     Trailer (32 bytes)
+ **         "LLRPCIDX"          magic
+ **         u64                 file offset of the first index entry
+ **         u32                 block count
+ **         u32                 frame count
+ **         u64                 reserved, 0
+ **
+ ** The index and trailer are written by CCaptureWriter::close().
+ ** A file that was never closed (the capture died) has records
+ ** only. CCaptureReader then rebuilds the index by walking the
+ ** records and ignores a partial record at the end.
+ ** Opening a closed file for append strips the index and
+ ** rewrites it at the next close.
+ **
+ *****************************************************************************/
+
+
+#include <stdio.h>
+
+
+namespace LLRP
+{
+
+class CCaptureBlock;
+class CCaptureFrame;
+class CCaptureWriter;
+class CCaptureReader;
+class CCaptureCursor;
+
+/*
+ * CCaptureBlock
+ *
+ * The in-memory form of an index entry.
+ */
+class CCaptureBlock
+{
+  public:
+    llrp_u64_t                  m_Offset;
+    llrp_u64_t                  m_nByte;
+    llrp_u32_t                  m_iFirstFrame;
+    llrp_u32_t                  m_nFrame;
+    llrp_u64_t                  m_MinTimestamp;
+    llrp_u64_t                  m_MaxTimestamp;
+    llrp_u8_t                   m_aTypeMap[128];
+
+    CCaptureBlock (void);
+
+    void
+    clear (void);
+
+    void
+    noteFrame (
+      llrp_u64_t                Timestamp,
+      llrp_u16_t                MessageType);
+
+    llrp_bool_t
+    hasMessageType (
+      llrp_u16_t                MessageType) const;
+};
+
+/*
+ * CCaptureFrame
+ *
+ * One frame of a capture. m_pFrame points into the reader's
+ * mapping of the file and is good until the reader is closed.
+ * Nothing is copied.
+ */
+class CCaptureFrame
+{
+  public:
+    const llrp_byte_t *         m_pFrame;
+    unsigned int                m_nFrame;
+    llrp_u32_t                  m_iFrame;
+    llrp_u64_t                  m_Timestamp;
+    llrp_u16_t                  m_ReaderID;
+    llrp_u16_t                  m_MessageType;
+    llrp_u32_t                  m_MessageID;
+};
+
+/*
+ * CCaptureWriter
+ *
+ * Appends frames to a capture file through a stdio buffer,
+ * so appendFrame() during a live capture is a memcpy most
+ * of the time. Every frame is checked with CFrameExtract
+ * before it is written. A new block is started when the
+ * current one reaches the frame or byte limit.
+ */
+class CCaptureWriter
+{
+  public:
+    /** @brief Why the last operation failed */
+    CErrorDetails               m_ErrorDetails;
+
+    CCaptureWriter (void);
+
+    ~CCaptureWriter (void);
+
+    EResultCode
+    open (
+      const char *              pFileName,
+      llrp_bool_t               bAppend);
+
+    void
+    setBlockLimits (
+      unsigned int              nMaxFrame,
+      unsigned int              nMaxByte);
+
+    EResultCode
+    appendFrame (
+      const llrp_byte_t *       pFrame,
+      unsigned int              nFrame,
+      llrp_u64_t                Timestamp,
+      llrp_u16_t                ReaderID);
+
+    EResultCode
+    flush (void);
+
+    EResultCode
+    close (void);
+
+    llrp_bool_t
+    isOpen (void) const;
+
+    llrp_u32_t
+    getFrameCount (void) const;
+
+    static llrp_u64_t
+    getTimeNowUSec (void);
+
+  private:
+    FILE *                      m_pFile;
+    llrp_u64_t                  m_Offset;
+    llrp_u32_t                  m_nFrame;
+    std::vector<CCaptureBlock>  m_aBlock;
+    CCaptureBlock               m_CurBlock;
+    unsigned int                m_nMaxBlockFrame;
+    unsigned int                m_nMaxBlockByte;
+
+    void
+    endBlock (void);
+
+    EResultCode
+    writeFailed (void);
+};
+
+/*
+ * CCaptureReader
+ *
+ * Maps a capture file read-only and serves frames straight
+ * out of the mapping. Once open() has returned the reader
+ * is not changed by lookups, so any number of cursors in
+ * any number of threads can share it.
+ */
+class CCaptureReader
+{
+    friend class CCaptureCursor;
+    friend class CCaptureWriter;
+
+  public:
+    /** @brief Why open() failed */
+    CErrorDetails               m_ErrorDetails;
+
+    CCaptureReader (void);
+
+    ~CCaptureReader (void);
+
+    EResultCode
+    open (
+      const char *              pFileName);
+
+    void
+    close (void);
+
+    llrp_u32_t
+    getFrameCount (void) const;
+
+    unsigned int
+    getBlockCount (void) const;
+
+    const CCaptureBlock *
+    getBlock (
+      unsigned int              iBlock) const;
+
+    llrp_bool_t
+    isIndexed (void) const;
+
+    llrp_bool_t
+    getFrame (
+      llrp_u32_t                iFrame,
+      CCaptureFrame *           pFrame) const;
+
+  private:
+    const llrp_byte_t *         m_pMap;
+    llrp_u64_t                  m_nMap;
+    std::vector<CCaptureBlock>  m_aBlock;
+    llrp_u32_t                  m_nFrame;
+    llrp_u64_t                  m_EndOfRecords;
+    llrp_bool_t                 m_bIndexed;
+
+    EResultCode
+    mapFile (
+      const char *              pFileName);
+
+    llrp_bool_t
+    loadIndex (void);
+
+    EResultCode
+    scanRecords (void);
+
+    llrp_u64_t
+    readRecord (
+      llrp_u64_t                Offset,
+      CCaptureFrame *           pFrame) const;
+};
+
+/*
+ * CCaptureCursor
+ *
+ * Walks the frames of a reader in file order, optionally
+ * only those received within a time range and/or of a set
+ * of message types. Blocks that can't hold a match are
+ * skipped on their index entry alone.
+ */
+class CCaptureCursor
+{
+  public:
+    CCaptureCursor (
+      const CCaptureReader *    pReader);
+
+    void
+    setTimeRange (
+      llrp_u64_t                FromTimestamp,
+      llrp_u64_t                ToTimestamp);
+
+    void
+    addMessageType (
+      llrp_u16_t                MessageType);
+
+    void
+    seekFrame (
+      llrp_u32_t                iFrame);
+
+    llrp_bool_t
+    next (
+      CCaptureFrame *           pFrame);
+
+  private:
+    const CCaptureReader *      m_pReader;
+    llrp_u64_t                  m_FromTimestamp;
+    llrp_u64_t                  m_ToTimestamp;
+    llrp_bool_t                 m_bTypeFilter;
+    llrp_u8_t                   m_aTypeMap[128];
+    unsigned int                m_iBlock;
+    llrp_u32_t                  m_iFrame;
+    llrp_u64_t                  m_Offset;
+
+    llrp_bool_t
+    blockMatches (
+      const CCaptureBlock *     pBlock) const;
+
+    llrp_bool_t
+    frameMatches (
+      const CCaptureFrame *     pFrame) const;
+};
+
+}; /* namespace LLRP */
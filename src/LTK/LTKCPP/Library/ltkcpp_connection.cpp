@@ -65,6 +65,7 @@
 #include "ltkcpp_platform.h"
 #include "ltkcpp_base.h"
 #include "ltkcpp_frame.h"
+#include "ltkcpp_capture.h"
 #include "ltkcpp_connection.h"
 
 
@@ -165,6 +166,9 @@ CConnection::CConnection (
     m_pPlatformSocket = NULL;
     m_pTypeRegistry = pTypeRegistry;
     m_nBufferSize = nBufferSize;
+    m_pCaptureWriter = NULL;
+    m_CaptureReaderID = 0;
+    m_eDecodeStrictness = CFrameDecoder::DECODE_STRICT;
 
     memset(&m_Recv, 0, sizeof m_Recv);
     memset(&m_Send, 0, sizeof m_Send);
@@ -547,7 +551,8 @@ CConnection::sendMessage (
   CMessage *                    pMessage)
 {
     CErrorDetails *             pError = &m_Send.ErrorDetails;
-    CFrameEncoder *             pEncoder;
+    llrp_byte_t *               pBuffer;
+    unsigned int                nLength;
 
     /*
      * Clear the error details in the send state.
@@ -564,55 +569,58 @@ CConnection::sendMessage (
     }
 
     /*
-     * Construct a frame encoder. It needs to know the buffer
-     * base and maximum size.
+     * Encode the message straight into the send buffer. We
+     * check the encoder's ErrorDetails for results. Regardless
+     * of what happened capture the error details and the
+     * number of bytes placed in the buffer.
      */
-    pEncoder = new CFrameEncoder(m_Send.pBuffer, m_nBufferSize);
-
-    /*
-     * Check that the encoder actually got created.
-     */
-    if(NULL == pEncoder)
+    pBuffer = m_Send.pBuffer;
     {
-        pError->resultCodeAndWhatStr(RC_MiscError,
-                "encoder constructor failed");
-        return pError->m_eResultCode;
+        CFrameEncoder           Encoder(pBuffer, m_nBufferSize);
+
+        Encoder.encodeElement(pMessage);
+        m_Send.ErrorDetails = Encoder.m_ErrorDetails;
+        m_Send.nBuffer = Encoder.getLength();
     }
 
     /*
-     * Encode the message. Return value is ignored.
-     * We check the encoder's ErrorDetails for results.
+     * Only a frame that overran the send buffer is encoded
+     * again. A measuring encoder sizes it exactly and it gets
+     * a buffer of its own, so the second encode can't overrun.
      */
-    pEncoder->encodeElement(pMessage);
+    if(RC_FieldOverrun == pError->m_eResultCode ||
+       RC_ReservedBitsOverrun == pError->m_eResultCode)
+    {
+        CFrameEncoder           MeasuringEncoder;
 
-    /*
-     * Regardless of what happened capture the error details
-     * and the number of bytes placed in the buffer.
-     */
-    m_Send.ErrorDetails = pEncoder->m_ErrorDetails;
-    m_Send.nBuffer = pEncoder->getLength();
+        MeasuringEncoder.encodeElement(pMessage);
+        m_Send.ErrorDetails = MeasuringEncoder.m_ErrorDetails;
 
-    /*
-     * Bye bye li'l encoder.
-     */
-    delete pEncoder;
+        if(RC_OK == pError->m_eResultCode)
+        {
+            nLength = MeasuringEncoder.getLength();
+            pBuffer = new llrp_byte_t[nLength];
+
+            CFrameEncoder       Encoder(pBuffer, nLength);
+
+            Encoder.encodeElement(pMessage);
+            m_Send.ErrorDetails = Encoder.m_ErrorDetails;
+            m_Send.nBuffer = Encoder.getLength();
+        }
+    }
 
     /*
      * If the encoding appears complete write the frame
-     * to the connection. NB: this is not ready for
-     * non-blocking I/O (EWOULDBLOCK).
+     * to the connection.
      */
     if(RC_OK == pError->m_eResultCode)
     {
-        int             rc;
+        sendFrame(pBuffer);
+    }
 
-        rc = send(m_pPlatformSocket->m_sock, (char*)m_Send.pBuffer,
-            m_Send.nBuffer, 0);
-        if(rc != (int)m_Send.nBuffer)
-        {
-            /* Yikes! */
-            pError->resultCodeAndWhatStr(RC_SendIOError, "send IO error");
-        }
+    if(pBuffer != m_Send.pBuffer)
+    {
+        delete[] pBuffer;
     }
 
     /*
@@ -622,6 +630,124 @@ CConnection::sendMessage (
 }
 
 
+/**
+ *****************************************************************************
+ **
+ ** @brief  Send an instance of a frame template to a connection
+ **
+ ** The template frame is copied to the send buffer with
+ ** the MessageID and slot values patched in. No encoding
+ ** takes place.
+ **
+ ** @param[in]  pTemplate       Compiled frame template
+ ** @param[in]  MessageID       MessageID for this instance
+ ** @param[in]  pSlotValues     One value per template slot,
+ **                             NULL to send the values compiled in
+ **
+ ** @return     RC_OK               Frame sent
+ **             RC_SendIOError      I/O error in write().
+ **             RC_...              Template not compiled or larger
+ **                                 than the send buffer.
+ **
+ *****************************************************************************/
+
+EResultCode
+CConnection::sendMessage (
+  const CFrameTemplate *        pTemplate,
+  llrp_u32_t                    MessageID,
+  const llrp_u64_t *            pSlotValues)
+{
+    CErrorDetails *             pError = &m_Send.ErrorDetails;
+
+    pError->clear();
+
+    if(NULL == m_pPlatformSocket)
+    {
+        pError->resultCodeAndWhatStr(RC_MiscError, "not connected");
+        return pError->m_eResultCode;
+    }
+
+    m_Send.nBuffer = pTemplate->instantiate(m_Send.pBuffer, m_nBufferSize,
+                                    MessageID, pSlotValues);
+    if(0 == m_Send.nBuffer)
+    {
+        pError->resultCodeAndWhatStr(RC_MiscError,
+            "template not compiled or too big");
+        return pError->m_eResultCode;
+    }
+
+    sendFrame(m_Send.pBuffer);
+
+    return pError->m_eResultCode;
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Transact an instance of a frame template
+ **
+ ** Same as transact() for a message, but the request is
+ ** instantiated from a frame template. The response type
+ ** comes from the template's message type.
+ **
+ *****************************************************************************/
+
+CMessage *
+CConnection::transact (
+  const CFrameTemplate *        pTemplate,
+  llrp_u32_t                    MessageID,
+  const llrp_u64_t *            pSlotValues,
+  int                           nMaxMS)
+{
+    const CTypeDescriptor *     pResponseType = NULL;
+    EResultCode                 lrc;
+
+    if(NULL != pTemplate->getType())
+    {
+        pResponseType = pTemplate->getType()->m_pResponseType;
+    }
+    if(NULL == pResponseType)
+    {
+        CErrorDetails *         pError = &m_Send.ErrorDetails;
+
+        pError->clear();
+        pError->resultCodeAndWhatStr(RC_MissingResponseType,
+            "send message has no response type");
+        return NULL;
+    }
+
+    lrc = sendMessage(pTemplate, MessageID, pSlotValues);
+    if(RC_OK != lrc)
+    {
+        return NULL;
+    }
+
+    return recvResponse(nMaxMS, pResponseType, MessageID);
+}
+
+
+/*
+ * Write m_Send.nBuffer bytes at pBuffer to the socket.
+ * NB: this is not ready for non-blocking I/O (EWOULDBLOCK).
+ */
+void
+CConnection::sendFrame (
+  const llrp_byte_t *           pBuffer)
+{
+    int                         rc;
+
+    rc = send(m_pPlatformSocket->m_sock, (const char*)pBuffer,
+        m_Send.nBuffer, 0);
+    if(rc != (int)m_Send.nBuffer)
+    {
+        /* Yikes! */
+        m_Send.ErrorDetails.resultCodeAndWhatStr(RC_SendIOError,
+            "send IO error");
+    }
+}
+
+
 /**
  *****************************************************************************
  **
@@ -723,6 +849,54 @@ CConnection::getRecvError (void)
 }
 
 
+/**
+ *****************************************************************************
+ **
+ ** @brief  Record received frames to a capture file
+ **
+ ** Every frame received after this call is appended to the
+ ** writer with its receive time, whether or not it decodes.
+ ** The writer must already be open and is still owned by the
+ ** caller, who closes it. Several connections may share one
+ ** writer as long as they are all used from one thread.
+ **
+ ** @param[in]  pCaptureWriter  The writer, or NULL to stop capturing
+ ** @param[in]  ReaderID        Recorded with each frame to tell
+ **                             readers apart in a shared capture
+ **
+ *****************************************************************************/
+
+void
+CConnection::setCaptureWriter (
+  CCaptureWriter *              pCaptureWriter,
+  llrp_u16_t                    ReaderID)
+{
+    m_pCaptureWriter = pCaptureWriter;
+    m_CaptureReaderID = ReaderID;
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Set how strictly received frames are decoded
+ **
+ ** See CFrameDecoder::setStrictness(). DECODE_TRUSTED is for
+ ** readers whose output is known good; the default is
+ ** DECODE_STRICT.
+ **
+ ** @param[in]  eStrictness     Used for every frame received after
+ **
+ *****************************************************************************/
+
+void
+CConnection::setDecodeStrictness (
+  CFrameDecoder::EStrictness    eStrictness)
+{
+    m_eDecodeStrictness = eStrictness;
+}
+
+
 /**
  *****************************************************************************
  **
@@ -1080,6 +1254,20 @@ CConnection::recvAdvance (
             CFrameDecoder *     pDecoder;
             CMessage *          pMessage;
 
+            /*
+             * Capture the frame as received, before decoding,
+             * so frames that fail to decode are kept too.
+             * A capture error is left in the writer and
+             * does not disturb the receive.
+             */
+            if(NULL != m_pCaptureWriter)
+            {
+                m_pCaptureWriter->appendFrame(m_Recv.pBuffer,
+                        m_Recv.FrameExtract.m_MessageLength,
+                        CCaptureWriter::getTimeNowUSec(),
+                        m_CaptureReaderID);
+            }
+
             /*
              * Construct a new frame decoder. It needs the registry
              * to facilitate decoding.
@@ -1100,6 +1288,8 @@ CConnection::recvAdvance (
                 break;
             }
 
+            pDecoder->setStrictness(m_eDecodeStrictness);
+
             /*
              * Now ask the nice, brand new decoder to decode the frame.
              * It returns NULL for some kind of error.
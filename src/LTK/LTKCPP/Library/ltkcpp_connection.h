@@ -112,6 +112,19 @@ class CConnection
     sendMessage (
       CMessage *                pMessage);
 
+    CMessage *
+    transact (
+      const CFrameTemplate *    pTemplate,
+      llrp_u32_t                MessageID,
+      const llrp_u64_t *        pSlotValues,
+      int                       nMaxMS);
+
+    EResultCode
+    sendMessage (
+      const CFrameTemplate *    pTemplate,
+      llrp_u32_t                MessageID,
+      const llrp_u64_t *        pSlotValues);
+
     const CErrorDetails *
     getSendError (void);
 
@@ -128,6 +141,15 @@ class CConnection
     const CErrorDetails *
     getRecvError (void);
 
+    void
+    setCaptureWriter (
+      CCaptureWriter *          pCaptureWriter,
+      llrp_u16_t                ReaderID);
+
+    void
+    setDecodeStrictness (
+      CFrameDecoder::EStrictness eStrictness);
+
   private:
     /** The socket handle, platform specific */
     CPlatformSocket *           m_pPlatformSocket;
@@ -165,6 +187,15 @@ class CConnection
         CErrorDetails       ErrorDetails;
     }                           m_Recv;
 
+    /** If not NULL every received frame is appended here */
+    CCaptureWriter *            m_pCaptureWriter;
+
+    /** Reader ID recorded with each captured frame */
+    llrp_u16_t                  m_CaptureReaderID;
+
+    /** Applied to the decoder of each received frame */
+    CFrameDecoder::EStrictness  m_eDecodeStrictness;
+
     /** Send state */
     struct SendState
     {
@@ -179,6 +210,10 @@ class CConnection
     }                           m_Send;
 
   private:
+    void
+    sendFrame (
+      const llrp_byte_t *           pBuffer);
+
     EResultCode
     recvAdvance (
       int                           nMaxMS,
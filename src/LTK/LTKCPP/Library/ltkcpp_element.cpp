@@ -142,6 +142,16 @@ CParameter::isAllowedExtension (
         return TRUE;
     }
 
+    /*
+     * So is one of a type this build doesn't know, it
+     * goes where the Custom parameters go.
+     */
+    if(COpaqueParameter::s_apFieldDescriptorTable ==
+                                        m_pType->m_ppFieldDescriptorTable)
+    {
+        return TRUE;
+    }
+
     /*
      * At this point checking specifically if it is allowed
      * is perfunctory.
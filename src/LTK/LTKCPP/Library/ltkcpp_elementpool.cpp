@@ -0,0 +1,430 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+
+#include <new>
+#include <atomic>
+#include <mutex>
+
+#include "ltkcpp_platform.h"
+#include "ltkcpp_base.h"
+
+
+namespace LLRP
+{
+
+/*
+ * Most pools a process can have. There is one per pooled
+ * class, see PooledTypes in ltkcpp_gen_h.xslt. Pools past
+ * this many just use the heap.
+ */
+#define MAX_POOL_SLOT           32u
+
+/*
+ * One thread's free list and counters for one pool. Only the
+ * owning thread changes them. The counters are atomic so that
+ * getCounters() can read them from any thread; relaxed loads
+ * and stores are all that is needed, and cost no more than
+ * plain ones.
+ */
+struct SPoolSlot
+{
+    void *                      pFreeList;
+    std::atomic<unsigned int>   nFree;
+    std::atomic<unsigned long>  nHit;
+    std::atomic<unsigned long>  nMiss;
+    std::atomic<unsigned long>  nRelease;
+};
+
+/*
+ * All of one thread's slots, on the heap and reached through
+ * t_pPoolSlots. Only trivially destructible thread_locals are
+ * read on the allocate/release path, so an element released
+ * while the thread's thread_locals are being destroyed never
+ * touches a destroyed object. Every thread's slots are on
+ * s_pPoolSlotsList so getCounters() can add them up.
+ */
+struct SThreadPoolSlots
+{
+    SPoolSlot                   aSlot[MAX_POOL_SLOT];
+    SThreadPoolSlots *          pNext;
+    SThreadPoolSlots *          pPrev;
+};
+
+/*
+ * Counters for the process, all under s_PoolSlotsMutex:
+ * the live threads' slots, what threads that have exited
+ * counted, and what resetCounters() last saw, which
+ * getCounters() subtracts.
+ */
+struct SPoolTotals
+{
+    unsigned long               nHit;
+    unsigned long               nMiss;
+    unsigned long               nRelease;
+};
+
+static std::mutex               s_PoolSlotsMutex;
+static SThreadPoolSlots *       s_pPoolSlotsList;
+static SPoolTotals              s_aRetiredTotals[MAX_POOL_SLOT];
+static SPoolTotals              s_aResetTotals[MAX_POOL_SLOT];
+
+static inline unsigned long
+counterValue (
+  const std::atomic<unsigned long> & rCounter)
+{
+    return rCounter.load(std::memory_order_relaxed);
+}
+
+static inline void
+bumpCounter (
+  std::atomic<unsigned long> &  rCounter)
+{
+    rCounter.store(counterValue(rCounter) + 1u, std::memory_order_relaxed);
+}
+
+static inline void
+setFree (
+  SPoolSlot *                   pSlot,
+  unsigned int                  nFree)
+{
+    pSlot->nFree.store(nFree, std::memory_order_relaxed);
+}
+
+static thread_local SThreadPoolSlots *  t_pPoolSlots;
+
+/*
+ * Set when the thread's slots have been freed at thread exit.
+ * Anything released on the thread after that goes straight
+ * to the heap and no new slots are made.
+ */
+static thread_local bool        t_bPoolSlotsGone;
+
+/*
+ * Frees the thread's slots, and everything on their free
+ * lists, when the thread exits. It is touched when the slots
+ * are made so its destructor is registered then.
+ */
+class CThreadPoolSlotsOwner
+{
+  public:
+    bool                        m_bOwning;
+
+    ~CThreadPoolSlotsOwner (void)
+    {
+        SThreadPoolSlots *      pSlots = t_pPoolSlots;
+
+        t_pPoolSlots = NULL;
+        t_bPoolSlotsGone = true;
+        if(NULL == pSlots)
+        {
+            return;
+        }
+
+        /*
+         * Keep the thread's counts in the process totals
+         */
+        {
+            std::lock_guard<std::mutex> Lock(s_PoolSlotsMutex);
+
+            if(NULL != pSlots->pPrev)
+            {
+                pSlots->pPrev->pNext = pSlots->pNext;
+            }
+            else
+            {
+                s_pPoolSlotsList = pSlots->pNext;
+            }
+            if(NULL != pSlots->pNext)
+            {
+                pSlots->pNext->pPrev = pSlots->pPrev;
+            }
+
+            for(unsigned int i = 0; i < MAX_POOL_SLOT; i++)
+            {
+                s_aRetiredTotals[i].nHit     += counterValue(pSlots->aSlot[i].nHit);
+                s_aRetiredTotals[i].nMiss    += counterValue(pSlots->aSlot[i].nMiss);
+                s_aRetiredTotals[i].nRelease += counterValue(pSlots->aSlot[i].nRelease);
+            }
+        }
+
+        for(unsigned int i = 0; i < MAX_POOL_SLOT; i++)
+        {
+            while(NULL != pSlots->aSlot[i].pFreeList)
+            {
+                void *          pObject = pSlots->aSlot[i].pFreeList;
+
+                pSlots->aSlot[i].pFreeList = *(void **)pObject;
+                ::operator delete(pObject);
+            }
+        }
+        delete pSlots;
+    }
+};
+
+static thread_local CThreadPoolSlotsOwner t_PoolSlotsOwner;
+
+/*
+ * This thread's slot iSlot, made on first use. NULL once the
+ * thread's slots are gone or if they could not be made.
+ */
+static SPoolSlot *
+threadPoolSlot (
+  unsigned int                  iSlot)
+{
+    SThreadPoolSlots *          pSlots = t_pPoolSlots;
+
+    if(NULL == pSlots)
+    {
+        if(t_bPoolSlotsGone)
+        {
+            return NULL;
+        }
+        /* value-initialized, so every list and counter is zero */
+        pSlots = new(std::nothrow) SThreadPoolSlots();
+        if(NULL == pSlots)
+        {
+            return NULL;
+        }
+
+        {
+            std::lock_guard<std::mutex> Lock(s_PoolSlotsMutex);
+
+            pSlots->pNext = s_pPoolSlotsList;
+            if(NULL != s_pPoolSlotsList)
+            {
+                s_pPoolSlotsList->pPrev = pSlots;
+            }
+            s_pPoolSlotsList = pSlots;
+        }
+        t_pPoolSlots = pSlots;
+        t_PoolSlotsOwner.m_bOwning = true;
+    }
+
+    return &pSlots->aSlot[iSlot];
+}
+
+CElementPool *                  CElementPool::s_pFirstPool;
+unsigned int                    CElementPool::s_nSlot;
+
+/*
+ * Pools are static members of the generated classes, so
+ * they are all constructed before main() on one thread.
+ */
+CElementPool::CElementPool (
+  const char *                  pName,
+  unsigned int                  nObjectSize,
+  unsigned int                  nMaxFree)
+{
+    m_pName       = pName;
+    m_nObjectSize = nObjectSize;
+    m_nMaxFree    = nMaxFree;
+    m_iSlot       = s_nSlot++;
+
+    /*
+     * The free list is threaded through the released objects
+     * themselves, so each must have room for the link.
+     */
+    if(m_nObjectSize < sizeof(void *))
+    {
+        m_nObjectSize = sizeof(void *);
+    }
+
+    m_pNextPool   = s_pFirstPool;
+    s_pFirstPool  = this;
+}
+
+void *
+CElementPool::allocate (
+  size_t                        nByte)
+{
+    if(m_iSlot >= MAX_POOL_SLOT)
+    {
+        return ::operator new(nByte);
+    }
+
+    SPoolSlot *                 pSlot = threadPoolSlot(m_iSlot);
+
+    if(NULL == pSlot)
+    {
+        return ::operator new(nByte);
+    }
+
+    /*
+     * A class derived from a pooled class inherits its
+     * operator new. Objects of any other size bypass the pool.
+     */
+    if(nByte != m_nObjectSize || NULL == pSlot->pFreeList)
+    {
+        bumpCounter(pSlot->nMiss);
+        return ::operator new(nByte);
+    }
+
+    void *                      pObject = pSlot->pFreeList;
+
+    pSlot->pFreeList = *(void **)pObject;
+    setFree(pSlot, pSlot->nFree.load(std::memory_order_relaxed) - 1u);
+    bumpCounter(pSlot->nHit);
+
+    return pObject;
+}
+
+void
+CElementPool::release (
+  void *                        pObject,
+  size_t                        nByte)
+{
+    if(NULL == pObject)
+    {
+        return;
+    }
+
+    SPoolSlot *                 pSlot = NULL;
+
+    if(m_iSlot < MAX_POOL_SLOT)
+    {
+        pSlot = threadPoolSlot(m_iSlot);
+    }
+
+    if(NULL == pSlot)
+    {
+        ::operator delete(pObject);
+        return;
+    }
+
+    unsigned int                nFree;
+
+    bumpCounter(pSlot->nRelease);
+    nFree = pSlot->nFree.load(std::memory_order_relaxed);
+
+    if(nByte != m_nObjectSize || nFree >= m_nMaxFree)
+    {
+        ::operator delete(pObject);
+        return;
+    }
+
+    *(void **)pObject = pSlot->pFreeList;
+    pSlot->pFreeList = pObject;
+    setFree(pSlot, nFree + 1u);
+}
+
+void
+CElementPool::trim (void)
+{
+    if(m_iSlot >= MAX_POOL_SLOT || NULL == t_pPoolSlots)
+    {
+        return;
+    }
+
+    SPoolSlot *                 pSlot = &t_pPoolSlots->aSlot[m_iSlot];
+
+    while(NULL != pSlot->pFreeList)
+    {
+        void *                  pObject = pSlot->pFreeList;
+
+        pSlot->pFreeList = *(void **)pObject;
+        ::operator delete(pObject);
+    }
+    setFree(pSlot, 0);
+}
+
+/*
+ * Add up every thread's slot iSlot, those of threads that
+ * have exited included. Only the free counts of live threads
+ * count, an exited thread's lists are gone. The caller holds
+ * s_PoolSlotsMutex.
+ */
+static void
+addUpPoolSlots (
+  unsigned int                  iSlot,
+  unsigned int *                pnFree,
+  SPoolTotals *                 pTotals)
+{
+    *pnFree  = 0;
+    *pTotals = s_aRetiredTotals[iSlot];
+
+    for(SThreadPoolSlots *pSlots = s_pPoolSlotsList;
+        NULL != pSlots;
+        pSlots = pSlots->pNext)
+    {
+        const SPoolSlot *       pSlot = &pSlots->aSlot[iSlot];
+
+        *pnFree           += pSlot->nFree.load(std::memory_order_relaxed);
+        pTotals->nHit     += counterValue(pSlot->nHit);
+        pTotals->nMiss    += counterValue(pSlot->nMiss);
+        pTotals->nRelease += counterValue(pSlot->nRelease);
+    }
+}
+
+/*
+ * The counters for all threads, since the last resetCounters()
+ */
+void
+CElementPool::getCounters (
+  unsigned int *                pnFree,
+  unsigned long *               pnHit,
+  unsigned long *               pnMiss,
+  unsigned long *               pnRelease) const
+{
+    *pnFree    = 0;
+    *pnHit     = 0;
+    *pnMiss    = 0;
+    *pnRelease = 0;
+
+    if(m_iSlot >= MAX_POOL_SLOT)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> Lock(s_PoolSlotsMutex);
+    SPoolTotals                 Totals;
+
+    addUpPoolSlots(m_iSlot, pnFree, &Totals);
+    *pnHit     = Totals.nHit     - s_aResetTotals[m_iSlot].nHit;
+    *pnMiss    = Totals.nMiss    - s_aResetTotals[m_iSlot].nMiss;
+    *pnRelease = Totals.nRelease - s_aResetTotals[m_iSlot].nRelease;
+}
+
+/*
+ * Threads keep counting while this runs, so rather than clear
+ * their counters it remembers the totals as they are now for
+ * getCounters() to subtract.
+ */
+void
+CElementPool::resetCounters (void)
+{
+    if(m_iSlot >= MAX_POOL_SLOT)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> Lock(s_PoolSlotsMutex);
+    unsigned int                nFree;
+
+    addUpPoolSlots(m_iSlot, &nFree, &s_aResetTotals[m_iSlot]);
+}
+
+CElementPool *
+CElementPool::getFirstPool (void)
+{
+    return s_pFirstPool;
+}
+
+};  /* namespace LLRP */
@@ -35,10 +35,12 @@
 namespace LLRP
 {
 class CFrameExtract;
+class CFrameByteOrder;
 class CFrameDecoder;
 class CFrameDecoderStream;
 class CFrameEncoder;
 class CFrameEncoderStream;
+class CFrameTemplate;
 
 class CFrameExtract
 {
@@ -64,6 +66,92 @@ class CFrameExtract
       unsigned int              nBuffer);
 };
 
+/**
+ *****************************************************************************
+ **
+ ** @brief  Bulk conversion of vector fields to and from LLRP byte order
+ **
+ ** The u16v/u32v/u64v (and signed) field codecs hand the whole array
+ ** to one of these instead of converting element by element. On x86
+ ** the conversion uses SSSE3 or AVX2 byte shuffles when the CPU has
+ ** them, chosen the first time a conversion is done. The portable
+ ** kernel works on any host and gives the same bytes.
+ **
+ ** setKernel() is for tests and benchmarks that want to compare the
+ ** kernels. It is not meant to be called while frames are being
+ ** encoded or decoded on other threads.
+ **
+ *****************************************************************************/
+
+class CFrameByteOrder
+{
+  public:
+    enum EKernel
+    {
+        KERNEL_PORTABLE,
+        KERNEL_SSSE3,
+        KERNEL_AVX2,
+
+        KERNEL_COUNT
+    };
+
+    static void
+    getU16v (
+      llrp_u16_t *              pValue,
+      const llrp_byte_t *       pBuffer,
+      unsigned int              nValue);
+
+    static void
+    getU32v (
+      llrp_u32_t *              pValue,
+      const llrp_byte_t *       pBuffer,
+      unsigned int              nValue);
+
+    static void
+    getU64v (
+      llrp_u64_t *              pValue,
+      const llrp_byte_t *       pBuffer,
+      unsigned int              nValue);
+
+    static void
+    putU16v (
+      llrp_byte_t *             pBuffer,
+      const llrp_u16_t *        pValue,
+      unsigned int              nValue);
+
+    static void
+    putU32v (
+      llrp_byte_t *             pBuffer,
+      const llrp_u32_t *        pValue,
+      unsigned int              nValue);
+
+    static void
+    putU64v (
+      llrp_byte_t *             pBuffer,
+      const llrp_u64_t *        pValue,
+      unsigned int              nValue);
+
+    static EKernel
+    getKernel (void);
+
+    static llrp_bool_t
+    setKernel (
+      EKernel                   eKernel);
+
+    static llrp_bool_t
+    isKernelSupported (
+      EKernel                   eKernel);
+
+    static const char *
+    getKernelName (
+      EKernel                   eKernel);
+
+    static llrp_bool_t
+    lookupKernel (
+      const char *              pName,
+      EKernel *                 peKernel);
+};
+
 class CFrameDecoder : public CDecoder
 {
     friend class CFrameDecoderStream;
@@ -79,6 +167,43 @@ class CFrameDecoder : public CDecoder
     CMessage *
     decodeMessage (void);
 
+    /*
+     * The generated decoders take all fixed size fields
+     * of an element in one go when the frame allows it.
+     * On by default. Turning it off forces the field at
+     * a time path, mostly useful for comparing the two.
+     */
+    void
+    setFixedFieldDecode (
+      llrp_bool_t               bFixedFieldDecode);
+
+    /*
+     * How much of the frame is checked.
+     *
+     * DECODE_STRICT, the default, checks every field against
+     * the end of its TLV, bit field alignment, and the order
+     * and count of sub-parameters the LLRP definitions give.
+     * Any deviation fails the decode.
+     *
+     * DECODE_TRUSTED is for frames from readers we configure
+     * ourselves. Fields are only checked against the end of
+     * the enclosing TLV, so a bad frame can't read past it,
+     * and sub-parameters are taken in any order and number.
+     * A required one that is missing leaves its member NULL,
+     * a repeated single one replaces the earlier, and one
+     * that fits nowhere stays in the element's list of all
+     * sub-parameters without being given a member.
+     */
+    enum EStrictness
+    {
+        DECODE_STRICT,
+        DECODE_TRUSTED
+    };
+
+    void
+    setStrictness (
+      EStrictness               eStrictness);
+
   private:
     unsigned char *             m_pBuffer;
     unsigned int                m_nBuffer;
@@ -87,6 +212,9 @@ class CFrameDecoder : public CDecoder
     unsigned int                m_BitFieldBuffer;
     unsigned int                m_nBitFieldResid;
 
+    llrp_bool_t                 m_bFixedFieldDecode;
+    llrp_bool_t                 m_bTrusted;
+
     llrp_u8_t
     next_u8(void);
 
@@ -98,6 +226,21 @@ class CFrameDecoder : public CDecoder
 
     llrp_u64_t
     next_u64(void);
+
+    void
+    next_u16v (
+      llrp_u16_t *              pValue,
+      unsigned int              nValue);
+
+    void
+    next_u32v (
+      llrp_u32_t *              pValue,
+      unsigned int              nValue);
+
+    void
+    next_u64v (
+      llrp_u64_t *              pValue,
+      unsigned int              nValue);
 };
 
 class CFrameDecoderStream : public CDecoderStream
@@ -249,6 +392,10 @@ class CFrameDecoderStream : public CDecoderStream
     get_reserved (
       unsigned int              nBit);
 
+    const llrp_u8_t *
+    getFixedFields (
+      unsigned int              nByte);
+
   private:
     CFrameDecoder *             m_pDecoder;
     CFrameDecoderStream *       m_pEnclosingDecoderStream;
@@ -296,12 +443,20 @@ class CFrameDecoderStream : public CDecoderStream
 class CFrameEncoder : public CEncoder
 {
   friend class CFrameEncoderStream;
+  friend class CFrameTemplate;
 
   public:
     CFrameEncoder (
       unsigned char *           pBuffer,
       unsigned int              nBuffer);
 
+    /*
+     * Measuring encoder. encodeElement() goes through all
+     * the motions but stores nothing, and getLength() is
+     * then the exact size of the encoded frame.
+     */
+    CFrameEncoder (void);
+
     ~CFrameEncoder (void);
 
     void
@@ -319,6 +474,9 @@ class CFrameEncoder : public CEncoder
     unsigned int                m_BitFieldBuffer;
     unsigned int                m_nBitFieldResid;
 
+    /* Template whose slots are being located, NULL usually */
+    CFrameTemplate *            m_pTemplate;
+
     void
     next_u8 (
       llrp_u8_t                 Value);
@@ -334,6 +492,21 @@ class CFrameEncoder : public CEncoder
     void
     next_u64 (
       llrp_u64_t                Value);
+
+    void
+    next_u16v (
+      const llrp_u16_t *        pValue,
+      unsigned int              nValue);
+
+    void
+    next_u32v (
+      const llrp_u32_t *        pValue,
+      unsigned int              nValue);
+
+    void
+    next_u64v (
+      const llrp_u64_t *        pValue,
+      unsigned int              nValue);
 };
 
 class CFrameEncoderStream : public CEncoderStream
@@ -563,5 +736,93 @@ class CFrameEncoderStream : public CEncoderStream
       const CFieldDescriptor *  pFieldDescriptor);
 };
 
+/*
+ * CFrameTemplate
+ *
+ * A message encoded once and kept as an immutable frame.
+ * Commands that go out again and again, the same but for
+ * the MessageID and maybe an ID or two, are instantiated
+ * by copying the frame and patching those few bytes
+ * instead of building and encoding an object tree.
+ *
+ * Before compile() name the fields that will vary with
+ * addSlot(). A slot must be a byte aligned scalar (u8..u64,
+ * s8..s64, or an enumeration of those sizes) that occurs
+ * exactly once in the message. The MessageID is always
+ * patchable and needs no slot.
+ *
+ * compile() sizes the message with a measuring encoder,
+ * encodes it into a buffer of exactly that size and notes
+ * where each slot landed.
+ */
+class CFrameTemplate
+{
+  friend class CFrameEncoderStream;
+
+  public:
+    /** @brief Why compile() failed */
+    CErrorDetails               m_ErrorDetails;
+
+    CFrameTemplate (void);
+
+    ~CFrameTemplate (void);
+
+    int
+    addSlot (
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    EResultCode
+    compile (
+      const CMessage *          pMessage);
+
+    const CTypeDescriptor *
+    getType (void) const;
+
+    unsigned int
+    getLength (void) const;
+
+    unsigned int
+    instantiate (
+      unsigned char *           pBuffer,
+      unsigned int              nBuffer,
+      llrp_u32_t                MessageID,
+      const llrp_u64_t *        pSlotValues) const;
+
+  private:
+    enum { MAX_SLOT = 8 };
+
+    struct SSlot
+    {
+        const CFieldDescriptor *    pFieldDescriptor;
+        unsigned int                iOffset;
+        unsigned int                nByte;
+        unsigned int                nSeen;
+    };
+
+    SSlot                       m_aSlot[MAX_SLOT];
+    unsigned int                m_nSlot;
+
+    unsigned char *             m_pFrame;
+    unsigned int                m_nFrame;
+    const CTypeDescriptor *     m_pType;
+
+    /*
+     * The template owns m_pFrame, so it is not copied.
+     * Declared but never defined.
+     */
+    CFrameTemplate (
+      const CFrameTemplate &    rOther);
+
+    CFrameTemplate &
+    operator= (
+      const CFrameTemplate &    rOther);
+
+    void
+    noteField (
+      const CFieldDescriptor *  pFieldDescriptor,
+      unsigned int              iOffset,
+      unsigned int              nByte);
+};
+
 
 };
@@ -42,6 +42,9 @@ CFrameDecoder::CFrameDecoder (
     m_iNext          = 0;
     m_BitFieldBuffer = 0;
     m_nBitFieldResid = 0;
+
+    m_bFixedFieldDecode = TRUE;
+    m_bTrusted = FALSE;
 }
 
 CFrameDecoder::~CFrameDecoder (void)
@@ -59,6 +62,20 @@ CFrameDecoder::decodeMessage (void)
     return pMessage;
 }
 
+void
+CFrameDecoder::setFixedFieldDecode (
+  llrp_bool_t                   bFixedFieldDecode)
+{
+    m_bFixedFieldDecode = bFixedFieldDecode;
+}
+
+void
+CFrameDecoder::setStrictness (
+  EStrictness                   eStrictness)
+{
+    m_bTrusted = (DECODE_TRUSTED == eStrictness);
+}
+
 llrp_u8_t
 CFrameDecoder::next_u8 (void)
 {
@@ -129,6 +146,39 @@ CFrameDecoder::next_u64 (void)
     return Value;
 }
 
+void
+CFrameDecoder::next_u16v (
+  llrp_u16_t *                  pValue,
+  unsigned int                  nValue)
+{
+    assert(m_iNext + 2u * nValue <= m_nBuffer);
+
+    CFrameByteOrder::getU16v(pValue, &m_pBuffer[m_iNext], nValue);
+    m_iNext += 2u * nValue;
+}
+
+void
+CFrameDecoder::next_u32v (
+  llrp_u32_t *                  pValue,
+  unsigned int                  nValue)
+{
+    assert(m_iNext + 4u * nValue <= m_nBuffer);
+
+    CFrameByteOrder::getU32v(pValue, &m_pBuffer[m_iNext], nValue);
+    m_iNext += 4u * nValue;
+}
+
+void
+CFrameDecoder::next_u64v (
+  llrp_u64_t *                  pValue,
+  unsigned int                  nValue)
+{
+    assert(m_iNext + 8u * nValue <= m_nBuffer);
+
+    CFrameByteOrder::getU64v(pValue, &m_pBuffer[m_iNext], nValue);
+    m_iNext += 8u * nValue;
+}
+
 llrp_u8_t
 CFrameDecoderStream::get_u8 (
   const CFieldDescriptor *      pFieldDescriptor)
@@ -271,10 +321,7 @@ CFrameDecoderStream::get_u16v (
             Value = llrp_u16v_t(nValue);
             if(verifyVectorAllocation(Value.m_pValue, pFieldDescriptor))
             {
-                for(unsigned int Ix = 0; Ix < nValue; Ix++)
-                {
-                    Value.m_pValue[Ix] = m_pDecoder->next_u16();
-                }
+                m_pDecoder->next_u16v(Value.m_pValue, nValue);
             }
         }
     }
@@ -298,10 +345,7 @@ CFrameDecoderStream::get_s16v (
             Value = llrp_s16v_t(nValue);
             if(verifyVectorAllocation(Value.m_pValue, pFieldDescriptor))
             {
-                for(unsigned int Ix = 0; Ix < nValue; Ix++)
-                {
-                    Value.m_pValue[Ix] = m_pDecoder->next_u16();
-                }
+                m_pDecoder->next_u16v((llrp_u16_t *) Value.m_pValue, nValue);
             }
         }
     }
@@ -363,10 +407,7 @@ CFrameDecoderStream::get_u32v (
             Value = llrp_u32v_t(nValue);
             if(verifyVectorAllocation(Value.m_pValue, pFieldDescriptor))
             {
-                for(unsigned int Ix = 0; Ix < nValue; Ix++)
-                {
-                    Value.m_pValue[Ix] = m_pDecoder->next_u32();
-                }
+                m_pDecoder->next_u32v(Value.m_pValue, nValue);
             }
         }
     }
@@ -390,10 +431,7 @@ CFrameDecoderStream::get_s32v (
             Value = llrp_s32v_t(nValue);
             if(verifyVectorAllocation(Value.m_pValue, pFieldDescriptor))
             {
-                for(unsigned int Ix = 0; Ix < nValue; Ix++)
-                {
-                    Value.m_pValue[Ix] = m_pDecoder->next_u32();
-                }
+                m_pDecoder->next_u32v((llrp_u32_t *) Value.m_pValue, nValue);
             }
         }
     }
@@ -454,10 +492,7 @@ CFrameDecoderStream::get_u64v (
             Value = llrp_u64v_t(nValue);
             if(verifyVectorAllocation(Value.m_pValue, pFieldDescriptor))
             {
-                for(unsigned int Ix = 0; Ix < nValue; Ix++)
-                {
-                    Value.m_pValue[Ix] = m_pDecoder->next_u64();
-                }
+                m_pDecoder->next_u64v(Value.m_pValue, nValue);
             }
         }
     }
@@ -481,10 +516,7 @@ CFrameDecoderStream::get_s64v (
             Value = llrp_s64v_t(nValue);
             if(verifyVectorAllocation(Value.m_pValue, pFieldDescriptor))
             {
-                for(unsigned int Ix = 0; Ix < nValue; Ix++)
-                {
-                    Value.m_pValue[Ix] = m_pDecoder->next_u64();
-                }
+                m_pDecoder->next_u64v((llrp_u64_t *) Value.m_pValue, nValue);
             }
         }
     }
@@ -734,6 +766,34 @@ CFrameDecoderStream::get_reserved (
     }
 }
 
+const llrp_u8_t *
+CFrameDecoderStream::getFixedFields (
+  unsigned int                  nByte)
+{
+    const llrp_u8_t *           pFixed;
+
+    if(!m_pDecoder->m_bFixedFieldDecode)
+    {
+        return NULL;
+    }
+
+    /*
+     * Anything out of the ordinary goes back to the field
+     * at a time decode so the error details come out the same.
+     */
+    if(RC_OK != m_pDecoder->m_ErrorDetails.m_eResultCode ||
+       0 != m_pDecoder->m_nBitFieldResid ||
+       m_pDecoder->m_iNext + nByte > m_iLimit)
+    {
+        return NULL;
+    }
+
+    pFixed = &m_pDecoder->m_pBuffer[m_pDecoder->m_iNext];
+    m_pDecoder->m_iNext += nByte;
+
+    return pFixed;
+}
+
 CFrameDecoderStream::CFrameDecoderStream (
   CFrameDecoder *               pDecoder)
 {
@@ -858,6 +918,17 @@ CFrameDecoderStream::getMessage (void)
         pTypeDescriptor = pRegistry->lookupMessage(Type);
     }
 
+    CMessage *                  pMessage = NULL;
+
+    if(NULL == pTypeDescriptor && pRegistry->m_bOpaqueUnknownTypes)
+    {
+        /*
+         * Not generated into this build, keep the body as is.
+         */
+        pMessage = new COpaqueMessage(Type);
+        pTypeDescriptor = pMessage->m_pType;
+    }
+
     if(NULL == pTypeDescriptor)
     {
         pError->m_eResultCode = RC_UnknownMessageType;
@@ -870,9 +941,10 @@ CFrameDecoderStream::getMessage (void)
 
     m_pRefType = pTypeDescriptor;
 
-    CMessage *                  pMessage;
-
-    pMessage = (CMessage *) pTypeDescriptor->constructElement();
+    if(NULL == pMessage)
+    {
+        pMessage = (CMessage *) pTypeDescriptor->constructElement();
+    }
 
     if(NULL == pMessage)
     {
@@ -941,7 +1013,8 @@ CFrameDecoderStream::getMessage (void)
         return NULL;
     }
 
-    pMessage->assimilateSubParameters(pError);
+    /* Trusted, no error details: no order or count checks */
+    pMessage->assimilateSubParameters(m_pDecoder->m_bTrusted ? NULL : pError);
 
     if(RC_OK != pError->m_eResultCode)
     {
@@ -1068,6 +1141,18 @@ CFrameDecoderStream::getParameter (void)
         pTypeDescriptor = pRegistry->lookupParameter(Type);
     }
 
+    CParameter *                pParameter = NULL;
+
+    if(NULL == pTypeDescriptor && !bIsTV && pRegistry->m_bOpaqueUnknownTypes)
+    {
+        /*
+         * Not generated into this build, keep the body as is.
+         * Only a TLV can be skipped, a TV's length isn't known.
+         */
+        pParameter = new COpaqueParameter(Type);
+        pTypeDescriptor = pParameter->m_pType;
+    }
+
     if(NULL == pTypeDescriptor)
     {
         pError->m_eResultCode = RC_UnknownParameterType;
@@ -1087,9 +1172,10 @@ CFrameDecoderStream::getParameter (void)
 
     m_pRefType = pTypeDescriptor;
 
-    CParameter *                pParameter;
-
-    pParameter = (CParameter *) pTypeDescriptor->constructElement();
+    if(NULL == pParameter)
+    {
+        pParameter = (CParameter *) pTypeDescriptor->constructElement();
+    }
 
     if(NULL == pParameter)
     {
@@ -1157,7 +1243,8 @@ CFrameDecoderStream::getParameter (void)
             return NULL;
         }
 
-        pParameter->assimilateSubParameters(pError);
+        pParameter->assimilateSubParameters(
+                                m_pDecoder->m_bTrusted ? NULL : pError);
 
         if(RC_OK != pError->m_eResultCode)
         {
@@ -1189,6 +1276,15 @@ CFrameDecoderStream::checkAvailable (
 {
     CErrorDetails *             pError = &m_pDecoder->m_ErrorDetails;
 
+    /*
+     * Trusted, the end of the TLV is the only check.
+     * Past it, the strict checks fill in the details.
+     */
+    if(m_pDecoder->m_bTrusted && m_pDecoder->m_iNext + nByte <= m_iLimit)
+    {
+        return TRUE;
+    }
+
     if(RC_OK != pError->m_eResultCode)
     {
         return FALSE;
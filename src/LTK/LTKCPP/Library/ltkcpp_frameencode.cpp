@@ -41,6 +41,25 @@ CFrameEncoder::CFrameEncoder (
     m_iNext          = 0;
     m_BitFieldBuffer = 0;
     m_nBitFieldResid = 0;
+
+    m_pTemplate      = NULL;
+}
+
+CFrameEncoder::CFrameEncoder (void)
+ : CEncoder()
+{
+    /*
+     * Measuring encoder. Nothing is stored and there
+     * is no limit, getLength() is the exact frame size.
+     */
+    m_pBuffer        = NULL;
+    m_nBuffer        = ~0u;
+
+    m_iNext          = 0;
+    m_BitFieldBuffer = 0;
+    m_nBitFieldResid = 0;
+
+    m_pTemplate      = NULL;
 }
 
 CFrameEncoder::~CFrameEncoder (void)
@@ -140,6 +159,12 @@ CFrameEncoder::next_u8 (
 {
     assert(m_iNext + 1u <= m_nBuffer);
 
+    if(NULL == m_pBuffer)
+    {
+        m_iNext += 1u;
+        return;
+    }
+
     m_pBuffer[m_iNext++] = Value;
 }
 
@@ -149,6 +174,12 @@ CFrameEncoder::next_u16 (
 {
     assert(m_iNext + 2u <= m_nBuffer);
 
+    if(NULL == m_pBuffer)
+    {
+        m_iNext += 2u;
+        return;
+    }
+
     m_pBuffer[m_iNext++] = Value >> 8u;
     m_pBuffer[m_iNext++] = Value >> 0u;
 }
@@ -159,6 +190,12 @@ CFrameEncoder::next_u32 (
 {
     assert(m_iNext + 4u <= m_nBuffer);
 
+    if(NULL == m_pBuffer)
+    {
+        m_iNext += 4u;
+        return;
+    }
+
     m_pBuffer[m_iNext++] = Value >> 24u;
     m_pBuffer[m_iNext++] = Value >> 16u;
     m_pBuffer[m_iNext++] = Value >> 8u;
@@ -171,6 +208,12 @@ CFrameEncoder::next_u64 (
 {
     assert(m_iNext + 8u <= m_nBuffer);
 
+    if(NULL == m_pBuffer)
+    {
+        m_iNext += 8u;
+        return;
+    }
+
     m_pBuffer[m_iNext++] = (llrp_byte_t)(Value >> 56u);
     m_pBuffer[m_iNext++] = (llrp_byte_t)(Value >> 48u);
     m_pBuffer[m_iNext++] = (llrp_byte_t)(Value >> 40u);
@@ -181,6 +224,57 @@ CFrameEncoder::next_u64 (
     m_pBuffer[m_iNext++] = (llrp_byte_t)(Value >> 0u);
 }
 
+void
+CFrameEncoder::next_u16v (
+  const llrp_u16_t *            pValue,
+  unsigned int                  nValue)
+{
+    assert(m_iNext + 2u * nValue <= m_nBuffer);
+
+    if(NULL == m_pBuffer)
+    {
+        m_iNext += 2u * nValue;
+        return;
+    }
+
+    CFrameByteOrder::putU16v(&m_pBuffer[m_iNext], pValue, nValue);
+    m_iNext += 2u * nValue;
+}
+
+void
+CFrameEncoder::next_u32v (
+  const llrp_u32_t *            pValue,
+  unsigned int                  nValue)
+{
+    assert(m_iNext + 4u * nValue <= m_nBuffer);
+
+    if(NULL == m_pBuffer)
+    {
+        m_iNext += 4u * nValue;
+        return;
+    }
+
+    CFrameByteOrder::putU32v(&m_pBuffer[m_iNext], pValue, nValue);
+    m_iNext += 4u * nValue;
+}
+
+void
+CFrameEncoder::next_u64v (
+  const llrp_u64_t *            pValue,
+  unsigned int                  nValue)
+{
+    assert(m_iNext + 8u * nValue <= m_nBuffer);
+
+    if(NULL == m_pBuffer)
+    {
+        m_iNext += 8u * nValue;
+        return;
+    }
+
+    CFrameByteOrder::putU64v(&m_pBuffer[m_iNext], pValue, nValue);
+    m_iNext += 8u * nValue;
+}
+
 /*
  * 8-bit types
  */
@@ -286,13 +380,8 @@ CFrameEncoderStream::put_u16v (
 
     if(checkAvailable(nByte, pFieldDescriptor))
     {
-        unsigned int            i;
-
         m_pEncoder->next_u16(Value.m_nValue);
-        for(i = 0; i < Value.m_nValue; i++)
-        {
-            m_pEncoder->next_u16(Value.m_pValue[i]);
-        }
+        m_pEncoder->next_u16v(Value.m_pValue, Value.m_nValue);
     }
 }
 
@@ -307,13 +396,8 @@ CFrameEncoderStream::put_s16v (
 
     if(checkAvailable(nByte, pFieldDescriptor))
     {
-        unsigned int            i;
-
         m_pEncoder->next_u16(Value.m_nValue);
-        for(i = 0; i < Value.m_nValue; i++)
-        {
-            m_pEncoder->next_u16(Value.m_pValue[i]);
-        }
+        m_pEncoder->next_u16v((const llrp_u16_t *) Value.m_pValue, Value.m_nValue);
     }
 }
 
@@ -354,13 +438,8 @@ CFrameEncoderStream::put_u32v (
 
     if(checkAvailable(nByte, pFieldDescriptor))
     {
-        unsigned int            i;
-
         m_pEncoder->next_u16(Value.m_nValue);
-        for(i = 0; i < Value.m_nValue; i++)
-        {
-            m_pEncoder->next_u32(Value.m_pValue[i]);
-        }
+        m_pEncoder->next_u32v(Value.m_pValue, Value.m_nValue);
     }
 }
 
@@ -375,13 +454,8 @@ CFrameEncoderStream::put_s32v (
 
     if(checkAvailable(nByte, pFieldDescriptor))
     {
-        unsigned int            i;
-
         m_pEncoder->next_u16(Value.m_nValue);
-        for(i = 0; i < Value.m_nValue; i++)
-        {
-            m_pEncoder->next_u32(Value.m_pValue[i]);
-        }
+        m_pEncoder->next_u32v((const llrp_u32_t *) Value.m_pValue, Value.m_nValue);
     }
 }
 
@@ -422,13 +496,8 @@ CFrameEncoderStream::put_u64v (
 
     if(checkAvailable(nByte, pFieldDescriptor))
     {
-        unsigned int            i;
-
         m_pEncoder->next_u16(Value.m_nValue);
-        for(i = 0; i < Value.m_nValue; i++)
-        {
-            m_pEncoder->next_u64(Value.m_pValue[i]);
-        }
+        m_pEncoder->next_u64v(Value.m_pValue, Value.m_nValue);
     }
 }
 
@@ -443,13 +512,8 @@ CFrameEncoderStream::put_s64v (
 
     if(checkAvailable(nByte, pFieldDescriptor))
     {
-        unsigned int            i;
-
         m_pEncoder->next_u16(Value.m_nValue);
-        for(i = 0; i < Value.m_nValue; i++)
-        {
-            m_pEncoder->next_u64(Value.m_pValue[i]);
-        }
+        m_pEncoder->next_u64v((const llrp_u64_t *) Value.m_pValue, Value.m_nValue);
     }
 }
 
@@ -787,6 +851,14 @@ CFrameEncoderStream::putElement (
     unsigned int        nLength;
     unsigned char *     pLen;
 
+    /*
+     * A measuring encoder has no buffer to back-patch.
+     */
+    if(NULL == m_pEncoder->m_pBuffer)
+    {
+        return;
+    }
+
     nLength = m_pEncoder->m_iNext - m_iBegin;
     pLen = &m_pEncoder->m_pBuffer[m_iBegin];
 
@@ -853,6 +925,12 @@ CFrameEncoderStream::checkAvailable (
         return FALSE;
     }
 
+    if(NULL != m_pEncoder->m_pTemplate)
+    {
+        m_pEncoder->m_pTemplate->noteField(pFieldDescriptor,
+            m_pEncoder->m_iNext, nByte);
+    }
+
     return TRUE;
 }
 
@@ -0,0 +1,292 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+
+#include "ltkcpp_platform.h"
+#include "ltkcpp_base.h"
+#include "ltkcpp_frame.h"
+
+
+namespace LLRP
+{
+
+/*
+ * Offset of the MessageID in every message header:
+ * Rsvd/Ver/Type (2 bytes), then Length (4 bytes).
+ */
+#define MESSAGE_ID_OFFSET       6u
+
+CFrameTemplate::CFrameTemplate (void)
+{
+    m_nSlot  = 0;
+    m_pFrame = NULL;
+    m_nFrame = 0;
+    m_pType  = NULL;
+}
+
+CFrameTemplate::~CFrameTemplate (void)
+{
+    delete[] m_pFrame;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Name a field whose value varies between instances
+ **
+ ** @param[in]  pFieldDescriptor    The field, e.g.
+ **                                 &CENABLE_ROSPEC::s_fdROSpecID
+ **
+ ** @return     >=0             Slot index, for instantiate()
+ **             <0              Too many slots, or not a byte aligned
+ **                             scalar field
+ **
+ *****************************************************************************/
+
+int
+CFrameTemplate::addSlot (
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    unsigned int                nByte;
+
+    switch(pFieldDescriptor->m_eFieldType)
+    {
+    case CFieldDescriptor::FT_U8:
+    case CFieldDescriptor::FT_S8:
+    case CFieldDescriptor::FT_E8:
+        nByte = 1u;
+        break;
+
+    case CFieldDescriptor::FT_U16:
+    case CFieldDescriptor::FT_S16:
+    case CFieldDescriptor::FT_E16:
+        nByte = 2u;
+        break;
+
+    case CFieldDescriptor::FT_U32:
+    case CFieldDescriptor::FT_S32:
+    case CFieldDescriptor::FT_E32:
+        nByte = 4u;
+        break;
+
+    case CFieldDescriptor::FT_U64:
+    case CFieldDescriptor::FT_S64:
+        nByte = 8u;
+        break;
+
+    default:
+        return -1;
+    }
+
+    if(MAX_SLOT <= m_nSlot || NULL != m_pFrame)
+    {
+        return -1;
+    }
+
+    m_aSlot[m_nSlot].pFieldDescriptor = pFieldDescriptor;
+    m_aSlot[m_nSlot].iOffset = 0;
+    m_aSlot[m_nSlot].nByte = nByte;
+    m_aSlot[m_nSlot].nSeen = 0;
+
+    return (int) m_nSlot++;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Encode the message into the template frame
+ **
+ ** The message is only read. The caller still owns it
+ ** and may delete it right after.
+ **
+ ** @param[in]  pMessage        The message, slot fields set to
+ **                             any value
+ **
+ ** @return     RC_OK           Template is ready
+ **             RC_...          Encode failed or a slot was not found
+ **                             exactly once. See m_ErrorDetails.
+ **
+ *****************************************************************************/
+
+EResultCode
+CFrameTemplate::compile (
+  const CMessage *              pMessage)
+{
+    CErrorDetails *             pError = &m_ErrorDetails;
+    unsigned int                nFrame;
+
+    pError->clear();
+
+    if(NULL != m_pFrame)
+    {
+        pError->resultCodeAndWhatStr(RC_MiscError,
+            "template already compiled");
+        return pError->m_eResultCode;
+    }
+
+    /*
+     * Size it exactly.
+     */
+    {
+        CFrameEncoder           MeasuringEncoder;
+
+        MeasuringEncoder.encodeElement(pMessage);
+        if(RC_OK != MeasuringEncoder.m_ErrorDetails.m_eResultCode)
+        {
+            *pError = MeasuringEncoder.m_ErrorDetails;
+            return pError->m_eResultCode;
+        }
+        nFrame = MeasuringEncoder.getLength();
+    }
+
+    /*
+     * Encode it for real, noting where the slots land.
+     */
+    m_pFrame = new unsigned char[nFrame];
+
+    {
+        CFrameEncoder           Encoder(m_pFrame, nFrame);
+
+        Encoder.m_pTemplate = this;
+        Encoder.encodeElement(pMessage);
+        if(RC_OK != Encoder.m_ErrorDetails.m_eResultCode)
+        {
+            *pError = Encoder.m_ErrorDetails;
+        }
+    }
+
+    for(unsigned int iSlot = 0;
+        RC_OK == pError->m_eResultCode && iSlot < m_nSlot;
+        iSlot++)
+    {
+        if(1u != m_aSlot[iSlot].nSeen)
+        {
+            pError->resultCodeAndWhatStr(RC_MiscError,
+                0 == m_aSlot[iSlot].nSeen ?
+                    "template slot field not in message" :
+                    "template slot field occurs more than once");
+            pError->m_pRefField = m_aSlot[iSlot].pFieldDescriptor;
+        }
+    }
+
+    if(RC_OK != pError->m_eResultCode)
+    {
+        delete[] m_pFrame;
+        m_pFrame = NULL;
+        return pError->m_eResultCode;
+    }
+
+    m_nFrame = nFrame;
+    m_pType  = pMessage->m_pType;
+
+    return RC_OK;
+}
+
+/** @brief Type of the compiled message, NULL before compile() */
+const CTypeDescriptor *
+CFrameTemplate::getType (void) const
+{
+    return m_pType;
+}
+
+/** @brief Exact size of an instance, 0 before compile() */
+unsigned int
+CFrameTemplate::getLength (void) const
+{
+    return m_nFrame;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Copy the frame into a buffer and patch in the variable values
+ **
+ ** @param[out] pBuffer         Where the frame goes
+ ** @param[in]  nBuffer         Size of pBuffer
+ ** @param[in]  MessageID       MessageID for this instance
+ ** @param[in]  pSlotValues     One value per slot, in addSlot() order.
+ **                             NULL leaves the compiled values.
+ **
+ ** @return     >0              Frame length
+ **             0               Not compiled or buffer too small
+ **
+ *****************************************************************************/
+
+unsigned int
+CFrameTemplate::instantiate (
+  unsigned char *               pBuffer,
+  unsigned int                  nBuffer,
+  llrp_u32_t                    MessageID,
+  const llrp_u64_t *            pSlotValues) const
+{
+    if(NULL == m_pFrame || nBuffer < m_nFrame)
+    {
+        return 0;
+    }
+
+    memcpy(pBuffer, m_pFrame, m_nFrame);
+
+    pBuffer[MESSAGE_ID_OFFSET + 0u] = MessageID >> 24u;
+    pBuffer[MESSAGE_ID_OFFSET + 1u] = MessageID >> 16u;
+    pBuffer[MESSAGE_ID_OFFSET + 2u] = MessageID >> 8u;
+    pBuffer[MESSAGE_ID_OFFSET + 3u] = MessageID >> 0u;
+
+    if(NULL != pSlotValues)
+    {
+        for(unsigned int iSlot = 0; iSlot < m_nSlot; iSlot++)
+        {
+            const SSlot *       pSlot = &m_aSlot[iSlot];
+            llrp_u64_t          Value = pSlotValues[iSlot];
+
+            for(unsigned int Ix = pSlot->nByte; Ix > 0; Ix--)
+            {
+                pBuffer[pSlot->iOffset + Ix - 1u] = (llrp_byte_t) Value;
+                Value >>= 8u;
+            }
+        }
+    }
+
+    return m_nFrame;
+}
+
+/*
+ * Called by CFrameEncoderStream::checkAvailable() for every
+ * byte aligned field while compile() is encoding.
+ */
+void
+CFrameTemplate::noteField (
+  const CFieldDescriptor *      pFieldDescriptor,
+  unsigned int                  iOffset,
+  unsigned int                  nByte)
+{
+    for(unsigned int iSlot = 0; iSlot < m_nSlot; iSlot++)
+    {
+        SSlot *                 pSlot = &m_aSlot[iSlot];
+
+        if(pSlot->pFieldDescriptor == pFieldDescriptor &&
+           pSlot->nByte == nByte)
+        {
+            pSlot->iOffset = iOffset;
+            pSlot->nSeen++;
+        }
+    }
+}
+
+};  /* namespace LLRP */
@@ -22,9 +22,14 @@
 #include "ltkcpp.h"
 
 
+/* The Makefile names it, in LTKCPP_OUTDIR */
+#ifndef LTKCPP_GENOUT_INC
+#define LTKCPP_GENOUT_INC "out_ltkcpp.inc"
+#endif
+
 namespace LLRP
 {
-#include "out_ltkcpp.inc"
+#include LTKCPP_GENOUT_INC
 
 
 static char     ident[] = {
@@ -55,5 +60,24 @@ getTheTypeRegistry (void)
 }
 
 
+/**
+ ****************************************************************************
+ ** @brief Gets the process-wide type registry for the LTKCPP
+ **
+ ** Built once by the first caller. Initialization of the
+ ** function-local static is thread-safe, so concurrent first
+ ** calls are fine. The registry is intentionally never deleted.
+ **
+ ** @return CTypeRegistry The shared type registry.
+ **/
+const CTypeRegistry *
+getTheSharedTypeRegistry (void)
+{
+    static const CTypeRegistry *    s_pTypeRegistry = getTheTypeRegistry();
+
+    return s_pTypeRegistry;
+}
+
+
 }; /* namespace LLRP */
 
@@ -0,0 +1,36 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+/*
+ * Compiles one of the extra parts of the generated code, the
+ * message and parameter classes ltkcpp_gen_cpp.xslt put in
+ * out_ltkcpp_N.inc when run with NParts. The Makefile builds
+ * this once per part with LTKCPP_GENPART_INC naming the file.
+ * Part 0, with the descriptors and the enroll function, is
+ * out_ltkcpp.inc and goes through ltkcpp_genout.cpp.
+ */
+
+#include "ltkcpp.h"
+
+
+namespace LLRP
+{
+#include LTKCPP_GENPART_INC
+}; /* namespace LLRP */
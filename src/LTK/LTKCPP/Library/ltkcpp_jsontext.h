@@ -0,0 +1,761 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+
+/**
+ *****************************************************************************
+ **
+ ** @file  ltkcpp_jsontext.h
+ **
+ ** @brief Classes to encode and decode compact JSON
+ **
+ ** These classes convert LTKCPP objects to and from a compact
+ ** JSON form. They are driven by the same type and field
+ ** descriptors as the LTK-XML classes.
+ **
+ ** An element is an object with one member named for its type:
+ **
+ **     {"RO_ACCESS_REPORT":{"MessageID":0,"TagReportData":[...]}}
+ **
+ ** Inside, the fields come first, in descriptor order and keyed
+ ** by field name, then the sub-parameters keyed by their type
+ ** name. A parameter is an object; parameters from a list are
+ ** an array, one array per run of the same type. Values:
+ **
+ **     integers, u2                number (u64 time stamps in usec)
+ **     u1                          true or false
+ **     enumerations                name string, or number if unknown
+ **     integer vectors             array of numbers, or a hex string
+ **                                 if the field format is hex
+ **     e8v                         array of names or numbers
+ **     u96, bytesToEnd             hex string
+ **     u1v                         {"Count":bits,"Data":"hex"}
+ **     utf8v                       string
+ **
+ ** There is no whitespace in the output. The decoder accepts any
+ ** JSON whitespace and a sequence of elements one after another,
+ ** e.g. one message per line.
+ **
+ *****************************************************************************/
+
+namespace LLRP
+{
+class CXMLTextSink;
+class CJSONTextEncoder;
+class CJSONTextEncoderStream;
+class CJSONTextDecoder;
+class CJSONTextDecoderStream;
+
+class CJSONTextEncoder : public CEncoder
+{
+    friend class CJSONTextEncoderStream;
+
+  private:
+    char *                      m_pBuffer;
+    int                         m_nBuffer;
+    int                         m_iNext;
+    CXMLTextSink *              m_pSink;
+    int                         m_bFailed;
+
+  public:
+    int                         m_bOverflow;
+
+  public:
+    /*
+     * Fill a fixed buffer. Text is NUL terminated. If it
+     * doesn't fit m_bOverflow is set and the rest dropped.
+     */
+    CJSONTextEncoder (
+      char *                    pBuffer,
+      int                       nBuffer);
+
+    /*
+     * Stream to pSink in chunks. Any of the XML text sinks
+     * will do. A failed sink write is reported in m_ErrorDetails.
+     */
+    CJSONTextEncoder (
+      CXMLTextSink *            pSink);
+
+    ~CJSONTextEncoder (void);
+
+    void
+    encodeElement (
+      const CElement *          pElement);
+
+  private:
+    void
+    append (
+      const char *              pData,
+      unsigned int              nData);
+
+    void
+    flush (void);
+};
+
+class CJSONTextEncoderStream : public CEncoderStream
+{
+    friend class CJSONTextEncoder;
+
+  public:
+    void
+    putRequiredSubParameter (
+      const CParameter *        pParameter,
+      const CTypeDescriptor *   pRefType);
+
+    void
+    putOptionalSubParameter (
+      const CParameter *        pParameter,
+      const CTypeDescriptor *   pRefType);
+
+    void
+    putRequiredSubParameterList (
+      const tListOfParameters * pParameterList,
+      const CTypeDescriptor *   pRefType);
+
+    void
+    putOptionalSubParameterList (
+      const tListOfParameters * pParameterList,
+      const CTypeDescriptor *   pRefType);
+
+    /*
+     * 8-bit types
+     */
+
+    void
+    put_u8 (
+      llrp_u8_t                 Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_s8 (
+      llrp_s8_t                 Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_u8v (
+      llrp_u8v_t                Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_s8v (
+      llrp_s8v_t                Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    /*
+     * 16-bit types
+     */
+
+    void
+    put_u16 (
+      llrp_u16_t                Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_s16 (
+      llrp_s16_t                Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_u16v (
+      llrp_u16v_t               Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_s16v (
+      llrp_s16v_t               Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    /*
+     * 32-bit types
+     */
+
+    void
+    put_u32 (
+      llrp_u32_t                Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_s32 (
+      llrp_s32_t                Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_u32v (
+      llrp_u32v_t               Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_s32v (
+      llrp_s32v_t               Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    /*
+     * 64-bit types
+     */
+
+    void
+    put_u64 (
+      llrp_u64_t                Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_s64 (
+      llrp_s64_t                Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_u64v (
+      llrp_u64v_t               Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_s64v (
+      llrp_s64v_t               Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    /*
+     * Special types
+     */
+
+    void
+    put_u1 (
+      llrp_u1_t                 Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_u1v (
+      llrp_u1v_t                Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_u2 (
+      llrp_u2_t                 Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_u96 (
+      llrp_u96_t                Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_utf8v (
+      llrp_utf8v_t              Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_bytesToEnd (
+      llrp_bytesToEnd_t         Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    /*
+     * Enumerated types of various sizes
+     */
+
+    void
+    put_e1 (
+      int                       eValue,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_e2 (
+      int                       eValue,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_e8 (
+      int                       eValue,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_e16 (
+      int                       eValue,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_e32 (
+      int                       eValue,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    put_e8v (
+      llrp_u8v_t                Value,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    /*
+     * Reserved types are some number of bits
+     */
+
+    void
+    put_reserved (
+      unsigned int              nBits);
+
+  private:
+    CJSONTextEncoderStream (
+      CJSONTextEncoder *        pEncoder);
+
+    CJSONTextEncoderStream (
+      CJSONTextEncoderStream *  pEnclosingEncoderStream);
+
+    CJSONTextEncoder *          m_pEncoder;
+    CJSONTextEncoderStream *    m_pEnclosingEncoderStream;
+    const CTypeDescriptor *     m_pRefType;
+    int                         m_nMember;
+
+    void
+    putElementBody (
+      const CElement *          pElement);
+
+    void
+    putParameterRun (
+      tListOfParameters::const_iterator Begin,
+      tListOfParameters::const_iterator End);
+
+    void
+    put_enum (
+      int                       eValue,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    appendEnumValue (
+      int                       eValue,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    appendKey (
+      const char *              pName);
+
+    void
+    appendString (
+      const char *              pString);
+
+    void
+    appendQuoted (
+      const llrp_utf8_t *       pValue,
+      unsigned int              nValue);
+
+    void
+    appendDecimal (
+      llrp_u64_t                Value);
+
+    void
+    appendSignedDecimal (
+      llrp_s64_t                Value);
+
+    void
+    appendHexBytes (
+      const llrp_u8_t *         pValue,
+      unsigned int              nValue);
+
+    void
+    appendHex (
+      llrp_u64_t                Value,
+      unsigned int              nDigit);
+};
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Decode compact JSON back into LTKCPP elements
+ **
+ ** The text is parsed in place, without building a document
+ ** tree first. Each decodeMessage() call decodes the next
+ ** element of the input. Errors are reported in m_ErrorDetails
+ ** with the same result codes as the LTK-XML decoder, and
+ ** m_OtherDetail set to the byte offset into the input.
+ ** After an error the rest of the input is not decoded.
+ **
+ *****************************************************************************/
+class CJSONTextDecoder : public CDecoder
+{
+    friend class CJSONTextDecoderStream;
+
+  private:
+    const char *                m_pBuffer;
+    const char *                m_pNext;
+    const char *                m_pEnd;
+
+  public:
+    CJSONTextDecoder (
+  const CTypeRegistry *         pTypeRegistry,
+      const char *              pBuffer,
+      int                       nBuffer);
+
+    ~CJSONTextDecoder (void);
+
+    CMessage *
+    decodeMessage (void);
+
+    /** @brief Decode the next element, message or parameter */
+    CElement *
+    decodeElement (void);
+
+    /** @brief TRUE when nothing but whitespace is left, or after an error */
+    int
+    isEndOfInput (void);
+};
+
+class CJSONTextDecoderStream : public CDecoderStream
+{
+  friend class CJSONTextDecoder;
+
+  private:
+    CJSONTextDecoderStream (
+      CJSONTextDecoder *        pDecoder);
+
+    CJSONTextDecoderStream (
+      CJSONTextDecoderStream *  pEnclosingDecoderStream);
+
+  public:
+    CElement *
+    decodeElement (
+      int                       bAllowMessage);
+
+    /*
+     * 8-bit types
+     */
+
+    /** @brief Decodes an llrp_u8_t (unsigned 8-bit number) into the specified field descriptor */
+    llrp_u8_t
+    get_u8 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes a llrp_s8_t (signed 8-bit number) into the specified field descriptor */
+    llrp_s8_t
+    get_s8 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_u8v_t into the specified field descriptor */
+    llrp_u8v_t
+    get_u8v (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_s8v_t into the specified field descriptor */
+    llrp_s8v_t
+    get_s8v (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /*
+     * 16-bit types
+     */
+
+    /** @brief Decodes an llrp_u16_t (unsigned 16-bit number) into the specified field descriptor */
+    llrp_u16_t
+    get_u16 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes a llrp_s16_t (signed 16-bit number) into the specified field descriptor */
+    llrp_s16_t
+    get_s16 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes a llrp_u16v_t into the specified field descriptor */
+    llrp_u16v_t
+    get_u16v (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_u16v_t into the specified field descriptor */
+    llrp_s16v_t
+    get_s16v (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /*
+     * 32-bit types
+     */
+
+    /** @brief Decodes an llrp_u32_t (unsigned 32-bit number) into the specified field descriptor */
+    llrp_u32_t
+    get_u32 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_s32_t (signed 32-bit number) into the specified field descriptor */
+    llrp_s32_t
+    get_s32 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_u32v_t into the specified field descriptor */
+    llrp_u32v_t
+    get_u32v (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_s32v_t into the specified field descriptor */
+    llrp_s32v_t
+    get_s32v (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /*
+     * 64-bit types
+     */
+
+    /** @brief Decodes an llrp_u64_t (unsigned 64-bit number) into the specified field descriptor */
+    llrp_u64_t
+    get_u64 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_s64_t (signed 64-bit number) into the specified field descriptor */
+    llrp_s64_t
+    get_s64 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_u64v_t into the specified field descriptor */
+    llrp_u64v_t
+    get_u64v (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_s64v_t into the specified field descriptor */
+    llrp_s64v_t
+    get_s64v (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /*
+     * Special types
+     */
+
+    /** @brief Decodes an llrp_u1_t (unsigned 1 bit number) into the specified field descriptor */
+    llrp_u1_t
+    get_u1 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_u1v_t into the specified field descriptor */
+    llrp_u1v_t
+    get_u1v (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_u2_t into the specified field descriptor */
+    llrp_u2_t
+    get_u2 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_u96_t into the specified field descriptor */
+    llrp_u96_t
+    get_u96 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_utf8v_t into the specified field descriptor */
+    llrp_utf8v_t
+    get_utf8v (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an llrp_bytesToEnd_t into the specified field descriptor */
+    llrp_bytesToEnd_t
+    get_bytesToEnd (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /*
+     * Enumerated types of various sizes
+     */
+
+    /** @brief Decodes a 1 bit enumerated field into the specified field descriptor */
+    int
+    get_e1 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes a 2 bit enumerated field into the specified field descriptor */
+    int
+    get_e2 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes a 8 bit enumerated field into the specified field descriptor */
+    int
+    get_e8 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes a 16 bit enumerated field into the specified field descriptor */
+    int
+    get_e16 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes a 32 bit enumerated field into the specified field descriptor */
+    int
+    get_e32 (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /** @brief Decodes an enumerated u8v field into the specified field descriptor */
+    llrp_u8v_t
+    get_e8v (
+      const CFieldDescriptor *  pFieldDesc);
+
+    /*
+     * Reserved means some number of bits
+     */
+    /* @brief skips a number of reserved bits and discards during the encode/decode process */
+    void
+    get_reserved (
+      unsigned int          nBits);
+
+  private:
+    CJSONTextDecoder *          m_pDecoder;
+    CJSONTextDecoderStream *    m_pEnclosingDecoderStream;
+    const CTypeDescriptor *     m_pRefType;
+    int                         m_nMember;
+    const char *                m_pHex;
+
+    CElement *
+    decodeElementBody (
+      const CTypeDescriptor *   pTypeDescriptor);
+
+    int
+    decodeSubParameter (
+      const CTypeDescriptor *   pSubType,
+      CElement *                pElement);
+
+    const CTypeDescriptor *
+    lookupType (
+      const char *              pName,
+      unsigned int              nName);
+
+    int
+    getNextMember (
+      const char **             ppName,
+      unsigned int *            pnName);
+
+    int
+    getMember (
+      const char *              pWantName,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    int
+    getFieldValue (
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    endObject (
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    llrp_s64_t
+    getInteger (
+      const CFieldDescriptor *  pFieldDescriptor,
+      llrp_s64_t                minValue,
+      llrp_s64_t                maxValue);
+
+    llrp_s64_t
+    getNumber (
+      const CFieldDescriptor *  pFieldDescriptor,
+      llrp_s64_t                minValue,
+      llrp_s64_t                maxValue);
+
+    int
+    getEnum (
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    int
+    countVector (
+      const CFieldDescriptor *  pFieldDescriptor,
+      unsigned int              nDigit);
+
+    llrp_s64_t
+    getVectorItem (
+      const CFieldDescriptor *  pFieldDescriptor,
+      int                       iItem,
+      unsigned int              nDigit,
+      llrp_s64_t                minValue,
+      llrp_s64_t                maxValue);
+
+    void
+    endVector (
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    int
+    getString (
+      const CFieldDescriptor *  pFieldDescriptor,
+      const char **             ppValue,
+      unsigned int *            pnValue);
+
+    int
+    getHexBytes (
+      const CFieldDescriptor *  pFieldDescriptor,
+      const char *              pHex,
+      unsigned int              nHex,
+      llrp_u8_t *               pValue,
+      unsigned int              nValue);
+
+    unsigned int
+    unescapeString (
+      const CFieldDescriptor *  pFieldDescriptor,
+      const char *              pStr,
+      unsigned int              nStr,
+      llrp_utf8_t *             pOut);
+
+    void
+    skipWhitespace (void);
+
+    int
+    expectChar (
+      char                      Ch,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    void
+    setError (
+      EResultCode               eResultCode,
+      const char *              pWhatStr,
+      const CFieldDescriptor *  pFieldDescriptor);
+
+    static int
+    hexDigitValue (
+      int                       Ch);
+
+    private:
+      static const llrp_s64_t MAX_U8 =  ((1ull << 8u) - 1u);
+      static const llrp_s64_t MIN_U8 =  0ull;
+      static const llrp_s64_t MAX_S8 =  ((1ull << 7u) - 1u);
+      static const llrp_s64_t MIN_S8 =  (-1ll - MAX_S8);
+
+      static const llrp_s64_t MAX_U16 = ((1ull << 16u) - 1u);
+      static const llrp_s64_t MIN_U16 = 0ull;
+      static const llrp_s64_t MAX_S16 = ((1ull << 15u) - 1u);
+      static const llrp_s64_t MIN_S16 = (-1ll - MAX_S16);
+
+      static const llrp_s64_t MAX_U32 = ((1ull << 32u) - 1u);
+      static const llrp_s64_t MIN_U32 = 0ull;
+      static const llrp_s64_t MAX_S32 = ((1ull << 31u) - 1u);
+      static const llrp_s64_t MIN_S32 = (-1ll - MAX_S32);
+
+      static const llrp_s64_t MAX_S64 = ((1ull << 63u) - 1u);
+      static const llrp_s64_t MIN_S64 = (-1ll - MAX_S64);
+};
+
+/*
+** @brief Streams a CElement as compact JSON to a sink
+**
+** @param[in]  pElement      The CElement to encode to JSON
+** @param[in]  pSink         Where the text goes
+**
+** @return EResultCode Result code from the operation
+*/
+extern EResultCode
+toJSONText (
+  const CElement *              pElement,
+  CXMLTextSink *                pSink);
+
+/*
+** @brief Encodes a CElement as compact JSON into a buffer
+**
+** @param[in]  pElement      The CElement to encode to JSON
+** @param[out] pBuffer       The buffer, NUL terminated on return
+** @param[in]  nBuffer       The size of pBuffer
+**
+** @return EResultCode Result code from the operation
+*/
+extern EResultCode
+toJSONString (
+  const CElement *              pElement,
+  char *                        pBuffer,
+  int                           nBuffer);
+
+};
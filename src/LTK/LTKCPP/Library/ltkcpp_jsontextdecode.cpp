@@ -0,0 +1,1555 @@
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+/**
+ *****************************************************************************
+ **
+ ** @file  ltkcpp_jsontextdecode.cpp
+ **
+ ** @brief Classes to decode compact JSON
+ **
+ ** The decoder walks the text with a cursor and hands each
+ ** value to the generated decodeFields() as it asks for it.
+ ** Nothing is tokenized or tree-built up front.
+ **
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <iosfwd>
+#include <string>
+
+#if defined(linux)
+#include <stdint.h>              // required for linux
+#endif
+
+#include "ltkcpp_platform.h"
+#include "ltkcpp_base.h"
+#include "ltkcpp_xmltext.h"
+#include "ltkcpp_jsontext.h"
+
+
+namespace LLRP
+{
+
+/* Longest type or field name we look up */
+#define JSON_MAX_NAME           128
+
+CJSONTextDecoder::CJSONTextDecoder (
+  const CTypeRegistry *         pTypeRegistry,
+  const char *                  pBuffer,
+  int                           nBuffer) : CDecoder(pTypeRegistry)
+{
+    m_pBuffer = pBuffer;
+    m_pNext   = pBuffer;
+    m_pEnd    = pBuffer + nBuffer;
+}
+
+CJSONTextDecoder::~CJSONTextDecoder (void)
+{
+}
+
+CMessage *
+CJSONTextDecoder::decodeMessage (void)
+{
+    CElement *                  pElement;
+
+    pElement = decodeElement();
+
+    if(NULL != pElement && !pElement->m_pType->m_bIsMessage)
+    {
+        m_ErrorDetails.m_eResultCode = RC_MiscError;
+        m_ErrorDetails.m_pWhatStr    = "parameter where message expected";
+        m_ErrorDetails.m_pRefType    = pElement->m_pType;
+        m_ErrorDetails.m_pRefField   = NULL;
+        m_ErrorDetails.m_OtherDetail = (int) (m_pNext - m_pBuffer);
+        delete pElement;
+        return NULL;
+    }
+
+    return (CMessage *) pElement;
+}
+
+CElement *
+CJSONTextDecoder::decodeElement (void)
+{
+    if(isEndOfInput())
+    {
+        return NULL;
+    }
+
+    CJSONTextDecoderStream      DecoderStream(this);
+
+    return DecoderStream.decodeElement(TRUE);
+}
+
+int
+CJSONTextDecoder::isEndOfInput (void)
+{
+    if(RC_OK != m_ErrorDetails.m_eResultCode)
+    {
+        return TRUE;
+    }
+
+    while(m_pNext < m_pEnd &&
+          (' ' == *m_pNext || '\n' == *m_pNext ||
+           '\r' == *m_pNext || '\t' == *m_pNext))
+    {
+        m_pNext++;
+    }
+
+    return m_pNext >= m_pEnd;
+}
+
+CJSONTextDecoderStream::CJSONTextDecoderStream (
+  CJSONTextDecoder *            pDecoder)
+{
+    m_pDecoder                = pDecoder;
+    m_pEnclosingDecoderStream = NULL;
+    m_pRefType                = NULL;
+    m_nMember                 = 0;
+    m_pHex                    = NULL;
+}
+
+CJSONTextDecoderStream::CJSONTextDecoderStream (
+  CJSONTextDecoderStream *      pEnclosingDecoderStream)
+{
+    m_pDecoder                = pEnclosingDecoderStream->m_pDecoder;
+    m_pEnclosingDecoderStream = pEnclosingDecoderStream;
+    m_pRefType                = pEnclosingDecoderStream->m_pRefType;
+    m_nMember                 = 0;
+    m_pHex                    = NULL;
+}
+
+/*
+ * {"TypeName":{...}} as written by CJSONTextEncoder::encodeElement()
+ */
+CElement *
+CJSONTextDecoderStream::decodeElement (
+  int                           bAllowMessage)
+{
+    CErrorDetails *             pError = &m_pDecoder->m_ErrorDetails;
+    const CTypeDescriptor *     pTypeDescriptor;
+    CElement *                  pElement;
+    const char *                pName;
+    unsigned int                nName;
+
+    if(!expectChar('{', NULL) ||
+       1 != getNextMember(&pName, &nName))
+    {
+        if(RC_OK == pError->m_eResultCode)
+        {
+            setError(RC_FieldUnderrun, "missing element", NULL);
+        }
+        return NULL;
+    }
+
+    pTypeDescriptor = lookupType(pName, nName);
+    if(NULL == pTypeDescriptor)
+    {
+        return NULL;
+    }
+
+    if(pTypeDescriptor->m_bIsMessage && !bAllowMessage)
+    {
+        m_pRefType = pTypeDescriptor;
+        setError(RC_MiscError, "message as subparameter", NULL);
+        return NULL;
+    }
+
+    CJSONTextDecoderStream      NestStream(this);
+
+    pElement = NestStream.decodeElementBody(pTypeDescriptor);
+    if(NULL == pElement)
+    {
+        return NULL;
+    }
+
+    if(0 != getNextMember(&pName, &nName))
+    {
+        delete pElement;
+        if(RC_OK == pError->m_eResultCode)
+        {
+            setError(RC_XMLExtraNode, "extra member after element", NULL);
+        }
+        return NULL;
+    }
+
+    return pElement;
+}
+
+/*
+ * The {...} of one element: MessageID, the fields in order,
+ * then the sub-parameters.
+ */
+CElement *
+CJSONTextDecoderStream::decodeElementBody (
+  const CTypeDescriptor *       pTypeDescriptor)
+{
+    CErrorDetails *             pError = &m_pDecoder->m_ErrorDetails;
+    CElement *                  pElement;
+    llrp_u32_t                  MessageID = 0;
+    const char *                pName;
+    unsigned int                nName;
+    int                         rc;
+
+    m_pRefType = pTypeDescriptor;
+
+    if(!expectChar('{', NULL))
+    {
+        return NULL;
+    }
+
+    /* messages may lead with their MessageID */
+    if(pTypeDescriptor->m_bIsMessage)
+    {
+        const char *            pSave = m_pDecoder->m_pNext;
+
+        rc = getNextMember(&pName, &nName);
+        if(1 == rc && 9u == nName && 0 == memcmp(pName, "MessageID", 9u))
+        {
+            MessageID = (llrp_u32_t) getNumber(NULL, MIN_U32, MAX_U32);
+        }
+        else
+        {
+            /* not there, read it again as a field */
+            m_pDecoder->m_pNext = pSave;
+            m_nMember = 0;
+        }
+
+        if(RC_OK != pError->m_eResultCode)
+        {
+            return NULL;
+        }
+    }
+
+    /* create our element to hold the information */
+    pElement = pTypeDescriptor->constructElement();
+
+    if(NULL == pElement)
+    {
+        setError(RC_MessageAllocationFailed, "element allocation failed", NULL);
+        return NULL;
+    }
+
+    if(pTypeDescriptor->m_bIsMessage)
+    {
+        ((CMessage *) pElement)->setMessageID(MessageID);
+    }
+
+    /* decode the fields first */
+    pTypeDescriptor->m_pfDecodeFields(this, pElement);
+
+    /* whatever members are left are sub-parameters */
+    while(RC_OK == pError->m_eResultCode &&
+          1 == (rc = getNextMember(&pName, &nName)))
+    {
+        const CTypeDescriptor * pSubType;
+
+        pSubType = lookupType(pName, nName);
+        if(NULL == pSubType)
+        {
+            break;
+        }
+
+        if(pSubType->m_bIsMessage)
+        {
+            setError(RC_MiscError, "message as subparameter", NULL);
+            break;
+        }
+
+        skipWhitespace();
+        if(m_pDecoder->m_pNext < m_pDecoder->m_pEnd &&
+           '[' == *m_pDecoder->m_pNext)
+        {
+            /* a run of parameters of this type */
+            m_pDecoder->m_pNext++;
+            skipWhitespace();
+            if(m_pDecoder->m_pNext < m_pDecoder->m_pEnd &&
+               ']' == *m_pDecoder->m_pNext)
+            {
+                m_pDecoder->m_pNext++;
+                continue;
+            }
+            while(decodeSubParameter(pSubType, pElement))
+            {
+                int             Ch;
+
+                skipWhitespace();
+                if(m_pDecoder->m_pNext >= m_pDecoder->m_pEnd)
+                {
+                    setError(RC_FieldUnderrun, "underrun in array", NULL);
+                    break;
+                }
+
+                Ch = *m_pDecoder->m_pNext++;
+                if(']' == Ch)
+                {
+                    break;
+                }
+                if(',' != Ch)
+                {
+                    setError(RC_XMLInvalidNodeType, "expected , or ]", NULL);
+                    break;
+                }
+            }
+        }
+        else
+        {
+            decodeSubParameter(pSubType, pElement);
+        }
+    }
+
+    if(RC_OK != pError->m_eResultCode)
+    {
+        delete pElement;
+        return NULL;
+    }
+
+    pElement->assimilateSubParameters(pError);
+
+    if(RC_OK != pError->m_eResultCode)
+    {
+        delete pElement;
+        return NULL;
+    }
+
+    return pElement;
+}
+
+int
+CJSONTextDecoderStream::decodeSubParameter (
+  const CTypeDescriptor *       pSubType,
+  CElement *                    pElement)
+{
+    CJSONTextDecoderStream      NestStream(this);
+    CParameter *                pParameter;
+
+    pParameter = (CParameter *) NestStream.decodeElementBody(pSubType);
+    if(NULL == pParameter)
+    {
+        return FALSE;
+    }
+
+    pParameter->m_pParent = pElement;
+    pElement->addSubParameterToAllList(pParameter);
+
+    return TRUE;
+}
+
+/*
+ * 8-bit types
+ */
+
+llrp_u8_t
+CJSONTextDecoderStream::get_u8 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    if(!getFieldValue(pFieldDesc))
+    {
+        return 0;
+    }
+
+    return (llrp_u8_t) getInteger(pFieldDesc, MIN_U8, MAX_U8);
+}
+
+llrp_s8_t
+CJSONTextDecoderStream::get_s8 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    if(!getFieldValue(pFieldDesc))
+    {
+        return 0;
+    }
+
+    return (llrp_s8_t) getInteger(pFieldDesc, MIN_S8, MAX_S8);
+}
+
+llrp_u8v_t
+CJSONTextDecoderStream::get_u8v (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    llrp_u8v_t                  Value;
+    int                         nValue;
+
+    if(!getFieldValue(pFieldDesc) ||
+       0 > (nValue = countVector(pFieldDesc, 2u)))
+    {
+        return Value;
+    }
+
+    Value = llrp_u8v_t(nValue);
+    for(int i = 0; i < nValue; i++)
+    {
+        Value.m_pValue[i] = (llrp_u8_t) getVectorItem(pFieldDesc, i, 2u,
+                                    MIN_U8, MAX_U8);
+    }
+    endVector(pFieldDesc);
+
+    return Value;
+}
+
+llrp_s8v_t
+CJSONTextDecoderStream::get_s8v (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    llrp_s8v_t                  Value;
+    int                         nValue;
+
+    if(!getFieldValue(pFieldDesc) ||
+       0 > (nValue = countVector(pFieldDesc, 2u)))
+    {
+        return Value;
+    }
+
+    Value = llrp_s8v_t(nValue);
+    for(int i = 0; i < nValue; i++)
+    {
+        Value.m_pValue[i] = (llrp_s8_t) getVectorItem(pFieldDesc, i, 2u,
+                                    MIN_S8, MAX_S8);
+    }
+    endVector(pFieldDesc);
+
+    return Value;
+}
+
+/*
+ * 16-bit types
+ */
+
+llrp_u16_t
+CJSONTextDecoderStream::get_u16 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    if(!getFieldValue(pFieldDesc))
+    {
+        return 0;
+    }
+
+    return (llrp_u16_t) getInteger(pFieldDesc, MIN_U16, MAX_U16);
+}
+
+llrp_s16_t
+CJSONTextDecoderStream::get_s16 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    if(!getFieldValue(pFieldDesc))
+    {
+        return 0;
+    }
+
+    return (llrp_s16_t) getInteger(pFieldDesc, MIN_S16, MAX_S16);
+}
+
+llrp_u16v_t
+CJSONTextDecoderStream::get_u16v (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    llrp_u16v_t                 Value;
+    int                         nValue;
+
+    if(!getFieldValue(pFieldDesc) ||
+       0 > (nValue = countVector(pFieldDesc, 4u)))
+    {
+        return Value;
+    }
+
+    Value = llrp_u16v_t(nValue);
+    for(int i = 0; i < nValue; i++)
+    {
+        Value.m_pValue[i] = (llrp_u16_t) getVectorItem(pFieldDesc, i, 4u,
+                                    MIN_U16, MAX_U16);
+    }
+    endVector(pFieldDesc);
+
+    return Value;
+}
+
+llrp_s16v_t
+CJSONTextDecoderStream::get_s16v (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    llrp_s16v_t                 Value;
+    int                         nValue;
+
+    if(!getFieldValue(pFieldDesc) ||
+       0 > (nValue = countVector(pFieldDesc, 4u)))
+    {
+        return Value;
+    }
+
+    Value = llrp_s16v_t(nValue);
+    for(int i = 0; i < nValue; i++)
+    {
+        Value.m_pValue[i] = (llrp_s16_t) getVectorItem(pFieldDesc, i, 4u,
+                                    MIN_S16, MAX_S16);
+    }
+    endVector(pFieldDesc);
+
+    return Value;
+}
+
+/*
+ * 32-bit types
+ */
+
+llrp_u32_t
+CJSONTextDecoderStream::get_u32 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    if(!getFieldValue(pFieldDesc))
+    {
+        return 0;
+    }
+
+    return (llrp_u32_t) getInteger(pFieldDesc, MIN_U32, MAX_U32);
+}
+
+llrp_s32_t
+CJSONTextDecoderStream::get_s32 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    if(!getFieldValue(pFieldDesc))
+    {
+        return 0;
+    }
+
+    return (llrp_s32_t) getInteger(pFieldDesc, MIN_S32, MAX_S32);
+}
+
+llrp_u32v_t
+CJSONTextDecoderStream::get_u32v (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    llrp_u32v_t                 Value;
+    int                         nValue;
+
+    if(!getFieldValue(pFieldDesc) ||
+       0 > (nValue = countVector(pFieldDesc, 8u)))
+    {
+        return Value;
+    }
+
+    Value = llrp_u32v_t(nValue);
+    for(int i = 0; i < nValue; i++)
+    {
+        Value.m_pValue[i] = (llrp_u32_t) getVectorItem(pFieldDesc, i, 8u,
+                                    MIN_U32, MAX_U32);
+    }
+    endVector(pFieldDesc);
+
+    return Value;
+}
+
+llrp_s32v_t
+CJSONTextDecoderStream::get_s32v (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    llrp_s32v_t                 Value;
+    int                         nValue;
+
+    if(!getFieldValue(pFieldDesc) ||
+       0 > (nValue = countVector(pFieldDesc, 8u)))
+    {
+        return Value;
+    }
+
+    Value = llrp_s32v_t(nValue);
+    for(int i = 0; i < nValue; i++)
+    {
+        Value.m_pValue[i] = (llrp_s32_t) getVectorItem(pFieldDesc, i, 8u,
+                                    MIN_S32, MAX_S32);
+    }
+    endVector(pFieldDesc);
+
+    return Value;
+}
+
+/*
+ * 64-bit types
+ */
+
+llrp_u64_t
+CJSONTextDecoderStream::get_u64 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    if(!getFieldValue(pFieldDesc))
+    {
+        return 0;
+    }
+
+    return (llrp_u64_t) getInteger(pFieldDesc, 0, MAX_S64);
+}
+
+llrp_s64_t
+CJSONTextDecoderStream::get_s64 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    if(!getFieldValue(pFieldDesc))
+    {
+        return 0;
+    }
+
+    return (llrp_s64_t) getInteger(pFieldDesc, MIN_S64, MAX_S64);
+}
+
+llrp_u64v_t
+CJSONTextDecoderStream::get_u64v (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    llrp_u64v_t                 Value;
+    int                         nValue;
+
+    if(!getFieldValue(pFieldDesc) ||
+       0 > (nValue = countVector(pFieldDesc, 16u)))
+    {
+        return Value;
+    }
+
+    Value = llrp_u64v_t(nValue);
+    for(int i = 0; i < nValue; i++)
+    {
+        Value.m_pValue[i] = (llrp_u64_t) getVectorItem(pFieldDesc, i, 16u,
+                                    0, MAX_S64);
+    }
+    endVector(pFieldDesc);
+
+    return Value;
+}
+
+llrp_s64v_t
+CJSONTextDecoderStream::get_s64v (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    llrp_s64v_t                 Value;
+    int                         nValue;
+
+    if(!getFieldValue(pFieldDesc) ||
+       0 > (nValue = countVector(pFieldDesc, 16u)))
+    {
+        return Value;
+    }
+
+    Value = llrp_s64v_t(nValue);
+    for(int i = 0; i < nValue; i++)
+    {
+        Value.m_pValue[i] = (llrp_s64_t) getVectorItem(pFieldDesc, i, 16u,
+                                    MIN_S64, MAX_S64);
+    }
+    endVector(pFieldDesc);
+
+    return Value;
+}
+
+/*
+ * Special types
+ */
+
+llrp_u1_t
+CJSONTextDecoderStream::get_u1 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    if(!getFieldValue(pFieldDesc))
+    {
+        return 0;
+    }
+
+    return (llrp_u1_t) getInteger(pFieldDesc, 0, 1);
+}
+
+/* {"Count":bits,"Data":"hex"} */
+llrp_u1v_t
+CJSONTextDecoderStream::get_u1v (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    llrp_u1v_t                  Value;
+    llrp_u16_t                  nBit;
+    const char *                pHex;
+    unsigned int                nHex;
+
+    if(!getFieldValue(pFieldDesc) || !expectChar('{', pFieldDesc))
+    {
+        return Value;
+    }
+
+    CJSONTextDecoderStream      NestStream(this);
+
+    if(!NestStream.getMember("Count", pFieldDesc))
+    {
+        return Value;
+    }
+    nBit = (llrp_u16_t) NestStream.getNumber(pFieldDesc, MIN_U16, MAX_U16);
+
+    if(!NestStream.getMember("Data", pFieldDesc) ||
+       !NestStream.getString(pFieldDesc, &pHex, &nHex))
+    {
+        return Value;
+    }
+
+    Value = llrp_u1v_t(nBit);
+    if(!getHexBytes(pFieldDesc, pHex, nHex,
+                    Value.m_pValue, (nBit + 7u) / 8u))
+    {
+        return Value;
+    }
+
+    NestStream.endObject(pFieldDesc);
+
+    return Value;
+}
+
+llrp_u2_t
+CJSONTextDecoderStream::get_u2 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    if(!getFieldValue(pFieldDesc))
+    {
+        return 0;
+    }
+
+    return (llrp_u2_t) getInteger(pFieldDesc, 0, 3);
+}
+
+llrp_u96_t
+CJSONTextDecoderStream::get_u96 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    llrp_u96_t                  Value;
+    const char *                pHex;
+    unsigned int                nHex;
+
+    memset(Value.m_aValue, 0, sizeof Value.m_aValue);
+
+    if(getFieldValue(pFieldDesc) &&
+       getString(pFieldDesc, &pHex, &nHex))
+    {
+        getHexBytes(pFieldDesc, pHex, nHex, Value.m_aValue, 12u);
+    }
+
+    return Value;
+}
+
+llrp_utf8v_t
+CJSONTextDecoderStream::get_utf8v (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    llrp_utf8v_t                Value;
+    const char *                pStr;
+    unsigned int                nStr;
+
+    if(!getFieldValue(pFieldDesc) ||
+       !getString(pFieldDesc, &pStr, &nStr))
+    {
+        return Value;
+    }
+
+    /* unescaping never makes the string longer */
+    Value = llrp_utf8v_t(nStr);
+    Value.m_nValue = (llrp_u16_t) unescapeString(pFieldDesc, pStr, nStr,
+                                                 Value.m_pValue);
+
+    return Value;
+}
+
+llrp_bytesToEnd_t
+CJSONTextDecoderStream::get_bytesToEnd (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    llrp_bytesToEnd_t           Value;
+    const char *                pHex;
+    unsigned int                nHex;
+
+    if(!getFieldValue(pFieldDesc) ||
+       !getString(pFieldDesc, &pHex, &nHex))
+    {
+        return Value;
+    }
+
+    Value = llrp_bytesToEnd_t(nHex / 2u);
+    getHexBytes(pFieldDesc, pHex, nHex, Value.m_pValue, nHex / 2u);
+
+    return Value;
+}
+
+/*
+ * Enumerated types of various sizes
+ */
+
+int
+CJSONTextDecoderStream::get_e1 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    return (int) get_u1(pFieldDesc);
+}
+
+int
+CJSONTextDecoderStream::get_e2 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    return (int) get_u2(pFieldDesc);
+}
+
+int
+CJSONTextDecoderStream::get_e8 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    return (int) get_u8(pFieldDesc);
+}
+
+int
+CJSONTextDecoderStream::get_e16 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    return (int) get_u16(pFieldDesc);
+}
+
+int
+CJSONTextDecoderStream::get_e32 (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    return (int) get_u32(pFieldDesc);
+}
+
+llrp_u8v_t
+CJSONTextDecoderStream::get_e8v (
+  const CFieldDescriptor *      pFieldDesc)
+{
+    return get_u8v(pFieldDesc);
+}
+
+/*
+ * Reserved bits carry nothing
+ */
+
+void
+CJSONTextDecoderStream::get_reserved (
+  unsigned int                  nBits)
+{
+}
+
+/*
+ * Helpers. They all do nothing once an error is recorded,
+ * so the generated decodeFields() can run to its end.
+ */
+
+/* Look up a member name as a type, an error if unknown */
+const CTypeDescriptor *
+CJSONTextDecoderStream::lookupType (
+  const char *                  pName,
+  unsigned int                  nName)
+{
+    char                        aName[JSON_MAX_NAME];
+    const CTypeDescriptor *     pTypeDescriptor = NULL;
+
+    if(nName < sizeof aName)
+    {
+        memcpy(aName, pName, nName);
+        aName[nName] = 0;
+        pTypeDescriptor = m_pDecoder->m_pRegistry->lookupByName(aName);
+    }
+
+    if(NULL == pTypeDescriptor)
+    {
+        setError(RC_UnknownParameterType,
+                 "unknown message or parameter type", NULL);
+    }
+
+    return pTypeDescriptor;
+}
+
+/*
+ * Move to the value of the next member. Returns 1 with the
+ * name, 0 after the closing brace, -1 on an error.
+ */
+int
+CJSONTextDecoderStream::getNextMember (
+  const char **                 ppName,
+  unsigned int *                pnName)
+{
+    const char *                pEnd = m_pDecoder->m_pEnd;
+    const char *                pName;
+
+    if(RC_OK != m_pDecoder->m_ErrorDetails.m_eResultCode)
+    {
+        return -1;
+    }
+
+    skipWhitespace();
+    if(m_pDecoder->m_pNext >= pEnd)
+    {
+        setError(RC_FieldUnderrun, "underrun in object", NULL);
+        return -1;
+    }
+
+    if('}' == *m_pDecoder->m_pNext)
+    {
+        m_pDecoder->m_pNext++;
+        return 0;
+    }
+
+    if(0 < m_nMember && !expectChar(',', NULL))
+    {
+        return -1;
+    }
+
+    if(!expectChar('"', NULL))
+    {
+        return -1;
+    }
+
+    /* names are plain ASCII, no escapes */
+    pName = m_pDecoder->m_pNext;
+    while(m_pDecoder->m_pNext < pEnd &&
+          '"' != *m_pDecoder->m_pNext && '\\' != *m_pDecoder->m_pNext)
+    {
+        m_pDecoder->m_pNext++;
+    }
+
+    if(m_pDecoder->m_pNext >= pEnd || '"' != *m_pDecoder->m_pNext)
+    {
+        setError(RC_XMLInvalidFieldCharacters, "bad member name", NULL);
+        return -1;
+    }
+
+    *ppName = pName;
+    *pnName = (unsigned int) (m_pDecoder->m_pNext - pName);
+    m_pDecoder->m_pNext++;
+
+    if(!expectChar(':', NULL))
+    {
+        return -1;
+    }
+
+    skipWhitespace();
+    m_nMember++;
+
+    return 1;
+}
+
+/* Move to the value of the named member, which must come next */
+int
+CJSONTextDecoderStream::getMember (
+  const char *                  pWantName,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    const char *                pName;
+    unsigned int                nName;
+    int                         rc;
+
+    rc = getNextMember(&pName, &nName);
+
+    if(0 == rc)
+    {
+        setError(RC_FieldUnderrun, "underrun at field", pFieldDescriptor);
+        return FALSE;
+    }
+
+    if(1 != rc)
+    {
+        return FALSE;
+    }
+
+    if(strlen(pWantName) != nName || 0 != memcmp(pName, pWantName, nName))
+    {
+        setError(RC_XMLMissingField, "missing field value", pFieldDescriptor);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+int
+CJSONTextDecoderStream::getFieldValue (
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    return getMember(pFieldDescriptor->m_pName, pFieldDescriptor);
+}
+
+/* The closing brace of a nested object such as a u1v */
+void
+CJSONTextDecoderStream::endObject (
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    const char *                pName;
+    unsigned int                nName;
+
+    if(1 == getNextMember(&pName, &nName))
+    {
+        setError(RC_FieldOverrun, "overrun at field extra members",
+                 pFieldDescriptor);
+    }
+}
+
+/*
+ * One integer value. u1 fields also take true and false,
+ * enumerations their names.
+ */
+llrp_s64_t
+CJSONTextDecoderStream::getInteger (
+  const CFieldDescriptor *      pFieldDescriptor,
+  llrp_s64_t                    minValue,
+  llrp_s64_t                    maxValue)
+{
+    const char *                pNext = m_pDecoder->m_pNext;
+    const char *                pEnd = m_pDecoder->m_pEnd;
+
+    if(RC_OK != m_pDecoder->m_ErrorDetails.m_eResultCode)
+    {
+        return 0;
+    }
+
+    switch(pFieldDescriptor->m_eFieldType)
+    {
+    case CFieldDescriptor::FT_U1:
+        if(4 <= pEnd - pNext && 0 == memcmp(pNext, "true", 4u))
+        {
+            m_pDecoder->m_pNext += 4;
+            return 1;
+        }
+        if(5 <= pEnd - pNext && 0 == memcmp(pNext, "false", 5u))
+        {
+            m_pDecoder->m_pNext += 5;
+            return 0;
+        }
+        break;
+
+    case CFieldDescriptor::FT_E1:
+    case CFieldDescriptor::FT_E2:
+    case CFieldDescriptor::FT_E8:
+    case CFieldDescriptor::FT_E16:
+    case CFieldDescriptor::FT_E32:
+    case CFieldDescriptor::FT_E8V:
+        if(pNext < pEnd && '"' == *pNext)
+        {
+            return getEnum(pFieldDescriptor);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return getNumber(pFieldDescriptor, minValue, maxValue);
+}
+
+/*
+ * A JSON integer, range checked. u64 fields get the full
+ * unsigned range, their value comes back in the same bits.
+ */
+llrp_s64_t
+CJSONTextDecoderStream::getNumber (
+  const CFieldDescriptor *      pFieldDescriptor,
+  llrp_s64_t                    minValue,
+  llrp_s64_t                    maxValue)
+{
+    const char *                pNext = m_pDecoder->m_pNext;
+    const char *                pEnd = m_pDecoder->m_pEnd;
+    int                         bNegative = FALSE;
+    int                         bUnsigned64 = FALSE;
+    llrp_u64_t                  Magnitude = 0;
+    const char *                pDigits;
+
+    if(RC_OK != m_pDecoder->m_ErrorDetails.m_eResultCode)
+    {
+        return 0;
+    }
+
+    if(NULL != pFieldDescriptor &&
+       (CFieldDescriptor::FT_U64 == pFieldDescriptor->m_eFieldType ||
+        CFieldDescriptor::FT_U64V == pFieldDescriptor->m_eFieldType))
+    {
+        bUnsigned64 = TRUE;
+    }
+
+    if(pNext < pEnd && '-' == *pNext)
+    {
+        bNegative = TRUE;
+        pNext++;
+    }
+
+    pDigits = pNext;
+    while(pNext < pEnd && '0' <= *pNext && '9' >= *pNext)
+    {
+        unsigned int            Digit = (unsigned int) (*pNext - '0');
+
+        if(Magnitude > (~(llrp_u64_t) 0 - Digit) / 10u)
+        {
+            m_pDecoder->m_pNext = pNext;
+            setError(RC_XMLOutOfRange, "out of range value",
+                     pFieldDescriptor);
+            return 0;
+        }
+        Magnitude = Magnitude * 10u + Digit;
+        pNext++;
+    }
+
+    if(pNext == pDigits ||
+       (pNext < pEnd && ('.' == *pNext || 'e' == *pNext || 'E' == *pNext)))
+    {
+        m_pDecoder->m_pNext = pNext;
+        setError(RC_XMLInvalidFieldCharacters, "Illegal field value",
+                 pFieldDescriptor);
+        return 0;
+    }
+
+    m_pDecoder->m_pNext = pNext;
+
+    if(bUnsigned64 && !bNegative)
+    {
+        return (llrp_s64_t) Magnitude;
+    }
+
+    if(bNegative ?
+        Magnitude > (llrp_u64_t) -(minValue + 1) + 1u :
+        Magnitude > (llrp_u64_t) maxValue)
+    {
+        setError(RC_XMLOutOfRange, "out of range value", pFieldDescriptor);
+        return 0;
+    }
+
+    return bNegative ? (llrp_s64_t) (0u - Magnitude) : (llrp_s64_t) Magnitude;
+}
+
+/* An enumerator name in quotes */
+int
+CJSONTextDecoderStream::getEnum (
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    const SEnumTableEntry *     pEntry;
+    const char *                pName;
+    unsigned int                nName;
+
+    if(!getString(pFieldDescriptor, &pName, &nName))
+    {
+        return 0;
+    }
+
+    for(pEntry = pFieldDescriptor->m_pEnumTable;
+        NULL != pEntry->pName;
+        pEntry++)
+    {
+        if(0 == strncmp(pEntry->pName, pName, nName) &&
+           0 == pEntry->pName[nName])
+        {
+            return pEntry->Value;
+        }
+    }
+
+    setError(RC_XMLInvalidFieldCharacters, "unknown enumeration",
+             pFieldDescriptor);
+    return 0;
+}
+
+/*
+ * Start an integer vector and return its length. Hex format
+ * is one string of nDigit digits per item, otherwise an array.
+ */
+int
+CJSONTextDecoderStream::countVector (
+  const CFieldDescriptor *      pFieldDescriptor,
+  unsigned int                  nDigit)
+{
+    const char *                pNext;
+    const char *                pEnd = m_pDecoder->m_pEnd;
+    unsigned int                nHex;
+    int                         nItem = 0;
+    int                         bInString = FALSE;
+
+    if(CFieldDescriptor::FMT_HEX == pFieldDescriptor->m_eFieldFormat)
+    {
+        if(!getString(pFieldDescriptor, &m_pHex, &nHex))
+        {
+            return -1;
+        }
+        if(0 != nHex % nDigit)
+        {
+            setError(RC_FieldOverrun, "overrun at field extra characters",
+                     pFieldDescriptor);
+            return -1;
+        }
+        return (int) (nHex / nDigit);
+    }
+
+    m_pHex = NULL;
+
+    if(!expectChar('[', pFieldDescriptor))
+    {
+        return -1;
+    }
+
+    /* count the items up to the closing bracket */
+    for(pNext = m_pDecoder->m_pNext; pNext < pEnd; pNext++)
+    {
+        if(bInString)
+        {
+            if('\\' == *pNext)
+            {
+                pNext++;
+            }
+            else if('"' == *pNext)
+            {
+                bInString = FALSE;
+            }
+            continue;
+        }
+
+        switch(*pNext)
+        {
+        case '"':
+            bInString = TRUE;
+            /* fall through */
+        default:
+            if(0 == nItem)
+            {
+                nItem = 1;
+            }
+            break;
+
+        case ',':
+            nItem++;
+            break;
+
+        case ' ': case '\t': case '\r': case '\n':
+            break;
+
+        case ']':
+            return nItem;
+        }
+    }
+
+    setError(RC_FieldUnderrun, "underrun in array", pFieldDescriptor);
+    return -1;
+}
+
+llrp_s64_t
+CJSONTextDecoderStream::getVectorItem (
+  const CFieldDescriptor *      pFieldDescriptor,
+  int                           iItem,
+  unsigned int                  nDigit,
+  llrp_s64_t                    minValue,
+  llrp_s64_t                    maxValue)
+{
+    if(NULL != m_pHex)
+    {
+        llrp_u64_t              Value = 0;
+        const char *            pHex = &m_pHex[iItem * nDigit];
+
+        for(unsigned int i = 0; i < nDigit; i++)
+        {
+            int                 Nibble = hexDigitValue(pHex[i]);
+
+            if(0 > Nibble)
+            {
+                setError(RC_XMLInvalidFieldCharacters, "Illegal field value",
+                         pFieldDescriptor);
+                return 0;
+            }
+            Value = (Value << 4u) | (unsigned int) Nibble;
+        }
+        return (llrp_s64_t) Value;
+    }
+
+    if(0 < iItem && !expectChar(',', pFieldDescriptor))
+    {
+        return 0;
+    }
+    skipWhitespace();
+
+    return getInteger(pFieldDescriptor, minValue, maxValue);
+}
+
+void
+CJSONTextDecoderStream::endVector (
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    if(NULL == m_pHex)
+    {
+        expectChar(']', pFieldDescriptor);
+    }
+}
+
+/*
+ * The raw text between the quotes of a string value,
+ * escapes still in place.
+ */
+int
+CJSONTextDecoderStream::getString (
+  const CFieldDescriptor *      pFieldDescriptor,
+  const char **                 ppValue,
+  unsigned int *                pnValue)
+{
+    const char *                pNext;
+    const char *                pEnd = m_pDecoder->m_pEnd;
+
+    if(!expectChar('"', pFieldDescriptor))
+    {
+        return FALSE;
+    }
+
+    for(pNext = m_pDecoder->m_pNext; pNext < pEnd; pNext++)
+    {
+        if('\\' == *pNext)
+        {
+            pNext++;
+        }
+        else if('"' == *pNext)
+        {
+            *ppValue = m_pDecoder->m_pNext;
+            *pnValue = (unsigned int) (pNext - m_pDecoder->m_pNext);
+            m_pDecoder->m_pNext = pNext + 1;
+            return TRUE;
+        }
+    }
+
+    setError(RC_FieldUnderrun, "underrun in string", pFieldDescriptor);
+    return FALSE;
+}
+
+/* Exactly nValue bytes worth of hex digits */
+int
+CJSONTextDecoderStream::getHexBytes (
+  const CFieldDescriptor *      pFieldDescriptor,
+  const char *                  pHex,
+  unsigned int                  nHex,
+  llrp_u8_t *                   pValue,
+  unsigned int                  nValue)
+{
+    if(RC_OK != m_pDecoder->m_ErrorDetails.m_eResultCode)
+    {
+        return FALSE;
+    }
+
+    if(nHex != 2u * nValue)
+    {
+        setError(nHex < 2u * nValue ? RC_FieldUnderrun : RC_FieldOverrun,
+                 "wrong number of hex digits", pFieldDescriptor);
+        return FALSE;
+    }
+
+    for(unsigned int i = 0; i < nValue; i++)
+    {
+        int                     Hi = hexDigitValue(pHex[2u * i]);
+        int                     Lo = hexDigitValue(pHex[2u * i + 1u]);
+
+        if(0 > Hi || 0 > Lo)
+        {
+            setError(RC_XMLInvalidFieldCharacters, "Illegal field value",
+                     pFieldDescriptor);
+            return FALSE;
+        }
+        pValue[i] = (llrp_u8_t) ((Hi << 4) | Lo);
+    }
+
+    return TRUE;
+}
+
+/*
+ * Undo the JSON escapes of a string into pOut, which has
+ * room for nStr bytes. \uXXXX becomes UTF-8. Returns the
+ * length written.
+ */
+unsigned int
+CJSONTextDecoderStream::unescapeString (
+  const CFieldDescriptor *      pFieldDescriptor,
+  const char *                  pStr,
+  unsigned int                  nStr,
+  llrp_utf8_t *                 pOut)
+{
+    unsigned int                nOut = 0;
+
+    for(unsigned int i = 0; i < nStr; i++)
+    {
+        unsigned int            Code;
+
+        if('\\' != pStr[i])
+        {
+            pOut[nOut++] = (llrp_utf8_t) pStr[i];
+            continue;
+        }
+
+        if(++i >= nStr)
+        {
+            break;
+        }
+
+        switch(pStr[i])
+        {
+        case 'b':   pOut[nOut++] = '\b';            continue;
+        case 'f':   pOut[nOut++] = '\f';            continue;
+        case 'n':   pOut[nOut++] = '\n';            continue;
+        case 'r':   pOut[nOut++] = '\r';            continue;
+        case 't':   pOut[nOut++] = '\t';            continue;
+        case 'u':   break;
+        default:    pOut[nOut++] = (llrp_utf8_t) pStr[i];   continue;
+        }
+
+        /* \uXXXX, and a following low surrogate if it's a high one */
+        Code = 0;
+        for(unsigned int j = 1; j <= 4u; j++)
+        {
+            int                 Nibble;
+
+            Nibble = (i + j < nStr) ? hexDigitValue(pStr[i + j]) : -1;
+            if(0 > Nibble)
+            {
+                setError(RC_XMLInvalidFieldCharacters, "bad \\u escape",
+                         pFieldDescriptor);
+                return nOut;
+            }
+            Code = (Code << 4u) | (unsigned int) Nibble;
+        }
+        i += 4u;
+
+        if(0xD800u <= Code && 0xDBFFu >= Code &&
+           i + 6u < nStr && '\\' == pStr[i + 1u] && 'u' == pStr[i + 2u])
+        {
+            unsigned int        Low = 0;
+            unsigned int        j;
+
+            for(j = 3u; j <= 6u; j++)
+            {
+                int             Nibble = hexDigitValue(pStr[i + j]);
+
+                if(0 > Nibble)
+                {
+                    break;
+                }
+                Low = (Low << 4u) | (unsigned int) Nibble;
+            }
+
+            if(j > 6u && 0xDC00u <= Low && 0xDFFFu >= Low)
+            {
+                Code = 0x10000u + ((Code - 0xD800u) << 10u) + (Low - 0xDC00u);
+                i += 6u;
+            }
+        }
+
+        if(0x80u > Code)
+        {
+            pOut[nOut++] = (llrp_utf8_t) Code;
+        }
+        else if(0x800u > Code)
+        {
+            pOut[nOut++] = (llrp_utf8_t) (0xC0u | (Code >> 6u));
+            pOut[nOut++] = (llrp_utf8_t) (0x80u | (Code & 0x3Fu));
+        }
+        else if(0x10000u > Code)
+        {
+            pOut[nOut++] = (llrp_utf8_t) (0xE0u | (Code >> 12u));
+            pOut[nOut++] = (llrp_utf8_t) (0x80u | ((Code >> 6u) & 0x3Fu));
+            pOut[nOut++] = (llrp_utf8_t) (0x80u | (Code & 0x3Fu));
+        }
+        else
+        {
+            pOut[nOut++] = (llrp_utf8_t) (0xF0u | (Code >> 18u));
+            pOut[nOut++] = (llrp_utf8_t) (0x80u | ((Code >> 12u) & 0x3Fu));
+            pOut[nOut++] = (llrp_utf8_t) (0x80u | ((Code >> 6u) & 0x3Fu));
+            pOut[nOut++] = (llrp_utf8_t) (0x80u | (Code & 0x3Fu));
+        }
+    }
+
+    return nOut;
+}
+
+void
+CJSONTextDecoderStream::skipWhitespace (void)
+{
+    const char *                pNext = m_pDecoder->m_pNext;
+    const char *                pEnd = m_pDecoder->m_pEnd;
+
+    while(pNext < pEnd &&
+          (' ' == *pNext || '\n' == *pNext || '\r' == *pNext || '\t' == *pNext))
+    {
+        pNext++;
+    }
+
+    m_pDecoder->m_pNext = pNext;
+}
+
+int
+CJSONTextDecoderStream::expectChar (
+  char                          Ch,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    if(RC_OK != m_pDecoder->m_ErrorDetails.m_eResultCode)
+    {
+        return FALSE;
+    }
+
+    skipWhitespace();
+
+    if(m_pDecoder->m_pNext >= m_pDecoder->m_pEnd)
+    {
+        setError(RC_FieldUnderrun, "unexpected end of input",
+                 pFieldDescriptor);
+        return FALSE;
+    }
+
+    if(Ch != *m_pDecoder->m_pNext)
+    {
+        setError(RC_XMLInvalidNodeType, "unexpected character",
+                 pFieldDescriptor);
+        return FALSE;
+    }
+
+    m_pDecoder->m_pNext++;
+    return TRUE;
+}
+
+/* Record the first error, with the byte offset it happened at */
+void
+CJSONTextDecoderStream::setError (
+  EResultCode                   eResultCode,
+  const char *                  pWhatStr,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    CErrorDetails *             pError = &m_pDecoder->m_ErrorDetails;
+
+    if(RC_OK != pError->m_eResultCode)
+    {
+        return;
+    }
+
+    pError->m_eResultCode = eResultCode;
+    pError->m_pWhatStr    = pWhatStr;
+    pError->m_pRefType    = m_pRefType;
+    pError->m_pRefField   = pFieldDescriptor;
+    pError->m_OtherDetail = (int) (m_pDecoder->m_pNext - m_pDecoder->m_pBuffer);
+}
+
+int
+CJSONTextDecoderStream::hexDigitValue (
+  int                           Ch)
+{
+    if('0' <= Ch && '9' >= Ch)
+    {
+        return Ch - '0';
+    }
+    if('A' <= Ch && 'F' >= Ch)
+    {
+        return Ch - 'A' + 10;
+    }
+    if('a' <= Ch && 'f' >= Ch)
+    {
+        return Ch - 'a' + 10;
+    }
+    return -1;
+}
+
+
+}; /* namespace LLRP */
@@ -0,0 +1,999 @@
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <iosfwd>
+#include <string>
+
+#if defined(linux)
+#include <stdint.h>              // required for linux
+#endif
+
+#include "ltkcpp_platform.h"
+#include "ltkcpp_base.h"
+#include "ltkcpp_xmltext.h"
+#include "ltkcpp_jsontext.h"
+
+
+
+namespace LLRP
+{
+
+/* Size of the chunks a streaming encoder hands its sink */
+#define JSON_TEXT_CHUNK_SIZE    8192
+
+
+CJSONTextEncoder::CJSONTextEncoder (
+  char *                        pBuffer,
+  int                           nBuffer)
+{
+    m_pBuffer = pBuffer;
+    m_nBuffer = nBuffer;
+    m_iNext = 0;
+    m_pSink = NULL;
+    m_bFailed = 0;
+    m_bOverflow = 0;
+}
+
+CJSONTextEncoder::CJSONTextEncoder (
+  CXMLTextSink *                pSink)
+{
+    m_pBuffer = new char[JSON_TEXT_CHUNK_SIZE];
+    m_nBuffer = JSON_TEXT_CHUNK_SIZE;
+    m_iNext = 0;
+    m_pSink = pSink;
+    m_bFailed = 0;
+    m_bOverflow = 0;
+}
+
+CJSONTextEncoder::~CJSONTextEncoder (void)
+{
+    if(NULL != m_pSink)
+    {
+        delete[] m_pBuffer;
+    }
+}
+
+void
+CJSONTextEncoder::encodeElement (
+  const CElement *              pElement)
+{
+    CJSONTextEncoderStream      MyEncoderStream(this);
+    CJSONTextEncoderStream      BodyEncoderStream(&MyEncoderStream);
+
+    append("{", 1u);
+    MyEncoderStream.appendKey(pElement->m_pType->m_pName);
+    BodyEncoderStream.putElementBody(pElement);
+    append("}", 1u);
+
+    if(NULL != m_pSink)
+    {
+        flush();
+    }
+}
+
+/*
+ * Same buffering as CXMLTextEncoder::append(). A fixed buffer
+ * that fills up sets m_bOverflow, a streaming encoder passes
+ * full chunks to the sink.
+ */
+void
+CJSONTextEncoder::append (
+  const char *                  pData,
+  unsigned int                  nData)
+{
+    if(m_bFailed)
+    {
+        return;
+    }
+
+    if(m_iNext + (int) nData >= m_nBuffer)
+    {
+        if(NULL == m_pSink)
+        {
+            m_bOverflow = 1;
+            m_bFailed = 1;
+            return;
+        }
+
+        flush();
+
+        if((int) nData >= m_nBuffer)
+        {
+            if(!m_bFailed && 0 != m_pSink->write(pData, nData))
+            {
+                m_ErrorDetails.resultCodeAndWhatStr(RC_MiscError,
+                    "JSON text sink write failed");
+                m_bFailed = 1;
+            }
+            return;
+        }
+
+        if(m_bFailed)
+        {
+            return;
+        }
+    }
+
+    memcpy(&m_pBuffer[m_iNext], pData, nData);
+    m_iNext += nData;
+    m_pBuffer[m_iNext] = 0;
+}
+
+void
+CJSONTextEncoder::flush (void)
+{
+    if(0 < m_iNext && !m_bFailed)
+    {
+        if(0 != m_pSink->write(m_pBuffer, m_iNext))
+        {
+            m_ErrorDetails.resultCodeAndWhatStr(RC_MiscError,
+                "JSON text sink write failed");
+            m_bFailed = 1;
+        }
+    }
+    m_iNext = 0;
+}
+
+CJSONTextEncoderStream::CJSONTextEncoderStream (
+  CJSONTextEncoder *            pEncoder)
+{
+    m_pEncoder                  = pEncoder;
+    m_pEnclosingEncoderStream   = NULL;
+    m_pRefType                  = NULL;
+    m_nMember                   = 0;
+}
+
+CJSONTextEncoderStream::CJSONTextEncoderStream (
+  CJSONTextEncoderStream *      pEnclosingEncoderStream)
+{
+    m_pEncoder                  = pEnclosingEncoderStream->m_pEncoder;
+    m_pEnclosingEncoderStream   = pEnclosingEncoderStream;
+    m_pRefType                  = NULL;
+    m_nMember                   = 0;
+}
+
+/*
+ * The {...} of an element: MessageID for messages, then
+ * whatever the generated encode() puts.
+ */
+void
+CJSONTextEncoderStream::putElementBody (
+  const CElement *              pElement)
+{
+    m_pRefType = pElement->m_pType;
+
+    appendString("{");
+    if(m_pRefType->m_bIsMessage)
+    {
+        appendKey("MessageID");
+        appendDecimal(((const CMessage *)pElement)->getMessageID());
+    }
+
+    pElement->encode(this);
+
+    appendString("}");
+}
+
+void
+CJSONTextEncoderStream::putRequiredSubParameter (
+  const CParameter *            pParameter,
+  const CTypeDescriptor *       pRefType)
+{
+    if(NULL == pParameter)
+    {
+        if(RC_OK == m_pEncoder->m_ErrorDetails.m_eResultCode)
+        {
+            m_pEncoder->m_ErrorDetails.missingParameter(pRefType);
+        }
+        return;
+    }
+
+    putOptionalSubParameter(pParameter, pRefType);
+}
+
+void
+CJSONTextEncoderStream::putOptionalSubParameter (
+  const CParameter *            pParameter,
+  const CTypeDescriptor *       pRefType)
+{
+    if(NULL == pParameter)
+    {
+        return;
+    }
+
+    CJSONTextEncoderStream      NestEncoderStream(this);
+
+    appendKey(pParameter->m_pType->m_pName);
+    NestEncoderStream.putElementBody(pParameter);
+}
+
+void
+CJSONTextEncoderStream::putRequiredSubParameterList (
+  const tListOfParameters *     pParameterList,
+  const CTypeDescriptor *       pRefType)
+{
+    if(pParameterList->empty())
+    {
+        if(RC_OK == m_pEncoder->m_ErrorDetails.m_eResultCode)
+        {
+            m_pEncoder->m_ErrorDetails.missingParameter(pRefType);
+        }
+        return;
+    }
+
+    putOptionalSubParameterList(pParameterList, pRefType);
+}
+
+void
+CJSONTextEncoderStream::putOptionalSubParameterList (
+  const tListOfParameters *     pParameterList,
+  const CTypeDescriptor *       pRefType)
+{
+    tListOfParameters::const_iterator Begin = pParameterList->begin();
+
+    while(Begin != pParameterList->end())
+    {
+        tListOfParameters::const_iterator End = Begin;
+
+        /* one array per run of the same type */
+        do
+        {
+            End++;
+        } while(End != pParameterList->end() &&
+                (*End)->m_pType == (*Begin)->m_pType);
+
+        putParameterRun(Begin, End);
+        Begin = End;
+    }
+}
+
+void
+CJSONTextEncoderStream::putParameterRun (
+  tListOfParameters::const_iterator Begin,
+  tListOfParameters::const_iterator End)
+{
+    appendKey((*Begin)->m_pType->m_pName);
+    appendString("[");
+
+    for(tListOfParameters::const_iterator Cur = Begin; Cur != End; Cur++)
+    {
+        CJSONTextEncoderStream  NestEncoderStream(this);
+
+        if(Cur != Begin)
+        {
+            appendString(",");
+        }
+        NestEncoderStream.putElementBody(*Cur);
+    }
+
+    appendString("]");
+}
+
+/*
+ * 8-bit types
+ */
+
+void
+CJSONTextEncoderStream::put_u8 (
+  llrp_u8_t                     Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendDecimal(Value);
+}
+
+void
+CJSONTextEncoderStream::put_s8 (
+  llrp_s8_t                     Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendSignedDecimal(Value);
+}
+
+void
+CJSONTextEncoderStream::put_u8v (
+  llrp_u8v_t                    Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+
+    /* hex format is one string of fixed width digits */
+    if(CFieldDescriptor::FMT_HEX == pFieldDescriptor->m_eFieldFormat)
+    {
+        appendString("\"");
+        for(int i = 0; i < Value.m_nValue; i++)
+        {
+            appendHex((llrp_u64_t) Value.m_pValue[i], 2u);
+        }
+        appendString("\"");
+        return;
+    }
+
+    appendString("[");
+    for(int i = 0; i < Value.m_nValue; i++)
+    {
+        if(0 < i)
+        {
+            appendString(",");
+        }
+        appendDecimal(Value.m_pValue[i]);
+    }
+    appendString("]");
+}
+
+void
+CJSONTextEncoderStream::put_s8v (
+  llrp_s8v_t                    Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+
+    /* hex format is one string of fixed width digits */
+    if(CFieldDescriptor::FMT_HEX == pFieldDescriptor->m_eFieldFormat)
+    {
+        appendString("\"");
+        for(int i = 0; i < Value.m_nValue; i++)
+        {
+            appendHex((llrp_u64_t) Value.m_pValue[i], 2u);
+        }
+        appendString("\"");
+        return;
+    }
+
+    appendString("[");
+    for(int i = 0; i < Value.m_nValue; i++)
+    {
+        if(0 < i)
+        {
+            appendString(",");
+        }
+        appendSignedDecimal(Value.m_pValue[i]);
+    }
+    appendString("]");
+}
+
+/*
+ * 16-bit types
+ */
+
+void
+CJSONTextEncoderStream::put_u16 (
+  llrp_u16_t                    Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendDecimal(Value);
+}
+
+void
+CJSONTextEncoderStream::put_s16 (
+  llrp_s16_t                    Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendSignedDecimal(Value);
+}
+
+void
+CJSONTextEncoderStream::put_u16v (
+  llrp_u16v_t                   Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+
+    /* hex format is one string of fixed width digits */
+    if(CFieldDescriptor::FMT_HEX == pFieldDescriptor->m_eFieldFormat)
+    {
+        appendString("\"");
+        for(int i = 0; i < Value.m_nValue; i++)
+        {
+            appendHex((llrp_u64_t) Value.m_pValue[i], 4u);
+        }
+        appendString("\"");
+        return;
+    }
+
+    appendString("[");
+    for(int i = 0; i < Value.m_nValue; i++)
+    {
+        if(0 < i)
+        {
+            appendString(",");
+        }
+        appendDecimal(Value.m_pValue[i]);
+    }
+    appendString("]");
+}
+
+void
+CJSONTextEncoderStream::put_s16v (
+  llrp_s16v_t                   Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+
+    /* hex format is one string of fixed width digits */
+    if(CFieldDescriptor::FMT_HEX == pFieldDescriptor->m_eFieldFormat)
+    {
+        appendString("\"");
+        for(int i = 0; i < Value.m_nValue; i++)
+        {
+            appendHex((llrp_u64_t) Value.m_pValue[i], 4u);
+        }
+        appendString("\"");
+        return;
+    }
+
+    appendString("[");
+    for(int i = 0; i < Value.m_nValue; i++)
+    {
+        if(0 < i)
+        {
+            appendString(",");
+        }
+        appendSignedDecimal(Value.m_pValue[i]);
+    }
+    appendString("]");
+}
+
+/*
+ * 32-bit types
+ */
+
+void
+CJSONTextEncoderStream::put_u32 (
+  llrp_u32_t                    Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendDecimal(Value);
+}
+
+void
+CJSONTextEncoderStream::put_s32 (
+  llrp_s32_t                    Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendSignedDecimal(Value);
+}
+
+void
+CJSONTextEncoderStream::put_u32v (
+  llrp_u32v_t                   Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+
+    /* hex format is one string of fixed width digits */
+    if(CFieldDescriptor::FMT_HEX == pFieldDescriptor->m_eFieldFormat)
+    {
+        appendString("\"");
+        for(int i = 0; i < Value.m_nValue; i++)
+        {
+            appendHex((llrp_u64_t) Value.m_pValue[i], 8u);
+        }
+        appendString("\"");
+        return;
+    }
+
+    appendString("[");
+    for(int i = 0; i < Value.m_nValue; i++)
+    {
+        if(0 < i)
+        {
+            appendString(",");
+        }
+        appendDecimal(Value.m_pValue[i]);
+    }
+    appendString("]");
+}
+
+void
+CJSONTextEncoderStream::put_s32v (
+  llrp_s32v_t                   Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+
+    /* hex format is one string of fixed width digits */
+    if(CFieldDescriptor::FMT_HEX == pFieldDescriptor->m_eFieldFormat)
+    {
+        appendString("\"");
+        for(int i = 0; i < Value.m_nValue; i++)
+        {
+            appendHex((llrp_u64_t) Value.m_pValue[i], 8u);
+        }
+        appendString("\"");
+        return;
+    }
+
+    appendString("[");
+    for(int i = 0; i < Value.m_nValue; i++)
+    {
+        if(0 < i)
+        {
+            appendString(",");
+        }
+        appendSignedDecimal(Value.m_pValue[i]);
+    }
+    appendString("]");
+}
+
+/*
+ * 64-bit types
+ */
+
+void
+CJSONTextEncoderStream::put_u64 (
+  llrp_u64_t                    Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendDecimal(Value);
+}
+
+void
+CJSONTextEncoderStream::put_s64 (
+  llrp_s64_t                    Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendSignedDecimal(Value);
+}
+
+void
+CJSONTextEncoderStream::put_u64v (
+  llrp_u64v_t                   Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+
+    /* hex format is one string of fixed width digits */
+    if(CFieldDescriptor::FMT_HEX == pFieldDescriptor->m_eFieldFormat)
+    {
+        appendString("\"");
+        for(int i = 0; i < Value.m_nValue; i++)
+        {
+            appendHex((llrp_u64_t) Value.m_pValue[i], 16u);
+        }
+        appendString("\"");
+        return;
+    }
+
+    appendString("[");
+    for(int i = 0; i < Value.m_nValue; i++)
+    {
+        if(0 < i)
+        {
+            appendString(",");
+        }
+        appendDecimal(Value.m_pValue[i]);
+    }
+    appendString("]");
+}
+
+void
+CJSONTextEncoderStream::put_s64v (
+  llrp_s64v_t                   Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+
+    /* hex format is one string of fixed width digits */
+    if(CFieldDescriptor::FMT_HEX == pFieldDescriptor->m_eFieldFormat)
+    {
+        appendString("\"");
+        for(int i = 0; i < Value.m_nValue; i++)
+        {
+            appendHex((llrp_u64_t) Value.m_pValue[i], 16u);
+        }
+        appendString("\"");
+        return;
+    }
+
+    appendString("[");
+    for(int i = 0; i < Value.m_nValue; i++)
+    {
+        if(0 < i)
+        {
+            appendString(",");
+        }
+        appendSignedDecimal(Value.m_pValue[i]);
+    }
+    appendString("]");
+}
+
+/*
+ * Special types
+ */
+
+void
+CJSONTextEncoderStream::put_u1 (
+  llrp_u1_t                     Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendString((Value & 1) ? "true" : "false");
+}
+
+void
+CJSONTextEncoderStream::put_u1v (
+  llrp_u1v_t                    Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendString("{\"Count\":");
+    appendDecimal(Value.m_nBit);
+    appendString(",\"Data\":\"");
+    appendHexBytes(Value.m_pValue, (Value.m_nBit + 7u) / 8u);
+    appendString("\"}");
+}
+
+void
+CJSONTextEncoderStream::put_u2 (
+  llrp_u2_t                     Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendDecimal(Value & 3);
+}
+
+void
+CJSONTextEncoderStream::put_u96 (
+  llrp_u96_t                    Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendString("\"");
+    appendHexBytes(Value.m_aValue, 12u);
+    appendString("\"");
+}
+
+void
+CJSONTextEncoderStream::put_utf8v (
+  llrp_utf8v_t                  Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    unsigned int                nValue = Value.m_nValue;
+
+    /* like the XML encoder, drop a trailing NUL */
+    if(0 < nValue && 0 == Value.m_pValue[nValue - 1])
+    {
+        nValue--;
+    }
+
+    appendKey(pFieldDescriptor->m_pName);
+    appendQuoted(Value.m_pValue, nValue);
+}
+
+void
+CJSONTextEncoderStream::put_bytesToEnd (
+  llrp_bytesToEnd_t             Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendString("\"");
+    appendHexBytes(Value.m_pValue, Value.m_nValue);
+    appendString("\"");
+}
+
+/*
+ * Enumerated types of various sizes
+ */
+
+void
+CJSONTextEncoderStream::put_e1 (
+  int                           eValue,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    put_enum(eValue, pFieldDescriptor);
+}
+
+void
+CJSONTextEncoderStream::put_e2 (
+  int                           eValue,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    put_enum(eValue, pFieldDescriptor);
+}
+
+void
+CJSONTextEncoderStream::put_e8 (
+  int                           eValue,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    put_enum(eValue, pFieldDescriptor);
+}
+
+void
+CJSONTextEncoderStream::put_e16 (
+  int                           eValue,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    put_enum(eValue, pFieldDescriptor);
+}
+
+void
+CJSONTextEncoderStream::put_e32 (
+  int                           eValue,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    put_enum(eValue, pFieldDescriptor);
+}
+
+void
+CJSONTextEncoderStream::put_e8v (
+  llrp_u8v_t                    Value,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendString("[");
+    for(int i = 0; i < Value.m_nValue; i++)
+    {
+        if(0 < i)
+        {
+            appendString(",");
+        }
+        appendEnumValue(Value.m_pValue[i], pFieldDescriptor);
+    }
+    appendString("]");
+}
+
+/*
+ * Reserved bits carry nothing
+ */
+
+void
+CJSONTextEncoderStream::put_reserved (
+  unsigned int                  nBits)
+{
+}
+
+void
+CJSONTextEncoderStream::put_enum (
+  int                           eValue,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    appendKey(pFieldDescriptor->m_pName);
+    appendEnumValue(eValue, pFieldDescriptor);
+}
+
+/* The enumerator's name in quotes, or the number if it has none */
+void
+CJSONTextEncoderStream::appendEnumValue (
+  int                           eValue,
+  const CFieldDescriptor *      pFieldDescriptor)
+{
+    const SEnumTableEntry *     pEntry;
+
+    for(pEntry = pFieldDescriptor->m_pEnumTable;
+        NULL != pEntry->pName;
+        pEntry++)
+    {
+        if(pEntry->Value == eValue)
+        {
+            break;
+        }
+    }
+
+    if(NULL != pEntry->pName)
+    {
+        appendString("\"");
+        appendString(pEntry->pName);
+        appendString("\"");
+    }
+    else
+    {
+        appendSignedDecimal(eValue);
+    }
+}
+
+/* "Name": preceded by a comma unless it's the first member */
+void
+CJSONTextEncoderStream::appendKey (
+  const char *                  pName)
+{
+    if(0 < m_nMember++)
+    {
+        appendString(",\"");
+    }
+    else
+    {
+        appendString("\"");
+    }
+    appendString(pName);
+    appendString("\":");
+}
+
+void
+CJSONTextEncoderStream::appendString (
+  const char *                  pString)
+{
+    m_pEncoder->append(pString, (unsigned int) strlen(pString));
+}
+
+/*
+ * A JSON string. Quotes, backslashes and control characters
+ * are escaped, everything else (UTF-8 included) is copied.
+ */
+void
+CJSONTextEncoderStream::appendQuoted (
+  const llrp_utf8_t *           pValue,
+  unsigned int                  nValue)
+{
+    unsigned int                iRun = 0;
+
+    appendString("\"");
+    for(unsigned int i = 0; i < nValue; i++)
+    {
+        int                     c = pValue[i];
+        char                    aEsc[6];
+
+        if(0x20 <= c && '"' != c && '\\' != c)
+        {
+            continue;
+        }
+
+        m_pEncoder->append((const char *) &pValue[iRun], i - iRun);
+        iRun = i + 1;
+
+        aEsc[0] = '\\';
+        if('"' == c || '\\' == c)
+        {
+            aEsc[1] = (char) c;
+            m_pEncoder->append(aEsc, 2u);
+        }
+        else
+        {
+            aEsc[1] = 'u';
+            aEsc[2] = '0';
+            aEsc[3] = '0';
+            aEsc[4] = "0123456789abcdef"[c >> 4u];
+            aEsc[5] = "0123456789abcdef"[c & 0xFu];
+            m_pEncoder->append(aEsc, 6u);
+        }
+    }
+    m_pEncoder->append((const char *) &pValue[iRun], nValue - iRun);
+    appendString("\"");
+}
+
+void
+CJSONTextEncoderStream::appendDecimal (
+  llrp_u64_t                    Value)
+{
+    char                        aBuf[24];
+    unsigned int                i = sizeof aBuf;
+
+    do
+    {
+        aBuf[--i] = (char) ('0' + Value % 10u);
+        Value /= 10u;
+    } while(0 != Value);
+
+    m_pEncoder->append(&aBuf[i], (unsigned int) (sizeof aBuf - i));
+}
+
+void
+CJSONTextEncoderStream::appendSignedDecimal (
+  llrp_s64_t                    Value)
+{
+    if(0 > Value)
+    {
+        appendString("-");
+        appendDecimal(0u - (llrp_u64_t) Value);
+    }
+    else
+    {
+        appendDecimal((llrp_u64_t) Value);
+    }
+}
+
+/* Upper case hex, two digits per byte */
+void
+CJSONTextEncoderStream::appendHexBytes (
+  const llrp_u8_t *             pValue,
+  unsigned int                  nValue)
+{
+    char                        aBuf[64];
+    unsigned int                n = 0;
+
+    for(unsigned int i = 0; i < nValue; i++)
+    {
+        aBuf[n++] = "0123456789ABCDEF"[pValue[i] >> 4u];
+        aBuf[n++] = "0123456789ABCDEF"[pValue[i] & 0xFu];
+        if(sizeof aBuf == n)
+        {
+            m_pEncoder->append(aBuf, n);
+            n = 0;
+        }
+    }
+
+    m_pEncoder->append(aBuf, n);
+}
+
+/* Upper case hex, exactly the nDigit low order digits */
+void
+CJSONTextEncoderStream::appendHex (
+  llrp_u64_t                    Value,
+  unsigned int                  nDigit)
+{
+    char                        aBuf[16];
+
+    for(unsigned int i = nDigit; 0 < i; i--)
+    {
+        aBuf[i - 1u] = "0123456789ABCDEF"[Value & 0xFu];
+        Value >>= 4u;
+    }
+
+    m_pEncoder->append(aBuf, nDigit);
+}
+
+
+EResultCode
+toJSONText (
+  const CElement *              pElement,
+  CXMLTextSink *                pSink)
+{
+    if(NULL == pElement)
+    {
+        return RC_MiscError;
+    }
+
+    CJSONTextEncoder            MyJSONEncoder(pSink);
+
+    MyJSONEncoder.encodeElement(pElement);
+
+    return MyJSONEncoder.m_ErrorDetails.m_eResultCode;
+}
+
+EResultCode
+toJSONString (
+  const CElement *              pElement,
+  char *                        pBuffer,
+  int                           nBuffer)
+{
+    if(NULL == pElement)
+    {
+        return RC_MiscError;
+    }
+
+    CJSONTextEncoder            MyJSONEncoder(pBuffer, nBuffer);
+
+    MyJSONEncoder.encodeElement(pElement);
+
+    if(RC_OK != MyJSONEncoder.m_ErrorDetails.m_eResultCode)
+    {
+        return MyJSONEncoder.m_ErrorDetails.m_eResultCode;
+    }
+
+    if(MyJSONEncoder.m_bOverflow)
+    {
+        return RC_MiscError;
+    }
+
+    return RC_OK;
+}
+
+
+}; /* namespace LLRP */
@@ -0,0 +1,176 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+/**
+ *****************************************************************************
+ **
+ ** @file   ltkcpp_opaque.cpp
+ **
+ ** @brief  Messages and parameters of types not generated into the build
+ **
+ *****************************************************************************/
+
+
+#include <stdio.h>
+
+#include "ltkcpp.h"
+
+
+namespace LLRP
+{
+
+/*
+ * The template the instances copy their type descriptor from.
+ * m_pfConstruct is NULL, only the frame decoder makes these,
+ * it knows the type number.
+ */
+static const CTypeDescriptor
+s_tdOpaqueMessage =
+{
+    TRUE,                       // m_bIsMessage
+    "OpaqueMessage",            // m_pName
+    NULL,                       // m_pVendorDescriptor
+    &g_nsdescllrp,              // m_pNamespaceDescriptor
+    0,                          // m_TypeNum
+    NULL,                       // m_pResponseType
+
+    COpaqueMessage::s_apFieldDescriptorTable,
+    NULL,                       // m_pfConstruct
+    NULL,                       // m_pfDecodeFields
+};
+
+static const CTypeDescriptor
+s_tdOpaqueParameter =
+{
+    FALSE,                      // m_bIsMessage
+    "OpaqueParameter",          // m_pName
+    NULL,                       // m_pVendorDescriptor
+    &g_nsdescllrp,              // m_pNamespaceDescriptor
+    0,                          // m_TypeNum
+    NULL,                       // m_pResponseType
+
+    COpaqueParameter::s_apFieldDescriptorTable,
+    NULL,                       // m_pfConstruct
+    NULL,                       // m_pfDecodeFields
+};
+
+
+const CFieldDescriptor
+COpaqueMessage::s_fdData =
+{
+    CFieldDescriptor::FT_BYTESTOEND,    // m_eFieldType
+    CFieldDescriptor::FMT_HEX,          // m_eFieldFormat
+    "Data",                             // m_pName
+    NULL                                // m_pEnumTable
+};
+
+const CFieldDescriptor * const
+COpaqueMessage::s_apFieldDescriptorTable[] =
+{
+    &s_fdData,
+    NULL
+};
+
+COpaqueMessage::COpaqueMessage (
+  llrp_u16_t                    TypeNum)
+  : m_OpaqueType(s_tdOpaqueMessage)
+{
+    sprintf(m_aOpaqueName, "OpaqueMessage_%u", TypeNum);
+    m_OpaqueType.m_pName = m_aOpaqueName;
+    m_OpaqueType.m_TypeNum = TypeNum;
+    m_pType = &m_OpaqueType;
+}
+
+void
+COpaqueMessage::decodeFields (
+  CDecoderStream *              pDecoderStream)
+{
+    m_Data = pDecoderStream->get_bytesToEnd(&s_fdData);
+}
+
+void
+COpaqueMessage::assimilateSubParameters (
+  CErrorDetails *               pError)
+{
+    if(NULL != pError && !m_listAllSubParameters.empty())
+    {
+        pError->unexpectedParameter(m_listAllSubParameters.front());
+    }
+}
+
+void
+COpaqueMessage::encode (
+  CEncoderStream *              pEncoderStream) const
+{
+    pEncoderStream->put_bytesToEnd(m_Data, &s_fdData);
+}
+
+
+const CFieldDescriptor
+COpaqueParameter::s_fdData =
+{
+    CFieldDescriptor::FT_BYTESTOEND,    // m_eFieldType
+    CFieldDescriptor::FMT_HEX,          // m_eFieldFormat
+    "Data",                             // m_pName
+    NULL                                // m_pEnumTable
+};
+
+const CFieldDescriptor * const
+COpaqueParameter::s_apFieldDescriptorTable[] =
+{
+    &s_fdData,
+    NULL
+};
+
+COpaqueParameter::COpaqueParameter (
+  llrp_u16_t                    TypeNum)
+  : m_OpaqueType(s_tdOpaqueParameter)
+{
+    sprintf(m_aOpaqueName, "OpaqueParameter_%u", TypeNum);
+    m_OpaqueType.m_pName = m_aOpaqueName;
+    m_OpaqueType.m_TypeNum = TypeNum;
+    m_pType = &m_OpaqueType;
+}
+
+void
+COpaqueParameter::decodeFields (
+  CDecoderStream *              pDecoderStream)
+{
+    m_Data = pDecoderStream->get_bytesToEnd(&s_fdData);
+}
+
+void
+COpaqueParameter::assimilateSubParameters (
+  CErrorDetails *               pError)
+{
+    if(NULL != pError && !m_listAllSubParameters.empty())
+    {
+        pError->unexpectedParameter(m_listAllSubParameters.front());
+    }
+}
+
+void
+COpaqueParameter::encode (
+  CEncoderStream *              pEncoderStream) const
+{
+    pEncoderStream->put_bytesToEnd(m_Data, &s_fdData);
+}
+
+}; /* namespace LLRP */
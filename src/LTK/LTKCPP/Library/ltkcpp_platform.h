@@ -35,6 +35,7 @@
  */
 
 #include <list>
+#include <vector>
 #include <string.h>         /* memcpy() */
 
 #define FALSE       0
@@ -26,6 +26,108 @@
 namespace LLRP
 {
 
+/*
+ * Hashes for the lookup indexes: FNV-1a over the name,
+ * and a multiplicative mix of (kind, VendorID, subtype).
+ */
+static unsigned int
+hashName (
+  const char *                  pName)
+{
+    unsigned int                Hash = 2166136261u;
+
+    while(0 != *pName)
+    {
+        Hash ^= (unsigned char) *pName++;
+        Hash *= 16777619u;
+    }
+
+    return Hash;
+}
+
+static unsigned int
+hashCustom (
+  llrp_bool_t                   bIsMessage,
+  unsigned int                  VendorID,
+  unsigned int                  SubTypeNum)
+{
+    llrp_u64_t                  Key;
+
+    Key = ((llrp_u64_t) VendorID << 32u) | SubTypeNum;
+    Key = (Key + (bIsMessage ? 1u : 0u)) * 0x9E3779B97F4A7C15ull;
+
+    return (unsigned int) (Key >> 32u);
+}
+
+static unsigned int
+hashCustomOf (
+  const CTypeDescriptor *       pTypeDescriptor)
+{
+    return hashCustom(pTypeDescriptor->m_bIsMessage,
+        pTypeDescriptor->m_pVendorDescriptor->m_VendorID,
+        pTypeDescriptor->m_TypeNum);
+}
+
+static unsigned int
+hashNameOf (
+  const CTypeDescriptor *       pTypeDescriptor)
+{
+    return hashName(pTypeDescriptor->m_pName);
+}
+
+/*
+ * Order lookupByName() searches in: standard messages,
+ * standard parameters, custom parameters, custom messages.
+ */
+static int
+nameRank (
+  const CTypeDescriptor *       pTypeDescriptor)
+{
+    if(NULL == pTypeDescriptor->m_pVendorDescriptor)
+    {
+        return pTypeDescriptor->m_bIsMessage ? 0 : 1;
+    }
+
+    return pTypeDescriptor->m_bIsMessage ? 3 : 2;
+}
+
+/*
+ * Double the size of an index (64 slots to start)
+ * and reinsert what was in it. Keys are unique.
+ */
+static void
+growIndex (
+  std::vector<const CTypeDescriptor *> & rIndex,
+  unsigned int                  (*pfHash)(const CTypeDescriptor *))
+{
+    std::vector<const CTypeDescriptor *> OldIndex;
+    unsigned int                nSlot;
+    unsigned int                Mask;
+
+    OldIndex.swap(rIndex);
+    nSlot = OldIndex.empty() ? 64u : 2u * (unsigned int) OldIndex.size();
+    rIndex.assign(nSlot, NULL);
+    Mask = nSlot - 1u;
+
+    for(unsigned int iOld = 0; iOld < OldIndex.size(); iOld++)
+    {
+        const CTypeDescriptor * pTypeDescriptor = OldIndex[iOld];
+        unsigned int            i;
+
+        if(NULL == pTypeDescriptor)
+        {
+            continue;
+        }
+
+        for(i = (*pfHash)(pTypeDescriptor) & Mask;
+            NULL != rIndex[i];
+            i = (i + 1u) & Mask)
+        {
+        }
+        rIndex[i] = pTypeDescriptor;
+    }
+}
+
 CTypeRegistry::CTypeRegistry (void)
 {
     memset(m_apStdMessageTypeDescriptors, 0,
@@ -33,6 +135,10 @@ CTypeRegistry::CTypeRegistry (void)
 
     memset(m_apStdParameterTypeDescriptors, 0,
         sizeof m_apStdParameterTypeDescriptors);
+
+    m_bOpaqueUnknownTypes = FALSE;
+    m_nCustomIndex = 0;
+    m_nNameIndex = 0;
 }
 
 CTypeRegistry::~CTypeRegistry (void)
@@ -77,8 +183,12 @@ CTypeRegistry::enroll (
         {
             m_listCustomParameterTypeDescriptors.push_back(pTypeDescriptor);
         }
+
+        indexCustom(pTypeDescriptor);
     }
 
+    indexName(pTypeDescriptor);
+
     return RC_OK;
 }
 
@@ -112,22 +222,7 @@ CTypeRegistry::lookupCustomMessage (
   unsigned int                  VendorID,
   unsigned int                  MessageSubTypeNum) const
 {
-    for (
-        std::list<const CTypeDescriptor *>::const_iterator elem =
-                            m_listCustomMessageTypeDescriptors.begin();
-        elem != m_listCustomMessageTypeDescriptors.end();
-        elem++)
-    {
-        const CTypeDescriptor * pTypeDescriptor;
-        pTypeDescriptor = *elem;
-        if(VendorID == pTypeDescriptor->m_pVendorDescriptor->m_VendorID &&
-           MessageSubTypeNum == pTypeDescriptor->m_TypeNum)
-        {
-            return pTypeDescriptor;
-        }
-    }
-
-    return NULL;
+    return lookupCustom(TRUE, VendorID, MessageSubTypeNum);
 }
 
 const CTypeDescriptor *
@@ -135,22 +230,7 @@ CTypeRegistry::lookupCustomParameter (
   unsigned int                  VendorID,
   unsigned int                  ParameterSubTypeNum) const
 {
-    for (
-        std::list<const CTypeDescriptor *>::const_iterator elem = 
-                            m_listCustomParameterTypeDescriptors.begin();
-        elem != m_listCustomParameterTypeDescriptors.end();
-        elem++)
-    {
-        const CTypeDescriptor * pTypeDescriptor;
-        pTypeDescriptor = *elem;
-        if(VendorID == pTypeDescriptor->m_pVendorDescriptor->m_VendorID &&
-           ParameterSubTypeNum == pTypeDescriptor->m_TypeNum)
-        {
-            return pTypeDescriptor;
-        }
-    }
-
-    return NULL;
+    return lookupCustom(FALSE, VendorID, ParameterSubTypeNum);
 }
 
 /* look up the type descriptor*/
@@ -158,65 +238,141 @@ const CTypeDescriptor *
 CTypeRegistry::lookupByName (
   char *                    pName) const
 {
-    unsigned int                i;
     const CTypeDescriptor *     pTypeDescriptor;
+    unsigned int                Mask;
+    unsigned int                i;
 
-    for(i = 0; i < 1024u; i++)
+    if(m_apNameIndex.empty())
     {
-        pTypeDescriptor = m_apStdMessageTypeDescriptors[i];
-        if(NULL == pTypeDescriptor)
-        {
-            continue;
-        }
+        return NULL;
+    }
 
+    Mask = (unsigned int) m_apNameIndex.size() - 1u;
+    for(i = hashName(pName) & Mask;
+        NULL != (pTypeDescriptor = m_apNameIndex[i]);
+        i = (i + 1u) & Mask)
+    {
         if(0 == strcmp(pTypeDescriptor->m_pName, pName))
         {
             return pTypeDescriptor;
         }
     }
 
-    for(i = 0; i < 1024u; i++)
+    return NULL;
+}
+
+const CTypeDescriptor *
+CTypeRegistry::lookupCustom (
+  llrp_bool_t                   bIsMessage,
+  unsigned int                  VendorID,
+  unsigned int                  SubTypeNum) const
+{
+    const CTypeDescriptor *     pTypeDescriptor;
+    unsigned int                Mask;
+    unsigned int                i;
+
+    if(m_apCustomIndex.empty())
     {
-        pTypeDescriptor = m_apStdParameterTypeDescriptors[i];
-        if(NULL == pTypeDescriptor)
-        {
-            continue;
-        }
+        return NULL;
+    }
 
-        if(0 == strcmp(pTypeDescriptor->m_pName, pName))
+    Mask = (unsigned int) m_apCustomIndex.size() - 1u;
+    for(i = hashCustom(bIsMessage, VendorID, SubTypeNum) & Mask;
+        NULL != (pTypeDescriptor = m_apCustomIndex[i]);
+        i = (i + 1u) & Mask)
+    {
+        if(SubTypeNum == pTypeDescriptor->m_TypeNum &&
+           VendorID == pTypeDescriptor->m_pVendorDescriptor->m_VendorID &&
+           bIsMessage == pTypeDescriptor->m_bIsMessage)
         {
             return pTypeDescriptor;
         }
     }
 
-    for (
-        std::list<const CTypeDescriptor *>::const_iterator elem = 
-                            m_listCustomParameterTypeDescriptors.begin();
-        elem != m_listCustomParameterTypeDescriptors.end();
-        elem++)
+    return NULL;
+}
+
+/*
+ * Add a custom descriptor to m_apCustomIndex. If the key
+ * is already there the earlier enrollment stays, like the
+ * list search that came before the index.
+ */
+void
+CTypeRegistry::indexCustom (
+  const CTypeDescriptor *       pTypeDescriptor)
+{
+    unsigned int                Mask;
+    unsigned int                i;
+
+    if(2u * (m_nCustomIndex + 1u) > m_apCustomIndex.size())
+    {
+        growIndex(m_apCustomIndex, hashCustomOf);
+    }
+
+    Mask = (unsigned int) m_apCustomIndex.size() - 1u;
+    for(i = hashCustomOf(pTypeDescriptor) & Mask;
+        NULL != m_apCustomIndex[i];
+        i = (i + 1u) & Mask)
     {
-        const CTypeDescriptor * pTypeDescriptor;
-        pTypeDescriptor = *elem;
-        if(0 == strcmp(pTypeDescriptor->m_pName, pName))
+        const CTypeDescriptor * pEntry = m_apCustomIndex[i];
+
+        if(pEntry->m_TypeNum == pTypeDescriptor->m_TypeNum &&
+           pEntry->m_bIsMessage == pTypeDescriptor->m_bIsMessage &&
+           pEntry->m_pVendorDescriptor->m_VendorID ==
+                pTypeDescriptor->m_pVendorDescriptor->m_VendorID)
         {
-            return pTypeDescriptor;
+            return;
         }
     }
 
-    for (
-        std::list<const CTypeDescriptor *>::const_iterator elem =
-                            m_listCustomMessageTypeDescriptors.begin();
-        elem != m_listCustomMessageTypeDescriptors.end();
-        elem++)
+    m_apCustomIndex[i] = pTypeDescriptor;
+    m_nCustomIndex++;
+}
+
+/*
+ * Add a descriptor to m_apNameIndex. When the name is
+ * already there, keep whichever the linear search would
+ * have found first: lower nameRank(), then, among standard
+ * types of one kind, the lower type number. Re-enrolling a
+ * standard type number replaces it.
+ */
+void
+CTypeRegistry::indexName (
+  const CTypeDescriptor *       pTypeDescriptor)
+{
+    unsigned int                Mask;
+    unsigned int                i;
+
+    if(2u * (m_nNameIndex + 1u) > m_apNameIndex.size())
+    {
+        growIndex(m_apNameIndex, hashNameOf);
+    }
+
+    Mask = (unsigned int) m_apNameIndex.size() - 1u;
+    for(i = hashNameOf(pTypeDescriptor) & Mask;
+        NULL != m_apNameIndex[i];
+        i = (i + 1u) & Mask)
     {
-        const CTypeDescriptor * pTypeDescriptor;
-        pTypeDescriptor = *elem;
-        if(0 == strcmp(pTypeDescriptor->m_pName, pName))
+        const CTypeDescriptor * pEntry = m_apNameIndex[i];
+        int                     NewRank = nameRank(pTypeDescriptor);
+        int                     OldRank = nameRank(pEntry);
+
+        if(0 != strcmp(pEntry->m_pName, pTypeDescriptor->m_pName))
         {
-            return pTypeDescriptor;
+            continue;
+        }
+
+        if(NewRank < OldRank ||
+           (NewRank == OldRank && 2 > NewRank &&
+            pTypeDescriptor->m_TypeNum <= pEntry->m_TypeNum))
+        {
+            m_apNameIndex[i] = pTypeDescriptor;
         }
+        return;
     }
-    return NULL;
+
+    m_apNameIndex[i] = pTypeDescriptor;
+    m_nNameIndex++;
 }
 
 }; /* namespace LLRP */
@@ -31,6 +31,14 @@
  **
  *****************************************************************************/
 
+/*
+ * ltkcpp_platform.h includes <stdint.h> inside namespace LLRP,
+ * so a .cpp that includes this header includes these first.
+ */
+#include <stdio.h>
+#include <iosfwd>
+#include <string>
+
 /* forward declare these so we don't need to include the
 ** whole XML header files here. Make sure they are out
 ** of the namespace and extern C since they need to 
@@ -39,15 +47,102 @@ extern "C"
 {
     struct _xmlNode;
     struct _xmlDoc;
+    struct _xmlTextReader;
 }
 
 namespace LLRP
 {
+class CXMLTextSink;
 class CXMLTextEncoder;
 class CXMLTextEncoderStream;
 class CXMLTextDecoder;
+class CXMLTextStreamDecoder;
 class CXMLTextDecoderStream;
 
+/**
+ *****************************************************************************
+ **
+ ** @brief  Destination for XML text from a streaming CXMLTextEncoder
+ **
+ ** The encoder hands over the text in chunks as it goes, so
+ ** the size of an element's XML is not limited. The
+ ** subclasses below cover the usual destinations.
+ **
+ *****************************************************************************/
+class CXMLTextSink
+{
+  public:
+    virtual
+    ~CXMLTextSink (void);
+
+    /** @brief Take nData bytes of text. Return 0 OK, else error */
+    virtual int
+    write (
+      const char *              pData,
+      unsigned int              nData) = 0;
+};
+
+/** @brief Sink that writes to a stdio stream, e.g. stdout */
+class CXMLTextFileSink : public CXMLTextSink
+{
+  private:
+    FILE *                      m_pFile;
+
+  public:
+    CXMLTextFileSink (
+      FILE *                    pFile);
+
+    int
+    write (
+      const char *              pData,
+      unsigned int              nData);
+};
+
+/** @brief Sink that writes to a file descriptor or socket */
+class CXMLTextFdSink : public CXMLTextSink
+{
+  private:
+    int                         m_fd;
+
+  public:
+    CXMLTextFdSink (
+      int                       fd);
+
+    int
+    write (
+      const char *              pData,
+      unsigned int              nData);
+};
+
+/** @brief Sink that writes to a std::ostream */
+class CXMLTextOstreamSink : public CXMLTextSink
+{
+  private:
+    std::ostream &              m_rStream;
+
+  public:
+    CXMLTextOstreamSink (
+      std::ostream &            rStream);
+
+    int
+    write (
+      const char *              pData,
+      unsigned int              nData);
+};
+
+/** @brief Sink that collects the text in a growing string */
+class CXMLTextStringSink : public CXMLTextSink
+{
+  public:
+    /** @brief All the text so far. Clear it to reuse the sink */
+    std::string                 m_Text;
+
+    int
+    write (
+      const char *              pData,
+      unsigned int              nData);
+};
+
 class CXMLTextEncoder : public CEncoder
 {
     friend class CXMLTextEncoderStream;
@@ -56,20 +151,42 @@ class CXMLTextEncoder : public CEncoder
     char *                      m_pBuffer;
     int                         m_nBuffer;
     int                         m_iNext;
+    CXMLTextSink *              m_pSink;
+    int                         m_bFailed;
 
   public:
     int                         m_bOverflow;
 
   public:
+    /*
+     * Fill a fixed buffer. Text is NUL terminated. If it
+     * doesn't fit m_bOverflow is set and the rest dropped.
+     */
     CXMLTextEncoder (
       char *                    pBuffer,
       int                       nBuffer);
 
+    /*
+     * Stream to pSink in chunks. No size limit. A failed
+     * sink write is reported in m_ErrorDetails.
+     */
+    CXMLTextEncoder (
+      CXMLTextSink *            pSink);
+
     ~CXMLTextEncoder (void);
 
     void
     encodeElement (
       const CElement *          pElement);
+
+  private:
+    void
+    append (
+      const char *              pData,
+      unsigned int              nData);
+
+    void
+    flush (void);
 };
 
 class CXMLTextDecoder : public CDecoder
@@ -102,6 +219,62 @@ class CXMLTextDecoder : public CDecoder
 
 };
 
+/**
+ *****************************************************************************
+ **
+ ** @brief  Decode an LTK-XML message sequence one message at a time
+ **
+ ** CXMLTextDecoder reads the whole document into a DOM before
+ ** decoding anything. This decoder pulls the input through a
+ ** libxml2 xmlTextReader instead and only builds the DOM
+ ** subtree of the message being decoded, so memory use is
+ ** bounded by the largest message rather than the file.
+ **
+ ** The root element is either a single message or a wrapper
+ ** such as <packetSequence> whose element children are the
+ ** messages. Each subtree is decoded by a CXMLTextDecoder, so
+ ** the error details are the same as on the DOM path.
+ **
+ ** decodeMessage() returns NULL when a message fails to decode
+ ** and the next call moves on to the following message. Once
+ ** isEndOfInput() is true no more messages will come. It is
+ ** also set on an XML syntax error, which is reported in
+ ** m_ErrorDetails as RC_MiscError with the line number.
+ **
+ *****************************************************************************/
+class CXMLTextStreamDecoder : public CDecoder
+{
+  private:
+    struct _xmlTextReader *     m_pReader;
+    int                         m_bEndOfInput;
+    int                         m_bPending;
+    int                         m_nMessageDepth;
+
+    int
+    advanceToMessage (void);
+
+    void
+    readerFailed (void);
+
+  public:
+    CXMLTextStreamDecoder (
+  const CTypeRegistry *         pTypeRegistry,
+      const char *              pBuffer,
+      int                       nBuffer);
+
+    CXMLTextStreamDecoder (
+  const CTypeRegistry *         pTypeRegistry,
+      const char *              fname);
+
+    ~CXMLTextStreamDecoder (void);
+
+    CMessage *
+    decodeMessage (void);
+
+    int
+    isEndOfInput (void);
+};
+
 class CXMLTextEncoderStream : public CEncoderStream
 {
     friend class CXMLTextEncoder;
@@ -340,6 +513,24 @@ class CXMLTextEncoderStream : public CEncoderStream
       const char *                    pFmtStr,
                                 ...);
 
+    void
+    appendString (
+      const char *              pString);
+
+    void
+    appendDecimal (
+      llrp_u64_t                Value,
+      unsigned int              nMinDigit = 1u);
+
+    void
+    appendSignedDecimal (
+      llrp_s64_t                Value);
+
+    void
+    appendHex (
+      llrp_u64_t                Value,
+      unsigned int              nDigit);
+
 };
 
 class CXMLTextDecoderStream : public CDecoderStream
@@ -648,4 +839,19 @@ class CXMLTextDecoderStream : public CDecoderStream
 
 };
 
+/*
+** @brief Streams a CElement as XML text to a sink
+**
+** Like toXMLString() without the buffer size limit.
+**
+** @param[in]  pElement      The CElement to encode to XML
+** @param[in]  pSink         Where the text goes
+**
+** @return EResultCode Result code from the operation
+*/
+extern EResultCode
+toXMLText (
+  const CElement *              pElement,
+  CXMLTextSink *                pSink);
+
 };
@@ -44,6 +44,7 @@
 
 #include "libxml/parser.h"
 #include "libxml/tree.h"
+#include "libxml/xmlreader.h"
 
 #include "ltkcpp_xmltext.h"
 
@@ -142,6 +143,208 @@ CXMLTextDecoder::decodeMessage (void)
     return pMessage;
 }
 
+CXMLTextStreamDecoder::CXMLTextStreamDecoder (
+  const CTypeRegistry *         pTypeRegistry,
+  const char *                  pBuffer,
+  int                           nBuffer) : CDecoder(pTypeRegistry)
+{
+    /* set the line numbers for error reporting */
+    xmlLineNumbersDefault(1);
+
+    m_pReader = xmlReaderForMemory(pBuffer, nBuffer, "noName.xml", NULL,
+                                   XML_PARSE_COMPACT | XML_PARSE_NONET);
+    m_bEndOfInput   = FALSE;
+    m_bPending      = FALSE;
+    m_nMessageDepth = -1;
+
+    if(NULL == m_pReader)
+    {
+        readerFailed();
+    }
+}
+
+CXMLTextStreamDecoder::CXMLTextStreamDecoder (
+  const CTypeRegistry *         pTypeRegistry,
+  const char *                  fname) : CDecoder(pTypeRegistry)
+{
+    /* set the line numbers for error reporting */
+    xmlLineNumbersDefault(1);
+
+    m_pReader = xmlReaderForFile(fname, NULL,
+                                 XML_PARSE_COMPACT | XML_PARSE_NONET);
+    m_bEndOfInput   = FALSE;
+    m_bPending      = FALSE;
+    m_nMessageDepth = -1;
+
+    if(NULL == m_pReader)
+    {
+        readerFailed();
+    }
+}
+
+CXMLTextStreamDecoder::~CXMLTextStreamDecoder (void)
+{
+    if(NULL != m_pReader)
+    {
+        xmlFreeTextReader(m_pReader);
+        m_pReader = NULL;
+    }
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Decode the next message of the input
+ **
+ ** The reader expands only the subtree of this message and
+ ** frees it again once it moves on to the next one.
+ **
+ ** @return CMessage *      The decoded message, or NULL when it
+ **                         failed to decode (see m_ErrorDetails)
+ **                         or when the input has ended
+ **
+ *****************************************************************************/
+CMessage *
+CXMLTextStreamDecoder::decodeMessage (void)
+{
+    struct _xmlNode *           pNode;
+    CMessage *                  pMessage;
+
+    if(m_bEndOfInput)
+    {
+        return NULL;
+    }
+
+    m_ErrorDetails.clear();
+
+    if(!m_bPending && 1 != advanceToMessage())
+    {
+        return NULL;
+    }
+
+    pNode = xmlTextReaderExpand(m_pReader);
+    if(NULL == pNode)
+    {
+        readerFailed();
+        return NULL;
+    }
+    m_bPending = FALSE;
+
+    /* decode the subtree just like a DOM-built one */
+    CXMLTextDecoder             Decoder(m_pRegistry, pNode);
+
+    pMessage = Decoder.decodeMessage();
+    m_ErrorDetails = Decoder.m_ErrorDetails;
+
+    return pMessage;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Tell whether more messages will come
+ **
+ ** This reads ahead to the start of the next message. When
+ ** it returns TRUE, m_ErrorDetails is RC_OK if the input
+ ** ended cleanly, and otherwise it says why reading stopped.
+ **
+ *****************************************************************************/
+int
+CXMLTextStreamDecoder::isEndOfInput (void)
+{
+    if(!m_bEndOfInput && !m_bPending)
+    {
+        advanceToMessage();
+    }
+
+    return m_bEndOfInput;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Move the reader to the start tag of the next message
+ **
+ ** The first call finds the root element and decides whether
+ ** it is the message itself or a wrapper around them.
+ **
+ ** @return int             1 on a message, 0 at the end of the
+ **                         input, -1 on an XML error
+ **
+ *****************************************************************************/
+int
+CXMLTextStreamDecoder::advanceToMessage (void)
+{
+    int                         rc;
+
+    if(m_nMessageDepth < 0)
+    {
+        const CTypeDescriptor * pTypeDescriptor;
+
+        do
+        {
+            rc = xmlTextReaderRead(m_pReader);
+        } while(1 == rc &&
+                XML_READER_TYPE_ELEMENT != xmlTextReaderNodeType(m_pReader));
+
+        if(1 == rc)
+        {
+            pTypeDescriptor = m_pRegistry->lookupByName(
+                       (char *) xmlTextReaderConstLocalName(m_pReader));
+
+            if(NULL != pTypeDescriptor && pTypeDescriptor->m_bIsMessage)
+            {
+                /* the document is a single message */
+                m_nMessageDepth = 0;
+            }
+            else
+            {
+                /* the messages are children of the root */
+                m_nMessageDepth = 1;
+                rc = xmlTextReaderRead(m_pReader);
+            }
+        }
+    }
+    else
+    {
+        /* skip over the message decoded last */
+        rc = xmlTextReaderNext(m_pReader);
+    }
+
+    while(1 == rc)
+    {
+        if(XML_READER_TYPE_ELEMENT == xmlTextReaderNodeType(m_pReader) &&
+           m_nMessageDepth == xmlTextReaderDepth(m_pReader))
+        {
+            m_bPending = TRUE;
+            return 1;
+        }
+        rc = xmlTextReaderRead(m_pReader);
+    }
+
+    if(0 == rc)
+    {
+        m_ErrorDetails.clear();
+        m_bEndOfInput = TRUE;
+        return 0;
+    }
+
+    readerFailed();
+    return -1;
+}
+
+void
+CXMLTextStreamDecoder::readerFailed (void)
+{
+    m_ErrorDetails.m_eResultCode = RC_MiscError;
+    m_ErrorDetails.m_pWhatStr    = "could not parse XML";
+    m_ErrorDetails.m_pRefType    = NULL;
+    m_ErrorDetails.m_pRefField   = NULL;
+    m_ErrorDetails.m_OtherDetail = (NULL == m_pReader) ? 0 :
+                        xmlTextReaderGetParserLineNumber(m_pReader);
+    m_bEndOfInput = TRUE;
+}
+
 CXMLTextDecoderStream::CXMLTextDecoderStream (
   CXMLTextDecoder *             pDecoder)
 {
@@ -22,6 +22,14 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <time.h>
+#include <errno.h>
+#include <ostream>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 #include "ltkcpp_platform.h"
 #include "ltkcpp_base.h"
@@ -50,6 +58,89 @@ discoverNamespaces (
   void *                        pArg);
 
 
+/* Size of the chunks a streaming encoder hands its sink */
+#define XML_TEXT_CHUNK_SIZE     8192
+
+
+CXMLTextSink::~CXMLTextSink (void)
+{
+}
+
+CXMLTextFileSink::CXMLTextFileSink (
+  FILE *                        pFile)
+{
+    m_pFile = pFile;
+}
+
+int
+CXMLTextFileSink::write (
+  const char *                  pData,
+  unsigned int                  nData)
+{
+    return (nData == fwrite(pData, 1u, nData, m_pFile)) ? 0 : -1;
+}
+
+CXMLTextFdSink::CXMLTextFdSink (
+  int                           fd)
+{
+    m_fd = fd;
+}
+
+int
+CXMLTextFdSink::write (
+  const char *                  pData,
+  unsigned int                  nData)
+{
+    while(0 < nData)
+    {
+#ifdef WIN32
+        int                     rc = _write(m_fd, pData, nData);
+#else
+        int                     rc = (int) ::write(m_fd, pData, nData);
+#endif
+
+        if(0 > rc && EINTR == errno)
+        {
+            continue;
+        }
+        if(0 >= rc)
+        {
+            return -1;
+        }
+        pData += rc;
+        nData -= rc;
+    }
+
+    return 0;
+}
+
+CXMLTextOstreamSink::CXMLTextOstreamSink (
+  std::ostream &                rStream)
+  : m_rStream(rStream)
+{
+}
+
+int
+CXMLTextOstreamSink::write (
+  const char *                  pData,
+  unsigned int                  nData)
+{
+    m_rStream.write(pData, nData);
+
+    return m_rStream.good() ? 0 : -1;
+}
+
+int
+CXMLTextStringSink::write (
+  const char *                  pData,
+  unsigned int                  nData)
+{
+    m_Text.append(pData, nData);
+
+    return 0;
+}
+
+
 CXMLTextEncoder::CXMLTextEncoder (
   char *                        pBuffer,
   int                           nBuffer)
@@ -57,11 +148,28 @@ CXMLTextEncoder::CXMLTextEncoder (
     m_pBuffer = pBuffer;
     m_nBuffer = nBuffer;
     m_iNext = 0;
+    m_pSink = NULL;
+    m_bFailed = 0;
+    m_bOverflow = 0;
+}
+
+CXMLTextEncoder::CXMLTextEncoder (
+  CXMLTextSink *                pSink)
+{
+    m_pBuffer = new char[XML_TEXT_CHUNK_SIZE];
+    m_nBuffer = XML_TEXT_CHUNK_SIZE;
+    m_iNext = 0;
+    m_pSink = pSink;
+    m_bFailed = 0;
     m_bOverflow = 0;
 }
 
 CXMLTextEncoder::~CXMLTextEncoder (void)
 {
+    if(NULL != m_pSink)
+    {
+        delete[] m_pBuffer;
+    }
 }
 
 void
@@ -71,6 +179,75 @@ CXMLTextEncoder::encodeElement (
     CXMLTextEncoderStream         MyEncoderStream(this);
 
     MyEncoderStream.putElement(pElement);
+
+    if(NULL != m_pSink)
+    {
+        flush();
+    }
+}
+
+/*
+ * Add text to the buffer. A fixed buffer that fills up
+ * sets m_bOverflow and drops the rest. A streaming
+ * encoder passes the full chunk to the sink and carries on.
+ * One byte is always kept for the NUL terminator.
+ */
+void
+CXMLTextEncoder::append (
+  const char *                  pData,
+  unsigned int                  nData)
+{
+    if(m_bFailed)
+    {
+        return;
+    }
+
+    if(m_iNext + (int) nData >= m_nBuffer)
+    {
+        if(NULL == m_pSink)
+        {
+            m_bOverflow = 1;
+            m_bFailed = 1;
+            return;
+        }
+
+        flush();
+
+        if((int) nData >= m_nBuffer)
+        {
+            if(!m_bFailed && 0 != m_pSink->write(pData, nData))
+            {
+                m_ErrorDetails.resultCodeAndWhatStr(RC_MiscError,
+                    "XML text sink write failed");
+                m_bFailed = 1;
+            }
+            return;
+        }
+
+        if(m_bFailed)
+        {
+            return;
+        }
+    }
+
+    memcpy(&m_pBuffer[m_iNext], pData, nData);
+    m_iNext += nData;
+    m_pBuffer[m_iNext] = 0;
+}
+
+void
+CXMLTextEncoder::flush (void)
+{
+    if(0 < m_iNext && !m_bFailed)
+    {
+        if(0 != m_pSink->write(m_pBuffer, m_iNext))
+        {
+            m_ErrorDetails.resultCodeAndWhatStr(RC_MiscError,
+                "XML text sink write failed");
+            m_bFailed = 1;
+        }
+    }
+    m_iNext = 0;
 }
 
 void
@@ -158,11 +335,11 @@ CXMLTextEncoderStream::put_u8 (
     case CFieldDescriptor::FMT_NORMAL:
     case CFieldDescriptor::FMT_DEC:
     default:
-        appendFormat("%u", Value);
+        appendDecimal(Value);
         break;
 
     case CFieldDescriptor::FMT_HEX:
-        appendFormat("%02X", Value);
+        appendHex(Value, 2u);
         break;
     }
     appendCloseTag(pFieldName);
@@ -181,11 +358,11 @@ CXMLTextEncoderStream::put_s8 (
     case CFieldDescriptor::FMT_NORMAL:
     case CFieldDescriptor::FMT_DEC:
     default:
-        appendFormat("%d", Value);
+        appendSignedDecimal(Value);
         break;
 
     case CFieldDescriptor::FMT_HEX:
-        appendFormat("%02X", 0xFF & Value);
+        appendHex(0xFF & Value, 2u);
         break;
     }
     appendCloseTag(pFieldName);
@@ -208,13 +385,13 @@ CXMLTextEncoderStream::put_u8v (
         default:
             if(0 < i)
             {
-                appendFormat(" ");
+                appendString(" ");
             }
-            appendFormat("%u", Value.m_pValue[i]);
+            appendDecimal(Value.m_pValue[i]);
             break;
 
         case CFieldDescriptor::FMT_HEX:
-            appendFormat("%02X", 0xFF & Value.m_pValue[i]);
+            appendHex(0xFF & Value.m_pValue[i], 2u);
             break;
         }
     }
@@ -238,13 +415,13 @@ CXMLTextEncoderStream::put_s8v (
         default:
             if(0 < i)
             {
-                appendFormat(" ");
+                appendString(" ");
             }
-            appendFormat("%d", Value.m_pValue[i]);
+            appendSignedDecimal(Value.m_pValue[i]);
             break;
 
         case CFieldDescriptor::FMT_HEX:
-            appendFormat("%02X", 0xFF & Value.m_pValue[i]);
+            appendHex(0xFF & Value.m_pValue[i], 2u);
             break;
         }
     }
@@ -268,11 +445,11 @@ CXMLTextEncoderStream::put_u16 (
     case CFieldDescriptor::FMT_NORMAL:
     case CFieldDescriptor::FMT_DEC:
     default:
-        appendFormat("%u", Value);
+        appendDecimal(Value);
         break;
 
     case CFieldDescriptor::FMT_HEX:
-        appendFormat("%04X", Value);
+        appendHex(Value, 4u);
         break;
     }
     appendCloseTag(pFieldName);
@@ -291,11 +468,11 @@ CXMLTextEncoderStream::put_s16 (
     case CFieldDescriptor::FMT_NORMAL:
     case CFieldDescriptor::FMT_DEC:
     default:
-        appendFormat("%d", Value);
+        appendSignedDecimal(Value);
         break;
 
     case CFieldDescriptor::FMT_HEX:
-        appendFormat("%04X", 0xFFFF & Value);
+        appendHex(0xFFFF & Value, 4u);
         break;
     }
     appendCloseTag(pFieldName);
@@ -313,18 +490,18 @@ CXMLTextEncoderStream::put_u16v (
     {
         if(0 < i)
         {
-            appendFormat(" ");
+            appendString(" ");
         }
         switch(pFieldDescriptor->m_eFieldFormat)
         {
         case CFieldDescriptor::FMT_NORMAL:
         case CFieldDescriptor::FMT_DEC:
         default:
-            appendFormat("%u", Value.m_pValue[i]);
+            appendDecimal(Value.m_pValue[i]);
             break;
 
         case CFieldDescriptor::FMT_HEX:
-            appendFormat("%04X", 0xFFFF & Value.m_pValue[i]);
+            appendHex(0xFFFF & Value.m_pValue[i], 4u);
             break;
         }
     }
@@ -343,18 +520,18 @@ CXMLTextEncoderStream::put_s16v (
     {
         if(0 < i)
         {
-            appendFormat(" ");
+            appendString(" ");
         }
         switch(pFieldDescriptor->m_eFieldFormat)
         {
         case CFieldDescriptor::FMT_NORMAL:
         case CFieldDescriptor::FMT_DEC:
         default:
-            appendFormat("%d", Value.m_pValue[i]);
+            appendSignedDecimal(Value.m_pValue[i]);
             break;
 
         case CFieldDescriptor::FMT_HEX:
-            appendFormat("%04X", 0xFFFF & Value.m_pValue[i]);
+            appendHex(0xFFFF & Value.m_pValue[i], 4u);
             break;
         }
     }
@@ -378,11 +555,11 @@ CXMLTextEncoderStream::put_u32 (
     case CFieldDescriptor::FMT_NORMAL:
     case CFieldDescriptor::FMT_DEC:
     default:
-        appendFormat("%u", Value);
+        appendDecimal(Value);
         break;
 
     case CFieldDescriptor::FMT_HEX:
-        appendFormat("%08X", Value);
+        appendHex(Value, 8u);
         break;
     }
     appendCloseTag(pFieldName);
@@ -401,11 +578,11 @@ CXMLTextEncoderStream::put_s32 (
     case CFieldDescriptor::FMT_NORMAL:
     case CFieldDescriptor::FMT_DEC:
     default:
-        appendFormat("%d", Value);
+        appendSignedDecimal(Value);
         break;
 
     case CFieldDescriptor::FMT_HEX:
-        appendFormat("%08X", Value);
+        appendHex(Value, 8u);
         break;
     }
     appendCloseTag(pFieldName);
@@ -423,18 +600,18 @@ CXMLTextEncoderStream::put_u32v (
     {
         if(0 < i)
         {
-            appendFormat(" ");
+            appendString(" ");
         }
         switch(pFieldDescriptor->m_eFieldFormat)
         {
         case CFieldDescriptor::FMT_NORMAL:
         case CFieldDescriptor::FMT_DEC:
         default:
-            appendFormat("%u", Value.m_pValue[i]);
+            appendDecimal(Value.m_pValue[i]);
             break;
 
         case CFieldDescriptor::FMT_HEX:
-            appendFormat("%08X", Value.m_pValue[i]);
+            appendHex(Value.m_pValue[i], 8u);
             break;
         }
     }
@@ -453,18 +630,18 @@ CXMLTextEncoderStream::put_s32v (
     {
         if(0 < i)
         {
-            appendFormat(" ");
+            appendString(" ");
         }
         switch(pFieldDescriptor->m_eFieldFormat)
         {
         case CFieldDescriptor::FMT_NORMAL:
         case CFieldDescriptor::FMT_DEC:
         default:
-            appendFormat("%d", Value.m_pValue[i]);
+            appendSignedDecimal(Value.m_pValue[i]);
             break;
 
         case CFieldDescriptor::FMT_HEX:
-            appendFormat("%08X", Value.m_pValue[i]);
+            appendHex(Value.m_pValue[i], 8u);
             break;
         }
     }
@@ -488,31 +665,44 @@ CXMLTextEncoderStream::put_u64 (
     case CFieldDescriptor::FMT_NORMAL:
     case CFieldDescriptor::FMT_DEC:
     default:
-#ifdef WIN32
-        appendFormat("%I64u", Value);
-#else
-        appendFormat("%llu", Value);
-#endif
+        appendDecimal(Value);
         break;
 
     case CFieldDescriptor::FMT_HEX:
-#ifdef WIN32
-        appendFormat("%016I64X", Value);
-#else
-        appendFormat("%016llX", Value);
-#endif
+        appendHex(Value, 16u);
         break;
 
     case CFieldDescriptor::FMT_DATETIME:
         {
-            char                aBuf[64];
             time_t              CurSec  = (time_t)(Value / 1000000u);
             llrp_u32_t          CurUSec = (llrp_u32_t)(Value % 1000000u);
-            struct tm *         pGMTime;
+            struct tm           GMTime;
+            struct tm *         pGMTime = &GMTime;
 
-            pGMTime = gmtime(&CurSec);
-            strftime(aBuf, sizeof aBuf, "%Y-%m-%dT%H:%M:%S", pGMTime);
-            appendFormat("%s.%06dZ", aBuf, CurUSec);
+            /*
+             * %Y-%m-%dT%H:%M:%S.uuuuuuZ, without strftime().
+             * Not gmtime(), its static result is shared by
+             * every thread.
+             */
+#ifdef WIN32
+            gmtime_s(&GMTime, &CurSec);
+#else
+            gmtime_r(&CurSec, &GMTime);
+#endif
+            appendDecimal(pGMTime->tm_year + 1900, 4u);
+            appendString("-");
+            appendDecimal(pGMTime->tm_mon + 1, 2u);
+            appendString("-");
+            appendDecimal(pGMTime->tm_mday, 2u);
+            appendString("T");
+            appendDecimal(pGMTime->tm_hour, 2u);
+            appendString(":");
+            appendDecimal(pGMTime->tm_min, 2u);
+            appendString(":");
+            appendDecimal(pGMTime->tm_sec, 2u);
+            appendString(".");
+            appendDecimal(CurUSec, 6u);
+            appendString("Z");
         }
         break;
     }
@@ -532,19 +722,11 @@ CXMLTextEncoderStream::put_s64 (
     case CFieldDescriptor::FMT_NORMAL:
     case CFieldDescriptor::FMT_DEC:
     default:
-#ifdef WIN32
-        appendFormat("%I64d", Value);
-#else
-        appendFormat("%lld", Value);
-#endif
+        appendSignedDecimal(Value);
         break;
 
     case CFieldDescriptor::FMT_HEX:
-#ifdef WIN32
-        appendFormat("%016I64X", Value);
-#else
-        appendFormat("%016llX", Value);
-#endif
+        appendHex(Value, 16u);
         break;
     }
     appendCloseTag(pFieldName);
@@ -562,26 +744,18 @@ CXMLTextEncoderStream::put_u64v (
     {
         if(0 < i)
         {
-            appendFormat(" ");
+            appendString(" ");
         }
         switch(pFieldDescriptor->m_eFieldFormat)
         {
         case CFieldDescriptor::FMT_NORMAL:
         case CFieldDescriptor::FMT_DEC:
         default:
-#ifdef WIN32
-            appendFormat("%I64u", Value.m_pValue[i]);
-#else
-            appendFormat("%llu", Value.m_pValue[i]);
-#endif
+            appendDecimal(Value.m_pValue[i]);
             break;
 
         case CFieldDescriptor::FMT_HEX:
-#ifdef WIN32
-            appendFormat("%016I64X", Value.m_pValue[i]);
-#else
-            appendFormat("%016llX", Value.m_pValue[i]);
-#endif
+            appendHex(Value.m_pValue[i], 16u);
             break;
         }
     }
@@ -600,26 +774,18 @@ CXMLTextEncoderStream::put_s64v (
     {
         if(0 < i)
         {
-            appendFormat(" ");
+            appendString(" ");
         }
         switch(pFieldDescriptor->m_eFieldFormat)
         {
         case CFieldDescriptor::FMT_NORMAL:
         case CFieldDescriptor::FMT_DEC:
         default:
-#ifdef WIN32
-            appendFormat("%I64d", Value.m_pValue[i]);
-#else
-            appendFormat("%lld", Value.m_pValue[i]);
-#endif
+            appendSignedDecimal(Value.m_pValue[i]);
             break;
 
         case CFieldDescriptor::FMT_HEX:
-#ifdef WIN32
-            appendFormat("%016I64X", Value.m_pValue[i]);
-#else
-            appendFormat("%016llX", Value.m_pValue[i]);
-#endif
+            appendHex(Value.m_pValue[i], 16u);
             break;
         }
     }
@@ -642,12 +808,12 @@ CXMLTextEncoderStream::put_u1 (
     {
     case CFieldDescriptor::FMT_NORMAL:
     default:
-        appendFormat("%s", (Value & 1) ? "true" : "false");
+        appendString((Value & 1) ? "true" : "false");
         break;
 
     case CFieldDescriptor::FMT_DEC:
     case CFieldDescriptor::FMT_HEX:
-        appendFormat("%d", Value & 1);
+        appendSignedDecimal(Value & 1);
         break;
     }
     appendCloseTag(pFieldName);
@@ -664,13 +830,15 @@ CXMLTextEncoderStream::put_u1v (
     nByte = (Value.m_nBit + 7u) / 8u;
 
     indent();
-    appendFormat("<");
+    appendString("<");
     appendPrefixedTagName(pFieldName);
-    appendFormat(" Count='%d'>", Value.m_nBit);
+    appendString(" Count='");
+    appendDecimal(Value.m_nBit);
+    appendString("'>");
 
     for(int i = 0; i < nByte; i++)
     {
-        appendFormat("%02X", Value.m_pValue[i]);
+        appendHex(Value.m_pValue[i], 2u);
     }
 
     appendCloseTag(pFieldName);
@@ -684,7 +852,7 @@ CXMLTextEncoderStream::put_u2 (
     const char *                pFieldName = pFieldDescriptor->m_pName;
 
     appendOpenTag(pFieldName);
-    appendFormat("%d", Value & 3);
+    appendSignedDecimal(Value & 3);
     appendCloseTag(pFieldName);
 }
 
@@ -695,11 +863,16 @@ CXMLTextEncoderStream::put_u96 (
 {
     const char *                pFieldName = pFieldDescriptor->m_pName;
 
-    appendOpenTag(pFieldName);
+    char                        aHex[24];
+
     for(int i = 0; i < 12; i++)
     {
-        appendFormat("%02X", Value.m_aValue[i]);
+        aHex[2*i]   = "0123456789ABCDEF"[Value.m_aValue[i] >> 4u];
+        aHex[2*i+1] = "0123456789ABCDEF"[Value.m_aValue[i] & 0xFu];
     }
+
+    appendOpenTag(pFieldName);
+    m_pEncoder->append(aHex, sizeof aHex);
     appendCloseTag(pFieldName);
 }
 
@@ -721,7 +894,9 @@ CXMLTextEncoderStream::put_utf8v (
         }
         if(' ' <= c && c < 0x7F)
         {
-            appendFormat("%c", c);
+            char    Ch = (char) c;
+
+            m_pEncoder->append(&Ch, 1u);
         }
         else
         {
@@ -741,7 +916,7 @@ CXMLTextEncoderStream::put_bytesToEnd (
     appendOpenTag(pFieldName);
     for(int i = 0; i < Value.m_nValue; i++)
     {
-        appendFormat("%02X", Value.m_pValue[i]);
+        appendHex(Value.m_pValue[i], 2u);
     }
     appendCloseTag(pFieldName);
 }
@@ -815,16 +990,16 @@ CXMLTextEncoderStream::put_e8v (
 
         if(0 < i)
         {
-            appendFormat(" ");
+            appendString(" ");
         }
 
         if(NULL != pEntry->pName)
         {
-            appendFormat("%s", pEntry->pName);
+            appendString(pEntry->pName);
         }
         else
         {
-            appendFormat("%d", eValue);
+            appendSignedDecimal(eValue);
         }
     }
     appendCloseTag(pFieldName);
@@ -868,12 +1043,13 @@ CXMLTextEncoderStream::putElement (
     m_pRefType = pElement->m_pType;
 
     indent(-1);
-    appendFormat("<");
+    appendString("<");
     appendPrefixedTagName(m_pRefType->m_pName);
     if(m_pRefType->m_bIsMessage)
     {
-        appendFormat(" MessageID='%u'",
-            ((const CMessage *)pElement)->getMessageID());
+        appendString(" MessageID='");
+        appendDecimal(((const CMessage *)pElement)->getMessageID());
+        appendString("'");
     }
 
     if(NULL == m_pEnclosingEncoderStream)
@@ -892,7 +1068,7 @@ CXMLTextEncoderStream::putElement (
         {
             pNamespaceDescriptor = NamespaceList.apNamespaceDescriptor[iNSD];
 
-            appendFormat("\n");
+            appendString("\n");
             indent(0);
             appendFormat("xmlns:%s='%s'",
                 pNamespaceDescriptor->m_pPrefix,
@@ -902,13 +1078,13 @@ CXMLTextEncoderStream::putElement (
              */
             if(0 == strcmp(pNamespaceDescriptor->m_pPrefix, "llrp"))
             {
-                appendFormat("\n");
+                appendString("\n");
                 indent(0);
                 appendFormat("xmlns='%s'", pNamespaceDescriptor->m_pURI);
             }
         }
     }
-    appendFormat(">\n");
+    appendString(">\n");
 
     pElement->encode(this);
 
@@ -969,11 +1145,11 @@ CXMLTextEncoderStream::put_enum (
 
     if(NULL != pEntry->pName)
     {
-        appendFormat("%s", pEntry->pName);
+        appendString(pEntry->pName);
     }
     else
     {
-        appendFormat("%d", eValue);
+        appendSignedDecimal(eValue);
     }
 
     appendCloseTag(pFieldName);
@@ -983,11 +1159,19 @@ void
 CXMLTextEncoderStream::indent (
   int                           adjust)
 {
-    int                         n = m_nDepth + adjust;
+    static const char           aSpaces[] = "                                ";
+    int                         n = 2 * (m_nDepth + adjust);
 
-    for(int i = 0; i < n; i++)
+    while(0 < n)
     {
-        appendFormat("  ");
+        int                     nChunk = n;
+
+        if(nChunk > (int) sizeof aSpaces - 1)
+        {
+            nChunk = (int) sizeof aSpaces - 1;
+        }
+        m_pEncoder->append(aSpaces, nChunk);
+        n -= nChunk;
     }
 }
 
@@ -996,18 +1180,18 @@ CXMLTextEncoderStream::appendOpenTag (
   const char *                  pName)
 {
     indent(0);
-    appendFormat("<");
+    appendString("<");
     appendPrefixedTagName(pName);
-    appendFormat(">");
+    appendString(">");
 }
 
 void
 CXMLTextEncoderStream::appendCloseTag (
   const char *                  pName)
 {
-    appendFormat("</");
+    appendString("</");
     appendPrefixedTagName(pName);
-    appendFormat(">\n");
+    appendString(">\n");
 }
 
 void
@@ -1020,11 +1204,13 @@ CXMLTextEncoderStream::appendPrefixedTagName (
 
     if(0 != strcmp("llrp", pPrefix))
     {
-        appendFormat("%s:%s", pPrefix, pName);
+        appendString(pPrefix);
+        appendString(":");
+        appendString(pName);
     }
     else
     {
-        appendFormat("%s", pName);
+        appendString(pName);
     }
 }
 
@@ -1037,8 +1223,8 @@ CXMLTextEncoderStream::appendFormat (
     int                         nHoldBuf;
     va_list                     ap;
 
-    /* If overflow already detected, bail */
-    if(m_pEncoder->m_bOverflow)
+    /* If overflow or a sink error already happened, bail */
+    if(m_pEncoder->m_bFailed)
     {
         return;
     }
@@ -1053,15 +1239,69 @@ CXMLTextEncoderStream::appendFormat (
 
     nHoldBuf = (int)strlen(aHoldBuf);
 
-    if(m_pEncoder->m_iNext + nHoldBuf >= m_pEncoder->m_nBuffer)
+    m_pEncoder->append(aHoldBuf, nHoldBuf);
+}
+
+/*
+ * The routines below format the common cases by hand.
+ * They are much cheaper than appendFormat()'s vsnprintf().
+ */
+
+void
+CXMLTextEncoderStream::appendString (
+  const char *                  pString)
+{
+    m_pEncoder->append(pString, (unsigned int) strlen(pString));
+}
+
+/* Unsigned decimal, zero padded to at least nMinDigit digits */
+void
+CXMLTextEncoderStream::appendDecimal (
+  llrp_u64_t                    Value,
+  unsigned int                  nMinDigit)
+{
+    char                        aBuf[24];
+    unsigned int                i = sizeof aBuf;
+
+    do
     {
-        m_pEncoder->m_bOverflow = 1;
-        return;
+        aBuf[--i] = (char) ('0' + Value % 10u);
+        Value /= 10u;
+    } while(0 != Value || sizeof aBuf - i < nMinDigit);
+
+    m_pEncoder->append(&aBuf[i], (unsigned int) (sizeof aBuf - i));
+}
+
+void
+CXMLTextEncoderStream::appendSignedDecimal (
+  llrp_s64_t                    Value)
+{
+    if(0 > Value)
+    {
+        appendString("-");
+        appendDecimal(0u - (llrp_u64_t) Value);
+    }
+    else
+    {
+        appendDecimal((llrp_u64_t) Value);
     }
+}
 
-    strcpy(&m_pEncoder->m_pBuffer[m_pEncoder->m_iNext], aHoldBuf);
+/* Upper case hex, exactly the nDigit low order digits */
+void
+CXMLTextEncoderStream::appendHex (
+  llrp_u64_t                    Value,
+  unsigned int                  nDigit)
+{
+    char                        aBuf[16];
 
-    m_pEncoder->m_iNext += nHoldBuf;
+    for(unsigned int i = nDigit; 0 < i; i--)
+    {
+        aBuf[i - 1u] = "0123456789ABCDEF"[Value & 0xFu];
+        Value >>= 4u;
+    }
+
+    m_pEncoder->append(aBuf, nDigit);
 }
 
 
@@ -1158,5 +1398,22 @@ toXMLString (
     return RC_OK;
 }
 
+EResultCode
+toXMLText (
+  const CElement *              pElement,
+  CXMLTextSink *                pSink)
+{
+    if(NULL == pElement)
+    {
+        return RC_MiscError;
+    }
+
+    CXMLTextEncoder             MyXMLEncoder(pSink);
+
+    MyXMLEncoder.encodeElement(pElement);
+
+    return MyXMLEncoder.m_ErrorDetails.m_eResultCode;
+}
+
 
 }; /* namespace LLRP */
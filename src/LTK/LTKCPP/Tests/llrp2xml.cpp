@@ -54,6 +54,7 @@
 
 
 #include <stdio.h>
+#include <string.h>
 
 #include "ltkcpp.h"
 
@@ -63,7 +64,6 @@ using namespace LLRP;
 
 /* Buffer sizes */
 #define FRAME_BUF_SIZE          (4u*1024u*1024u)
-#define XML_TEXT_BUF_SIZE       (10u * FRAME_BUF_SIZE)
 
 
 /* forward declaration */
@@ -107,12 +107,11 @@ static char * g_errMsgStr = "<ERROR_MESSAGE MessageID=\"0\" Version=\"0\">\n" \
                             "</ERROR_MESSAGE>\n";
 
 /*
- * These used to be allocated as local (auto) variables.
- * But they are really, really big and Linux has a 10mb
- * stack limit. So they had to be moved here.
+ * This used to be allocated as a local (auto) variable.
+ * But it is really, really big and Linux has a 10mb
+ * stack limit. So it had to be moved here.
  */
 unsigned char                   aInBuffer[FRAME_BUF_SIZE];
-char                            aXMLTextBuf[XML_TEXT_BUF_SIZE];
 
 /**
  *****************************************************************************
@@ -121,7 +120,10 @@ char                            aXMLTextBuf[XML_TEXT_BUF_SIZE];
  **
  ** Command synopsis:
  **
- **     dx101 INPUTFILE
+ **     dx101 [-k KERNEL] INPUTFILE
+ **
+ ** -k picks the CFrameByteOrder kernel (portable, ssse3 or
+ ** avx2) so RUN101 can check they all give the same bytes.
  **
  ** @exitcode   0               Everything *seemed* to work.
  **             1               Bad usage
@@ -138,9 +140,24 @@ main (int ac, char *av[])
     /*
      * Check arg count
      */
+    if(ac == 4 && 0 == strcmp(av[1], "-k"))
+    {
+        CFrameByteOrder::EKernel    eKernel;
+
+        if(!CFrameByteOrder::lookupKernel(av[2], &eKernel) ||
+           !CFrameByteOrder::setKernel(eKernel))
+        {
+            fprintf(stderr, "ERROR: Byte order kernel %s not available\n",
+                av[2]);
+            return(1);
+        }
+        av += 2;
+        ac -= 2;
+    }
+
     if(ac != 2)
     {
-        fprintf(stderr, "ERROR: Bad usage\nusage: %s INPUTFILE\n", av[0]);
+        fprintf(stderr, "ERROR: Bad usage\nusage: %s [-k KERNEL] INPUTFILE\n", av[0]);
         return(1);
     }
 
@@ -327,19 +344,17 @@ main (int ac, char *av[])
          */
 
         /*
-         * Print as XML text the LLRP message to stdout.
+         * Stream the LLRP message as XML text to stdout.
+         * There is no size limit.
          */
         {
-            CXMLTextEncoder     MyXMLEncoder(aXMLTextBuf, sizeof aXMLTextBuf);
+            CXMLTextFileSink    MySink(stdout);
+            CXMLTextEncoder     MyXMLEncoder(&MySink);
 
             MyXMLEncoder.encodeElement(pMessage);
-            if(!MyXMLEncoder.m_bOverflow)
-            {
-                printf("%s", aXMLTextBuf);
-            }
-            else
+            if(RC_OK != MyXMLEncoder.m_ErrorDetails.m_eResultCode)
             {
-                fprintf(stderr, "<!-- Buffer overflow -->\n");
+                fprintf(stderr, "<!-- XML output failed -->\n");
 	        printf("%s\n", g_errMsgStr);
             }
         }
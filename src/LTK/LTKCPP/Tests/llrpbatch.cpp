@@ -0,0 +1,450 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+
+/**
+ *****************************************************************************
+ **
+ ** @file  llrpbatch.cpp
+ **
+ ** @brief Decodes a capture file on several threads
+ **
+ ** The capture is read through CCaptureReader and decoded with
+ ** CBatchDecoder. Workers decode and render each message as
+ ** LTK-XML; the main thread writes the text out in frame order,
+ ** so the output is the same as "llrpcap xml" whatever the
+ ** thread count.
+ **
+ **     llrpbatch [-j THREADS] [-c CHUNK] CAPTURE
+ **         Prints the capture as an LTK-XML packet sequence.
+ **         -j 0 uses one thread per CPU. Default 0. -c is
+ **         frames per work unit, default 256.
+ **
+ **     llrpbatch -s MAXTHREADS [-r ROUNDS] [-c CHUNK] CAPTURE
+ **         Scaling run. Decodes (and decodes plus renders XML)
+ **         with 1..MAXTHREADS threads, prints the time and the
+ **         speedup over one thread, and checks that every run
+ **         produced the same text as the single thread run.
+ **         Then prints the element pool counters, summed over
+ **         every worker thread of every run.
+ **
+ ** A raw file of LLRP frames can be turned into a capture with
+ ** "llrpcap pack".
+ **
+ *****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <thread>
+
+#include "ltkcpp.h"
+
+
+using namespace LLRP;
+
+
+/*
+ * Renders each message as XML on the worker, then either
+ * writes the text (main thread, frame order) or just folds
+ * it into a checksum.
+ */
+class CXMLBatchHandler : public CBatchHandler
+{
+  public:
+    llrp_bool_t                 m_bRender;
+    FILE *                      m_pOutFile;
+    llrp_u64_t                  m_Checksum;
+    unsigned long               m_nMessage;
+    unsigned long               m_nError;
+
+    CXMLBatchHandler (
+      llrp_bool_t               bRender,
+      FILE *                    pOutFile);
+
+    void
+    decoded (
+      CBatchItem *              pItem);
+
+    void
+    deliver (
+      CBatchItem *              pItem);
+};
+
+/*
+ * Sink that appends to a batch item's text
+ */
+class CItemTextSink : public CXMLTextSink
+{
+  public:
+    std::string *               m_pText;
+
+    int
+    write (
+      const char *              pData,
+      unsigned int              nData)
+    {
+        m_pText->append(pData, nData);
+        return 0;
+    }
+};
+
+static void
+usage (
+  const char *                  pProgName);
+
+static int
+runScaling (
+  const CCaptureReader *        pReader,
+  unsigned int                  nMaxThread,
+  unsigned int                  nRound,
+  unsigned int                  nChunk);
+
+static double
+timeBatch (
+  const CCaptureReader *        pReader,
+  unsigned int                  nThread,
+  unsigned int                  nRound,
+  unsigned int                  nChunk,
+  llrp_bool_t                   bRender,
+  llrp_u64_t *                  pChecksum);
+
+static void
+printPoolCounters (void);
+
+static double
+nowNsec (void);
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Command main routine
+ **
+ ** @exitcode   0               Everything *seemed* to work.
+ **             1               Bad usage
+ **             2               Could not open the capture
+ **             3               Frames failed to decode
+ **             4               Thread counts gave different output
+ **
+ *****************************************************************************/
+
+int
+main (int ac, char *av[])
+{
+    CCaptureReader              MyReader;
+    unsigned int                nThread = 0;
+    unsigned int                nMaxThread = 0;
+    unsigned int                nRound = 3;
+    unsigned int                nChunk = 0;
+    int                         i;
+
+    for(i = 1; i + 1 < ac && '-' == av[i][0]; i += 2)
+    {
+        unsigned int            Value = (unsigned int) strtoul(av[i + 1], NULL, 0);
+
+        if(0 == strcmp(av[i], "-j"))
+        {
+            nThread = Value;
+        }
+        else if(0 == strcmp(av[i], "-s"))
+        {
+            nMaxThread = Value;
+        }
+        else if(0 == strcmp(av[i], "-r"))
+        {
+            nRound = (0 == Value) ? 1u : Value;
+        }
+        else if(0 == strcmp(av[i], "-c"))
+        {
+            nChunk = Value;
+        }
+        else
+        {
+            usage(av[0]);
+            return 1;
+        }
+    }
+
+    if(i + 1 != ac)
+    {
+        usage(av[0]);
+        return 1;
+    }
+
+    if(RC_OK != MyReader.open(av[i]))
+    {
+        fprintf(stderr, "ERROR: %s: %s\n", av[i],
+            MyReader.m_ErrorDetails.m_pWhatStr);
+        return 2;
+    }
+
+    if(0 != nMaxThread)
+    {
+        return runScaling(&MyReader, nMaxThread, nRound, nChunk);
+    }
+
+    CBatchDecoder               MyBatchDecoder(getTheSharedTypeRegistry());
+    CCaptureCursor              MyCursor(&MyReader);
+    CXMLBatchHandler            MyHandler(TRUE, stdout);
+
+    MyBatchDecoder.setThreadCount(nThread);
+    if(0 != nChunk)
+    {
+        MyBatchDecoder.setChunkSize(nChunk);
+    }
+
+    printf("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+        "\n"
+        "<ps:packetSequence\n"
+        "  xmlns='http://www.llrp.org/ltk/schema/core/encoding/xml/1.0'\n"
+        "  xmlns:xsi='http://www.w3.org/2001/XMLSchema-instance'\n"
+        "  xmlns:ps='http://www.llrp.org/ltk/schema/testing/encoding/xml/0.6'\n"
+        "  xsi:schemaLocation='http://www.llrp.org/ltk/schema/core/encoding/xml/1.0\n"
+        "                      http://www.llrp.org/ltk/schema/core/encoding/xml/1.0/llrp.xsd\n'>\n");
+
+    MyBatchDecoder.decode(&MyCursor, &MyHandler);
+
+    printf("\n</ps:packetSequence>\n\n");
+
+    if(0 != MyHandler.m_nError)
+    {
+        fprintf(stderr, "ERROR: %lu frames failed to decode\n",
+            MyHandler.m_nError);
+        return 3;
+    }
+
+    return 0;
+}
+
+static void
+usage (
+  const char *                  pProgName)
+{
+    fprintf(stderr, "ERROR: Bad usage\nusage:\n"
+        "  %s [-j THREADS] [-c CHUNK] CAPTURE\n"
+        "  %s -s MAXTHREADS [-r ROUNDS] [-c CHUNK] CAPTURE\n",
+        pProgName, pProgName);
+}
+
+
+CXMLBatchHandler::CXMLBatchHandler (
+  llrp_bool_t                   bRender,
+  FILE *                        pOutFile)
+{
+    m_bRender = bRender;
+    m_pOutFile = pOutFile;
+    m_Checksum = 14695981039346656037ull;
+    m_nMessage = 0;
+    m_nError = 0;
+}
+
+/*
+ * Worker thread: render the XML and drop the message. Freeing
+ * it here, where it was allocated, keeps the element pools warm.
+ */
+void
+CXMLBatchHandler::decoded (
+  CBatchItem *                  pItem)
+{
+    if(NULL == pItem->m_pMessage)
+    {
+        return;
+    }
+
+    if(m_bRender)
+    {
+        CItemTextSink           MySink;
+        CXMLTextEncoder         MyXMLEncoder(&MySink);
+
+        MySink.m_pText = &pItem->m_Text;
+        MyXMLEncoder.encodeElement(pItem->m_pMessage);
+    }
+
+    delete pItem->m_pMessage;
+    pItem->m_pMessage = NULL;
+}
+
+/*
+ * Main thread, frame order
+ */
+void
+CXMLBatchHandler::deliver (
+  CBatchItem *                  pItem)
+{
+    const std::string &         rText = pItem->m_Text;
+
+    if(pItem->m_ErrorDetails.m_eResultCode != RC_OK)
+    {
+        fprintf(stderr, "ERROR: frame %u: decoder error, result=%d\n",
+            pItem->m_Frame.m_iFrame, pItem->m_ErrorDetails.m_eResultCode);
+        m_nError++;
+    }
+    m_nMessage++;
+
+    if(NULL != m_pOutFile)
+    {
+        fputc('\n', m_pOutFile);
+        fwrite(rText.data(), 1u, rText.size(), m_pOutFile);
+        return;
+    }
+
+    /* FNV-1a over the text, and the frame number for order */
+    m_Checksum = (m_Checksum ^ pItem->m_Frame.m_iFrame) * 1099511628211ull;
+    for(size_t i = 0; i < rText.size(); i++)
+    {
+        m_Checksum = (m_Checksum ^ (unsigned char) rText[i]) *
+                        1099511628211ull;
+    }
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Time 1..nMaxThread threads and print the table
+ **
+ *****************************************************************************/
+
+static int
+runScaling (
+  const CCaptureReader *        pReader,
+  unsigned int                  nMaxThread,
+  unsigned int                  nRound,
+  unsigned int                  nChunk)
+{
+    double                      BaseDecode = 0;
+    double                      BaseRender = 0;
+    llrp_u64_t                  BaseChecksum = 0;
+    int                         rc = 0;
+
+    printf("frames %u, %u CPUs, %u rounds\n",
+        pReader->getFrameCount(), std::thread::hardware_concurrency(),
+        nRound);
+    printf("threads   decode ms  speedup   decode+xml ms  speedup\n");
+
+    for(unsigned int nThread = 1; nThread <= nMaxThread; nThread++)
+    {
+        llrp_u64_t              Checksum;
+        double                  Decode;
+        double                  Render;
+
+        Decode = timeBatch(pReader, nThread, nRound, nChunk, FALSE, &Checksum);
+        Render = timeBatch(pReader, nThread, nRound, nChunk, TRUE, &Checksum);
+
+        if(1u == nThread)
+        {
+            BaseDecode = Decode;
+            BaseRender = Render;
+            BaseChecksum = Checksum;
+        }
+        else if(Checksum != BaseChecksum)
+        {
+            fprintf(stderr, "ERROR: %u threads gave different XML\n",
+                nThread);
+            rc = 4;
+        }
+
+        printf("%7u %11.1f %8.2fx %15.1f %8.2fx\n", nThread,
+            Decode / 1e6, BaseDecode / Decode,
+            Render / 1e6, BaseRender / Render);
+    }
+
+    printPoolCounters();
+
+    return rc;
+}
+
+/*
+ * The workers have all exited by now, what they counted is in
+ * the pools' totals
+ */
+static void
+printPoolCounters (void)
+{
+    printf("\npool                          hits     misses   releases   free\n");
+
+    for(CElementPool *pPool = CElementPool::getFirstPool();
+        NULL != pPool;
+        pPool = pPool->m_pNextPool)
+    {
+        unsigned int            nFree;
+        unsigned long           nHit;
+        unsigned long           nMiss;
+        unsigned long           nRelease;
+
+        pPool->getCounters(&nFree, &nHit, &nMiss, &nRelease);
+        printf("%-24s %10lu %10lu %10lu %6u\n", pPool->m_pName,
+            nHit, nMiss, nRelease, nFree);
+    }
+}
+
+/*
+ * Best of nRound runs, in ns
+ */
+static double
+timeBatch (
+  const CCaptureReader *        pReader,
+  unsigned int                  nThread,
+  unsigned int                  nRound,
+  unsigned int                  nChunk,
+  llrp_bool_t                   bRender,
+  llrp_u64_t *                  pChecksum)
+{
+    double                      Best = 0;
+
+    for(unsigned int iRound = 0; iRound < nRound; iRound++)
+    {
+        CBatchDecoder           MyBatchDecoder(getTheSharedTypeRegistry());
+        CCaptureCursor          MyCursor(pReader);
+        CXMLBatchHandler        MyHandler(bRender, NULL);
+        double                  Start;
+        double                  Elapsed;
+
+        MyBatchDecoder.setThreadCount(nThread);
+        if(0 != nChunk)
+        {
+            MyBatchDecoder.setChunkSize(nChunk);
+        }
+
+        Start = nowNsec();
+        MyBatchDecoder.decode(&MyCursor, &MyHandler);
+        Elapsed = nowNsec() - Start;
+
+        if(0 == iRound || Elapsed < Best)
+        {
+            Best = Elapsed;
+        }
+        *pChecksum = MyHandler.m_Checksum;
+    }
+
+    return Best;
+}
+
+static double
+nowNsec (void)
+{
+    struct timespec             Now;
+
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+
+    return Now.tv_sec * 1e9 + Now.tv_nsec;
+}
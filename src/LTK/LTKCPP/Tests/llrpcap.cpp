@@ -0,0 +1,445 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+
+/**
+ *****************************************************************************
+ **
+ ** @file  llrpcap.cpp
+ **
+ ** @brief Builds, inspects and extracts LLRP capture files
+ **
+ ** Capture files (see ltkcpp_capture.h) hold received frames with
+ ** their receive times and reader IDs, plus a block index that
+ ** lets a time window or a few message types be pulled out of a
+ ** long recording without reading all of it.
+ **
+ **     llrpcap pack [-a] [-r ID] [-t USEC] [-d USEC] INPUT CAPTURE
+ **         Packs a file of consecutive LLRP frames, like the ones
+ **         llrp2xml reads, into a capture. Raw frames carry no
+ **         receive time so frame N is stamped -t + N * -d
+ **         (defaults 0 and 1000). -r sets the reader ID, -a
+ **         appends to an existing capture.
+ **
+ **     llrpcap info CAPTURE
+ **         Prints the frame count and the block index.
+ **
+ **     llrpcap list [FILTERS] CAPTURE
+ **         One line per frame: number, time, reader, type,
+ **         MessageID, length.
+ **
+ **     llrpcap raw [FILTERS] CAPTURE
+ **         Writes the frames to stdout as consecutive LLRP
+ **         frames, the input format of llrp2xml.
+ **
+ **     llrpcap xml [FILTERS] CAPTURE
+ **         Decodes the frames and prints them as an LTK-XML
+ **         packet sequence like llrp2xml.
+ **
+ **     FILTERS
+ **         -f USEC         only frames received at or after USEC
+ **         -u USEC         only frames received at or before USEC
+ **         -m TYPE         only message type TYPE, may repeat
+ **
+ ** Round trip check, as done by RUN101:
+ **
+ **     llrpcap pack ../../Tests/dx101/dx101_a.bin dx101_a.cap
+ **     llrpcap raw dx101_a.cap | cmp - ../../Tests/dx101/dx101_a.bin
+ **
+ *****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ltkcpp.h"
+
+
+using namespace LLRP;
+
+
+/* Buffer sizes */
+#define FRAME_BUF_SIZE          (4u*1024u*1024u)
+
+
+/*
+ * Too big for the stack, same as in llrp2xml.
+ */
+unsigned char                   aInBuffer[FRAME_BUF_SIZE];
+
+static void
+usage (
+  const char *                  pProgName);
+
+static int
+packCapture (
+  int                           ac,
+  char *                        av[]);
+
+static int
+readCapture (
+  const char *                  pMode,
+  int                           ac,
+  char *                        av[]);
+
+static int
+printInfo (
+  const CCaptureReader *        pReader);
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Command main routine
+ **
+ ** @exitcode   0               Everything *seemed* to work.
+ **             1               Bad usage
+ **             2               Could not open input or capture file
+ **             3               Bad frame in input or write failed
+ **
+ *****************************************************************************/
+
+int
+main (int ac, char *av[])
+{
+    if(ac < 3)
+    {
+        usage(av[0]);
+        return 1;
+    }
+
+    if(0 == strcmp(av[1], "pack"))
+    {
+        return packCapture(ac, av);
+    }
+
+    if(0 == strcmp(av[1], "info") || 0 == strcmp(av[1], "list") ||
+       0 == strcmp(av[1], "raw") || 0 == strcmp(av[1], "xml"))
+    {
+        return readCapture(av[1], ac, av);
+    }
+
+    usage(av[0]);
+    return 1;
+}
+
+static void
+usage (
+  const char *                  pProgName)
+{
+    fprintf(stderr, "ERROR: Bad usage\nusage:\n"
+        "  %s pack [-a] [-r ID] [-t USEC] [-d USEC] INPUT CAPTURE\n"
+        "  %s info CAPTURE\n"
+        "  %s list|raw|xml [-f USEC] [-u USEC] [-m TYPE]... CAPTURE\n",
+        pProgName, pProgName, pProgName);
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Pack consecutive LLRP frames into a capture
+ **
+ *****************************************************************************/
+
+static int
+packCapture (
+  int                           ac,
+  char *                        av[])
+{
+    CCaptureWriter              MyWriter;
+    llrp_bool_t                 bAppend = FALSE;
+    llrp_u16_t                  ReaderID = 0;
+    llrp_u64_t                  Timestamp = 0;
+    llrp_u64_t                  Step = 1000u;
+    FILE *                      infp;
+    unsigned int                nInBuffer = 0;
+    int                         i;
+
+    for(i = 2; i < ac && '-' == av[i][0]; i++)
+    {
+        if(0 == strcmp(av[i], "-a"))
+        {
+            bAppend = TRUE;
+        }
+        else if(0 == strcmp(av[i], "-r") && i + 1 < ac)
+        {
+            ReaderID = (llrp_u16_t) strtoul(av[++i], NULL, 0);
+        }
+        else if(0 == strcmp(av[i], "-t") && i + 1 < ac)
+        {
+            Timestamp = strtoull(av[++i], NULL, 0);
+        }
+        else if(0 == strcmp(av[i], "-d") && i + 1 < ac)
+        {
+            Step = strtoull(av[++i], NULL, 0);
+        }
+        else
+        {
+            usage(av[0]);
+            return 1;
+        }
+    }
+
+    if(i + 2 != ac)
+    {
+        usage(av[0]);
+        return 1;
+    }
+
+    infp = fopen(av[i], "rb");
+    if(NULL == infp)
+    {
+        perror(av[i]);
+        return 2;
+    }
+
+    if(RC_OK != MyWriter.open(av[i + 1], bAppend))
+    {
+        fprintf(stderr, "ERROR: %s: %s\n", av[i + 1],
+            MyWriter.m_ErrorDetails.m_pWhatStr);
+        fclose(infp);
+        return 2;
+    }
+
+    /*
+     * Same frame read loop as llrp2xml: let CFrameExtract
+     * say how many more bytes it wants.
+     */
+    for(;;)
+    {
+        CFrameExtract           MyFrameExtract(aInBuffer, nInBuffer);
+        size_t                  nRead;
+
+        if(CFrameExtract::FRAME_ERROR == MyFrameExtract.m_eStatus)
+        {
+            fprintf(stderr, "ERROR: Frame error, bail!\n");
+            fclose(infp);
+            return 3;
+        }
+
+        if(CFrameExtract::NEED_MORE == MyFrameExtract.m_eStatus)
+        {
+            if(sizeof aInBuffer < nInBuffer + MyFrameExtract.m_nBytesNeeded)
+            {
+                fprintf(stderr, "Input frame too big\n");
+                fclose(infp);
+                return 3;
+            }
+
+            nRead = fread(&aInBuffer[nInBuffer], 1u,
+                        MyFrameExtract.m_nBytesNeeded, infp);
+            if(0 == nRead)
+            {
+                if(0 < nInBuffer)
+                {
+                    fprintf(stderr, "ERROR: EOF w/ %u bytes in buffer\n",
+                        nInBuffer);
+                }
+                break;
+            }
+            nInBuffer += (unsigned int) nRead;
+            continue;
+        }
+
+        if(RC_OK != MyWriter.appendFrame(aInBuffer, nInBuffer,
+                                         Timestamp, ReaderID))
+        {
+            fprintf(stderr, "ERROR: %s\n",
+                MyWriter.m_ErrorDetails.m_pWhatStr);
+            fclose(infp);
+            return 3;
+        }
+
+        Timestamp += Step;
+        nInBuffer = 0;
+    }
+
+    fclose(infp);
+
+    if(RC_OK != MyWriter.close())
+    {
+        fprintf(stderr, "ERROR: %s\n", MyWriter.m_ErrorDetails.m_pWhatStr);
+        return 3;
+    }
+
+    return 0;
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Open a capture and print or extract the selected frames
+ **
+ *****************************************************************************/
+
+static int
+readCapture (
+  const char *                  pMode,
+  int                           ac,
+  char *                        av[])
+{
+    CCaptureReader              MyReader;
+    const CTypeRegistry *       pTypeRegistry = NULL;
+    CCaptureFrame               Frame;
+    llrp_u64_t                  From = 0;
+    llrp_u64_t                  To = ~(llrp_u64_t)0;
+    std::vector<llrp_u16_t>     aType;
+    int                         i;
+
+    for(i = 2; i < ac - 1; i++)
+    {
+        if(0 == strcmp(av[i], "-f"))
+        {
+            From = strtoull(av[++i], NULL, 0);
+        }
+        else if(0 == strcmp(av[i], "-u"))
+        {
+            To = strtoull(av[++i], NULL, 0);
+        }
+        else if(0 == strcmp(av[i], "-m"))
+        {
+            aType.push_back((llrp_u16_t) strtoul(av[++i], NULL, 0));
+        }
+        else
+        {
+            usage(av[0]);
+            return 1;
+        }
+    }
+
+    if(i != ac - 1)
+    {
+        usage(av[0]);
+        return 1;
+    }
+
+    if(RC_OK != MyReader.open(av[i]))
+    {
+        fprintf(stderr, "ERROR: %s: %s\n", av[i],
+            MyReader.m_ErrorDetails.m_pWhatStr);
+        return 2;
+    }
+
+    if(0 == strcmp(pMode, "info"))
+    {
+        return printInfo(&MyReader);
+    }
+
+    CCaptureCursor              MyCursor(&MyReader);
+
+    MyCursor.setTimeRange(From, To);
+    for(unsigned int j = 0; j < aType.size(); j++)
+    {
+        MyCursor.addMessageType(aType[j]);
+    }
+
+    if(0 == strcmp(pMode, "xml"))
+    {
+        pTypeRegistry = getTheSharedTypeRegistry();
+        printf("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+            "\n"
+            "<ps:packetSequence\n"
+            "  xmlns='http://www.llrp.org/ltk/schema/core/encoding/xml/1.0'\n"
+            "  xmlns:xsi='http://www.w3.org/2001/XMLSchema-instance'\n"
+            "  xmlns:ps='http://www.llrp.org/ltk/schema/testing/encoding/xml/0.6'\n"
+            "  xsi:schemaLocation='http://www.llrp.org/ltk/schema/core/encoding/xml/1.0\n"
+            "                      http://www.llrp.org/ltk/schema/core/encoding/xml/1.0/llrp.xsd\n'>\n");
+    }
+
+    while(MyCursor.next(&Frame))
+    {
+        if(0 == strcmp(pMode, "list"))
+        {
+            printf("%u %llu %u %u %u %u\n",
+                Frame.m_iFrame, (unsigned long long) Frame.m_Timestamp,
+                Frame.m_ReaderID, Frame.m_MessageType,
+                Frame.m_MessageID, Frame.m_nFrame);
+        }
+        else if(0 == strcmp(pMode, "raw"))
+        {
+            if(1u != fwrite(Frame.m_pFrame, Frame.m_nFrame, 1u, stdout))
+            {
+                perror("stdout");
+                return 3;
+            }
+        }
+        else
+        {
+            /* The decoder only reads the frame, the mapping is read-only */
+            CFrameDecoder       MyFrameDecoder(pTypeRegistry,
+                                    (unsigned char *) Frame.m_pFrame,
+                                    Frame.m_nFrame);
+            CMessage *          pMessage = MyFrameDecoder.decodeMessage();
+
+            printf("\n");
+            if(NULL == pMessage)
+            {
+                fprintf(stderr, "ERROR: frame %u: decoder error, result=%d\n",
+                    Frame.m_iFrame, MyFrameDecoder.m_ErrorDetails.m_eResultCode);
+                continue;
+            }
+
+            CXMLTextFileSink    MySink(stdout);
+            CXMLTextEncoder     MyXMLEncoder(&MySink);
+
+            MyXMLEncoder.encodeElement(pMessage);
+            delete pMessage;
+        }
+    }
+
+    if(0 == strcmp(pMode, "xml"))
+    {
+        printf("\n</ps:packetSequence>\n\n");
+    }
+
+    return 0;
+}
+
+static int
+printInfo (
+  const CCaptureReader *        pReader)
+{
+    printf("frames %u\n", pReader->getFrameCount());
+    printf("blocks %u%s\n", pReader->getBlockCount(),
+        pReader->isIndexed() ? "" : " (index rebuilt, not closed)");
+
+    for(unsigned int i = 0; i < pReader->getBlockCount(); i++)
+    {
+        const CCaptureBlock *   pBlock = pReader->getBlock(i);
+
+        printf("block %u offset %llu frames %u-%u time %llu-%llu types",
+            i, (unsigned long long) pBlock->m_Offset,
+            pBlock->m_iFirstFrame,
+            pBlock->m_iFirstFrame + pBlock->m_nFrame - 1u,
+            (unsigned long long) pBlock->m_MinTimestamp,
+            (unsigned long long) pBlock->m_MaxTimestamp);
+
+        for(unsigned int Type = 0; Type < 1024u; Type++)
+        {
+            if(pBlock->hasMessageType((llrp_u16_t) Type))
+            {
+                printf(" %u", Type);
+            }
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,1343 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+
+/**
+ *****************************************************************************
+ **
+ ** @file  ltkbench.cpp
+ **
+ ** @brief Times the LTKCPP frame decoder
+ **
+ ** ltkbench reads a file of consecutive LLRP frames, the same
+ ** "binary encoding" llrp2xml takes, into memory. It then decodes
+ ** every frame over and over, once with the generated fixed part
+ ** decoders and once with the field at a time path, and prints
+ ** the time per message for each.
+ **
+ ** Before timing it checks that both paths produce the same
+ ** XML text for every frame. Any difference is an error.
+ **
+ ** With no input file a synthetic RO_ACCESS_REPORT carrying
+ ** a batch of EPC_96 tag reports is used.
+ **
+ ** The decoded messages are then encoded as XML text, into a
+ ** fixed buffer and streamed into a growing string, and the
+ ** text rate of each is printed. Both must give the same text.
+ **
+ ** The messages also go through compact JSON and back. The
+ ** round trip must give the same XML text as the original. The
+ ** text size and the encode and decode times of JSON and XML
+ ** are printed side by side.
+ **
+ ** The messages are sorted by type through the generated
+ ** CCoreMessageDispatcher and through the usual chain of
+ ** s_typeDescriptor comparisons. Both must agree; the time
+ ** per message of each is printed.
+ **
+ ** It then times CTypeRegistry lookups: standard by type number,
+ ** custom by (VendorID, subtype) and any by name, the last two
+ ** against the linear search the registry used to do. A made up
+ ** vendor extension is enrolled so there are custom types to find.
+ **
+ **     ltkbench ../../Tests/dx101/dx101_a.bin
+ **
+ *****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <string>
+
+#include "ltkcpp.h"
+
+
+using namespace LLRP;
+
+
+/* Buffer sizes */
+#define FRAME_BUF_SIZE          (4u*1024u*1024u)
+#define XML_TEXT_BUF_SIZE       (1024u*1024u)
+#define MAX_FRAMES              4096u
+
+/* Number of synthetic tag reports per RO_ACCESS_REPORT */
+#define SYNTH_N_TAG             64u
+
+/* Synthetic vendor extension, about the size of a real one */
+#define SYNTH_VENDOR_ID         25882u
+#define SYNTH_N_CUSTOM_PARAM    96u
+#define SYNTH_N_CUSTOM_MSG      8u
+#define SYNTH_NAME_SIZE         32u
+
+/* Rounds of lookups over every key */
+#define LOOKUP_ROUNDS           200u
+
+/* Message kinds told apart by the dispatch timings */
+#define DISPATCH_N_KIND         6u
+
+
+/*
+ * The frames are packed back to back in aFrameBuf.
+ * aiFrame[i] is the offset of frame i, anFrame[i] its length.
+ */
+unsigned char                   aFrameBuf[FRAME_BUF_SIZE];
+unsigned int                    nFrameBuf;
+unsigned int                    aiFrame[MAX_FRAMES];
+unsigned int                    anFrame[MAX_FRAMES];
+unsigned int                    nFrame;
+
+char                            aXMLTextBufA[XML_TEXT_BUF_SIZE];
+char                            aXMLTextBufB[XML_TEXT_BUF_SIZE];
+
+CVendorDescriptor               SynthVendor = { "Synth", SYNTH_VENDOR_ID };
+char                            aSynthName[SYNTH_N_CUSTOM_PARAM +
+                                    SYNTH_N_CUSTOM_MSG][SYNTH_NAME_SIZE];
+
+/*
+ * Every name in the registry, plus a few that are not,
+ * for the by-name lookups.
+ */
+std::vector<char *>             apLookupName;
+
+static int
+loadFrames (
+  const char *                  pFileName);
+
+static int
+makeSyntheticReport (void);
+
+static int
+compareDecodePaths (
+  CTypeRegistry *               pTypeRegistry);
+
+static double
+timeDecode (
+  CTypeRegistry *               pTypeRegistry,
+  llrp_bool_t                   bFixedFieldDecode,
+  unsigned int                  nRound);
+
+static int
+compareXMLEncodes (
+  CMessage **                   apMessage);
+
+static double
+timeXMLEncode (
+  CMessage **                   apMessage,
+  llrp_bool_t                   bStream,
+  unsigned int                  nRound,
+  double *                      pnByte);
+
+static int
+compareJSONRoundTrip (
+  CTypeRegistry *               pTypeRegistry,
+  CMessage **                   apMessage);
+
+static double
+timeJSONEncode (
+  CMessage **                   apMessage,
+  unsigned int                  nRound,
+  double *                      pnByte);
+
+static double
+timeTextDecode (
+  CTypeRegistry *               pTypeRegistry,
+  std::vector<std::string> &    aText,
+  llrp_bool_t                   bJSON,
+  unsigned int                  nRound);
+
+static int
+compareDispatch (
+  CMessage **                   apMessage);
+
+static void
+timeDispatch (
+  CMessage **                   apMessage,
+  unsigned int                  nRound);
+
+static unsigned int
+chainDispatch (
+  CMessage *                    pMessage);
+
+static void
+enrollSyntheticCustomTypes (
+  CTypeRegistry *               pTypeRegistry);
+
+static int
+compareLookups (
+  CTypeRegistry *               pTypeRegistry);
+
+static void
+timeLookups (
+  CTypeRegistry *               pTypeRegistry);
+
+static const CTypeDescriptor *
+linearLookupCustom (
+  CTypeRegistry *               pTypeRegistry,
+  llrp_bool_t                   bIsMessage,
+  unsigned int                  VendorID,
+  unsigned int                  SubTypeNum);
+
+static const CTypeDescriptor *
+linearLookupByName (
+  CTypeRegistry *               pTypeRegistry,
+  const char *                  pName);
+
+static double
+nowNsec (void);
+
+
+/*
+ * Sorts messages into the kinds a reader client cares
+ * about, the way CReader::processReports() does.
+ */
+class CKindDispatcher : public CCoreMessageDispatcher<CKindDispatcher>
+{
+  public:
+    int
+    onRO_ACCESS_REPORT (
+      CRO_ACCESS_REPORT *       pMessage)
+    {
+        return 1;
+    }
+
+    int
+    onREADER_EVENT_NOTIFICATION (
+      CREADER_EVENT_NOTIFICATION * pMessage)
+    {
+        return 2;
+    }
+
+    int
+    onKEEPALIVE (
+      CKEEPALIVE *              pMessage)
+    {
+        return 3;
+    }
+
+    int
+    onERROR_MESSAGE (
+      CERROR_MESSAGE *          pMessage)
+    {
+        return 4;
+    }
+
+    int
+    onGET_READER_CONFIG_RESPONSE (
+      CGET_READER_CONFIG_RESPONSE * pMessage)
+    {
+        return 5;
+    }
+};
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Command main routine
+ **
+ ** Command synopsis:
+ **
+ **     ltkbench [INPUTFILE [ROUNDS]]
+ **
+ ** @exitcode   0               Everything *seemed* to work.
+ **             1               Bad usage
+ **             2               Could not load input
+ **             3               The decode paths disagree
+ **             4               Indexed and linear lookups disagree
+ **             5               Fixed buffer and streamed XML disagree
+ **             6               JSON round trip changed a message
+ **             7               Dispatcher and comparison chain disagree
+ **
+ *****************************************************************************/
+
+int
+main (int ac, char *av[])
+{
+    CTypeRegistry *             pTypeRegistry;
+    unsigned int                nRound = 2000u;
+    double                      FixedNsec;
+    double                      FieldNsec;
+    CMessage *                  apMessage[MAX_FRAMES];
+    double                      nXMLByte;
+    double                      BufferNsec;
+    double                      StreamNsec;
+    double                      nJSONByte;
+    double                      JSONNsec;
+    std::vector<std::string>    aXMLText;
+    std::vector<std::string>    aJSONText;
+
+    if(ac > 3)
+    {
+        fprintf(stderr, "ERROR: Bad usage\nusage: %s [INPUTFILE [ROUNDS]]\n",
+            av[0]);
+        return 1;
+    }
+
+    if(ac >= 2)
+    {
+        if(0 != loadFrames(av[1]))
+        {
+            return 2;
+        }
+    }
+    else
+    {
+        if(0 != makeSyntheticReport())
+        {
+            return 2;
+        }
+    }
+
+    if(ac >= 3)
+    {
+        nRound = (unsigned int) atoi(av[2]);
+    }
+
+    pTypeRegistry = getTheTypeRegistry();
+
+    if(0 != compareDecodePaths(pTypeRegistry))
+    {
+        delete pTypeRegistry;
+        return 3;
+    }
+
+    /* One untimed round each to warm the caches and pools */
+    timeDecode(pTypeRegistry, TRUE, 1u);
+    timeDecode(pTypeRegistry, FALSE, 1u);
+
+    FixedNsec = timeDecode(pTypeRegistry, TRUE, nRound);
+    FieldNsec = timeDecode(pTypeRegistry, FALSE, nRound);
+
+    printf("frames %u, bytes %u, rounds %u\n", nFrame, nFrameBuf, nRound);
+    printf("decode fixed-part   %10.1f ns/msg %8.1f MB/s\n",
+        FixedNsec, nFrameBuf / (FixedNsec * nFrame) * 1e3);
+    printf("decode field-a-time %10.1f ns/msg %8.1f MB/s\n",
+        FieldNsec, nFrameBuf / (FieldNsec * nFrame) * 1e3);
+    printf("speedup             %10.2fx\n", FieldNsec / FixedNsec);
+
+    for(unsigned int iFrame = 0; iFrame < nFrame; iFrame++)
+    {
+        CFrameDecoder           MyFrameDecoder(pTypeRegistry,
+                                    &aFrameBuf[aiFrame[iFrame]],
+                                    anFrame[iFrame]);
+
+        apMessage[iFrame] = MyFrameDecoder.decodeMessage();
+    }
+
+    if(0 != compareXMLEncodes(apMessage))
+    {
+        delete pTypeRegistry;
+        return 5;
+    }
+
+    BufferNsec = timeXMLEncode(apMessage, FALSE, nRound / 10u + 1u, &nXMLByte);
+    StreamNsec = timeXMLEncode(apMessage, TRUE, nRound / 10u + 1u, &nXMLByte);
+
+    printf("xml text bytes %.0f\n", nXMLByte);
+    printf("xml fixed buffer    %10.1f ns/msg %8.1f MB/s\n",
+        BufferNsec, nXMLByte / (BufferNsec * nFrame) * 1e3);
+    printf("xml streamed        %10.1f ns/msg %8.1f MB/s\n",
+        StreamNsec, nXMLByte / (StreamNsec * nFrame) * 1e3);
+
+    if(0 != compareJSONRoundTrip(pTypeRegistry, apMessage))
+    {
+        delete pTypeRegistry;
+        return 6;
+    }
+
+    JSONNsec = timeJSONEncode(apMessage, nRound / 10u + 1u, &nJSONByte);
+
+    printf("json text bytes %.0f (%.1f%% of xml)\n",
+        nJSONByte, nJSONByte * 100.0 / nXMLByte);
+    printf("json streamed       %10.1f ns/msg %8.1f MB/s %6.2fx xml\n",
+        JSONNsec, nJSONByte / (JSONNsec * nFrame) * 1e3,
+        StreamNsec / JSONNsec);
+
+    for(unsigned int iFrame = 0; iFrame < nFrame; iFrame++)
+    {
+        CXMLTextStringSink      MySink;
+
+        if(NULL == apMessage[iFrame])
+        {
+            continue;
+        }
+
+        toXMLText(apMessage[iFrame], &MySink);
+        aXMLText.push_back(MySink.m_Text);
+        MySink.m_Text.clear();
+        toJSONText(apMessage[iFrame], &MySink);
+        aJSONText.push_back(MySink.m_Text);
+    }
+
+    BufferNsec = timeTextDecode(pTypeRegistry, aXMLText, FALSE,
+        nRound / 100u + 1u);
+    JSONNsec = timeTextDecode(pTypeRegistry, aJSONText, TRUE,
+        nRound / 100u + 1u);
+
+    printf("xml decode          %10.1f ns/msg %8.1f MB/s\n",
+        BufferNsec, nXMLByte / (BufferNsec * nFrame) * 1e3);
+    printf("json decode         %10.1f ns/msg %8.1f MB/s %6.2fx xml\n",
+        JSONNsec, nJSONByte / (JSONNsec * nFrame) * 1e3,
+        BufferNsec / JSONNsec);
+
+    if(0 != compareDispatch(apMessage))
+    {
+        delete pTypeRegistry;
+        return 7;
+    }
+
+    timeDispatch(apMessage, nRound);
+
+    for(unsigned int iFrame = 0; iFrame < nFrame; iFrame++)
+    {
+        delete apMessage[iFrame];
+    }
+
+    enrollSyntheticCustomTypes(pTypeRegistry);
+
+    if(0 != compareLookups(pTypeRegistry))
+    {
+        delete pTypeRegistry;
+        return 4;
+    }
+
+    timeLookups(pTypeRegistry);
+
+    delete pTypeRegistry;
+
+    return 0;
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Read the frames of a file into aFrameBuf
+ **
+ ** @return     0 OK, else error already reported
+ **
+ *****************************************************************************/
+
+static int
+loadFrames (
+  const char *                  pFileName)
+{
+    FILE *                      infp;
+
+#ifdef WIN32
+    infp = fopen(pFileName, "rb");
+#else
+    infp = fopen(pFileName, "r");
+#endif
+    if(NULL == infp)
+    {
+        perror(pFileName);
+        return -1;
+    }
+
+    nFrameBuf = (unsigned int) fread(aFrameBuf, 1u, sizeof aFrameBuf, infp);
+    fclose(infp);
+
+    nFrame = 0;
+    for(unsigned int iNext = 0; iNext < nFrameBuf; )
+    {
+        CFrameExtract           MyFrameExtract(&aFrameBuf[iNext],
+                                        nFrameBuf - iNext);
+
+        if(CFrameExtract::READY != MyFrameExtract.m_eStatus)
+        {
+            fprintf(stderr, "ERROR: bad frame at offset %u\n", iNext);
+            return -1;
+        }
+
+        if(MAX_FRAMES <= nFrame)
+        {
+            fprintf(stderr, "ERROR: too many frames\n");
+            return -1;
+        }
+
+        aiFrame[nFrame] = iNext;
+        anFrame[nFrame] = MyFrameExtract.m_MessageLength;
+        nFrame++;
+
+        iNext += MyFrameExtract.m_MessageLength;
+    }
+
+    if(0 == nFrame)
+    {
+        fprintf(stderr, "ERROR: no frames in %s\n", pFileName);
+        return -1;
+    }
+
+    return 0;
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Build and encode a typical tag report into aFrameBuf
+ **
+ ** @return     0 OK, else error already reported
+ **
+ *****************************************************************************/
+
+static int
+makeSyntheticReport (void)
+{
+    CRO_ACCESS_REPORT *         pReport = new CRO_ACCESS_REPORT();
+
+    pReport->setMessageID(1u);
+
+    for(unsigned int i = 0; i < SYNTH_N_TAG; i++)
+    {
+        CTagReportData *        pTagReportData = new CTagReportData();
+        CEPC_96 *               pEPC_96 = new CEPC_96();
+        CAntennaID *            pAntennaID = new CAntennaID();
+        CPeakRSSI *             pPeakRSSI = new CPeakRSSI();
+        CFirstSeenTimestampUTC *pFirstSeen = new CFirstSeenTimestampUTC();
+        CLastSeenTimestampUTC * pLastSeen = new CLastSeenTimestampUTC();
+        CTagSeenCount *         pTagSeenCount = new CTagSeenCount();
+        llrp_u96_t              EPC;
+
+        for(unsigned int Ix = 0; Ix < 12u; Ix++)
+        {
+            EPC.m_aValue[Ix] = (llrp_u8_t)(i * 12u + Ix);
+        }
+        pEPC_96->setEPC(EPC);
+        pAntennaID->setAntennaID(1u + i % 4u);
+        pPeakRSSI->setPeakRSSI(-40 - (llrp_s8_t)(i % 30u));
+        pFirstSeen->setMicroseconds(1234567890123456ull + i);
+        pLastSeen->setMicroseconds(1234567890223456ull + i);
+        pTagSeenCount->setTagCount(1u + i % 7u);
+
+        pTagReportData->setEPCParameter(pEPC_96);
+        pTagReportData->setAntennaID(pAntennaID);
+        pTagReportData->setPeakRSSI(pPeakRSSI);
+        pTagReportData->setFirstSeenTimestampUTC(pFirstSeen);
+        pTagReportData->setLastSeenTimestampUTC(pLastSeen);
+        pTagReportData->setTagSeenCount(pTagSeenCount);
+
+        pReport->addTagReportData(pTagReportData);
+    }
+
+    CFrameEncoder               MyFrameEncoder(aFrameBuf, sizeof aFrameBuf);
+
+    MyFrameEncoder.encodeElement(pReport);
+    delete pReport;
+
+    if(RC_OK != MyFrameEncoder.m_ErrorDetails.m_eResultCode)
+    {
+        fprintf(stderr, "ERROR: synthetic encode failed, result=%d\n",
+            MyFrameEncoder.m_ErrorDetails.m_eResultCode);
+        return -1;
+    }
+
+    nFrameBuf  = MyFrameEncoder.getLength();
+    aiFrame[0] = 0;
+    anFrame[0] = nFrameBuf;
+    nFrame     = 1u;
+
+    return 0;
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Decode every frame both ways and compare the XML text
+ **
+ ** A frame that fails to decode must fail the same way on both
+ ** paths.
+ **
+ ** @return     0 OK, else number of frames that differ
+ **
+ *****************************************************************************/
+
+static int
+compareDecodePaths (
+  CTypeRegistry *               pTypeRegistry)
+{
+    int                         nDiffer = 0;
+
+    for(unsigned int iFrame = 0; iFrame < nFrame; iFrame++)
+    {
+        CFrameDecoder           DecoderA(pTypeRegistry,
+                                    &aFrameBuf[aiFrame[iFrame]],
+                                    anFrame[iFrame]);
+        CFrameDecoder           DecoderB(pTypeRegistry,
+                                    &aFrameBuf[aiFrame[iFrame]],
+                                    anFrame[iFrame]);
+        CMessage *              pMessageA;
+        CMessage *              pMessageB;
+
+        DecoderB.setFixedFieldDecode(FALSE);
+
+        pMessageA = DecoderA.decodeMessage();
+        pMessageB = DecoderB.decodeMessage();
+
+        if(NULL == pMessageA || NULL == pMessageB)
+        {
+            if(pMessageA != pMessageB ||
+               DecoderA.m_ErrorDetails.m_eResultCode !=
+                    DecoderB.m_ErrorDetails.m_eResultCode ||
+               DecoderA.m_ErrorDetails.m_pRefField !=
+                    DecoderB.m_ErrorDetails.m_pRefField)
+            {
+                fprintf(stderr, "ERROR: frame %u decode status differs\n",
+                    iFrame);
+                nDiffer++;
+            }
+            delete pMessageA;
+            delete pMessageB;
+            continue;
+        }
+
+        pMessageA->toXMLString(aXMLTextBufA, sizeof aXMLTextBufA);
+        pMessageB->toXMLString(aXMLTextBufB, sizeof aXMLTextBufB);
+
+        if(0 != strcmp(aXMLTextBufA, aXMLTextBufB))
+        {
+            fprintf(stderr, "ERROR: frame %u decodes differ\n", iFrame);
+            nDiffer++;
+        }
+
+        delete pMessageA;
+        delete pMessageB;
+    }
+
+    return nDiffer;
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Decode and delete all the frames nRound times
+ **
+ ** @return     Average nanoseconds per message
+ **
+ *****************************************************************************/
+
+static double
+timeDecode (
+  CTypeRegistry *               pTypeRegistry,
+  llrp_bool_t                   bFixedFieldDecode,
+  unsigned int                  nRound)
+{
+    double                      Start = nowNsec();
+
+    for(unsigned int iRound = 0; iRound < nRound; iRound++)
+    {
+        for(unsigned int iFrame = 0; iFrame < nFrame; iFrame++)
+        {
+            CFrameDecoder       MyFrameDecoder(pTypeRegistry,
+                                    &aFrameBuf[aiFrame[iFrame]],
+                                    anFrame[iFrame]);
+
+            MyFrameDecoder.setFixedFieldDecode(bFixedFieldDecode);
+            delete MyFrameDecoder.decodeMessage();
+        }
+    }
+
+    return (nowNsec() - Start) / ((double)nRound * nFrame);
+}
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Check the streamed XML text matches the fixed buffer text
+ **
+ ** Messages that failed to decode (NULL) or don't fit the
+ ** buffer are skipped.
+ **
+ ** @return     0 OK, else number of messages that differ
+ **
+ *****************************************************************************/
+
+static int
+compareXMLEncodes (
+  CMessage **                   apMessage)
+{
+    int                         nDiffer = 0;
+
+    for(unsigned int iFrame = 0; iFrame < nFrame; iFrame++)
+    {
+        CXMLTextStringSink      MySink;
+
+        if(NULL == apMessage[iFrame])
+        {
+            continue;
+        }
+
+        /* too big for the fixed buffer, nothing to compare */
+        if(RC_OK != toXMLString(apMessage[iFrame], aXMLTextBufA,
+                                sizeof aXMLTextBufA))
+        {
+            continue;
+        }
+        toXMLText(apMessage[iFrame], &MySink);
+
+        if(MySink.m_Text != aXMLTextBufA)
+        {
+            fprintf(stderr, "ERROR: frame %u XML text differs\n", iFrame);
+            nDiffer++;
+        }
+    }
+
+    return nDiffer;
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Encode all the messages as XML text nRound times
+ **
+ ** @param[out] pnByte          XML text bytes per round
+ **
+ ** @return     Average nanoseconds per message
+ **
+ *****************************************************************************/
+
+static double
+timeXMLEncode (
+  CMessage **                   apMessage,
+  llrp_bool_t                   bStream,
+  unsigned int                  nRound,
+  double *                      pnByte)
+{
+    CXMLTextStringSink          MySink;
+    double                      nByte = 0;
+    double                      Start = nowNsec();
+
+    for(unsigned int iRound = 0; iRound < nRound; iRound++)
+    {
+        nByte = 0;
+        for(unsigned int iFrame = 0; iFrame < nFrame; iFrame++)
+        {
+            if(NULL == apMessage[iFrame])
+            {
+                continue;
+            }
+
+            if(bStream)
+            {
+                MySink.m_Text.clear();
+                toXMLText(apMessage[iFrame], &MySink);
+                nByte += MySink.m_Text.size();
+            }
+            else
+            {
+                toXMLString(apMessage[iFrame], aXMLTextBufA,
+                    sizeof aXMLTextBufA);
+                nByte += strlen(aXMLTextBufA);
+            }
+        }
+    }
+
+    *pnByte = nByte;
+
+    return (nowNsec() - Start) / ((double)nRound * nFrame);
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Check each message survives a trip through JSON
+ **
+ ** The message is encoded as JSON, decoded again and both are
+ ** compared as XML text. Messages that failed to decode (NULL)
+ ** are skipped.
+ **
+ ** @return     0 OK, else number of messages that differ
+ **
+ *****************************************************************************/
+
+static int
+compareJSONRoundTrip (
+  CTypeRegistry *               pTypeRegistry,
+  CMessage **                   apMessage)
+{
+    int                         nDiffer = 0;
+
+    for(unsigned int iFrame = 0; iFrame < nFrame; iFrame++)
+    {
+        CXMLTextStringSink      MySink;
+        CMessage *              pMessage;
+
+        if(NULL == apMessage[iFrame])
+        {
+            continue;
+        }
+
+        toJSONText(apMessage[iFrame], &MySink);
+
+        CJSONTextDecoder        MyJSONDecoder(pTypeRegistry,
+                                    MySink.m_Text.data(),
+                                    (int) MySink.m_Text.size());
+
+        pMessage = MyJSONDecoder.decodeMessage();
+        if(NULL == pMessage)
+        {
+            const CErrorDetails *pError = &MyJSONDecoder.m_ErrorDetails;
+
+            fprintf(stderr, "ERROR: frame %u JSON decode failed, %s "
+                "at offset %d\n", iFrame,
+                pError->m_pWhatStr ? pError->m_pWhatStr : "no reason given",
+                pError->m_OtherDetail);
+            nDiffer++;
+            continue;
+        }
+
+        CXMLTextStringSink      OrigSink;
+        CXMLTextStringSink      TripSink;
+
+        toXMLText(apMessage[iFrame], &OrigSink);
+        toXMLText(pMessage, &TripSink);
+
+        if(OrigSink.m_Text != TripSink.m_Text ||
+           !MyJSONDecoder.isEndOfInput())
+        {
+            fprintf(stderr, "ERROR: frame %u JSON round trip differs\n",
+                iFrame);
+            nDiffer++;
+        }
+
+        delete pMessage;
+    }
+
+    return nDiffer;
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Encode all the messages as JSON text nRound times
+ **
+ ** @param[out] pnByte          JSON text bytes per round
+ **
+ ** @return     Average nanoseconds per message
+ **
+ *****************************************************************************/
+
+static double
+timeJSONEncode (
+  CMessage **                   apMessage,
+  unsigned int                  nRound,
+  double *                      pnByte)
+{
+    CXMLTextStringSink          MySink;
+    double                      nByte = 0;
+    double                      Start = nowNsec();
+
+    for(unsigned int iRound = 0; iRound < nRound; iRound++)
+    {
+        nByte = 0;
+        for(unsigned int iFrame = 0; iFrame < nFrame; iFrame++)
+        {
+            if(NULL == apMessage[iFrame])
+            {
+                continue;
+            }
+
+            MySink.m_Text.clear();
+            toJSONText(apMessage[iFrame], &MySink);
+            nByte += MySink.m_Text.size();
+        }
+    }
+
+    *pnByte = nByte;
+
+    return (nowNsec() - Start) / ((double)nRound * nFrame);
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Decode the text of every message nRound times
+ **
+ ** @param[in]  bJSON           aText is JSON, else LTK-XML
+ **
+ ** @return     Average nanoseconds per message
+ **
+ *****************************************************************************/
+
+static double
+timeTextDecode (
+  CTypeRegistry *               pTypeRegistry,
+  std::vector<std::string> &    aText,
+  llrp_bool_t                   bJSON,
+  unsigned int                  nRound)
+{
+    double                      Start = nowNsec();
+
+    for(unsigned int iRound = 0; iRound < nRound; iRound++)
+    {
+        for(unsigned int iText = 0; iText < aText.size(); iText++)
+        {
+            CMessage *          pMessage;
+
+            if(bJSON)
+            {
+                CJSONTextDecoder MyDecoder(pTypeRegistry,
+                                     aText[iText].data(),
+                                     (int) aText[iText].size());
+
+                pMessage = MyDecoder.decodeMessage();
+            }
+            else
+            {
+                CXMLTextDecoder MyDecoder(pTypeRegistry,
+                                    &aText[iText][0],
+                                    (int) aText[iText].size());
+
+                pMessage = MyDecoder.decodeMessage();
+            }
+
+            delete pMessage;
+        }
+    }
+
+    return (nowNsec() - Start) / ((double)nRound * aText.size());
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Check the dispatcher sorts like the comparison chain
+ **
+ ** @return     0 OK, else number of messages that differ
+ **
+ *****************************************************************************/
+
+static int
+compareDispatch (
+  CMessage **                   apMessage)
+{
+    CKindDispatcher             MyDispatcher;
+    int                         nDiffer = 0;
+
+    for(unsigned int iFrame = 0; iFrame < nFrame; iFrame++)
+    {
+        if(NULL == apMessage[iFrame])
+        {
+            continue;
+        }
+
+        if((unsigned int) MyDispatcher.dispatch(apMessage[iFrame]) !=
+           chainDispatch(apMessage[iFrame]))
+        {
+            fprintf(stderr, "ERROR: frame %u dispatch differs\n", iFrame);
+            nDiffer++;
+        }
+    }
+
+    return nDiffer;
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Time the dispatcher against the comparison chain
+ **
+ *****************************************************************************/
+
+static void
+timeDispatch (
+  CMessage **                   apMessage,
+  unsigned int                  nRound)
+{
+    CKindDispatcher             MyDispatcher;
+    unsigned int                anKind[DISPATCH_N_KIND];
+    double                      Start;
+    double                      Nsec;
+    double                      SwitchNsec = 0;
+    double                      ChainNsec = 0;
+    unsigned int                nSorted;
+
+    memset(anKind, 0, sizeof anKind);
+
+    /*
+     * One untimed round each to warm up, then the two in turn,
+     * the best of three passes each. Timed once back to back,
+     * whichever went first came out slower.
+     */
+    for(int iPass = -1; iPass < 3; iPass++)
+    {
+        unsigned int            nPassRound = (iPass < 0) ? 1u : nRound;
+
+        Start = nowNsec();
+        for(unsigned int iRound = 0; iRound < nPassRound; iRound++)
+        {
+            for(unsigned int iFrame = 0; iFrame < nFrame; iFrame++)
+            {
+                if(NULL != apMessage[iFrame])
+                {
+                    anKind[MyDispatcher.dispatch(apMessage[iFrame])]++;
+                }
+            }
+        }
+        Nsec = (nowNsec() - Start) / ((double) nPassRound * nFrame);
+        if(0 == iPass || (0 < iPass && Nsec < SwitchNsec))
+        {
+            SwitchNsec = Nsec;
+        }
+
+        Start = nowNsec();
+        for(unsigned int iRound = 0; iRound < nPassRound; iRound++)
+        {
+            for(unsigned int iFrame = 0; iFrame < nFrame; iFrame++)
+            {
+                if(NULL != apMessage[iFrame])
+                {
+                    anKind[chainDispatch(apMessage[iFrame])]++;
+                }
+            }
+        }
+        Nsec = (nowNsec() - Start) / ((double) nPassRound * nFrame);
+        if(0 == iPass || (0 < iPass && Nsec < ChainNsec))
+        {
+            ChainNsec = Nsec;
+        }
+    }
+
+    /* both sorted every message 1 + 3 * nRound times */
+    nSorted = 2u * (1u + 3u * nRound);
+    printf("dispatch: %u reports, %u events, %u other\n",
+        anKind[1] / nSorted, anKind[2] / nSorted, anKind[0] / nSorted);
+    printf("dispatch switch     %10.1f ns/msg  chain %10.1f ns/msg\n",
+        SwitchNsec, ChainNsec);
+}
+
+/*
+ * The if/else chain applications write by hand
+ */
+static unsigned int
+chainDispatch (
+  CMessage *                    pMessage)
+{
+    const CTypeDescriptor *     pType = pMessage->m_pType;
+
+    if(&CRO_ACCESS_REPORT::s_typeDescriptor == pType)
+    {
+        return 1;
+    }
+    else if(&CREADER_EVENT_NOTIFICATION::s_typeDescriptor == pType)
+    {
+        return 2;
+    }
+    else if(&CKEEPALIVE::s_typeDescriptor == pType)
+    {
+        return 3;
+    }
+    else if(&CERROR_MESSAGE::s_typeDescriptor == pType)
+    {
+        return 4;
+    }
+    else if(&CGET_READER_CONFIG_RESPONSE::s_typeDescriptor == pType)
+    {
+        return 5;
+    }
+
+    return 0;
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Enroll a made up vendor's custom parameters and messages
+ **
+ ** The descriptors are never used to decode, only looked up.
+ ** They live until the program exits.
+ **
+ *****************************************************************************/
+
+static void
+enrollSyntheticCustomTypes (
+  CTypeRegistry *               pTypeRegistry)
+{
+    for(unsigned int i = 0;
+        i < SYNTH_N_CUSTOM_PARAM + SYNTH_N_CUSTOM_MSG;
+        i++)
+    {
+        llrp_bool_t             bIsMessage = (i >= SYNTH_N_CUSTOM_PARAM);
+
+        snprintf(aSynthName[i], SYNTH_NAME_SIZE, "Synth%s%u",
+            bIsMessage ? "Message" : "Parameter", i);
+
+        CTypeDescriptor         Proto = {
+            bIsMessage, aSynthName[i], &SynthVendor, NULL,
+            bIsMessage ? i - SYNTH_N_CUSTOM_PARAM : 20u + 3u * i,
+            NULL, NULL, NULL, NULL };
+
+        pTypeRegistry->enroll(new CTypeDescriptor(Proto));
+    }
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Check the indexed lookups against a linear search
+ **
+ ** Also fills apLookupName.
+ **
+ ** @return     0 OK, else number of lookups that differ
+ **
+ *****************************************************************************/
+
+static int
+compareLookups (
+  CTypeRegistry *               pTypeRegistry)
+{
+    static char                 aMissing[][SYNTH_NAME_SIZE] = {
+        "NoSuchParameter", "", "rospec", "ROSpecX" };
+    int                         nDiffer = 0;
+
+    apLookupName.clear();
+    for(unsigned int i = 0; i < 1024u; i++)
+    {
+        if(NULL != pTypeRegistry->m_apStdMessageTypeDescriptors[i])
+        {
+            apLookupName.push_back((char *)
+                pTypeRegistry->m_apStdMessageTypeDescriptors[i]->m_pName);
+        }
+        if(NULL != pTypeRegistry->m_apStdParameterTypeDescriptors[i])
+        {
+            apLookupName.push_back((char *)
+                pTypeRegistry->m_apStdParameterTypeDescriptors[i]->m_pName);
+        }
+    }
+    for(unsigned int i = 0;
+        i < SYNTH_N_CUSTOM_PARAM + SYNTH_N_CUSTOM_MSG;
+        i++)
+    {
+        apLookupName.push_back(aSynthName[i]);
+    }
+    for(unsigned int i = 0; i < sizeof aMissing / sizeof aMissing[0]; i++)
+    {
+        apLookupName.push_back(aMissing[i]);
+    }
+
+    for(unsigned int i = 0; i < apLookupName.size(); i++)
+    {
+        if(pTypeRegistry->lookupByName(apLookupName[i]) !=
+           linearLookupByName(pTypeRegistry, apLookupName[i]))
+        {
+            fprintf(stderr, "ERROR: lookupByName(\"%s\") differs\n",
+                apLookupName[i]);
+            nDiffer++;
+        }
+    }
+
+    for(unsigned int SubType = 0; SubType < 1024u; SubType++)
+    {
+        if(pTypeRegistry->lookupCustomParameter(SYNTH_VENDOR_ID, SubType) !=
+           linearLookupCustom(pTypeRegistry, FALSE, SYNTH_VENDOR_ID, SubType)
+           ||
+           pTypeRegistry->lookupCustomMessage(SYNTH_VENDOR_ID, SubType) !=
+           linearLookupCustom(pTypeRegistry, TRUE, SYNTH_VENDOR_ID, SubType)
+           ||
+           NULL != pTypeRegistry->lookupCustomParameter(SYNTH_VENDOR_ID + 1u,
+                                        SubType))
+        {
+            fprintf(stderr, "ERROR: custom lookup of subtype %u differs\n",
+                SubType);
+            nDiffer++;
+        }
+    }
+
+    return nDiffer;
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Time standard, custom and by-name lookups
+ **
+ *****************************************************************************/
+
+static void
+timeLookups (
+  CTypeRegistry *               pTypeRegistry)
+{
+    const unsigned int          nCustom = SYNTH_N_CUSTOM_PARAM;
+    const unsigned int          nName = (unsigned int) apLookupName.size();
+    unsigned int                nFound = 0;
+    double                      Start;
+    double                      StdNsec;
+    double                      CustomNsec;
+    double                      CustomLinearNsec;
+    double                      NameNsec;
+    double                      NameLinearNsec;
+
+    Start = nowNsec();
+    for(unsigned int iRound = 0; iRound < LOOKUP_ROUNDS; iRound++)
+    {
+        for(unsigned int TypeNum = 0; TypeNum < 1024u; TypeNum++)
+        {
+            nFound += (NULL != pTypeRegistry->lookupParameter(TypeNum));
+        }
+    }
+    StdNsec = (nowNsec() - Start) / (LOOKUP_ROUNDS * 1024.0);
+
+    Start = nowNsec();
+    for(unsigned int iRound = 0; iRound < LOOKUP_ROUNDS; iRound++)
+    {
+        for(unsigned int i = 0; i < nCustom; i++)
+        {
+            nFound += (NULL != pTypeRegistry->lookupCustomParameter(
+                                    SYNTH_VENDOR_ID, 20u + 3u * i));
+        }
+    }
+    CustomNsec = (nowNsec() - Start) / ((double) LOOKUP_ROUNDS * nCustom);
+
+    Start = nowNsec();
+    for(unsigned int iRound = 0; iRound < LOOKUP_ROUNDS; iRound++)
+    {
+        for(unsigned int i = 0; i < nCustom; i++)
+        {
+            nFound += (NULL != linearLookupCustom(pTypeRegistry, FALSE,
+                                    SYNTH_VENDOR_ID, 20u + 3u * i));
+        }
+    }
+    CustomLinearNsec = (nowNsec() - Start) /
+                            ((double) LOOKUP_ROUNDS * nCustom);
+
+    Start = nowNsec();
+    for(unsigned int iRound = 0; iRound < LOOKUP_ROUNDS; iRound++)
+    {
+        for(unsigned int i = 0; i < nName; i++)
+        {
+            nFound += (NULL != pTypeRegistry->lookupByName(apLookupName[i]));
+        }
+    }
+    NameNsec = (nowNsec() - Start) / ((double) LOOKUP_ROUNDS * nName);
+
+    Start = nowNsec();
+    for(unsigned int iRound = 0; iRound < LOOKUP_ROUNDS; iRound++)
+    {
+        for(unsigned int i = 0; i < nName; i++)
+        {
+            nFound += (NULL != linearLookupByName(pTypeRegistry,
+                                    apLookupName[i]));
+        }
+    }
+    NameLinearNsec = (nowNsec() - Start) / ((double) LOOKUP_ROUNDS * nName);
+
+    printf("lookups: %u custom types, %u names, %u found\n",
+        SYNTH_N_CUSTOM_PARAM + SYNTH_N_CUSTOM_MSG, nName, nFound);
+    printf("lookup standard     %10.1f ns\n", StdNsec);
+    printf("lookup custom       %10.1f ns  linear %10.1f ns\n",
+        CustomNsec, CustomLinearNsec);
+    printf("lookup by name      %10.1f ns  linear %10.1f ns\n",
+        NameNsec, NameLinearNsec);
+}
+
+
+/*
+ * The searches CTypeRegistry did before it had indexes,
+ * as the reference for the comparisons and timings.
+ */
+static const CTypeDescriptor *
+linearLookupCustom (
+  CTypeRegistry *               pTypeRegistry,
+  llrp_bool_t                   bIsMessage,
+  unsigned int                  VendorID,
+  unsigned int                  SubTypeNum)
+{
+    std::list<const CTypeDescriptor *> & rList = bIsMessage ?
+                    pTypeRegistry->m_listCustomMessageTypeDescriptors :
+                    pTypeRegistry->m_listCustomParameterTypeDescriptors;
+
+    for(std::list<const CTypeDescriptor *>::const_iterator elem =
+                            rList.begin();
+        elem != rList.end();
+        elem++)
+    {
+        if(VendorID == (*elem)->m_pVendorDescriptor->m_VendorID &&
+           SubTypeNum == (*elem)->m_TypeNum)
+        {
+            return *elem;
+        }
+    }
+
+    return NULL;
+}
+
+static const CTypeDescriptor *
+linearLookupByName (
+  CTypeRegistry *               pTypeRegistry,
+  const char *                  pName)
+{
+    const CTypeDescriptor * const * apStd[2] = {
+        pTypeRegistry->m_apStdMessageTypeDescriptors,
+        pTypeRegistry->m_apStdParameterTypeDescriptors };
+    std::list<const CTypeDescriptor *> * apList[2] = {
+        &pTypeRegistry->m_listCustomParameterTypeDescriptors,
+        &pTypeRegistry->m_listCustomMessageTypeDescriptors };
+
+    for(unsigned int iTable = 0; iTable < 2u; iTable++)
+    {
+        for(unsigned int i = 0; i < 1024u; i++)
+        {
+            if(NULL != apStd[iTable][i] &&
+               0 == strcmp(apStd[iTable][i]->m_pName, pName))
+            {
+                return apStd[iTable][i];
+            }
+        }
+    }
+
+    for(unsigned int iList = 0; iList < 2u; iList++)
+    {
+        for(std::list<const CTypeDescriptor *>::const_iterator elem =
+                                apList[iList]->begin();
+            elem != apList[iList]->end();
+            elem++)
+        {
+            if(0 == strcmp((*elem)->m_pName, pName))
+            {
+                return *elem;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static double
+nowNsec (void)
+{
+    struct timespec             Now;
+
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+
+    return Now.tv_sec * 1e9 + Now.tv_nsec;
+}
@@ -0,0 +1,936 @@
+
+/*
+ ***************************************************************************
+ *  Copyright 2007,2008 Impinj, Inc.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ ***************************************************************************
+ */
+
+
+/**
+ *****************************************************************************
+ **
+ ** @file  ltkperf.cpp
+ **
+ ** @brief Codec benchmark over a set of frame files
+ **
+ ** ltkperf times the codec paths a reader connection and the
+ ** tools use, over every input it is given:
+ **
+ **     extract     CFrameExtract walking the frames
+ **     decode      CFrameDecoder, message deleted
+ **     tdecode     the same with CFrameDecoder::DECODE_TRUSTED
+ **     encode      CFrameEncoder of the decoded messages
+ **     xmlencode   toXMLText() into a string
+ **     xmldecode   CXMLTextDecoder of that text, message deleted
+ **
+ ** Each input is a file of consecutive LLRP frames, the same
+ ** "binary encoding" llrp2xml takes, or a synthetic
+ ** RO_ACCESS_REPORT with a given number of tag reports (-s).
+ ** With -w each synthetic tag report also carries a
+ ** C1G2ReadOpSpecResult of that many words of ReadData.
+ **
+ ** The output is one tab separated line per input and
+ ** operation, after a header line, so runs can be kept and
+ ** compared from one LTK change to the next:
+ **
+ **     corpus  op  msgs  bytes  rounds  ns_per_msg  mb_per_s
+ **         allocs_per_msg  peak_rss_kb
+ **
+ ** bytes is per round: the frames for extract, decode and
+ ** encode, the XML text for xmlencode and xmldecode.
+ ** allocs_per_msg counts operator new and libxml2 allocations
+ ** in one round after a warm up round, so element pool hits
+ ** don't count. peak_rss_kb is the peak resident size while
+ ** that input was loaded and run; where the kernel can't
+ ** reset the peak it is the peak so far.
+ **
+ ** Frames that don't decode are timed by extract, decode
+ ** and tdecode and left out of the rest.
+ **
+ **     ltkperf [-t MSEC] [-r ROUNDS] [-k KERNEL] [-w NWORD]
+ **         [-s NTAG]... [FILE]...
+ **
+ ** -t is the minimum time per measurement, default 200 ms.
+ ** -r fixes the rounds instead. -k picks the CFrameByteOrder
+ ** kernel for vector fields (portable, ssse3 or avx2), the
+ ** header line names the one used. With no inputs at all
+ ** "-s 64 -s 1024" is assumed. "make bench" runs it over
+ ** the dx101 and dx301 vectors and three synthetic sizes.
+ **
+ *****************************************************************************/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "ltkcpp.h"
+#include "libxml/parser.h"
+#include "libxml/xmlmemory.h"
+
+
+using namespace LLRP;
+
+
+/* Default minimum time per measurement */
+#define MIN_MSEC_DEFAULT        200u
+
+/* Synthetic sizes used when there are no inputs */
+#define SYNTH_N_TAG_SMALL       64u
+#define SYNTH_N_TAG_LARGE       1024u
+
+
+/*
+ * One input: the frames packed back to back in aBuf,
+ * the decoded messages and their XML text.
+ */
+class CCorpus
+{
+  public:
+    std::string                 m_Name;
+    std::vector<unsigned char>  m_aBuf;
+    std::vector<unsigned int>   m_aiFrame;
+    std::vector<unsigned int>   m_anFrame;
+    unsigned int                m_nMaxFrame;
+
+    std::vector<CMessage *>     m_apMessage;
+    double                      m_nMessageByte;
+    std::vector<std::string>    m_aXMLText;
+    double                      m_nXMLByte;
+
+    std::vector<unsigned char>  m_aEncodeBuf;
+
+    CCorpus (void);
+
+    ~CCorpus (void);
+};
+
+/*
+ * One timed operation. pFunc does one round over the corpus.
+ */
+struct SPerfOp
+{
+    const char *                pName;
+    void                        (*pFunc) (
+                                    CCorpus *           pCorpus,
+                                    CTypeRegistry *     pTypeRegistry);
+    llrp_bool_t                 bDecodedOnly;
+    llrp_bool_t                 bXMLBytes;
+};
+
+
+/*
+ * Allocations since start. Bumped by the operator new
+ * replacements below and the libxml2 allocator hooks.
+ */
+static unsigned long            g_nAlloc;
+
+
+static int
+loadFrames (
+  CCorpus *                     pCorpus,
+  const char *                  pFileName);
+
+static int
+makeSyntheticReport (
+  CCorpus *                     pCorpus,
+  unsigned int                  nTag,
+  unsigned int                  nReadWord);
+
+static void
+prepareCorpus (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry);
+
+static void
+runCorpus (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry,
+  double                        MinNsec,
+  unsigned int                  nFixedRound);
+
+static void
+opExtract (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry);
+
+static void
+opDecode (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry);
+
+static void
+opTrustedDecode (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry);
+
+static void
+decodeFrames (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry,
+  CFrameDecoder::EStrictness    eStrictness);
+
+static void
+opEncode (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry);
+
+static void
+opXMLEncode (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry);
+
+static void
+opXMLDecode (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry);
+
+static void
+resetPeakRSS (void);
+
+static long
+getPeakRSSKB (void);
+
+static void
+usage (
+  const char *                  pProgName);
+
+static double
+nowNsec (void);
+
+
+static const SPerfOp            s_aPerfOp[] =
+{
+    { "extract",    opExtract,      FALSE,  FALSE },
+    { "decode",     opDecode,       FALSE,  FALSE },
+    { "tdecode",    opTrustedDecode, FALSE, FALSE },
+    { "encode",     opEncode,       TRUE,   FALSE },
+    { "xmlencode",  opXMLEncode,    TRUE,   TRUE },
+    { "xmldecode",  opXMLDecode,    TRUE,   TRUE },
+};
+
+
+/*
+ * Counting allocators. The program is single threaded.
+ */
+void *
+operator new (
+  size_t                        nByte)
+{
+    void *                      pMem = malloc(nByte ? nByte : 1u);
+
+    if(NULL == pMem)
+    {
+        throw std::bad_alloc();
+    }
+    g_nAlloc++;
+
+    return pMem;
+}
+
+void *
+operator new[] (
+  size_t                        nByte)
+{
+    return operator new(nByte);
+}
+
+void
+operator delete (
+  void *                        pMem) noexcept
+{
+    free(pMem);
+}
+
+void
+operator delete[] (
+  void *                        pMem) noexcept
+{
+    free(pMem);
+}
+
+static void *
+countXMLMalloc (
+  size_t                        nByte)
+{
+    g_nAlloc++;
+    return malloc(nByte);
+}
+
+static void *
+countXMLRealloc (
+  void *                        pMem,
+  size_t                        nByte)
+{
+    g_nAlloc++;
+    return realloc(pMem, nByte);
+}
+
+static char *
+countXMLStrdup (
+  const char *                  pStr)
+{
+    g_nAlloc++;
+    return strdup(pStr);
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Command main routine
+ **
+ ** @exitcode   0               Everything *seemed* to work.
+ **             1               Bad usage
+ **             2               Could not load an input
+ **
+ *****************************************************************************/
+
+int
+main (int ac, char *av[])
+{
+    CTypeRegistry *             pTypeRegistry;
+    unsigned int                MinMsec = MIN_MSEC_DEFAULT;
+    unsigned int                nFixedRound = 0;
+    unsigned int                nReadWord = 0;
+    std::vector<unsigned int>   anSynthTag;
+    std::vector<const char *>   apFileName;
+    int                         i;
+
+    /* Before libxml2 allocates anything */
+    xmlMemSetup(free, countXMLMalloc, countXMLRealloc, countXMLStrdup);
+    xmlInitParser();
+
+    for(i = 1; i < ac; i++)
+    {
+        if('-' != av[i][0])
+        {
+            apFileName.push_back(av[i]);
+            continue;
+        }
+
+        if(i + 1 >= ac)
+        {
+            usage(av[0]);
+            return 1;
+        }
+
+        unsigned int            Value = (unsigned int) strtoul(av[i + 1], NULL, 0);
+        CFrameByteOrder::EKernel eKernel;
+
+        if(0 == strcmp(av[i], "-k"))
+        {
+            if(!CFrameByteOrder::lookupKernel(av[i + 1], &eKernel))
+            {
+                usage(av[0]);
+                return 1;
+            }
+            if(!CFrameByteOrder::setKernel(eKernel))
+            {
+                fprintf(stderr, "ERROR: %s not supported here\n", av[i + 1]);
+                return 1;
+            }
+        }
+        else if(0 == strcmp(av[i], "-t"))
+        {
+            MinMsec = Value;
+        }
+        else if(0 == strcmp(av[i], "-r"))
+        {
+            nFixedRound = Value;
+        }
+        else if(0 == strcmp(av[i], "-w"))
+        {
+            nReadWord = Value;
+        }
+        else if(0 == strcmp(av[i], "-s") && 0 != Value)
+        {
+            anSynthTag.push_back(Value);
+        }
+        else
+        {
+            usage(av[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    if(anSynthTag.empty() && apFileName.empty())
+    {
+        anSynthTag.push_back(SYNTH_N_TAG_SMALL);
+        anSynthTag.push_back(SYNTH_N_TAG_LARGE);
+    }
+
+    pTypeRegistry = getTheTypeRegistry();
+
+    printf("# ltkperf, min %u ms per measurement, %s byte order kernel\n",
+        MinMsec,
+        CFrameByteOrder::getKernelName(CFrameByteOrder::getKernel()));
+    printf("corpus\top\tmsgs\tbytes\trounds\tns_per_msg\tmb_per_s\t"
+        "allocs_per_msg\tpeak_rss_kb\n");
+
+    for(unsigned int iInput = 0;
+        iInput < apFileName.size() + anSynthTag.size();
+        iInput++)
+    {
+        CCorpus *               pCorpus;
+        int                     rc;
+
+        resetPeakRSS();
+
+        pCorpus = new CCorpus();
+        if(iInput < apFileName.size())
+        {
+            rc = loadFrames(pCorpus, apFileName[iInput]);
+        }
+        else
+        {
+            rc = makeSyntheticReport(pCorpus,
+                    anSynthTag[iInput - apFileName.size()], nReadWord);
+        }
+
+        if(0 != rc)
+        {
+            delete pCorpus;
+            delete pTypeRegistry;
+            return 2;
+        }
+
+        prepareCorpus(pCorpus, pTypeRegistry);
+        runCorpus(pCorpus, pTypeRegistry, MinMsec * 1e6, nFixedRound);
+        fflush(stdout);
+
+        delete pCorpus;
+    }
+
+    delete pTypeRegistry;
+
+    xmlCleanupParser();
+
+    return 0;
+}
+
+static void
+usage (
+  const char *                  pProgName)
+{
+    fprintf(stderr, "ERROR: Bad usage\nusage: "
+        "%s [-t MSEC] [-r ROUNDS] [-k KERNEL] [-w NWORD]\n"
+        "    [-s NTAG]... [FILE]...\n", pProgName);
+}
+
+
+CCorpus::CCorpus (void)
+{
+    m_nMaxFrame = 0;
+    m_nMessageByte = 0;
+    m_nXMLByte = 0;
+}
+
+CCorpus::~CCorpus (void)
+{
+    for(unsigned int i = 0; i < m_apMessage.size(); i++)
+    {
+        delete m_apMessage[i];
+    }
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Read a file of frames and find the frame boundaries
+ **
+ ** @return     0 OK, else error already reported
+ **
+ *****************************************************************************/
+
+static int
+loadFrames (
+  CCorpus *                     pCorpus,
+  const char *                  pFileName)
+{
+    FILE *                      infp;
+    unsigned char               aChunk[65536];
+    size_t                      nRead;
+    const char *                pBase;
+    const char *                pDot;
+
+#ifdef WIN32
+    infp = fopen(pFileName, "rb");
+#else
+    infp = fopen(pFileName, "r");
+#endif
+    if(NULL == infp)
+    {
+        perror(pFileName);
+        return -1;
+    }
+
+    while(0 < (nRead = fread(aChunk, 1u, sizeof aChunk, infp)))
+    {
+        pCorpus->m_aBuf.insert(pCorpus->m_aBuf.end(), aChunk, aChunk + nRead);
+    }
+    fclose(infp);
+
+    for(unsigned int iNext = 0; iNext < pCorpus->m_aBuf.size(); )
+    {
+        CFrameExtract           MyFrameExtract(&pCorpus->m_aBuf[iNext],
+                                    (unsigned int) pCorpus->m_aBuf.size() -
+                                        iNext);
+
+        if(CFrameExtract::READY != MyFrameExtract.m_eStatus)
+        {
+            fprintf(stderr, "ERROR: %s: bad frame at offset %u\n",
+                pFileName, iNext);
+            return -1;
+        }
+
+        pCorpus->m_aiFrame.push_back(iNext);
+        pCorpus->m_anFrame.push_back(MyFrameExtract.m_MessageLength);
+        if(pCorpus->m_nMaxFrame < MyFrameExtract.m_MessageLength)
+        {
+            pCorpus->m_nMaxFrame = MyFrameExtract.m_MessageLength;
+        }
+
+        iNext += MyFrameExtract.m_MessageLength;
+    }
+
+    if(pCorpus->m_aiFrame.empty())
+    {
+        fprintf(stderr, "ERROR: no frames in %s\n", pFileName);
+        return -1;
+    }
+
+    pBase = strrchr(pFileName, '/');
+    pBase = (NULL == pBase) ? pFileName : pBase + 1;
+    pDot = strrchr(pBase, '.');
+    pCorpus->m_Name.assign(pBase, (NULL == pDot) ? strlen(pBase) :
+                                  (size_t)(pDot - pBase));
+
+    return 0;
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Build one RO_ACCESS_REPORT of nTag typical tag reports
+ **
+ ** Each has nReadWord words of ReadData when that isn't 0.
+ **
+ ** @return     0 OK, else error already reported
+ **
+ *****************************************************************************/
+
+static int
+makeSyntheticReport (
+  CCorpus *                     pCorpus,
+  unsigned int                  nTag,
+  unsigned int                  nReadWord)
+{
+    CRO_ACCESS_REPORT *         pReport = new CRO_ACCESS_REPORT();
+    char                        aName[32];
+
+    pReport->setMessageID(1u);
+
+    for(unsigned int i = 0; i < nTag; i++)
+    {
+        CTagReportData *        pTagReportData = new CTagReportData();
+        CEPC_96 *               pEPC_96 = new CEPC_96();
+        CAntennaID *            pAntennaID = new CAntennaID();
+        CPeakRSSI *             pPeakRSSI = new CPeakRSSI();
+        CFirstSeenTimestampUTC *pFirstSeen = new CFirstSeenTimestampUTC();
+        CLastSeenTimestampUTC * pLastSeen = new CLastSeenTimestampUTC();
+        CTagSeenCount *         pTagSeenCount = new CTagSeenCount();
+        llrp_u96_t              EPC;
+
+        for(unsigned int Ix = 0; Ix < 12u; Ix++)
+        {
+            EPC.m_aValue[Ix] = (llrp_u8_t)(i * 12u + Ix);
+        }
+        pEPC_96->setEPC(EPC);
+        pAntennaID->setAntennaID(1u + i % 4u);
+        pPeakRSSI->setPeakRSSI(-40 - (llrp_s8_t)(i % 30u));
+        pFirstSeen->setMicroseconds(1234567890123456ull + i);
+        pLastSeen->setMicroseconds(1234567890223456ull + i);
+        pTagSeenCount->setTagCount(1u + i % 7u);
+
+        pTagReportData->setEPCParameter(pEPC_96);
+        pTagReportData->setAntennaID(pAntennaID);
+        pTagReportData->setPeakRSSI(pPeakRSSI);
+        pTagReportData->setFirstSeenTimestampUTC(pFirstSeen);
+        pTagReportData->setLastSeenTimestampUTC(pLastSeen);
+        pTagReportData->setTagSeenCount(pTagSeenCount);
+
+        if(0 < nReadWord)
+        {
+            CC1G2ReadOpSpecResult * pReadResult = new CC1G2ReadOpSpecResult();
+            llrp_u16v_t         ReadData(nReadWord);
+
+            for(unsigned int Ix = 0; Ix < nReadWord; Ix++)
+            {
+                ReadData.m_pValue[Ix] = (llrp_u16_t)(i * 0x0101u + Ix);
+            }
+            pReadResult->setResult(C1G2ReadResultType_Success);
+            pReadResult->setOpSpecID(1u);
+            pReadResult->setReadData(ReadData);
+            pTagReportData->addAccessCommandOpSpecResult(pReadResult);
+        }
+
+        pReport->addTagReportData(pTagReportData);
+    }
+
+    /* Generous: a tag report is well under 128 bytes plus ReadData */
+    pCorpus->m_aBuf.resize(64u + (128u + 2u * nReadWord) * (size_t) nTag);
+
+    CFrameEncoder               MyFrameEncoder(&pCorpus->m_aBuf[0],
+                                    (unsigned int) pCorpus->m_aBuf.size());
+
+    MyFrameEncoder.encodeElement(pReport);
+    delete pReport;
+
+    if(RC_OK != MyFrameEncoder.m_ErrorDetails.m_eResultCode)
+    {
+        fprintf(stderr, "ERROR: synthetic encode failed, result=%d\n",
+            MyFrameEncoder.m_ErrorDetails.m_eResultCode);
+        return -1;
+    }
+
+    pCorpus->m_aBuf.resize(MyFrameEncoder.getLength());
+    pCorpus->m_aiFrame.push_back(0);
+    pCorpus->m_anFrame.push_back(MyFrameEncoder.getLength());
+    pCorpus->m_nMaxFrame = MyFrameEncoder.getLength();
+
+    if(0 < nReadWord)
+    {
+        snprintf(aName, sizeof aName, "synth_%u_w%u", nTag, nReadWord);
+    }
+    else
+    {
+        snprintf(aName, sizeof aName, "synth_%u", nTag);
+    }
+    pCorpus->m_Name = aName;
+
+    return 0;
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Decode the frames and render the XML the later ops use
+ **
+ *****************************************************************************/
+
+static void
+prepareCorpus (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry)
+{
+    for(unsigned int iFrame = 0; iFrame < pCorpus->m_aiFrame.size(); iFrame++)
+    {
+        CFrameDecoder           MyFrameDecoder(pTypeRegistry,
+                                    &pCorpus->m_aBuf[pCorpus->m_aiFrame[iFrame]],
+                                    pCorpus->m_anFrame[iFrame]);
+        CMessage *              pMessage;
+        CXMLTextStringSink      MySink;
+
+        pMessage = MyFrameDecoder.decodeMessage();
+        if(NULL == pMessage)
+        {
+            continue;
+        }
+
+        toXMLText(pMessage, &MySink);
+        pCorpus->m_apMessage.push_back(pMessage);
+        pCorpus->m_nMessageByte += pCorpus->m_anFrame[iFrame];
+        pCorpus->m_aXMLText.push_back(MySink.m_Text);
+        pCorpus->m_nXMLByte += MySink.m_Text.size();
+    }
+
+    /* Room for any re-encoded frame, which may grow a little */
+    pCorpus->m_aEncodeBuf.resize(2u * pCorpus->m_nMaxFrame + 1024u);
+}
+
+
+/**
+ *****************************************************************************
+ **
+ ** @brief  Time every operation over one corpus and print the lines
+ **
+ ** Each operation gets a warm up round, a round with the
+ ** allocations counted, then enough rounds to fill MinNsec
+ ** (or exactly nFixedRound).
+ **
+ *****************************************************************************/
+
+static void
+runCorpus (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry,
+  double                        MinNsec,
+  unsigned int                  nFixedRound)
+{
+    const unsigned int          nOp = sizeof s_aPerfOp / sizeof s_aPerfOp[0];
+    double                      aNsecPerMsg[nOp];
+    double                      aAllocPerMsg[nOp];
+    unsigned int                anRound[nOp];
+    long                        PeakRSSKB;
+
+    for(unsigned int iOp = 0; iOp < nOp; iOp++)
+    {
+        const SPerfOp *         pOp = &s_aPerfOp[iOp];
+        unsigned int            nMsg;
+        unsigned int            nRound = nFixedRound;
+        unsigned long           nAllocStart;
+        double                  Start;
+        double                  Elapsed;
+
+        nMsg = (unsigned int) (pOp->bDecodedOnly ?
+                    pCorpus->m_apMessage.size() : pCorpus->m_aiFrame.size());
+        if(0 == nMsg)
+        {
+            anRound[iOp] = 0;
+            continue;
+        }
+
+        (*pOp->pFunc)(pCorpus, pTypeRegistry);
+
+        nAllocStart = g_nAlloc;
+        Start = nowNsec();
+        (*pOp->pFunc)(pCorpus, pTypeRegistry);
+        Elapsed = nowNsec() - Start;
+        aAllocPerMsg[iOp] = (double) (g_nAlloc - nAllocStart) / nMsg;
+
+        if(0 == nRound)
+        {
+            nRound = (Elapsed >= MinNsec) ? 1u :
+                        (unsigned int) (MinNsec / (Elapsed + 1.0)) + 1u;
+        }
+
+        Start = nowNsec();
+        for(unsigned int iRound = 0; iRound < nRound; iRound++)
+        {
+            (*pOp->pFunc)(pCorpus, pTypeRegistry);
+        }
+        Elapsed = nowNsec() - Start;
+
+        anRound[iOp] = nRound;
+        aNsecPerMsg[iOp] = Elapsed / ((double) nRound * nMsg);
+    }
+
+    /* Only now is the peak for this corpus known */
+    PeakRSSKB = getPeakRSSKB();
+
+    for(unsigned int iOp = 0; iOp < nOp; iOp++)
+    {
+        const SPerfOp *         pOp = &s_aPerfOp[iOp];
+        double                  nByte;
+        unsigned int            nMsg;
+
+        if(0 == anRound[iOp])
+        {
+            continue;
+        }
+
+        nMsg = (unsigned int) (pOp->bDecodedOnly ?
+                    pCorpus->m_apMessage.size() : pCorpus->m_aiFrame.size());
+        if(pOp->bXMLBytes)
+        {
+            nByte = pCorpus->m_nXMLByte;
+        }
+        else if(pOp->bDecodedOnly)
+        {
+            nByte = pCorpus->m_nMessageByte;
+        }
+        else
+        {
+            nByte = (double) pCorpus->m_aBuf.size();
+        }
+
+        printf("%s\t%s\t%u\t%.0f\t%u\t%.1f\t%.1f\t%.2f\t%ld\n",
+            pCorpus->m_Name.c_str(), pOp->pName, nMsg, nByte,
+            anRound[iOp], aNsecPerMsg[iOp],
+            nByte / (aNsecPerMsg[iOp] * nMsg) * 1e3,
+            aAllocPerMsg[iOp], PeakRSSKB);
+    }
+}
+
+
+/*
+ * The operations, one round each
+ */
+
+static void
+opExtract (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry)
+{
+    unsigned int                nBuf = (unsigned int) pCorpus->m_aBuf.size();
+
+    for(unsigned int iNext = 0; iNext < nBuf; )
+    {
+        CFrameExtract           MyFrameExtract(&pCorpus->m_aBuf[iNext],
+                                    nBuf - iNext);
+
+        if(CFrameExtract::READY != MyFrameExtract.m_eStatus)
+        {
+            break;
+        }
+        iNext += MyFrameExtract.m_MessageLength;
+    }
+}
+
+static void
+opDecode (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry)
+{
+    decodeFrames(pCorpus, pTypeRegistry, CFrameDecoder::DECODE_STRICT);
+}
+
+static void
+opTrustedDecode (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry)
+{
+    decodeFrames(pCorpus, pTypeRegistry, CFrameDecoder::DECODE_TRUSTED);
+}
+
+static void
+decodeFrames (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry,
+  CFrameDecoder::EStrictness    eStrictness)
+{
+    for(unsigned int iFrame = 0; iFrame < pCorpus->m_aiFrame.size(); iFrame++)
+    {
+        CFrameDecoder           MyFrameDecoder(pTypeRegistry,
+                                    &pCorpus->m_aBuf[pCorpus->m_aiFrame[iFrame]],
+                                    pCorpus->m_anFrame[iFrame]);
+
+        MyFrameDecoder.setStrictness(eStrictness);
+        delete MyFrameDecoder.decodeMessage();
+    }
+}
+
+static void
+opEncode (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry)
+{
+    for(unsigned int i = 0; i < pCorpus->m_apMessage.size(); i++)
+    {
+        CFrameEncoder           MyFrameEncoder(&pCorpus->m_aEncodeBuf[0],
+                                    (unsigned int)
+                                        pCorpus->m_aEncodeBuf.size());
+
+        MyFrameEncoder.encodeElement(pCorpus->m_apMessage[i]);
+    }
+}
+
+static void
+opXMLEncode (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry)
+{
+    CXMLTextStringSink          MySink;
+
+    for(unsigned int i = 0; i < pCorpus->m_apMessage.size(); i++)
+    {
+        MySink.m_Text.clear();
+        toXMLText(pCorpus->m_apMessage[i], &MySink);
+    }
+}
+
+static void
+opXMLDecode (
+  CCorpus *                     pCorpus,
+  CTypeRegistry *               pTypeRegistry)
+{
+    for(unsigned int i = 0; i < pCorpus->m_aXMLText.size(); i++)
+    {
+        CXMLTextDecoder         MyDecoder(pTypeRegistry,
+                                    &pCorpus->m_aXMLText[i][0],
+                                    (int) pCorpus->m_aXMLText[i].size());
+
+        delete MyDecoder.decodeMessage();
+    }
+}
+
+
+/*
+ * Linux resets the peak RSS ("VmHWM") when "5" is written
+ * to clear_refs. Elsewhere this does nothing and the peak
+ * is the peak since start.
+ */
+static void
+resetPeakRSS (void)
+{
+    FILE *                      fp = fopen("/proc/self/clear_refs", "w");
+
+    if(NULL != fp)
+    {
+        fputs("5", fp);
+        fclose(fp);
+    }
+}
+
+static long
+getPeakRSSKB (void)
+{
+    FILE *                      fp = fopen("/proc/self/status", "r");
+    char                        aLine[256];
+    long                        PeakKB = -1;
+    struct rusage               Usage;
+
+    if(NULL != fp)
+    {
+        while(NULL != fgets(aLine, sizeof aLine, fp))
+        {
+            if(0 == strncmp(aLine, "VmHWM:", 6u))
+            {
+                PeakKB = strtol(aLine + 6, NULL, 10);
+                break;
+            }
+        }
+        fclose(fp);
+    }
+
+    if(0 > PeakKB && 0 == getrusage(RUSAGE_SELF, &Usage))
+    {
+        PeakKB = Usage.ru_maxrss;
+    }
+
+    return PeakKB;
+}
+
+static double
+nowNsec (void)
+{
+    struct timespec             Now;
+
+    clock_gettime(CLOCK_MONOTONIC, &Now);
+
+    return Now.tv_sec * 1e9 + Now.tv_nsec;
+}
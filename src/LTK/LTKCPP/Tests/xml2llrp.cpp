@@ -53,6 +53,7 @@
 
 
 #include <stdio.h>
+#include <string.h>
 
 #if defined(linux)
 #include <stdint.h>
@@ -94,11 +95,14 @@ unsigned char errMsgBinary[18] = {0x04, 0x64, 0x00, 0x00,
  **
  ** Command synopsis:
  **
- **     dx101 INPUTFILE
+ **     dx101 [-k KERNEL] INPUTFILE
+ **
+ ** -k picks the CFrameByteOrder kernel (portable, ssse3 or
+ ** avx2) so RUN101 can check they all give the same bytes.
  **
  ** @exitcode   0               Everything *seemed* to work.
  **             1               Bad usage
- **             2               Could not open input file
+ **             2               Could not open or parse input file
  **
  *****************************************************************************/
 
@@ -106,16 +110,29 @@ int
 main (int ac, char *av[])
 {
     CTypeRegistry *             pTypeRegistry;
-    CXMLTextDecoder *           pDecoder;
+    CXMLTextStreamDecoder *     pDecoder;
     CMessage *                  pMessage;
-    xmlDoc*                     pDoc;
-    xmlNode*                    pNode;
     /*
      * Check arg count
      */
+    if(ac == 4 && 0 == strcmp(av[1], "-k"))
+    {
+        CFrameByteOrder::EKernel    eKernel;
+
+        if(!CFrameByteOrder::lookupKernel(av[2], &eKernel) ||
+           !CFrameByteOrder::setKernel(eKernel))
+        {
+            fprintf(stderr, "ERROR: Byte order kernel %s not available\n",
+                av[2]);
+            exit(1);
+        }
+        av += 2;
+        ac -= 2;
+    }
+
     if(ac != 2)
     {
-        fprintf(stderr, "ERROR: Bad usage\nusage: %s INPUTFILE\n", av[0]);
+        fprintf(stderr, "ERROR: Bad usage\nusage: %s [-k KERNEL] INPUTFILE\n", av[0]);
         exit(1);
     }
 
@@ -125,210 +142,162 @@ main (int ac, char *av[])
     pTypeRegistry = getTheTypeRegistry();
 
 
-    /* use libXML to read the DOM */
+    /* use libXML to pull the messages one at a time */
     xmlInitParser();
 
-    /* set the line numbers for error reporting */
-    xmlLineNumbersDefault(1);
-
-    pDoc = xmlReadFile(av[1], 
-                       NULL, 
-                       XML_PARSE_COMPACT | XML_PARSE_NONET);
+    /*
+     * Construct the stream decoder. It reads the file as we go
+     * so only one message is in memory at a time.
+     */
+    pDecoder = new CXMLTextStreamDecoder(pTypeRegistry, av[1]);
 
-    if(NULL == pDoc)
+    if(pDecoder->isEndOfInput() &&
+       RC_OK != pDecoder->m_ErrorDetails.m_eResultCode)
     {
         fprintf(stderr, "ERROR: Could not read XML File\n");
+        delete pDecoder;
         delete pTypeRegistry;
         xmlCleanupParser();
         exit(2);
     }
 
-    pNode = xmlDocGetRootElement(pDoc);
-
-    /* find the first element node and make sure its PS */
-    while((pNode) && (XML_ELEMENT_NODE != pNode->type))
-    {
-        pNode = pNode->next;
-    }
-
-    if(NULL == pNode)
-    {
-        fprintf(stderr, "ERROR: Could not get XML PacketSequence node.  " \
-                        "Found no top-level Element nodes \n");
-        delete pTypeRegistry;
-        xmlCleanupParser();
-        exit(3);
-    }
-
-    if(strcmp((const char*) pNode->name, "packetSequence") != 0)
-    {
-        fprintf(stderr, "ERROR: Could not get XML PacketSequence node.  " \
-                        "Found %s instead\n", pNode->name);
-        xmlFreeDoc(pDoc);
-        xmlCleanupParser();
-        delete pTypeRegistry;
-        exit(4);
-    }
-    
     /* not sure this is necessary */
     freopen(NULL, "wb", stdout);
 
-    /* packets are all children of the first node */
-    pNode = pNode->children;
-  
-    while(pNode != NULL)
+    while(!pDecoder->isEndOfInput())
     {
-        if(XML_ELEMENT_NODE == pNode->type)
+        /*
+         * Ask the stream decoder to decode the next
+         * message. It returns NULL for an error.
+         */
+        pMessage = pDecoder->decodeMessage();
+
+        /*
+         * Did the decode fail?
+         */
+        if(NULL == pMessage)
+        {
+            /* encode error message as binary */
+            fwrite(errMsgBinary, 1, sizeof(errMsgBinary), stdout);
+
+#ifdef XML2LLRP_DEBUG
+            const CErrorDetails *pError = &pDecoder->m_ErrorDetails;
+  
+            fprintf(stderr, "ERROR: Decoder error, result=%d\n",
+                    pError->m_eResultCode);
+
+            if(NULL != pError->m_pRefType)
+            { 
+                fprintf(stderr, "ERROR ... refType=%s\n",
+                       pError->m_pRefType->m_pName);
+            }
+            if(NULL != pError->m_pRefField)
+            {
+                fprintf(stderr, "ERROR ... refField=%s\n",
+                       pError->m_pRefField->m_pName);
+            }
+            if(NULL != pError->m_pWhatStr)
+            {
+                fprintf(stderr, "ERROR ... whatStr=%s\n",
+                       pError->m_pWhatStr); 
+            }
+            if(0 != pError->m_OtherDetail)
+            {
+                fprintf(stderr, "ERROR ... XML line number %d\n", 
+                        pError->m_OtherDetail);
+            }
+#endif /* XML2LLRP_DEBUG */
+        }
+        else
         {
-            xmlChar *           pMessageIDStr = NULL;
+            unsigned char           aOutBuffer[FRAME_BUF_SIZE];
+            unsigned int            nOutBuffer;
+            CFrameEncoder *         pEncoder;
+
+#ifdef XML2LLRP_DEBUG
+            fprintf(stderr, "SUCCESS ... MessageID=%u passed encoding\n", 
+                    pMessage->getMessageID());
+
+#endif  /* XML2LLRP_DEBUG */
 
-            /* It helps to know the message ID for debugging */
-            pMessageIDStr = xmlGetProp(pNode, (const xmlChar*) "MessageID");
+            /* encode the message as binary */
+ 
+            /*
+             * Zero fill the buffer to make things easier
+             * on the debugger.
+             */
+            memset(aOutBuffer, 0, sizeof aOutBuffer);
 
             /*
-             * Construct a frame decoder. It references the
-             * type registry and the input buffer.
+             * Construct a frame encoder. It references
+             * the output buffer and knows the maximum size.
              */
-            pDecoder = new CXMLTextDecoder(pTypeRegistry, pNode);
+            pEncoder = new CFrameEncoder(aOutBuffer, 
+                                         sizeof aOutBuffer);
 
             /*
-             * Now ask the frame decoder to actually decode
-             * the message. It returns NULL for an error.
+             * Do the encode.
+             * TODO: check the result, tattle on errors.
              */
-             pMessage = pDecoder->decodeMessage();
+            pEncoder->encodeElement(pMessage);
 
             /*
-             * Did the decode fail?
+             * Get the byte length of the resulting frame.
              */
-            if(NULL == pMessage)
+            nOutBuffer = pEncoder->getLength();
+
+            /*
+             * Check the status, tattle on errors
+             */
+            if(RC_OK != pEncoder->m_ErrorDetails.m_eResultCode)
             {
                 /* encode error message as binary */
-                fwrite(errMsgBinary, 1, sizeof(errMsgBinary), stdout);
+                fwrite(errMsgBinary,1, sizeof(errMsgBinary), stdout);
 
 #ifdef XML2LLRP_DEBUG
-                const CErrorDetails *pError = &pDecoder->m_ErrorDetails;
-  
-                fprintf(stderr, "ERROR: Decoder error, result=%d\n",
-                        pError->m_eResultCode);
+                const CErrorDetails *pError = &pEncoder->m_ErrorDetails;
 
-                if(NULL != pMessageIDStr)
-                {
-                    fprintf(stderr, "ERROR ... MessageID=%s\n", 
-                           pMessageIDStr);
-                }
+                fprintf(stderr, "Failed to Encode XML message\n");
+                fprintf(stderr, "ERROR: Encoder error, status=%d\n",
+                        pError->m_eResultCode);
                 if(NULL != pError->m_pRefType)
-                { 
+                {
                     fprintf(stderr, "ERROR ... refType=%s\n",
-                           pError->m_pRefType->m_pName);
+                            pError->m_pRefType->m_pName);
                 }
                 if(NULL != pError->m_pRefField)
                 {
                     fprintf(stderr, "ERROR ... refField=%s\n",
-                           pError->m_pRefField->m_pName);
-                }
-                if(NULL != pError->m_pWhatStr)
-                {
-                    fprintf(stderr, "ERROR ... whatStr=%s\n",
-                           pError->m_pWhatStr); 
-                }
-                if(0 != pError->m_OtherDetail)
-                {
-                    fprintf(stderr, "ERROR ... XML line number %d\n", 
-                            pError->m_OtherDetail);
+                            pError->m_pRefField->m_pName);
                 }
 #endif /* XML2LLRP_DEBUG */
-
-                delete pDecoder;
-                xmlFree(pMessageIDStr);
             }
             else
             {
-                unsigned char           aOutBuffer[FRAME_BUF_SIZE];
-                unsigned int            nOutBuffer;
-                CFrameEncoder *         pEncoder;
-
-#ifdef XML2LLRP_DEBUG
-                if(NULL == pMessageIDStr)
-                {
-                    pMessageIDStr = (xmlChar*) "unknown";
-                }
-                fprintf(stderr, "SUCCESS ... MessageID=%s passed encoding\n", 
-                        pMessageIDStr);
-
-#endif  /* XML2LLRP_DEBUG */
-
-                xmlFree(pMessageIDStr);
-                delete pDecoder;
-                
-                /* encode the message as binary */
- 
-                /*
-                 * Zero fill the buffer to make things easier
-                 * on the debugger.
-                 */
-                memset(aOutBuffer, 0, sizeof aOutBuffer);
-
-                /*
-                 * Construct a frame encoder. It references
-                 * the output buffer and knows the maximum size.
-                 */
-                pEncoder = new CFrameEncoder(aOutBuffer, 
-                                             sizeof aOutBuffer);
-
-                /*
-                 * Do the encode.
-                 * TODO: check the result, tattle on errors.
-                 */
-                pEncoder->encodeElement(pMessage);
-
-                /*
-                 * Get the byte length of the resulting frame.
-                 */
-                nOutBuffer = pEncoder->getLength();
-
-                /*
-                 * Check the status, tattle on errors
-                 */
-                if(RC_OK != pEncoder->m_ErrorDetails.m_eResultCode)
-                {
-                    /* encode error message as binary */
-                    fwrite(errMsgBinary,1, sizeof(errMsgBinary), stdout);
+                fwrite(aOutBuffer, 1, nOutBuffer, stdout);
+            }
 
-#ifdef XML2LLRP_DEBUG
-                    const CErrorDetails *pError = &pEncoder->m_ErrorDetails;
-
-                    fprintf(stderr, "Failed to Encode XML message\n");
-                    fprintf(stderr, "ERROR: Encoder error, status=%d\n",
-                            pError->m_eResultCode);
-                    if(NULL != pError->m_pRefType)
-                    {
-                        fprintf(stderr, "ERROR ... refType=%s\n",
-                                pError->m_pRefType->m_pName);
-                    }
-                    if(NULL != pError->m_pRefField)
-                    {
-                        fprintf(stderr, "ERROR ... refField=%s\n",
-                                pError->m_pRefField->m_pName);
-                    }
-#endif /* XML2LLRP_DEBUG */
-                }
-                else
-                {
-                    fwrite(aOutBuffer, 1, nOutBuffer, stdout);
-                }
 
+            /* free the frame encoder */
+            delete pEncoder;
+        }
 
-                /* free the frame encoder */
-                delete pEncoder;
-            }
+        /* free the message we built */
+        delete pMessage;
+    }
 
-            /* free the message we built */
-            delete pMessage;
-        }
-        pNode = pNode->next;
+    /* the input stopped early on an XML syntax error */
+    if(RC_OK != pDecoder->m_ErrorDetails.m_eResultCode)
+    {
+        fprintf(stderr, "ERROR: Could not read XML File, line %d\n",
+                pDecoder->m_ErrorDetails.m_OtherDetail);
+        delete pDecoder;
+        xmlCleanupParser();
+        delete pTypeRegistry;
+        exit(2);
     }
 
-    xmlFreeDoc(pDoc);
+    delete pDecoder;
     xmlCleanupParser();
     delete pTypeRegistry;
 
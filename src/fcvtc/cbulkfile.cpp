@@ -0,0 +1,427 @@
+// cbulkfile.cpp
+
+
+#include "cbulkfile.h"
+#include "cdbase.h"
+#include <QDebug>
+
+
+
+// Binary files start with the magic, then version, then the row count, which
+// is -1 until the writer is closed so an unfinished export is never read as whole
+
+static const int magicSize = 8;
+static const qint64 rowCountOffset = magicSize + sizeof(qint32);
+
+
+
+// CSV rows are about this long, for estimating a CSV file's row count
+
+static const int csvNameRowBytes = 40;
+static const int csvLapRowBytes = 56;
+
+
+
+const char *CBulkFile::magic(Kind kind) {
+    return kind == names ? "FCVTNAME" : "FCVTLAPS";
+}
+
+
+
+CBulkProgress::CBulkProgress(const QString &what)
+    : what(what) {
+    reportedMsec = 0;
+    timer.start();
+}
+
+
+
+void CBulkProgress::update(long long rowCount) {
+    if (timer.elapsed() - reportedMsec >= 2000) {
+        reportedMsec = timer.elapsed();
+        qDebug() << qPrintable(what) << rowCount << "rows," << rowsPerSecond(rowCount) << "rows/s";
+    }
+}
+
+
+
+void CBulkProgress::finish(long long rowCount) {
+    qDebug() << qPrintable(what) << rowCount << "rows in" << timer.elapsed() << "msec," << rowsPerSecond(rowCount) << "rows/s";
+}
+
+
+
+long long CBulkProgress::rowsPerSecond(long long rowCount) {
+    return rowCount * 1000 / qMax(timer.elapsed(), (qint64)1);
+}
+
+
+
+CBulkWriter::CBulkWriter(const QString &fileName)
+    : file(fileName) {
+    rowCount = 0;
+    csv = fileName.endsWith(".csv", Qt::CaseInsensitive);
+}
+
+
+
+CBulkWriter::~CBulkWriter(void) {
+    file.close();
+}
+
+
+
+// open
+// Create the file and write its header.  Return 0 on success.
+//
+int CBulkWriter::open(CBulkFile::Kind kind) {
+    rowCount = 0;
+    tagKeys.clear();
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        errorTextVal = "Could not create " + file.fileName() + ": " + file.errorString();
+        return 1;
+    }
+
+    if (csv) {
+        if (kind == CBulkFile::names)
+            file.write("tagId,firstName,lastName\n");
+        else
+            file.write("tagId,timeStampUSec,sessionId,readerId,antennaId,lapmsec,lapm\n");
+    }
+    else {
+        stream.setDevice(&file);
+        stream.setVersion(QDataStream::Qt_5_0);
+        stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+        stream.writeRawData(CBulkFile::magic(kind), magicSize);
+        stream << qint32(CBulkFile::version) << qint64(-1);
+    }
+    return checkStatus();
+}
+
+
+
+int CBulkWriter::writeName(const CDbaseName &name) {
+    if (csv)
+        file.write(csvField(name.tagId) + ',' + csvField(name.firstName.toUtf8()) + ',' + csvField(name.lastName.toUtf8()) + '\n');
+    else
+        stream << name.tagId << name.firstName << name.lastName;
+    rowCount++;
+    return checkStatus();
+}
+
+
+
+int CBulkWriter::writeLap(const CLapRecord &lap) {
+    if (csv) {
+        QByteArray line = csvField(lap.tagId);
+        line += ',' + QByteArray::number(lap.timeStampUSec);
+        line += ',' + QByteArray::number(lap.sessionId);
+        line += ',' + QByteArray::number(lap.readerId);
+        line += ',' + QByteArray::number(lap.antennaId);
+        line += ',' + QByteArray::number(lap.lapmsec);
+        line += ',' + QByteArray::number(lap.lapm, 'f', 3);
+        line += '\n';
+        file.write(line);
+    }
+    else {
+        QHash<QByteArray, qint32>::const_iterator key = tagKeys.constFind(lap.tagId);
+        if (key == tagKeys.constEnd()) {
+            qint32 newKey = tagKeys.size();
+            tagKeys.insert(lap.tagId, newKey);
+            stream << newKey << lap.tagId;
+        }
+        else
+            stream << *key;
+        stream << qint64(lap.timeStampUSec) << qint32(lap.sessionId) << qint16(lap.readerId) << qint16(lap.antennaId)
+               << qint32(lap.lapmsec) << lap.lapm;
+    }
+    rowCount++;
+    return checkStatus();
+}
+
+
+
+// close
+// Finish the file, filling in a binary file's row count.  Return 0 on success.
+//
+int CBulkWriter::close(void) {
+    if (!file.isOpen())
+        return 1;
+    if (!csv && file.seek(rowCountOffset))
+        stream << qint64(rowCount);
+    int rc = checkStatus();
+    if (rc == 0 && !file.flush()) {
+        errorTextVal = "Could not write " + file.fileName() + ": " + file.errorString();
+        rc = 2;
+    }
+    file.close();
+    return rc;
+}
+
+
+
+QString CBulkWriter::errorText(void) {
+    return errorTextVal;
+}
+
+
+
+int CBulkWriter::checkStatus(void) {
+    if (file.error() != QFileDevice::NoError || (!csv && stream.status() != QDataStream::Ok)) {
+        errorTextVal = "Could not write " + file.fileName() + ": " + file.errorString();
+        return 1;
+    }
+    return 0;
+}
+
+
+
+// csvField
+// field quoted if it has a comma, quote or line break in it
+//
+QByteArray CBulkWriter::csvField(const QByteArray &field) {
+    for (int i=0; i<field.size(); i++) {
+        char c = field[i];
+        if (c == ',' || c == '"' || c == '\n' || c == '\r') {
+            QByteArray quoted = field;
+            quoted.replace("\"", "\"\"");
+            return '"' + quoted + '"';
+        }
+    }
+    return field;
+}
+
+
+
+CBulkReader::CBulkReader(const QString &fileName)
+    : file(fileName) {
+    kind = CBulkFile::names;
+    csv = true;
+    binaryRowCount = 0;
+    lineNumber = 0;
+    rowCount = 0;
+}
+
+
+
+CBulkReader::~CBulkReader(void) {
+    close();
+}
+
+
+
+// open
+// Open the file and read its header.  Return 0 on success.
+//
+int CBulkReader::open(CBulkFile::Kind kind) {
+    this->kind = kind;
+    rowCount = 0;
+    lineNumber = 0;
+    tagIds.clear();
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorTextVal = "Could not open " + file.fileName() + ": " + file.errorString();
+        return 1;
+    }
+
+    QByteArray magic = file.read(magicSize);
+    CBulkFile::Kind otherKind = kind == CBulkFile::names ? CBulkFile::laps : CBulkFile::names;
+    if (magic == CBulkFile::magic(otherKind)) {
+        errorTextVal = file.fileName() + QString(" has ") + (otherKind == CBulkFile::names ? "names" : "laps") + " in it";
+        return 2;
+    }
+    csv = magic != CBulkFile::magic(kind);
+    if (csv)
+        return file.seek(0) ? 0 : 3;
+
+    stream.setDevice(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    qint32 fileVersion = 0;
+    stream >> fileVersion >> binaryRowCount;
+    if (stream.status() != QDataStream::Ok || fileVersion != CBulkFile::version) {
+        errorTextVal = file.fileName() + QString(" is version %1, not %2").arg(fileVersion).arg(CBulkFile::version);
+        return 4;
+    }
+    if (binaryRowCount < 0) {
+        errorTextVal = file.fileName() + " was not finished";
+        return 5;
+    }
+    return 0;
+}
+
+
+
+// readName
+// The next row of a names file.  Return 1 for a row, 0 at the end of the file, -1 on error.
+//
+int CBulkReader::readName(CDbaseName *name) {
+    if (csv) {
+        int rc = readCsvRow(3);
+        if (rc != 1)
+            return rc;
+        name->tagId = fields[0].trimmed();
+        name->firstName = QString::fromUtf8(fields[1]);
+        name->lastName = QString::fromUtf8(fields[2]);
+    }
+    else {
+        if (rowCount == binaryRowCount)
+            return 0;
+        stream >> name->tagId >> name->firstName >> name->lastName;
+        if (stream.status() != QDataStream::Ok) {
+            errorTextVal = QString("%1 ends after %2 of its %3 names").arg(file.fileName()).arg(rowCount).arg(binaryRowCount);
+            return -1;
+        }
+    }
+    if (name->tagId.isEmpty()) {
+        errorTextVal = QString("Name %1 has no tagId").arg(rowCount + 1);
+        return -1;
+    }
+    rowCount++;
+    return 1;
+}
+
+
+
+// readLap
+// The next row of a laps file.  Return 1 for a row, 0 at the end of the file, -1 on error.
+//
+int CBulkReader::readLap(CLapRecord *lap) {
+    if (csv) {
+        int rc = readCsvRow(7);
+        if (rc != 1)
+            return rc;
+        bool ok[6];
+        lap->tagId = fields[0].trimmed();
+        lap->timeStampUSec = fields[1].trimmed().toLongLong(&ok[0]);
+        lap->sessionId = fields[2].trimmed().toInt(&ok[1]);
+        lap->readerId = fields[3].trimmed().toInt(&ok[2]);
+        lap->antennaId = fields[4].trimmed().toInt(&ok[3]);
+        lap->lapmsec = fields[5].trimmed().toInt(&ok[4]);
+        lap->lapm = fields[6].trimmed().toFloat(&ok[5]);
+        if (!(ok[0] && ok[1] && ok[2] && ok[3] && ok[4] && ok[5])) {
+            errorTextVal = QString("Line %1 of %2 has a field that is not a number").arg(lineNumber).arg(file.fileName());
+            return -1;
+        }
+    }
+    else {
+        if (rowCount == binaryRowCount)
+            return 0;
+        qint32 key;
+        stream >> key;
+        if (key == tagIds.size()) {
+            QByteArray tagId;
+            stream >> tagId;
+            tagIds.append(tagId);
+        }
+        else if (key < 0 || key > tagIds.size())
+            stream.setStatus(QDataStream::ReadCorruptData);
+        qint64 timeStampUSec;
+        qint32 sessionId;
+        qint16 readerId;
+        qint16 antennaId;
+        qint32 lapmsec;
+        stream >> timeStampUSec >> sessionId >> readerId >> antennaId >> lapmsec >> lap->lapm;
+        if (stream.status() != QDataStream::Ok) {
+            errorTextVal = QString("%1 is damaged or ends after %2 of its %3 laps").arg(file.fileName()).arg(rowCount).arg(binaryRowCount);
+            return -1;
+        }
+        lap->tagId = tagIds[key];
+        lap->timeStampUSec = timeStampUSec;
+        lap->sessionId = sessionId;
+        lap->readerId = readerId;
+        lap->antennaId = antennaId;
+        lap->lapmsec = lapmsec;
+    }
+    if (lap->tagId.isEmpty()) {
+        errorTextVal = QString("Lap %1 has no tagId").arg(rowCount + 1);
+        return -1;
+    }
+    rowCount++;
+    return 1;
+}
+
+
+
+// estimatedRowCount
+// Rows in the file, exact for the binary format and from the file size for CSV
+//
+long long CBulkReader::estimatedRowCount(void) {
+    if (!csv)
+        return binaryRowCount;
+    return file.size() / (kind == CBulkFile::names ? csvNameRowBytes : csvLapRowBytes);
+}
+
+
+
+void CBulkReader::close(void) {
+    stream.setDevice(NULL);
+    file.close();
+}
+
+
+
+QString CBulkReader::errorText(void) {
+    return errorTextVal;
+}
+
+
+
+// readCsvRow
+// Split the next non-blank row into fields, skipping a header row.  A quoted
+// field may run over several lines.  Return 1 for a row, 0 at the end of the
+// file, -1 when the row doesn't have fieldCount fields.
+//
+int CBulkReader::readCsvRow(int fieldCount) {
+    for (;;) {
+        fields.clear();
+        QByteArray line;
+        while (line.isEmpty() || line == "\n" || line == "\r\n") {
+            if (file.atEnd())
+                return 0;
+            line = file.readLine();
+            lineNumber++;
+        }
+        int rowLineNumber = lineNumber;
+
+        QByteArray field;
+        bool quoted = false;
+        int i = 0;
+        for (;;) {
+            if (i == line.size()) {
+                if (!quoted || file.atEnd())
+                    break;
+                line += file.readLine();
+                lineNumber++;
+                continue;
+            }
+            char c = line[i++];
+            if (quoted) {
+                if (c != '"')
+                    field += c;
+                else if (i < line.size() && line[i] == '"') {
+                    field += '"';
+                    i++;
+                }
+                else
+                    quoted = false;
+            }
+            else if (c == '"')
+                quoted = true;
+            else if (c == ',') {
+                fields.append(field);
+                field.clear();
+            }
+            else if (c != '\n' && c != '\r')
+                field += c;
+        }
+        fields.append(field);
+
+        if (rowLineNumber == 1 && fields[0].trimmed() == "tagId")
+            continue;
+        if (fields.size() != fieldCount) {
+            errorTextVal = QString("Line %1 of %2 has %3 fields, not %4").arg(rowLineNumber).arg(file.fileName()).arg(fields.size()).arg(fieldCount);
+            return -1;
+        }
+        return 1;
+    }
+}
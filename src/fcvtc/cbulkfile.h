@@ -0,0 +1,109 @@
+// cbulkfile.h
+//
+
+#ifndef CBULKFILE_H
+#define CBULKFILE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+
+#include "clapstore.h"
+
+
+class CDbaseName;
+
+
+// Files of names or laps for CDbase's bulk import and export, a row at a time
+// so neither end holds the whole file.  A file is CSV, a header line then a
+// row per line:
+//   tagId,firstName,lastName
+//   tagId,timeStampUSec,sessionId,readerId,antennaId,lapmsec,lapm
+// with lapm to the mm, or fcvtc's binary format: an 8 byte magic, a version
+// and the row count, then the rows through QDataStream.  Binary laps give
+// their rider as a key, the number of riders seen before it in the file, with
+// the tagId following the first use of each key.  Laps are 28 bytes that way.
+
+class CBulkFile
+{
+public:
+    enum Kind { names, laps };
+    static const int version = 1;
+    static const char *magic(Kind kind);
+};
+
+
+// Logs how far a bulk import or export has got, and its rows/s, every few seconds
+
+class CBulkProgress
+{
+public:
+    explicit CBulkProgress(const QString &what);
+    void update(long long rowCount);
+    void finish(long long rowCount);
+    long long rowsPerSecond(long long rowCount);
+private:
+    QString what;
+    QElapsedTimer timer;
+    qint64 reportedMsec;
+};
+
+
+// Writes CSV when the file name ends in .csv, the binary format otherwise
+
+class CBulkWriter
+{
+public:
+    explicit CBulkWriter(const QString &fileName);
+    ~CBulkWriter(void);
+    int open(CBulkFile::Kind kind);
+    int writeName(const CDbaseName &name);
+    int writeLap(const CLapRecord &lap);
+    int close(void);
+    QString errorText(void);
+    long long rowCount;
+private:
+    QFile file;
+    QDataStream stream;
+    bool csv;
+    QHash<QByteArray, qint32> tagKeys;
+    QString errorTextVal;
+    int checkStatus(void);
+    static QByteArray csvField(const QByteArray &field);
+};
+
+
+// Reads either format, telling them apart by the binary format's magic.  A CSV
+// file's header line is optional.  readName() and readLap() return 1 for a
+// row, 0 at the end of the file and -1 on error.
+
+class CBulkReader
+{
+public:
+    explicit CBulkReader(const QString &fileName);
+    ~CBulkReader(void);
+    int open(CBulkFile::Kind kind);
+    int readName(CDbaseName *name);
+    int readLap(CLapRecord *lap);
+    long long estimatedRowCount(void);
+    void close(void);
+    QString errorText(void);
+    long long rowCount;
+private:
+    QFile file;
+    QDataStream stream;
+    CBulkFile::Kind kind;
+    bool csv;
+    qint64 binaryRowCount;          // from the header
+    int lineNumber;
+    QList<QByteArray> fields;
+    QList<QByteArray> tagIds;       // binary laps, by key
+    QString errorTextVal;
+    int readCsvRow(int fieldCount);
+};
+
+#endif // CBULKFILE_H
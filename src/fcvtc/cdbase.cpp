@@ -3,11 +3,136 @@
 
 #include "cdbase.h"
 #include "crider.h"
+#include "cbulkfile.h"
+
+
+
+// Schema migrations, applied in order by migrate() when the database is opened.
+// PRAGMA user_version holds the number of the last one applied.  Add new ones
+// at the end with the next number, never change one that has been released.
+
+struct CDbaseMigration {
+    int version;
+    const char *description;
+    const char *statements[12];     // NULL terminated, run in one transaction
+    int (CDbase::*function)(void);  // run after the statements in the same transaction, or NULL, see migrate()
+};
+
+#define ROLLUP_COLUMNS "(tagId VARCHAR(20), period INTEGER, lapCount INTEGER, lapmsec INTEGER, lapm FLOAT, " \
+    "bestLapmsec INTEGER, bestLapm FLOAT, workoutCount INTEGER, continuedWorkout INTEGER, " \
+    "firstDateTime INTEGER, lastDateTime INTEGER, PRIMARY KEY (tagId, period)) WITHOUT ROWID"
+
+// From version 3 rollup periods and times are usec since the epoch, like laps.timeStampUSec
+
+#define ROLLUP_USEC_COLUMNS "(tagId VARCHAR(20), period INTEGER, lapCount INTEGER, lapmsec INTEGER, lapm FLOAT, " \
+    "bestLapmsec INTEGER, bestLapm FLOAT, workoutCount INTEGER, continuedWorkout INTEGER, " \
+    "firstTimeStampUSec INTEGER, lastTimeStampUSec INTEGER, PRIMARY KEY (tagId, period)) WITHOUT ROWID"
+
+// Version 2 and earlier laps.dateTime, local time packed by the old dateTime2Int() as
+// year-2000 << 26 | month << 22 | day << 17 | hour << 12 | minute << 6 | second, as usec since the epoch
+
+#define PACKED_DATETIME_USEC "IFNULL(CAST(strftime('%s', printf('%04d-%02d-%02d %02d:%02d:%02d', " \
+    "(dateTime >> 26) + 2000, (dateTime >> 22) & 15, (dateTime >> 17) & 31, (dateTime >> 12) & 31, " \
+    "(dateTime >> 6) & 63, dateTime & 63), 'utc') AS INTEGER) * 1000000, 0)"
+
+const CDbaseMigration CDbase::migrations[] = {
+    { 1, "index laps by tagId and dateTime for getStatsForPeriod",
+      { "CREATE INDEX IF NOT EXISTS lapsTagIdDateTime ON laps (tagId, dateTime)", NULL },
+      NULL },
+    { 2, "per rider daily and monthly rollups of laps",
+      { "CREATE TABLE IF NOT EXISTS lapsDay " ROLLUP_COLUMNS,
+        "CREATE TABLE IF NOT EXISTS lapsMonth " ROLLUP_COLUMNS, NULL },
+      &CDbase::fillRollups },
+    { 3, "laps timestamped in usec since the epoch, with session and reader ids",
+      { "CREATE TABLE IF NOT EXISTS sessions (id INTEGER PRIMARY KEY AUTOINCREMENT, startTimeStampUSec INTEGER)",
+        "CREATE TABLE lapsNew (id INTEGER PRIMARY KEY AUTOINCREMENT, tagId VARCHAR(20), timeStampUSec INTEGER, "
+        "sessionId INTEGER, readerId INTEGER, lapmsec INTEGER, lapm FLOAT)",
+        "INSERT INTO lapsNew (id, tagId, timeStampUSec, sessionId, readerId, lapmsec, lapm) "
+        "SELECT id, tagId, " PACKED_DATETIME_USEC ", 0, 0, lapmsec, lapm FROM laps",
+        "DROP TABLE laps",
+        "ALTER TABLE lapsNew RENAME TO laps",
+        "CREATE INDEX lapsTagIdTimeStamp ON laps (tagId, timeStampUSec)",
+        "DROP TABLE lapsDay",
+        "DROP TABLE lapsMonth",
+        "CREATE TABLE lapsDay " ROLLUP_USEC_COLUMNS,
+        "CREATE TABLE lapsMonth " ROLLUP_USEC_COLUMNS, NULL },
+      &CDbase::fillRollups },
+    { 4, "antenna id for each lap",
+      { "ALTER TABLE laps ADD COLUMN antennaId INTEGER NOT NULL DEFAULT 0", NULL },
+      &CDbase::fillRollups },
+    { 5, "lap count of each lap log, committed with the rollups",
+      { "CREATE TABLE IF NOT EXISTS lapLogMarks (directory TEXT PRIMARY KEY, lapCount INTEGER)", NULL },
+      NULL },
+};
+
+const int CDbase::migrationCount = sizeof CDbase::migrations / sizeof CDbase::migrations[0];
+
+
+
+// The laps index made by migration 3.  importLaps() drops it for big imports and builds it
+// again after, open() builds it if an import stopped in between.
+
+static const char *lapsIndexSql = "CREATE INDEX IF NOT EXISTS lapsTagIdTimeStamp ON laps (tagId, timeStampUSec)";
+
+
+
+// A statement in the statement cache, prepared once on dBase and rebound for each call
+
+class CDbaseStatement {
+public:
+    QSqlQuery query;
+    CDbaseStatementStats stats;
+};
+
+
+
+CDbaseName::CDbaseName(void) {
+    id = 0;
+}
+
+
+
+CDbaseStatementStats::CDbaseStatementStats(void) {
+    hitCount = 0;
+    prepareCount = 0;
+    execCount = 0;
+    failedExecCount = 0;
+    totalExecUsec = 0;
+    maxExecUsec = 0;
+}
 
 
 
 CDbase::CDbase() {
     dBase = QSqlDatabase::addDatabase("QSQLITE");
+    lapWriter = NULL;
+    statsPrefetcher = NULL;
+    backgroundThreads = true;
+    sessionId = 0;
+    sqliteLapStore = NULL;
+    lapLog = NULL;
+    lapStore = NULL;
+}
+
+
+
+// setLapLogDirectory
+// Keep laps in a CLapLog in directory rather than the laps table, from the next open().
+// An empty lap log is filled from the laps table when it is opened.
+//
+void CDbase::setLapLogDirectory(const QString &directory) {
+    lapLogDirectory = directory;
+}
+
+
+
+// setBackgroundThreads
+// Whether the next open() starts the lap writer and stats prefetcher, each on its own thread and
+// connection.  The command line tools turn them off: the bulk imports' long transactions on this
+// connection would keep the lap writer's from committing.  Without them addLap() fails.
+//
+void CDbase::setBackgroundThreads(bool start) {
+    backgroundThreads = start;
 }
 
 
@@ -56,7 +181,8 @@ int CDbase::open(QString filename, QString username, QString password) {
     }
 
 
-    // The second table is a list of completed laps: tagId values, timeDateInt stamp values and laptime usec values and lapdistance values
+    // The second table is a list of completed laps.  It is made in its first form, with the
+    // packed dateTime, and migrate() brings it up to date like any other database's.
 
     bool deleteLapsTable = false;
     QString tableLaps = "laps";
@@ -81,6 +207,91 @@ int CDbase::open(QString filename, QString username, QString password) {
     }
 
 
+    // Laps may be kept in a lap log instead.  Migrations read laps from it when it has
+    // any, from the laps table when it is still to be filled from there.
+
+    sqliteLapStore = new CSqliteLapStore(dBase);
+    lapStore = sqliteLapStore;
+    if (!lapLogDirectory.isEmpty()) {
+        lapLog = CLapStore::create(lapLogDirectory, dBase);
+        if (lapLog->open() != 0) {
+            errorTextVal = lapLog->errorText();
+            qDebug() << "Error opening lap log" << lapLogDirectory << ":" << errorTextVal;
+            return 8;
+        }
+        if (lapLog->lapCount() > 0)
+            lapStore = lapLog;
+    }
+
+
+    // Bring the schema up to date
+
+    int rc = migrate();
+    if (rc != 0)
+        return 5;
+    if (!query.exec(lapsIndexSql)) {
+        errorTextVal = query.lastError().text();
+        qDebug() << "Error indexing laps table:" << errorTextVal;
+        return 9;
+    }
+
+
+    // Every lap added from now on is marked with this session
+
+    query.prepare("INSERT INTO sessions (startTimeStampUSec) VALUES (:startTimeStampUSec)");
+    query.bindValue(":startTimeStampUSec", QDateTime::currentMSecsSinceEpoch() * 1000);
+    if (!query.exec()) {
+        errorTextVal = query.lastError().text();
+        qDebug() << "Error starting session:" << errorTextVal;
+        return 7;
+    }
+    sessionId = query.lastInsertId().toInt();
+
+
+    // An empty lap log is filled from the laps table the first time
+
+    if (lapLog && lapStore != lapLog) {
+        if (CLapStore::copy(sqliteLapStore, lapLog) != 0) {
+            errorTextVal = lapLog->errorText();
+            qDebug() << "Error filling lap log" << lapLogDirectory << ":" << errorTextVal;
+            return 8;
+        }
+        lapStore = lapLog;
+    }
+
+
+    // Riders are looked up in memory, the names table is read once here and kept up to date by addTagId etc
+
+    if (loadNames() != 0)
+        return 6;
+
+
+    // Laps are written by CLapWriter on its own thread and connection, in batches
+
+    if (backgroundThreads && !lapWriter) {
+        lapWriter = new CLapWriter(filename, lapLogDirectory);
+        QThread *lapWriterThread = new QThread();
+        lapWriter->moveToThread(lapWriterThread);
+        lapWriter->thread = lapWriterThread;
+        QObject::connect(lapWriterThread, SIGNAL(started(void)), lapWriter, SLOT(onStarted(void)));
+        lapWriterThread->start();
+    }
+
+
+    // Riders' stats are loaded ahead of their first crossing by CStatsPrefetcher, on its own
+    // thread and connection, and reloaded whenever the lap writer commits their laps
+
+    if (backgroundThreads && !statsPrefetcher) {
+        statsPrefetcher = new CStatsPrefetcher(filename);
+        QThread *statsPrefetcherThread = new QThread();
+        statsPrefetcher->moveToThread(statsPrefetcherThread);
+        statsPrefetcher->thread = statsPrefetcherThread;
+        QObject::connect(statsPrefetcherThread, SIGNAL(started(void)), statsPrefetcher, SLOT(onStarted(void)));
+        QObject::connect(lapWriter, SIGNAL(lapsCommitted(QList<QByteArray>)), statsPrefetcher, SLOT(onLapsCommitted(QList<QByteArray>)), Qt::DirectConnection);
+        statsPrefetcherThread->start();
+    }
+
+
     bool showLaps = false;
     if (showLaps) {
         qDebug() << "List of lap info in laps table...";
@@ -93,13 +304,13 @@ int CDbase::open(QString filename, QString username, QString password) {
         }
         int id = queryLaps.record().indexOf("id");
         int idTagId = queryLaps.record().indexOf("tagId");
-        int idDateTime = queryLaps.record().indexOf("dateTime");
+        int idTimeStamp = queryLaps.record().indexOf("timeStampUSec");
         int idLapmsec = queryLaps.record().indexOf("lapmsec");
         int idLapm = queryLaps.record().indexOf("lapm");
         while (queryLaps.next()) {
             int lapmsec = queryLaps.value(idLapmsec).toInt();
             float lapm = queryLaps.value(idLapm).toFloat();
-            qDebug("id=%d tagId=%s dateTime=%d lapmsec=%d lapm=%f", queryLaps.value(id).toInt(), queryLaps.value(idTagId).toString().toLatin1().data(), queryLaps.value(idDateTime).toInt(), lapmsec, lapm);
+            qDebug("id=%d tagId=%s timeStampUSec=%lld lapmsec=%d lapm=%f", queryLaps.value(id).toInt(), queryLaps.value(idTagId).toString().toLatin1().data(), queryLaps.value(idTimeStamp).toLongLong(), lapmsec, lapm);
         }
     }
 
@@ -108,12 +319,207 @@ int CDbase::open(QString filename, QString username, QString password) {
 
 
 
+// migrate
+// Apply the migrations newer than the database's user_version, each in its own transaction.  Only
+// the last of their functions runs.  Return 0 on success.
+//
+int CDbase::migrate(void) {
+    int version = schemaVersion();
+    if (version < 0)
+        return 1;
+
+    int latestVersion = migrations[migrationCount - 1].version;
+    if (version > latestVersion) {
+        qDebug() << "Database schema version" << version << "is newer than this program's" << latestVersion;
+        return 0;
+    }
+
+    // A migration function is today's code, written for the latest schema, and rebuilds what it
+    // fills from scratch, so only the last pending one runs, after the tables it reads are migrated
+
+    int lastFunction = -1;
+    for (int i=0; i<migrationCount; i++)
+        if (migrations[i].version > version && migrations[i].function)
+            lastFunction = i;
+
+    for (int i=0; i<migrationCount; i++) {
+        const CDbaseMigration &migration = migrations[i];
+        if (migration.version <= version)
+            continue;
+
+        QElapsedTimer migrationTimer;
+        migrationTimer.start();
+        if (!dBase.transaction()) {
+            errorTextVal = dBase.lastError().text();
+            qDebug() << errorTextVal;
+            return 2;
+        }
+        QSqlQuery query;
+        for (int j=0; migration.statements[j]; j++) {
+            if (!query.exec(migration.statements[j])) {
+                errorTextVal = "Error in schema migration " + QString::number(migration.version) + ": " + query.lastError().text();
+                qDebug() << errorTextVal;
+                dBase.rollback();
+                return 3;
+            }
+        }
+        if (i == lastFunction && (this->*migration.function)() != 0) {
+            qDebug() << "Error in schema migration" << migration.version << ":" << errorTextVal;
+            dBase.rollback();
+            return 5;
+        }
+        if (!query.exec("PRAGMA user_version = " + QString::number(migration.version)) || !dBase.commit()) {
+            errorTextVal = "Error in schema migration " + QString::number(migration.version) + ": " + dBase.lastError().text();
+            qDebug() << errorTextVal;
+            dBase.rollback();
+            return 4;
+        }
+        version = migration.version;
+        qDebug() << "Migrated database schema to version" << version << "(" << migration.description << ") in" << migrationTimer.elapsed() << "msec";
+    }
+    return 0;
+}
+
+
+
+// schemaVersion
+// Return the database's schema version, -1 on error
+//
+int CDbase::schemaVersion(void) {
+    if (!dBase.isOpen())
+        return -1;
+
+    QSqlQuery query;
+    if (!query.exec("PRAGMA user_version") || !query.next()) {
+        errorTextVal = query.lastError().text();
+        qDebug() << errorTextVal;
+        return -1;
+    }
+    return query.value(0).toInt();
+}
+
+
+
 void CDbase::close(void) {
+
+    // Stop the lap writer first, it commits any laps still queued
+
+    if (lapWriter) {
+        lapWriter->stop();
+        lapWriter->thread->wait();
+        CLapWriterStats stats = lapWriter->getStats();
+        qDebug("Lap writer: %lld laps in %lld commits, %lld failed, %lld laps lost%s, max queue %d, commit msec avg %lld max %d",
+               stats.lapCount, stats.commitCount, stats.failedCommitCount, stats.lostLapCount,
+               stats.writerFailed ? " (gave up)" : "", stats.maxQueueDepth,
+               stats.commitCount ? stats.totalCommitMsec / stats.commitCount : 0LL, stats.maxCommitMsec);
+        delete lapWriter->thread;
+        delete lapWriter;
+        lapWriter = NULL;
+    }
+
+    // The prefetcher after the writer, whose last commits call it
+
+    if (statsPrefetcher) {
+        statsPrefetcher->stop();
+        statsPrefetcher->thread->wait();
+        delete statsPrefetcher->thread;
+        delete statsPrefetcher;
+        statsPrefetcher = NULL;
+    }
+
+    // Cached statements belong to the connection, they go before it does
+
+    QList<CDbaseStatementStats> statementStats;
+    getStatementStats(&statementStats);
+    for (int i=0; i<statementStats.size(); i++) {
+        const CDbaseStatementStats &stats = statementStats[i];
+        qDebug("Statement: %lld hits %lld prepares %lld execs %lld failed, exec usec avg %lld max %d, %.0f/sec: %s",
+               stats.hitCount, stats.prepareCount, stats.execCount, stats.failedExecCount,
+               stats.execCount ? stats.totalExecUsec / stats.execCount : 0LL, stats.maxExecUsec,
+               stats.totalExecUsec ? stats.execCount * 1000000. / stats.totalExecUsec : 0., stats.sql.toLatin1().data());
+    }
+    delete lapLog;
+    delete sqliteLapStore;
+    lapStore = NULL;
+    lapLog = NULL;
+    sqliteLapStore = NULL;
+    clearStatements();
+    names.clear();
     dBase.close();
 }
 
 
 
+// statement
+// The prepared statement for sql from the statement cache, preparing it on first use.
+// Bind values and run it with execStatement(), call query.finish() when done reading
+// so SQLite isn't left holding the read.  Return NULL if it doesn't prepare.
+//
+CDbaseStatement *CDbase::statement(const char *sql) {
+    QString key(sql);
+    CDbaseStatement *cached = statements.value(key);
+    if (cached) {
+        cached->stats.hitCount++;
+        return cached;
+    }
+
+    CDbaseStatement *added = new CDbaseStatement;
+    added->query = QSqlQuery(dBase);
+    added->query.setForwardOnly(true);
+    added->stats.sql = key;
+    added->stats.prepareCount++;
+    if (!added->query.prepare(key)) {
+        errorTextVal = added->query.lastError().text();
+        qDebug() << errorTextVal;
+        delete added;
+        return NULL;
+    }
+    statements.insert(key, added);
+    return added;
+}
+
+
+
+// execStatement
+// exec() a cached statement and time it.  Return true on success.
+//
+bool CDbase::execStatement(CDbaseStatement *statement) {
+    QElapsedTimer execTimer;
+    execTimer.start();
+    bool ok = statement->query.exec();
+    int execUsec = execTimer.nsecsElapsed() / 1000;
+
+    statement->stats.execCount++;
+    if (!ok)
+        statement->stats.failedExecCount++;
+    statement->stats.totalExecUsec += execUsec;
+    if (execUsec > statement->stats.maxExecUsec)
+        statement->stats.maxExecUsec = execUsec;
+    return ok;
+}
+
+
+
+void CDbase::clearStatements(void) {
+    qDeleteAll(statements);
+    statements.clear();
+}
+
+
+
+// getStatementStats
+// Hit counts and exec times of the cached statements, for lookups and inserts per second
+//
+int CDbase::getStatementStats(QList<CDbaseStatementStats> *stats) {
+    stats->clear();
+    QHash<QString, CDbaseStatement *>::const_iterator i;
+    for (i = statements.constBegin(); i != statements.constEnd(); ++i)
+        stats->append(i.value()->stats);
+    return 0;
+}
+
+
+
 QString CDbase::errorText(void) {
     return errorTextVal;
 }
@@ -132,15 +538,23 @@ bool CDbase::isOpen(void) {
 int CDbase::addTagId(const QByteArray &tagId, const QString &firstName, const QString &lastName) {
     if (!dBase.isOpen()) return 1;
 
-    QSqlQuery query;
-    query.prepare("INSERT INTO names (tagId, firstName, lastName) VALUES (:tagId, :firstName, :lastName)");
+    CDbaseStatement *insert = statement("INSERT INTO names (tagId, firstName, lastName) VALUES (:tagId, :firstName, :lastName)");
+    if (!insert) return 2;
+    QSqlQuery &query = insert->query;
     query.bindValue(":tagId", tagId);
     query.bindValue(":firstName", firstName);
     query.bindValue(":lastName", lastName);
-    if (!query.exec()) {
+    if (!execStatement(insert)) {
         errorTextVal = "Could not add to database";
         return 2;
     }
+
+    CDbaseName name;
+    name.id = query.lastInsertId().toInt();
+    name.tagId = tagId;
+    name.firstName = firstName;
+    name.lastName = lastName;
+    names.insert(tagId, name);
     return 0;
 }
 
@@ -151,21 +565,30 @@ int CDbase::addTagId(const QByteArray &tagId, const QString &firstName, const QS
 int CDbase::updateTagId(const QByteArray &tagId, const QString &firstName, const QString &lastName) {
     if (!dBase.isOpen()) return 1;
 
-    QSqlQuery query;
-    query.prepare("UPDATE names SET firstName = :firstName WHERE tagId = :tagId");
-    query.bindValue(":tagId", tagId);
-    query.bindValue(":firstName", firstName);
-    if (!query.exec()) {
+    CDbaseStatement *updateFirst = statement("UPDATE names SET firstName = :firstName WHERE tagId = :tagId");
+    CDbaseStatement *updateLast = statement("UPDATE names SET lastName = :lastName WHERE tagId = :tagId");
+    if (!updateFirst || !updateLast) {
         errorTextVal = "Could not update database";
         return 2;
     }
-    query.prepare("UPDATE names SET lastName = :lastName WHERE tagId = :tagId");
-    query.bindValue(":tagId", tagId);
-    query.bindValue(":lastName", lastName);
-    if (!query.exec()) {
+    updateFirst->query.bindValue(":tagId", tagId);
+    updateFirst->query.bindValue(":firstName", firstName);
+    if (!execStatement(updateFirst)) {
+        errorTextVal = "Could not update database";
+        return 2;
+    }
+    updateLast->query.bindValue(":tagId", tagId);
+    updateLast->query.bindValue(":lastName", lastName);
+    if (!execStatement(updateLast)) {
         errorTextVal = "Could not update database";
         return 3;
     }
+
+    QHash<QByteArray, CDbaseName>::iterator name = names.find(tagId);
+    if (name != names.end()) {
+        name->firstName = firstName;
+        name->lastName = lastName;
+    }
     return 0;
 }
 
@@ -176,14 +599,16 @@ int CDbase::updateTagId(const QByteArray &tagId, const QString &firstName, const
 int CDbase::removeTagId(const QByteArray &tagId) {
     if (!dBase.isOpen()) return 1;
 
-    QSqlQuery query;
-    query.prepare("DELETE FROM names WHERE tagId = (:tagId)");
+    CDbaseStatement *remove = statement("DELETE FROM names WHERE tagId = (:tagId)");
+    if (!remove) return 2;
+    QSqlQuery &query = remove->query;
     query.bindValue(":tagId", tagId);
-    if (!query.exec()) {
+    if (!execStatement(remove)) {
         errorTextVal = query.lastError().text();
         qDebug() << errorTextVal;
         return 2;
     }
+    names.remove(tagId);
     return 0;
 }
 
@@ -192,23 +617,27 @@ int CDbase::removeTagId(const QByteArray &tagId) {
 int CDbase::findTagIdFromName(const QString &firstName, const QString &lastName, QByteArray *tagId) {
     if (!dBase.isOpen()) return 1;
 
-    QSqlQuery query;
+    CDbaseStatement *select;
     if (!lastName.isEmpty() && !firstName.isEmpty()) {
-        query.prepare("SELECT tagId FROM names WHERE lastName = (:lastName) AND firstName = (:firstName)");
-        query.bindValue(":lastName", lastName);
-        query.bindValue(":firstName", firstName);
+        select = statement("SELECT tagId FROM names WHERE lastName = (:lastName) AND firstName = (:firstName)");
+        if (!select) return 3;
+        select->query.bindValue(":lastName", lastName);
+        select->query.bindValue(":firstName", firstName);
     }
     else if (!lastName.isEmpty()) {
-        query.prepare("SELECT tagId FROM names WHERE lastName = (:lastName)");
-        query.bindValue(":lastName", lastName);
+        select = statement("SELECT tagId FROM names WHERE lastName = (:lastName)");
+        if (!select) return 3;
+        select->query.bindValue(":lastName", lastName);
     }
     else if (!firstName.isEmpty()) {
-        query.prepare("SELECT tagId FROM names WHERE firstName = (:firstName)");
-        query.bindValue(":firstName", firstName);
+        select = statement("SELECT tagId FROM names WHERE firstName = (:firstName)");
+        if (!select) return 3;
+        select->query.bindValue(":firstName", firstName);
     }
     else return 2;
 
-    if (!query.exec()) {
+    QSqlQuery &query = select->query;
+    if (!execStatement(select)) {
         errorTextVal = query.lastError().text();
         qDebug() << errorTextVal;
         return 3;
@@ -216,6 +645,7 @@ int CDbase::findTagIdFromName(const QString &firstName, const QString &lastName,
 
     if (query.next()) {
         *tagId = query.value(0).toString().toLatin1();
+        query.finish();
         errorTextVal.clear();
         return 0;
     }
@@ -231,23 +661,27 @@ int CDbase::findTagIdFromName(const QString &firstName, const QString &lastName,
 int CDbase::getIdFromName(const QString &firstName, const QString &lastName) {
     if (!dBase.isOpen()) return 0;
 
-    QSqlQuery query;
+    CDbaseStatement *select;
     if (!lastName.isEmpty() && !firstName.isEmpty()) {
-        query.prepare("SELECT id FROM names WHERE lastName = (:lastName) AND firstName = (:firstName)");
-        query.bindValue(":lastName", lastName);
-        query.bindValue(":firstName", firstName);
+        select = statement("SELECT id FROM names WHERE lastName = (:lastName) AND firstName = (:firstName)");
+        if (!select) return 0;
+        select->query.bindValue(":lastName", lastName);
+        select->query.bindValue(":firstName", firstName);
     }
     else if (!lastName.isEmpty()) {
-        query.prepare("SELECT id FROM names WHERE lastName = (:lastName)");
-        query.bindValue(":lastName", lastName);
+        select = statement("SELECT id FROM names WHERE lastName = (:lastName)");
+        if (!select) return 0;
+        select->query.bindValue(":lastName", lastName);
     }
     else if (!firstName.isEmpty()) {
-        query.prepare("SELECT id FROM names WHERE firstName = (:firstName)");
-        query.bindValue(":firstName", firstName);
+        select = statement("SELECT id FROM names WHERE firstName = (:firstName)");
+        if (!select) return 0;
+        select->query.bindValue(":firstName", firstName);
     }
     else return 0;
 
-    if (!query.exec()) {
+    QSqlQuery &query = select->query;
+    if (!execStatement(select)) {
         errorTextVal = query.lastError().text();
         qDebug() << errorTextVal;
         return 0;
@@ -256,6 +690,7 @@ int CDbase::getIdFromName(const QString &firstName, const QString &lastName) {
     int id = 0;
     if (query.next()) {
         id = query.value(0).toInt();
+        query.finish();
         errorTextVal.clear();
         return id;
     }
@@ -268,10 +703,11 @@ int CDbase::getAllFromId(int id, QByteArray *tagId, QString *firstName, QString
     if (!dBase.isOpen())
         return 1;
 
-    QSqlQuery query;
-    query.prepare("SELECT * FROM names WHERE id = (:id)");
+    CDbaseStatement *select = statement("SELECT * FROM names WHERE id = (:id)");
+    if (!select) return 2;
+    QSqlQuery &query = select->query;
     query.bindValue(":id", id);
-    if (!query.exec()) {
+    if (!execStatement(select)) {
         errorTextVal = query.lastError().text();
         qDebug() << errorTextVal;
         return 2;
@@ -290,6 +726,7 @@ int CDbase::getAllFromId(int id, QByteArray *tagId, QString *firstName, QString
         *tagId = query.value(tagIdIndex).toString().toLatin1();
         *firstName = query.value(firstNameIndex).toString();
         *lastName = query.value(lastNameIndex).toString();
+        query.finish();
         errorTextVal.clear();
         return 0;
     }
@@ -299,30 +736,17 @@ int CDbase::getAllFromId(int id, QByteArray *tagId, QString *firstName, QString
 
 
 
+// findNameFromTagId
+// From the rider directory, no database access
+//
 int CDbase::findNameFromTagId(const QByteArray &tagId, QString *firstName, QString *lastName) {
     if (!dBase.isOpen())
         return 1;
 
-    QSqlQuery query;
-    query.prepare("SELECT * FROM names WHERE tagId = (:tagId)");
-    query.bindValue(":tagId", tagId);
-    if (!query.exec()) {
-        errorTextVal = query.lastError().text();
-        qDebug() << errorTextVal;
-        return 1;
-    }
-
-    int firstNameIndex = query.record().indexOf("firstName");
-    int lastNameIndex = query.record().indexOf("lastName");
-    if ((firstNameIndex < 0) || (lastNameIndex < 0)) {
-        errorTextVal = "Could not find index";
-        qDebug() << errorTextVal;
-        return 2;
-    }
-
-    if (query.next()) {
-        *firstName = query.value(firstNameIndex).toString();
-        *lastName = query.value(lastNameIndex).toString();
+    QHash<QByteArray, CDbaseName>::const_iterator name = names.constFind(tagId);
+    if (name != names.constEnd()) {
+        *firstName = name->firstName;
+        *lastName = name->lastName;
         errorTextVal.clear();
         return 0;
     }
@@ -335,17 +759,42 @@ int CDbase::namesRowCount(void) {
     if (!dBase.isOpen())
         return -1;
 
+    return names.size();
+}
+
+
+
+// getNames
+// The rider directory: every row of the names table, by tagId
+//
+const QHash<QByteArray, CDbaseName> &CDbase::getNames(void) {
+    return names;
+}
+
+
+
+// loadNames
+// Fill the rider directory from the names table.  Return 0 on success.
+//
+int CDbase::loadNames(void) {
+    names.clear();
+
     QSqlQuery query;
-    query.prepare("SELECT Count(*) FROM names");
-    if (!query.exec()) {
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT id, tagId, firstName, lastName FROM names")) {
         errorTextVal = query.lastError().text();
-        return -1;
+        qDebug() << errorTextVal;
+        return 1;
     }
-
-    if (query.next()) {
-        int count = query.value(0).toInt();
-        return count;
+    while (query.next()) {
+        CDbaseName name;
+        name.id = query.value(0).toInt();
+        name.tagId = query.value(1).toString().toLatin1();
+        name.firstName = query.value(2).toString();
+        name.lastName = query.value(3).toString();
+        names.insert(name.tagId, name);
     }
+    qDebug() << "Loaded" << names.size() << "riders from names table";
     return 0;
 }
 
@@ -358,10 +807,11 @@ int CDbase::getTagIdAndName(int id, QByteArray *tagId, QString *firstName, QStri
     if (!dBase.isOpen())
         return 1;
 
-    QSqlQuery query;
-    query.prepare("SELECT * FROM names WHERE id = (:id)");
+    CDbaseStatement *select = statement("SELECT * FROM names WHERE id = (:id)");
+    if (!select) return 2;
+    QSqlQuery &query = select->query;
     query.bindValue(":id", id);
-    if (!query.exec()) {
+    if (!execStatement(select)) {
         errorTextVal = query.lastError().text();
         qDebug() << errorTextVal;
         return 1;
@@ -380,6 +830,7 @@ int CDbase::getTagIdAndName(int id, QByteArray *tagId, QString *firstName, QStri
         *tagId = query.value(tagIdIndex).toString().toLatin1();
         *firstName = query.value(firstNameIndex).toString();
         *lastName = query.value(lastNameIndex).toString();
+        query.finish();
         errorTextVal.clear();
         return 0;
     }
@@ -391,21 +842,24 @@ int CDbase::getTagIdAndName(int id, QByteArray *tagId, QString *firstName, QStri
 
 
 // addLap
-// Add entry to laps database
+// Add entry to laps database, timeStampUSec is the reader's timestamp for the crossing in usec since
+// the epoch.  The lap is queued for the lap writer thread, so it is in the table within the writer's
+// batch interval, not on return.
 //
-int CDbase::addLap(const QByteArray &tagId, int year, int month, int day, int hour, int minute, int second, int lapmsec, float lapm) {
-    if (!dBase.isOpen())
+int CDbase::addLap(const QByteArray &tagId, int readerId, int antennaId, long long timeStampUSec, int lapmsec, float lapm) {
+    if (!dBase.isOpen() || !lapWriter)
         return 1;
 
-    unsigned int dateTime = dateTime2Int(year, month, day, hour, minute, second);
-    //qDebug() << "addLap" << dateTime << year << month << day << hour << minute << second << lapmsec << lapm;
-    QSqlQuery query;
-    query.prepare("INSERT INTO laps (tagId, dateTime, lapmsec, lapm) VALUES (:tagId, :dateTime, :lapmsec, :lapm)");
-    query.bindValue(":tagId", tagId);
-    query.bindValue(":dateTime", dateTime);
-    query.bindValue(":lapmsec", lapmsec);
-    query.bindValue(":lapm", lapm);
-    if (!query.exec()) {
+    CLapRecord lap;
+    lap.tagId = tagId;
+    lap.timeStampUSec = timeStampUSec;
+    lap.sessionId = sessionId;
+    lap.readerId = readerId;
+    lap.antennaId = antennaId;
+    lap.lapmsec = lapmsec;
+    lap.lapm = lapm;
+    //qDebug() << "addLap" << lap.timeStampUSec << readerId << lapmsec << lapm;
+    if (lapWriter->addLap(lap) != 0) {
         errorTextVal = "Could not add to laps table";
         qDebug() << errorTextVal;
         return 1;
@@ -415,6 +869,19 @@ int CDbase::addLap(const QByteArray &tagId, int year, int month, int day, int ho
 
 
 
+// getLapWriterStats
+// Queue depth and commit latency of the lap writer
+//
+int CDbase::getLapWriterStats(CLapWriterStats *stats) {
+    if (!lapWriter)
+        return 1;
+
+    *stats = lapWriter->getStats();
+    return 0;
+}
+
+
+
 
 
 // Calculate stats for specified rider (tagId) from dbase entries and populate CRider
@@ -423,129 +890,335 @@ int CDbase::getStats(const QByteArray &tagId, CRider *rider) {
     if (!dBase.isOpen())
         return 1;
 
-    int thisMonthYear = QDateTime::currentDateTime().date().year();
-    int thisMonthMonth = QDateTime::currentDateTime().date().month();
-    QDateTime lastMonthDateTime(QDateTime::currentDateTime().addMonths(-1));
-    int lastMonthYear = lastMonthDateTime.date().year();
-    int lastMonthMonth = lastMonthDateTime.date().month();
-
     rider->thisMonth.clear();
     rider->lastMonth.clear();
     rider->allTime.clear();
 
-    // Get stats for this month
+    // Stats come from the lapsMonth rollup, a row per month the rider has laps
+
+    CDbaseStatement *select = statement(riderMonthsSql);
+    if (!select) return 2;
+    QSqlQuery &query = select->query;
+    query.bindValue(":tagId", tagId);
+    if (!execStatement(select)) {
+        errorTextVal = query.lastError().text();
+        qDebug() << errorTextVal;
+        return 2;
+    }
+    statsFromMonths(query, &rider->thisMonth, &rider->lastMonth, &rider->allTime);
+    query.finish();
+
+    return 0;
+}
+
 
-    unsigned int dateTimeStart = dateTime2Int(thisMonthYear, thisMonthMonth, 0);
-    unsigned int dateTimeEnd = dateTime2Int(thisMonthYear, thisMonthMonth, 31);
 
-    getStatsForPeriod(tagId, dateTimeStart, dateTimeEnd, &rider->thisMonth);
+// The rider's lapsMonth rows for statsFromMonths()
 
+const char *CDbase::riderMonthsSql = "SELECT period, lapCount, lapmsec, lapm, bestLapmsec, bestLapm, workoutCount, continuedWorkout, "
+                                     "lastTimeStampUSec "
+                                     "FROM lapsMonth WHERE tagId = :tagId ORDER BY period";
 
-    // Get stats for last month
 
-    dateTimeStart = dateTime2Int(lastMonthYear, lastMonthMonth, 0);
-    dateTimeEnd = dateTime2Int(lastMonthYear, lastMonthMonth, 31);
 
-    getStatsForPeriod(tagId, dateTimeStart, dateTimeEnd, &rider->lastMonth);
+// statsFromMonths
+// This month's, last month's and all time stats from the rows of riderMonthsSql, already run on query.
+// Used by getStats() and by the stats prefetcher on its own connection.  lastTimeStampUSec, if given, is
+// set to the timestamp of the latest lap the stats count, 0 if none.
+//
+void CDbase::statsFromMonths(QSqlQuery &query, CStats *thisMonthStats, CStats *lastMonthStats, CStats *allTimeStats, long long *lastTimeStampUSec) {
+    long long thisMonth = CLapRollup::monthOf(QDateTime::currentMSecsSinceEpoch() * 1000);
+    long long lastMonth = CLapRollup::monthOf(thisMonth - 1);
 
+    CLapRollup thisMonthRollup;
+    CLapRollup lastMonthRollup;
+    CLapRollup allTimeRollup;
+    while (query.next()) {
+        long long period = query.value(0).toLongLong();
+        if (period > thisMonth)
+            break;
+        CLapRollup month;
+        month.lapCount = query.value(1).toInt();
+        month.lapmsec = query.value(2).toLongLong();
+        month.lapm = query.value(3).toDouble();
+        month.bestLapmsec = query.value(4).toInt();
+        month.bestLapm = query.value(5).toFloat();
+        month.workoutCount = query.value(6).toInt();
+        month.continuedWorkout = query.value(7).toInt();
+        month.lastTimeStampUSec = query.value(8).toLongLong();
+        allTimeRollup.addRollup(month);
+        if (period == thisMonth)
+            thisMonthRollup.addRollup(month);
+        else if (period == lastMonth)
+            lastMonthRollup.addRollup(month);
+    }
+    thisMonthRollup.toStats(thisMonthStats);
+    lastMonthRollup.toStats(lastMonthStats);
+    allTimeRollup.toStats(allTimeStats);
+    if (lastTimeStampUSec)
+        *lastTimeStampUSec = allTimeRollup.lastTimeStampUSec;
+}
 
-    // Get stats for all time
 
-    int allTimeYear = 2000;     // min value is 2000
-    int allTimeMonth = 0;
-    dateTimeStart = dateTime2Int(allTimeYear, allTimeMonth, 0);
-    dateTimeEnd = dateTime2Int(thisMonthYear, thisMonthMonth, 31);
 
-    getStatsForPeriod(tagId, dateTimeStart, dateTimeEnd, &rider->allTime);
+// prefetchStats
+// Have the stats prefetcher load the rider's stats in the background, say when they sign in at the desk
+//
+int CDbase::prefetchStats(const QByteArray &tagId) {
+    if (!statsPrefetcher)
+        return 1;
 
+    statsPrefetcher->request(tagId);
     return 0;
 }
 
 
 
-// Get stats for specified tagId and time period from dbase
+// getPrefetchedStats
+// Set the rider's thisMonth, lastMonth and allTime from the stats prefetcher without touching the
+// database, and lastTimeStampUSec if given to the latest lap they count.  Return false if it hasn't
+// loaded them, prefetchStats() them and wait for statsReady().
+//
+bool CDbase::getPrefetchedStats(const QByteArray &tagId, CRider *rider, long long *lastTimeStampUSec) {
+    CRiderStats stats;
+    if (!statsPrefetcher || !statsPrefetcher->getStats(tagId, &stats))
+        return false;
+
+    rider->thisMonth = stats.thisMonth;
+    rider->lastMonth = stats.lastMonth;
+    rider->allTime = stats.allTime;
+    if (lastTimeStampUSec)
+        *lastTimeStampUSec = stats.lastTimeStampUSec;
+    return true;
+}
+
+
+
+// getStatsPrefetcher
+// For connecting to statsReady(), NULL when the database isn't open
+//
+CStatsPrefetcher *CDbase::getStatsPrefetcher(void) {
+    return statsPrefetcher;
+}
+
+
+
+// Get stats for specified tagId and time period from dbase, laps from timeStampUSecStart up to
+// but not including timeStampUSecEnd, both usec since the epoch
 //
-int CDbase::getStatsForPeriod(const QByteArray &tagId, unsigned int dateTimeStart, unsigned int dateTimeEnd, CStats *stats) {
+int CDbase::getStatsForPeriod(const QByteArray &tagId, long long timeStampUSecStart, long long timeStampUSecEnd, CStats *stats) {
+    return getStatsForPeriods(tagId, &timeStampUSecStart, &timeStampUSecEnd, 1, stats);
+}
+
+
+
+// getStatsForPeriods
+// Stats for periodCount periods (timeStampUSecStart[i] up to timeStampUSecEnd[i], periods may overlap) from one
+// pass over the laps of all of them in time order.  stats[i] gets period i.  The laps table adds them up in one
+// SELECT, see getStatsForPeriodsSql(), other lap stores are scanned.
+//
+int CDbase::getStatsForPeriods(const QByteArray &tagId, const long long *timeStampUSecStart, const long long *timeStampUSecEnd, int periodCount, CStats *stats) {
     if (!dBase.isOpen())
         return 1;
 
-    if (dateTimeStart > dateTimeEnd)
-        throw("dateTimeStart > dateTimeEnd in getStatsForPeriod");
+    if (periodCount < 1)
+        return 0;
 
+    long long unionStart = timeStampUSecStart[0];
+    long long unionEnd = timeStampUSecEnd[0];
+    for (int i=0; i<periodCount; i++) {
+        if (timeStampUSecStart[i] > timeStampUSecEnd[i])
+            throw("timeStampUSecStart > timeStampUSecEnd in getStatsForPeriods");
+        if (timeStampUSecStart[i] < unionStart) unionStart = timeStampUSecStart[i];
+        if (timeStampUSecEnd[i] > unionEnd) unionEnd = timeStampUSecEnd[i];
+    }
 
-    // Determine minimum time difference in dateTimeInt that separates workouts
+    if (lapStore == sqliteLapStore && !tagId.isEmpty())
+        return getStatsForPeriodsSql(tagId, timeStampUSecStart, timeStampUSecEnd, periodCount, unionStart, unionEnd, stats);
 
-    int workoutDateTimeSeparation = dateTime2Int(2000,0,0,12,0,0) - dateTime2Int(2000,0,0,0,0,0);
+    CLapColumns laps;
+    if (lapStore->scan(tagId, unionStart, unionEnd, &laps) != 0) {
+        errorTextVal = lapStore->errorText();
+        return 1;
+    }
+    errorTextVal.clear();
 
-    QSqlQuery query;
-    query.prepare("SELECT * FROM laps WHERE tagId = :tagId AND dateTime BETWEEN :dateTimeStart AND :dateTimeEnd");
+    QVector<CLapRollup> periods(periodCount);
+    bool havePrevious = false;
+    long long previousTimeStampUSec = 0;
+    for (int lap=0; lap<laps.size(); lap++) {
+        long long timeStampUSec = laps.timeStampUSec[lap];
+        int lapmsec = laps.lapmsec[lap];
+        float lapm = laps.lapm[lap];
+
+        // A workout starts with the rider's first lap in the period, or a lap more than 12 hours after the one before
+
+        for (int i=0; i<periodCount; i++) {
+            if (timeStampUSec < timeStampUSecStart[i] || timeStampUSec >= timeStampUSecEnd[i])
+                continue;
+            bool previousInPeriod = havePrevious && previousTimeStampUSec >= timeStampUSecStart[i];
+            periods[i].addLap(timeStampUSec, lapmsec, lapm, CLapRollup::isNewWorkout(previousInPeriod, previousTimeStampUSec, timeStampUSec));
+        }
+        havePrevious = true;
+        previousTimeStampUSec = timeStampUSec;
+    }
+
+    for (int i=0; i<periodCount; i++)
+        periods[i].toStats(&stats[i]);
+
+    return 0;
+}
+
+
+
+// getStatsForPeriodsSql
+// getStatsForPeriods() for the laps table: one SELECT adds up every period over the rider's laps from
+// unionStart up to unionEnd, so only a row per period with laps comes back.  A workout starts at a lap
+// when the lap before is outside the period or more than CLapRollup::workoutSeparationUSec before it,
+// as CLapRollup::isNewWorkout() has it.  The best lap is the earliest of the fastest: MIN() of lapmsec
+// then position in time order, and SQLite takes the bare lapm column from the row MIN() picks.  The CROSS
+// JOIN keeps periods the outer loop, riderLaps is worked out once and scanned in memory for each period.
+//
+int CDbase::getStatsForPeriodsSql(const QByteArray &tagId, const long long *timeStampUSecStart, const long long *timeStampUSecEnd,
+                                  int periodCount, long long unionStart, long long unionEnd, CStats *stats) {
+    QByteArray periods;
+    for (int i=0; i<periodCount; i++) {
+        QByteArray p = QByteArray::number(i);
+        periods += QByteArray(i ? ", " : "") + "(" + p + ", :start" + p + ", :end" + p + ")";
+    }
+    QByteArray sql = "WITH periods (period, periodStart, periodEnd) AS (VALUES " + periods + "), "
+                     "riderLaps AS (SELECT timeStampUSec, lapmsec, lapm, LAG(timeStampUSec) OVER byTime AS previousTimeStampUSec, "
+                     "ROW_NUMBER() OVER byTime AS position FROM laps "
+                     "WHERE tagId = :tagId AND timeStampUSec >= :start AND timeStampUSec < :end "
+                     "WINDOW byTime AS (ORDER BY timeStampUSec, id)) "
+                     "SELECT period, COUNT(*), SUM(lapmsec), TOTAL(lapm), "
+                     "SUM(previousTimeStampUSec IS NULL OR previousTimeStampUSec < periodStart OR "
+                     "timeStampUSec - previousTimeStampUSec > " + QByteArray::number(CLapRollup::workoutSeparationUSec) + "), "
+                     "MIN(lapmsec * 4294967296 + position), lapm "
+                     "FROM periods CROSS JOIN riderLaps WHERE timeStampUSec >= periodStart AND timeStampUSec < periodEnd GROUP BY period";
+
+    CDbaseStatement *select = statement(sql.constData());
+    if (!select) return 2;
+    QSqlQuery &query = select->query;
     query.bindValue(":tagId", tagId);
-    query.bindValue(":dateTimeStart", dateTimeStart);
-    query.bindValue(":dateTimeEnd", dateTimeEnd);
-    if (!query.exec()) {
-        errorTextVal = query.lastError().text();
-        qDebug() << errorTextVal;
-        return 1;
+    query.bindValue(":start", unionStart);
+    query.bindValue(":end", unionEnd);
+    for (int i=0; i<periodCount; i++) {
+        query.bindValue(":start" + QString::number(i), timeStampUSecStart[i]);
+        query.bindValue(":end" + QString::number(i), timeStampUSecEnd[i]);
     }
-    int lapmsecIndex = query.record().indexOf("lapmsec");
-    if (lapmsecIndex < 0) {
-        errorTextVal = "Could not find lapmsec index in getStats";
+    if (!execStatement(select)) {
+        errorTextVal = query.lastError().text();
         qDebug() << errorTextVal;
         return 2;
     }
-    int lapmIndex = query.record().indexOf("lapm");
-    if (lapmIndex < 0) {
-        errorTextVal = "Could not find lapm index in getStats";
-        qDebug() << errorTextVal;
-        return 2;
+    errorTextVal.clear();
+
+    QVector<CLapRollup> rollups(periodCount);
+    while (query.next()) {
+        CLapRollup &period = rollups[query.value(0).toInt()];
+        period.lapCount = query.value(1).toInt();
+        period.lapmsec = query.value(2).toLongLong();
+        period.lapm = query.value(3).toDouble();
+        period.workoutCount = query.value(4).toInt();
+        period.bestLapmsec = query.value(5).toLongLong() >> 32;
+        period.bestLapm = query.value(6).toFloat();
     }
-    int dateTimeIndex = query.record().indexOf("dateTime");
-    if (dateTimeIndex < 0) {
-        errorTextVal = "Could not find dateTime index in getStatus";
+    query.finish();
+    for (int i=0; i<periodCount; i++)
+        rollups[i].toStats(&stats[i]);
+    return 0;
+}
+
+
+
+// getStatsFromLaps
+// What getStats gives, worked out from the laps in one scan rather than from the lapsMonth rollup.
+//
+int CDbase::getStatsFromLaps(const QByteArray &tagId, CRider *rider) {
+    if (!dBase.isOpen())
+        return 1;
+
+    long long now = QDateTime::currentMSecsSinceEpoch() * 1000;
+
+    long long start[3];
+    long long end[3];
+    start[0] = CLapRollup::monthOf(now);
+    end[0] = CLapRollup::nextMonthOf(now);
+    start[1] = CLapRollup::monthOf(start[0] - 1);
+    end[1] = start[0];
+    start[2] = 0;
+    end[2] = end[0];
+
+    CStats stats[3];
+    int rc = getStatsForPeriods(tagId, start, end, 3, stats);
+    if (rc != 0)
+        return rc;
+    rider->thisMonth = stats[0];
+    rider->lastMonth = stats[1];
+    rider->allTime = stats[2];
+
+    return 0;
+}
+
+
+
+
+
+
+// getStatsForMonths
+// Stats for the months holding monthStart through the one holding monthEnd (usec since the epoch) from
+// the lapsMonth rollup.  Gives what getStatsForPeriod gives for the same months, without reading laps.
+//
+int CDbase::getStatsForMonths(const QByteArray &tagId, long long monthStart, long long monthEnd, CStats *stats) {
+    if (!dBase.isOpen())
+        return 1;
+
+    CDbaseStatement *select = statement("SELECT lapCount, lapmsec, lapm, bestLapmsec, bestLapm, workoutCount, continuedWorkout FROM lapsMonth "
+                                        "WHERE tagId = :tagId AND period BETWEEN :monthStart AND :monthEnd ORDER BY period");
+    if (!select) return 2;
+    QSqlQuery &query = select->query;
+    query.bindValue(":tagId", tagId);
+    query.bindValue(":monthStart", CLapRollup::monthOf(monthStart));
+    query.bindValue(":monthEnd", CLapRollup::monthOf(monthEnd));
+    if (!execStatement(select)) {
+        errorTextVal = query.lastError().text();
         qDebug() << errorTextVal;
-        return 3;
+        return 2;
     }
     errorTextVal.clear();
 
-    // Determine workout count, lap count, average lap time, best lap time, distance
-
     int localBestLapmsec = -1;
     float localBestLapM = 0.;
-    int previousDateTime = 0;
     int localWorkoutCount = 0;
     int localLapCount = 0;
-    float localTotalSec = 0.;
-    float localTotalM = 0.;
+    long long localTotalmsec = 0;
+    double localTotalM = 0.;
+    bool first = true;
     while (query.next()) {
-        int lapmsec = query.value(lapmsecIndex).toInt();
-        float lapm = query.value(lapmIndex).toFloat();
-        float lapspeed = 0.;
-        if (lapmsec > 0) lapspeed = lapm / lapspeed;
-        int dateTime = query.value(dateTimeIndex).toInt();
-        if (localBestLapmsec < 0) {
-            localBestLapmsec = lapmsec;
-            localBestLapM = lapm;
-        }
-        else if (lapmsec < localBestLapmsec) {
-            localBestLapmsec = lapmsec;
-            localBestLapM = lapm;
-        }
-        localTotalSec += (float)lapmsec / 1000.;
-        localLapCount++;
-        localTotalM += lapm;
-        int dateTimeDif = dateTime - previousDateTime;
-        if (dateTimeDif > workoutDateTimeSeparation) {
-            localWorkoutCount++;
+        int bestLapmsec = query.value(3).toInt();
+        if (localBestLapmsec < 0 || bestLapmsec < localBestLapmsec) {
+            localBestLapmsec = bestLapmsec;
+            localBestLapM = query.value(4).toFloat();
         }
+        localLapCount += query.value(0).toInt();
+        localTotalmsec += query.value(1).toLongLong();
+        localTotalM += query.value(2).toDouble();
+        localWorkoutCount += query.value(5).toInt();
+
+        // The first lap of the period starts a workout as far as the period is concerned
 
-        previousDateTime = dateTime;
+        if (first)
+            localWorkoutCount += query.value(6).toInt();
+        first = false;
     }
+    query.finish();
 
     stats->lapCount = localLapCount;
     stats->workoutCount = localWorkoutCount;
     stats->bestLapSec = localBestLapmsec;
     stats->bestLapM = localBestLapM;
-    stats->totalSec = localTotalSec;
+    stats->totalSec = localTotalmsec / 1000.;
     stats->totalM = localTotalM;
 
     return 0;
@@ -553,33 +1226,505 @@ int CDbase::getStatsForPeriod(const QByteArray &tagId, unsigned int dateTimeStar
 
 
 
+// computeRollups
+// Build the lapsDay and lapsMonth rows from the lap store, the lap log when laps are kept in one.  Return 0 on success.
+//
+int CDbase::computeRollups(QMap<QPair<QByteArray, long long>, CLapRollup> *days, QMap<QPair<QByteArray, long long>, CLapRollup> *months) {
+    long long first;
+    long long last;
+    if (lapStore->timeStampRange(&first, &last) != 0) {
+        errorTextVal = lapStore->errorText();
+        return 1;
+    }
+
+    // A month of laps at a time, so only a month is in memory.  Whether a rider's
+    // first lap in the month starts a workout depends on their last lap before it.
+
+    QHash<QByteArray, long long> previousTimeStampByTag;
+    CLapColumns laps;
+    for (long long month = CLapRollup::monthOf(first); month <= last; month = CLapRollup::nextMonthOf(month)) {
+        if (lapStore->scan("", month, CLapRollup::nextMonthOf(month), &laps) != 0) {
+            errorTextVal = lapStore->errorText();
+            return 2;
+        }
+
+        // Working out local days takes a time zone lookup, laps come in runs
+        // in the same day so the current one's range is kept
+
+        long long day = 0;
+        long long dayEnd = 0;
+        for (int i=0; i<laps.size(); i++) {
+            const QByteArray &tagId = laps.tagIds[laps.tagIndex[i]];
+            long long timeStampUSec = laps.timeStampUSec[i];
+            if (timeStampUSec < day || timeStampUSec >= dayEnd) {
+                day = CLapRollup::dayOf(timeStampUSec);
+                dayEnd = CLapRollup::dayOf(day + 36LL * 3600 * 1000000);     // days are 23 to 25 hours
+            }
+            QHash<QByteArray, long long>::iterator previous = previousTimeStampByTag.find(tagId);
+            bool havePrevious = previous != previousTimeStampByTag.end();
+            bool newWorkout = CLapRollup::isNewWorkout(havePrevious, havePrevious ? *previous : 0, timeStampUSec);
+            (*days)[qMakePair(tagId, day)].addLap(timeStampUSec, laps.lapmsec[i], laps.lapm[i], newWorkout);
+            (*months)[qMakePair(tagId, month)].addLap(timeStampUSec, laps.lapmsec[i], laps.lapm[i], newWorkout);
+            if (havePrevious)
+                *previous = timeStampUSec;
+            else
+                previousTimeStampByTag.insert(tagId, timeStampUSec);
+        }
+    }
+    return 0;
+}
+
+
+
+// fillRollups
+// Replace the contents of lapsDay and lapsMonth with rows computed from laps.
+// Runs inside the caller's transaction.  Return 0 on success.
+//
+int CDbase::fillRollups(void) {
+    QMap<QPair<QByteArray, long long>, CLapRollup> days;
+    QMap<QPair<QByteArray, long long>, CLapRollup> months;
+    int rc = computeRollups(&days, &months);
+    if (rc != 0)
+        return rc;
+
+    const char *tables[2] = { "lapsDay", "lapsMonth" };
+    QMap<QPair<QByteArray, long long>, CLapRollup> *rollups[2] = { &days, &months };
+    for (int t=0; t<2; t++) {
+        QSqlQuery query;
+        if (!query.exec(QString("DELETE FROM ") + tables[t])) {
+            errorTextVal = query.lastError().text();
+            return 2;
+        }
+        query.prepare(QString("INSERT INTO ") + tables[t] + " (tagId, period, lapCount, lapmsec, lapm, bestLapmsec, bestLapm, "
+                      "workoutCount, continuedWorkout, firstTimeStampUSec, lastTimeStampUSec) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+        QMap<QPair<QByteArray, long long>, CLapRollup>::const_iterator i;
+        for (i = rollups[t]->constBegin(); i != rollups[t]->constEnd(); ++i) {
+            const CLapRollup &rollup = i.value();
+            query.addBindValue(i.key().first);
+            query.addBindValue(i.key().second);
+            query.addBindValue(rollup.lapCount);
+            query.addBindValue(rollup.lapmsec);
+            query.addBindValue(rollup.lapm);
+            query.addBindValue(rollup.bestLapmsec);
+            query.addBindValue(rollup.bestLapm);
+            query.addBindValue(rollup.workoutCount);
+            query.addBindValue(rollup.continuedWorkout);
+            query.addBindValue(rollup.firstTimeStampUSec);
+            query.addBindValue(rollup.lastTimeStampUSec);
+            if (!query.exec()) {
+                errorTextVal = query.lastError().text();
+                return 3;
+            }
+        }
+        qDebug() << "Filled" << tables[t] << "with" << rollups[t]->size() << "rows";
+    }
+    return 0;
+}
+
+
+
+// rebuildRollups
+// One-shot backfill: recompute lapsDay and lapsMonth from every lap, as importLaps() does after
+// adding laps, and have the stats prefetcher load its riders again.  Return 0 on success.
+//
+int CDbase::rebuildRollups(void) {
+    if (!dBase.isOpen())
+        return 1;
+
+    if (!dBase.transaction()) {
+        errorTextVal = dBase.lastError().text();
+        return 2;
+    }
+    int rc = fillRollups();
+    if (rc != 0) {
+        dBase.rollback();
+        return 3;
+    }
+    if (!dBase.commit()) {
+        errorTextVal = dBase.lastError().text();
+        dBase.rollback();
+        return 4;
+    }
+    if (statsPrefetcher)
+        statsPrefetcher->invalidate();
+    return 0;
+}
+
+
+
+// checkRollups
+// Compare lapsDay and lapsMonth, and the getStats() figures read from them, with what the lap store says.
+// Each difference is described in problems.  Return the number of differences, -1 on error.
+//
+int CDbase::checkRollups(QStringList *problems) {
+    if (!dBase.isOpen())
+        return -1;
+
+    QMap<QPair<QByteArray, long long>, CLapRollup> days;
+    QMap<QPair<QByteArray, long long>, CLapRollup> months;
+    if (computeRollups(&days, &months) != 0)
+        return -1;
+
+    const char *tables[2] = { "lapsDay", "lapsMonth" };
+    QMap<QPair<QByteArray, long long>, CLapRollup> *expected[2] = { &days, &months };
+    int problemCount = 0;
+    for (int t=0; t<2; t++) {
+        QSqlQuery query;
+        query.setForwardOnly(true);
+        if (!query.exec(QString("SELECT tagId, period, lapCount, lapmsec, lapm, bestLapmsec, bestLapm, workoutCount, "
+                                "continuedWorkout, firstTimeStampUSec, lastTimeStampUSec FROM ") + tables[t])) {
+            errorTextVal = query.lastError().text();
+            return -1;
+        }
+        QMap<QPair<QByteArray, long long>, CLapRollup> remaining = *expected[t];
+        while (query.next()) {
+            QPair<QByteArray, long long> key = qMakePair(query.value(0).toByteArray(), query.value(1).toLongLong());
+            QString where = QString("%1 %2 period %3").arg(tables[t]).arg(QString(key.first)).arg(key.second);
+            if (!remaining.contains(key)) {
+                problems->append(where + ": row has no laps");
+                problemCount++;
+                continue;
+            }
+            CLapRollup e = remaining.take(key);
+
+            // lapm is a sum of floats, allow for the order they were added in
+
+            if (query.value(2).toInt() != e.lapCount || query.value(3).toLongLong() != e.lapmsec ||
+                qAbs(query.value(4).toDouble() - e.lapm) > 0.001 * (1. + qAbs(e.lapm)) ||
+                query.value(5).toInt() != e.bestLapmsec || query.value(6).toFloat() != e.bestLapm ||
+                query.value(7).toInt() != e.workoutCount || query.value(8).toInt() != e.continuedWorkout ||
+                query.value(9).toLongLong() != e.firstTimeStampUSec || query.value(10).toLongLong() != e.lastTimeStampUSec) {
+                problems->append(where + QString(": has %1 laps %2 msec %3 m, laps say %4 laps %5 msec %6 m")
+                                 .arg(query.value(2).toInt()).arg(query.value(3).toLongLong()).arg(query.value(4).toDouble())
+                                 .arg(e.lapCount).arg(e.lapmsec).arg(e.lapm));
+                problemCount++;
+            }
+        }
+        QMap<QPair<QByteArray, long long>, CLapRollup>::const_iterator i;
+        for (i = remaining.constBegin(); i != remaining.constEnd(); ++i) {
+            problems->append(QString("%1 %2 period %3: missing, laps say %4 laps").arg(tables[t]).arg(QString(i.key().first)).arg(i.key().second).arg(i.value().lapCount));
+            problemCount++;
+        }
+    }
+
+    // And what getStats reads from lapsMonth against the same stats from the laps themselves
+
+    QList<QByteArray> tagIds;
+    QMap<QPair<QByteArray, long long>, CLapRollup>::const_iterator m;
+    for (m = months.constBegin(); m != months.constEnd(); ++m)
+        if (tagIds.isEmpty() || tagIds.last() != m.key().first)
+            tagIds.append(m.key().first);
+    for (int i=0; i<tagIds.size(); i++) {
+        CRider fromRollups;
+        CRider fromLaps;
+        if (getStats(tagIds[i], &fromRollups) != 0 || getStatsFromLaps(tagIds[i], &fromLaps) != 0)
+            return -1;
+        const char *periods[3] = { "this month", "last month", "all time" };
+        CStats *r[3] = { &fromRollups.thisMonth, &fromRollups.lastMonth, &fromRollups.allTime };
+        CStats *l[3] = { &fromLaps.thisMonth, &fromLaps.lastMonth, &fromLaps.allTime };
+        for (int j=0; j<3; j++) {
+            if (r[j]->lapCount != l[j]->lapCount || r[j]->workoutCount != l[j]->workoutCount ||
+                r[j]->bestLapSec != l[j]->bestLapSec || qAbs(r[j]->totalSec - l[j]->totalSec) > 0.001 * (1. + l[j]->totalSec)) {
+                problems->append(QString("getStats %1 %2: has %3 laps %4 workouts, laps say %5 laps %6 workouts")
+                                 .arg(QString(tagIds[i])).arg(periods[j]).arg(r[j]->lapCount).arg(r[j]->workoutCount)
+                                 .arg(l[j]->lapCount).arg(l[j]->workoutCount));
+                problemCount++;
+            }
+        }
+    }
+    return problemCount;
+}
+
+
+
+// importNames
+// Add the riders in fileName, CSV or binary, to the names table, or rename the ones already in it,
+// bulkBatchRows to a transaction.  On error the batch with the bad row is rolled back and the ones
+// before it stay.  Only with the background threads off.  *rowCount is the riders imported.  Return 0
+// on success.
+//
+int CDbase::importNames(const QString &fileName, long long *rowCount) {
+    *rowCount = 0;
+    if (!dBase.isOpen())
+        return 1;
+    if (lapWriter) {
+        errorTextVal = "Bulk imports need the database opened without the lap writer, see setBackgroundThreads()";
+        return 1;
+    }
+
+    CBulkReader reader(fileName);
+    if (reader.open(CBulkFile::names) != 0) {
+        errorTextVal = reader.errorText();
+        return 2;
+    }
+
+    CBulkProgress progress("Imported names");
+    CDbaseName name;
+    int read = 1;
+    while (read == 1) {
+        if (!dBase.transaction()) {
+            errorTextVal = dBase.lastError().text();
+            return 3;
+        }
+        int batchCount = 0;
+        int rc = 0;
+        while (rc == 0 && batchCount < bulkBatchRows && (read = reader.readName(&name)) == 1) {
+            if (names.contains(name.tagId))
+                rc = updateTagId(name.tagId, name.firstName, name.lastName);
+            else
+                rc = addTagId(name.tagId, name.firstName, name.lastName);
+            if (rc != 0)
+                errorTextVal = QString("Name %1, %2: %3").arg(reader.rowCount).arg(QString(name.tagId)).arg(errorTextVal);
+            batchCount++;
+        }
+        if (read < 0)
+            errorTextVal = reader.errorText();
+        else if (rc == 0 && !dBase.commit())
+            errorTextVal = dBase.lastError().text();
+        else if (rc == 0) {
+            *rowCount += batchCount;
+            progress.update(*rowCount);
+            continue;
+        }
+
+        // The rider directory has the rolled back batch in it, read it again
+
+        qDebug() << errorTextVal;
+        dBase.rollback();
+        loadNames();
+        return 4;
+    }
+    progress.finish(*rowCount);
+    return 0;
+}
+
+
+
+// exportNames
+// Write the names table to fileName, CSV when it ends in .csv, binary otherwise.  *rowCount is the
+// riders written.  Return 0 on success.
+//
+int CDbase::exportNames(const QString &fileName, long long *rowCount) {
+    *rowCount = 0;
+    if (!dBase.isOpen())
+        return 1;
+
+    CBulkWriter writer(fileName);
+    if (writer.open(CBulkFile::names) != 0) {
+        errorTextVal = writer.errorText();
+        return 2;
+    }
+
+    QSqlQuery query;
+    query.setForwardOnly(true);
+    if (!query.exec("SELECT tagId, firstName, lastName FROM names ORDER BY id")) {
+        errorTextVal = query.lastError().text();
+        qDebug() << errorTextVal;
+        return 3;
+    }
+    CBulkProgress progress("Exported names");
+    CDbaseName name;
+    while (query.next()) {
+        name.tagId = query.value(0).toString().toLatin1();
+        name.firstName = query.value(1).toString();
+        name.lastName = query.value(2).toString();
+        if (writer.writeName(name) != 0) {
+            errorTextVal = writer.errorText();
+            return 4;
+        }
+        progress.update(writer.rowCount);
+    }
+    if (writer.close() != 0) {
+        errorTextVal = writer.errorText();
+        return 5;
+    }
+    *rowCount = writer.rowCount;
+    progress.finish(*rowCount);
+    return 0;
+}
 
 
 
-// dateTime2Int()
-// seconds (0 - 63) - 6 bits (0 - 5)
-// minutes (0 - 63) - 6 bits (6 - 11)
-// hours   (0 -31)  - 5 bits (12 - 16)
-// day     (0 - 31) - 5 bits (17 - 21)
-// month   (0 - 15) - 4 bits (22 - 25)
-// year    (0 - 63) - 6 bits (26 - 31)
+// importSessions
+// Give the laps read by importLaps() session ids in this database.  A file session id that isn't
+// a sessions row yet is kept and gets a row, started at its first lap; one that is, from this
+// database or another import, gets a new row.  *sessionIds maps file ids to ours, 0 for laps from
+// before sessions stays 0.  Return 0 on success.
 //
-unsigned int CDbase::dateTime2Int(int year, int month, int day, int hour, int minute, int second) {
-    if (year < 2000)
-        throw("Year < 2000 in dateTime2Int");
+int CDbase::importSessions(QList<CLapRecord> *laps, QHash<int, int> *sessionIds) {
+    QSqlQuery query;
+
+    for (int i=0; i<laps->size(); i++) {
+        CLapRecord &lap = (*laps)[i];
+        if (lap.sessionId == 0)
+            continue;
+        if (sessionIds->contains(lap.sessionId)) {
+            lap.sessionId = sessionIds->value(lap.sessionId);
+            continue;
+        }
 
-    unsigned int dateTime = (year-2000) << 26 | month << 22 | day << 17 | hour << 12 | minute << 6 | (second & 0x3f);
-    return dateTime;
+        query.prepare("SELECT id FROM sessions WHERE id = :id");
+        query.bindValue(":id", lap.sessionId);
+        if (!query.exec()) {
+            errorTextVal = query.lastError().text();
+            return 1;
+        }
+        bool clash = query.next();
+        query.finish();
+
+        if (clash)
+            query.prepare("INSERT INTO sessions (startTimeStampUSec) VALUES (:startTimeStampUSec)");
+        else {
+            query.prepare("INSERT INTO sessions (id, startTimeStampUSec) VALUES (:id, :startTimeStampUSec)");
+            query.bindValue(":id", lap.sessionId);
+        }
+        query.bindValue(":startTimeStampUSec", lap.timeStampUSec);
+        if (!query.exec()) {
+            errorTextVal = query.lastError().text();
+            return 2;
+        }
+        int id = query.lastInsertId().toInt();
+        sessionIds->insert(lap.sessionId, id);
+        lap.sessionId = id;
+    }
+    return 0;
 }
 
 
-// int2DateTime()
+
+// importLaps
+// Add the laps in fileName, CSV or binary, to the lap store, bulkBatchRows to a transaction, then
+// rebuild the rollups.  Imported laps keep their file's sessions, see importSessions().  On error the batch with the bad row is rolled back and the ones before it stay.
+// Only with the background threads off, see setBackgroundThreads().  *rowCount is the laps imported.
+// Return 0 on success.
 //
-void CDbase::int2DateTime(unsigned int dateTime, int *year, int *month, int *day, int *hour, int *minute, int *second) {
-    *year = ((dateTime >> 26) & 0x00ff) + 2000;
-    *month = (dateTime >> 22) & 0x0f;
-    *day = (dateTime >> 17) & 0x1f;
-    *hour = (dateTime >> 12) & 0x0f;
-    *minute = (dateTime >> 6) & 0x1f;
-    *second = (dateTime >> 0) & 0x1f;
+int CDbase::importLaps(const QString &fileName, long long *rowCount) {
+    *rowCount = 0;
+    if (!dBase.isOpen())
+        return 1;
+    if (lapWriter) {
+        errorTextVal = "Bulk imports need the database opened without the lap writer, see setBackgroundThreads()";
+        return 1;
+    }
+
+    CBulkReader reader(fileName);
+    if (reader.open(CBulkFile::laps) != 0) {
+        errorTextVal = reader.errorText();
+        return 2;
+    }
+
+    // Building the laps index once after an import as big as the table is faster than
+    // updating it for every lap
+
+    QSqlQuery query;
+    long long estimatedRowCount = reader.estimatedRowCount();
+    bool rebuildIndex = lapStore == sqliteLapStore && estimatedRowCount >= bulkIndexRebuildRows &&
+        estimatedRowCount >= sqliteLapStore->lapCount();
+    if (rebuildIndex && !query.exec("DROP INDEX IF EXISTS lapsTagIdTimeStamp")) {
+        errorTextVal = query.lastError().text();
+        qDebug() << errorTextVal;
+        return 3;
+    }
+
+    CBulkProgress progress("Imported laps");
+    QList<CLapRecord> batch;
+    CLapRecord lap;
+    QHash<int, int> sessionIds;
+    int rc = 0;
+    int read = 1;
+    while (rc == 0 && read == 1) {
+        batch.clear();
+        while (batch.size() < bulkBatchRows && (read = reader.readLap(&lap)) == 1)
+            batch.append(lap);
+        if (read < 0) {
+            errorTextVal = reader.errorText();
+            rc = 4;
+        }
+        else if (batch.isEmpty())
+            break;
+        else if (!dBase.transaction()) {
+            errorTextVal = dBase.lastError().text();
+            rc = 5;
+        }
+        else if (importSessions(&batch, &sessionIds) != 0) {
+            qDebug() << "Error adding imported sessions";
+            dBase.rollback();
+            rc = 6;
+        }
+        else if (lapStore->append(batch) != 0 || lapStore->commit() != 0 || !dBase.commit()) {
+            errorTextVal = lapStore->errorText().isEmpty() ? dBase.lastError().text() : lapStore->errorText();
+            dBase.rollback();
+            lapStore->rollback();
+            lapStore->reconcile();
+            rc = 7;
+        }
+        else {
+            *rowCount += batch.size();
+            progress.update(*rowCount);
+        }
+    }
+    if (rc != 0)
+        qDebug() << errorTextVal;
+    progress.finish(*rowCount);
+
+    if (rebuildIndex && !query.exec(lapsIndexSql)) {
+        qDebug() << "Error indexing laps table:" << query.lastError().text();
+        if (rc == 0) {
+            errorTextVal = query.lastError().text();
+            rc = 8;
+        }
+    }
+
+    // The rollups are out of date for whatever was imported, even by an import that stopped short
+
+    if (*rowCount > 0 && rebuildRollups() != 0 && rc == 0)
+        rc = 9;
+    return rc;
+}
+
+
+
+// exportLaps
+// Write every lap in the lap store to fileName, CSV when it ends in .csv, binary otherwise, a month
+// at a time so only a month of laps is in memory.  *rowCount is the laps written.  Return 0 on success.
+//
+int CDbase::exportLaps(const QString &fileName, long long *rowCount) {
+    *rowCount = 0;
+    if (!dBase.isOpen())
+        return 1;
+
+    CBulkWriter writer(fileName);
+    if (writer.open(CBulkFile::laps) != 0) {
+        errorTextVal = writer.errorText();
+        return 2;
+    }
+
+    long long first;
+    long long last;
+    if (lapStore->timeStampRange(&first, &last) != 0) {
+        errorTextVal = lapStore->errorText();
+        return 3;
+    }
+    CBulkProgress progress("Exported laps");
+    CLapColumns laps;
+    for (long long month = CLapRollup::monthOf(first); month <= last; month = CLapRollup::nextMonthOf(month)) {
+        if (lapStore->scan("", month, CLapRollup::nextMonthOf(month), &laps) != 0) {
+            errorTextVal = lapStore->errorText();
+            return 4;
+        }
+        for (int i=0; i<laps.size(); i++) {
+            if (writer.writeLap(laps.record(i)) != 0) {
+                errorTextVal = writer.errorText();
+                return 5;
+            }
+        }
+        progress.update(writer.rowCount);
+    }
+    if (writer.close() != 0) {
+        errorTextVal = writer.errorText();
+        return 6;
+    }
+    *rowCount = writer.rowCount;
+    progress.finish(*rowCount);
+    return 0;
 }
@@ -2,16 +2,53 @@
 #define CDBASE_H
 
 #include <QString>
+#include <QHash>
 #include <QtSql/QtSql>
 //#include <QSqlDatabase>
 
 #include "crider.h"
+#include "clapwriter.h"
+#include "cstatsprefetcher.h"
+
+
+struct CDbaseMigration;
+class CDbaseStatement;
+
+
+// Counters for one statement in CDbase's statement cache, copied out by
+// CDbase::getStatementStats()
+
+class CDbaseStatementStats {
+public:
+    CDbaseStatementStats(void);
+    QString sql;
+    long long hitCount;         // calls that found the statement already prepared
+    long long prepareCount;     // calls that had to prepare it, once unless preparing failed
+    long long execCount;
+    long long failedExecCount;
+    long long totalExecUsec;    // time in exec(), for SELECTs that includes finding the first row
+    int maxExecUsec;
+};
+
+
+// One row of the names table, as held in CDbase's rider directory
+
+class CDbaseName {
+public:
+    CDbaseName(void);
+    int id;
+    QByteArray tagId;
+    QString firstName;
+    QString lastName;
+};
 
 
 class CDbase
 {
 public:
     CDbase();
+    void setLapLogDirectory(const QString &directory);
+    void setBackgroundThreads(bool start);
     int open(QString filename, QString username, QString password);
     void close(void);
     int error(void);
@@ -26,17 +63,55 @@ public:
     int getTagIdAndName(int id, QByteArray *tagId, QString *firstName, QString *lastName);
     int getAllFromId(int id, QByteArray *tagId, QString *firstName, QString *lastName);
     int namesRowCount(void);
-    int addLap(const QByteArray &tagId, int year, int month, int day, int hour, int minute, int second, int msec, float lapm);
-    QList<int> getLapmsec(const QByteArray &tagId, int yearStart=0, int monthStart=0, int dayStart=0, int yearEnd=0, int monthEnd=0, int dayEnd=0);
+    const QHash<QByteArray, CDbaseName> &getNames(void);
+    int schemaVersion(void);
+    int addLap(const QByteArray &tagId, int readerId, int antennaId, long long timeStampUSec, int lapmsec, float lapm);
+    int getLapWriterStats(CLapWriterStats *stats);
+    int getStatementStats(QList<CDbaseStatementStats> *stats);
     int getStats(const QByteArray &tagId, CRider *rider);
-//    int getStatsForPeriod(const QByteArray &tagId, unsigned int dateTimeStart, unsigned int dateTimeEnd, int *lapCount, int *workoutCount, float *totalSec, float *totalM, float *bestLapSec, float *bestLapM);
-    int getStatsForPeriod(const QByteArray &tagId, unsigned int dateTimeStart, unsigned int dateTimeEnd, CStats *stats);
-    unsigned int dateTime2Int(int year=0, int month=0, int day=0, int hour=0, int minute=0, int second=0);
-    void int2DateTime(unsigned int dateTime, int *year, int *month, int *day, int *hour, int *minute, int *second);
+    int prefetchStats(const QByteArray &tagId);
+    bool getPrefetchedStats(const QByteArray &tagId, CRider *rider, long long *lastTimeStampUSec=NULL);
+    CStatsPrefetcher *getStatsPrefetcher(void);
+    static const char *riderMonthsSql;
+    static void statsFromMonths(QSqlQuery &query, CStats *thisMonthStats, CStats *lastMonthStats, CStats *allTimeStats, long long *lastTimeStampUSec=NULL);
+    int getStatsForPeriod(const QByteArray &tagId, long long timeStampUSecStart, long long timeStampUSecEnd, CStats *stats);
+    int getStatsForPeriods(const QByteArray &tagId, const long long *timeStampUSecStart, const long long *timeStampUSecEnd, int periodCount, CStats *stats);
+    int getStatsFromLaps(const QByteArray &tagId, CRider *rider);
+    int getStatsForMonths(const QByteArray &tagId, long long monthStart, long long monthEnd, CStats *stats);
+    int rebuildRollups(void);
+    int checkRollups(QStringList *problems);
+    int importNames(const QString &fileName, long long *rowCount);
+    int exportNames(const QString &fileName, long long *rowCount);
+    int importLaps(const QString &fileName, long long *rowCount);
+    int exportLaps(const QString &fileName, long long *rowCount);
+    static const int bulkBatchRows = 50000;                 // rows per transaction for bulk imports
+    static const long long bulkIndexRebuildRows = 100000;   // smallest laps import the index is dropped and rebuilt for
 private:
     QSqlDatabase dBase;
     QString errorTextVal;
     int errorVal;
+    CLapWriter *lapWriter;
+    CStatsPrefetcher *statsPrefetcher;
+    bool backgroundThreads;                 // open() starts lapWriter and statsPrefetcher
+    QString lapLogDirectory;                // laps go to a CLapLog here, or the laps table when empty
+    CSqliteLapStore *sqliteLapStore;        // the laps table, what an empty lap log is filled from
+    CLapStore *lapLog;                      // the CLapLog in lapLogDirectory, NULL when there isn't one
+    CLapStore *lapStore;                    // where laps are read from, sqliteLapStore or lapLog
+    int sessionId;                          // sessions row for the laps added since open()
+    QHash<QString, CDbaseStatement *> statements;
+    QHash<QByteArray, CDbaseName> names;     // rider directory, the names table by tagId
+    int loadNames(void);
+    CDbaseStatement *statement(const char *sql);
+    bool execStatement(CDbaseStatement *statement);
+    void clearStatements(void);
+    static const CDbaseMigration migrations[];
+    static const int migrationCount;
+    int migrate(void);
+    int fillRollups(void);
+    int importSessions(QList<CLapRecord> *laps, QHash<int, int> *sessionIds);
+    int getStatsForPeriodsSql(const QByteArray &tagId, const long long *timeStampUSecStart, const long long *timeStampUSecEnd,
+                              int periodCount, long long unionStart, long long unionEnd, CStats *stats);
+    int computeRollups(QMap<QPair<QByteArray, long long>, CLapRollup> *days, QMap<QPair<QByteArray, long long>, CLapRollup> *months);
 private slots:
 };
 
@@ -0,0 +1,763 @@
+// claplog.cpp
+
+
+#include "claplog.h"
+
+#include <QDir>
+#include <QtGlobal>
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+
+
+// Segment file header, followed by the columns, each capacity entries:
+// timeStampUSec (qint64), tagKey, sessionId, lapmsec, lapmm (qint32),
+// readerId, antennaId (qint16).  capacity is a multiple of 16 so every
+// column starts 64 byte aligned.
+
+struct CLapLogHeader {
+    char magic[8];              // "FCVTLAP1"
+    qint32 capacity;
+    qint32 count;               // laps written, only used through countOf()
+    qint64 minTimeStampUSec;    // of the laps counted
+    qint64 maxTimeStampUSec;
+    char reserved[32];
+};
+
+Q_STATIC_ASSERT(sizeof(CLapLogHeader) == 64);
+Q_STATIC_ASSERT(sizeof(std::atomic<qint32>) == sizeof(qint32));
+
+static const char lapLogMagic[8] = { 'F', 'C', 'V', 'T', 'L', 'A', 'P', '1' };
+
+
+// count is the one header field written while other threads read the segment.  The
+// writer stores it after the columns of the laps it counts, readers load it before
+// reading them.
+
+static std::atomic<qint32> *countOf(CLapLogHeader *header) {
+    return reinterpret_cast<std::atomic<qint32> *>(&header->count);
+}
+
+
+
+// One segment file, mapped, and where its columns are
+
+class CLapLogSegment {
+public:
+    explicit CLapLogSegment(const QString &fileName);
+    int map(void);
+    int publishedCount(void);
+    void publish(int count);
+    int sync(void);
+    static qint64 fileSize(int capacity);
+    QFile file;
+    CLapLogHeader *header;
+    qint64 *timeStampUSec;
+    qint32 *tagKey;
+    qint32 *sessionId;
+    qint32 *lapmsec;
+    qint32 *lapmm;
+    qint16 *readerId;
+    qint16 *antennaId;
+};
+
+
+
+CLapLogSegment::CLapLogSegment(const QString &fileName) : file(fileName) {
+    header = NULL;
+}
+
+
+
+// map
+// Open and map the file and check its header.  Return 0 on success.
+//
+int CLapLogSegment::map(void) {
+    if (!file.open(QIODevice::ReadWrite))
+        return 1;
+    if (file.size() < (qint64)sizeof(CLapLogHeader))
+        return 2;
+    uchar *data = file.map(0, file.size());
+    if (!data)
+        return 3;
+    header = (CLapLogHeader *)data;
+    if (memcmp(header->magic, lapLogMagic, sizeof lapLogMagic) != 0 || header->capacity <= 0 ||
+        header->capacity % 16 != 0 || file.size() < fileSize(header->capacity))
+        return 4;
+
+    qint64 capacity = header->capacity;
+    uchar *column = data + sizeof(CLapLogHeader);
+    timeStampUSec = (qint64 *)column;
+    column += capacity * sizeof(qint64);
+    tagKey = (qint32 *)column;
+    column += capacity * sizeof(qint32);
+    sessionId = (qint32 *)column;
+    column += capacity * sizeof(qint32);
+    lapmsec = (qint32 *)column;
+    column += capacity * sizeof(qint32);
+    lapmm = (qint32 *)column;
+    column += capacity * sizeof(qint32);
+    readerId = (qint16 *)column;
+    column += capacity * sizeof(qint16);
+    antennaId = (qint16 *)column;
+    return 0;
+}
+
+
+
+int CLapLogSegment::publishedCount(void) {
+    return countOf(header)->load(std::memory_order_acquire);
+}
+
+
+
+void CLapLogSegment::publish(int count) {
+    countOf(header)->store(count, std::memory_order_release);
+}
+
+
+
+// sync
+// Get what has been written through the mapping to the disk.  Return 0 on success.
+//
+int CLapLogSegment::sync(void) {
+#ifdef Q_OS_UNIX
+    if (::fsync(file.handle()) != 0)
+        return 1;
+#endif
+    return 0;
+}
+
+
+
+qint64 CLapLogSegment::fileSize(int capacity) {
+    return sizeof(CLapLogHeader) + (qint64)capacity * (sizeof(qint64) + 4 * sizeof(qint32) + 2 * sizeof(qint16));
+}
+
+
+
+// Put column in the order given, order[i] is the index of the entry that goes at i
+
+template <typename T> static void permute(QVector<T> *column, const QVector<int> &order) {
+    QVector<T> sorted(order.size());
+    for (int i=0; i<order.size(); i++)
+        sorted[i] = column->at(order[i]);
+    *column = sorted;
+}
+
+
+
+CLapLog::CLapLog(const QString &directory, int segmentCapacity) {
+    this->directory = directory;
+    this->segmentCapacity = qMax(16, (segmentCapacity + 15) / 16 * 16);
+    isOpen = false;
+    tagsFileRead = 0;
+    appending = false;
+    firstStagedSegment = 0;
+    writeSegment = 0;
+    writePosition = 0;
+}
+
+
+
+CLapLog::~CLapLog(void) {
+    close();
+}
+
+
+
+// setMarkDatabase
+// Keep the lap count in db's lapLogMarks table, from the next commit() or reconcile()
+//
+void CLapLog::setMarkDatabase(QSqlDatabase db) {
+    markDb = db;
+}
+
+
+
+// open
+// Open the log in directory, making the directory if need be.  Return 0 on success.
+//
+int CLapLog::open(void) {
+    errorTextVal.clear();
+    if (!QDir().mkpath(directory)) {
+        errorTextVal = "Could not make lap log directory " + directory;
+        qDebug() << errorTextVal;
+        return 1;
+    }
+
+    tagsFile.setFileName(directory + "/tags");
+    if (!tagsFile.open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+        errorTextVal = "Could not open " + tagsFile.fileName() + ": " + tagsFile.errorString();
+        qDebug() << errorTextVal;
+        return 2;
+    }
+    if (loadTagIds() != 0 || mapSegments() != 0) {
+        qDebug() << errorTextVal;
+        close();
+        return 3;
+    }
+    isOpen = true;
+    return 0;
+}
+
+
+
+// close
+// Unmap everything.  Laps appended and not committed are dropped.
+//
+void CLapLog::close(void) {
+    qDeleteAll(segments);
+    segments.clear();
+    tagsFile.close();
+    tagsFileRead = 0;
+    tagIds.clear();
+    tagKeys.clear();
+    appending = false;
+    isOpen = false;
+}
+
+
+
+QString CLapLog::segmentFileName(int number) {
+    return directory + QString("/laps-%1.seg").arg(number, 6, 10, QChar('0'));
+}
+
+
+
+// mapSegments
+// Map the segment files made since the last call, by this or another CLapLog.  Return 0 on success.
+//
+int CLapLog::mapSegments(void) {
+    forever {
+        QString fileName = segmentFileName(segments.size());
+        if (!QFile::exists(fileName))
+            return 0;
+        CLapLogSegment *segment = new CLapLogSegment(fileName);
+        int rc = segment->map();
+        if (rc != 0) {
+            errorTextVal = QString("Could not map lap log segment %1, error %2: %3").arg(fileName).arg(rc).arg(segment->file.errorString());
+            delete segment;
+            return 1;
+        }
+        segments.append(segment);
+    }
+}
+
+
+
+// createSegment
+// Add an empty segment at the end.  It is made under another name and renamed
+// when complete, so a reader never maps half a header.  Return 0 on success.
+//
+int CLapLog::createSegment(void) {
+    QString fileName = segmentFileName(segments.size());
+    QFile file(fileName + ".new");
+    CLapLogHeader header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, lapLogMagic, sizeof lapLogMagic);
+    header.capacity = segmentCapacity;
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+        !file.resize(CLapLogSegment::fileSize(segmentCapacity)) ||
+        file.write((const char *)&header, sizeof header) != sizeof header) {
+        errorTextVal = "Could not make lap log segment " + fileName + ": " + file.errorString();
+        qDebug() << errorTextVal;
+        return 1;
+    }
+    file.close();
+    if (!file.rename(fileName)) {
+        errorTextVal = "Could not make lap log segment " + fileName + ": " + file.errorString();
+        qDebug() << errorTextVal;
+        return 2;
+    }
+    return mapSegments();
+}
+
+
+
+// loadTagIds
+// Read the tagIds added to the tags file since the last call.  A line without its
+// newline yet is left for next time.  Return 0 on success.
+//
+int CLapLog::loadTagIds(void) {
+    qint64 size = tagsFile.size();
+    if (size <= tagsFileRead)
+        return 0;
+    if (!tagsFile.seek(tagsFileRead)) {
+        errorTextVal = "Could not read " + tagsFile.fileName() + ": " + tagsFile.errorString();
+        return 1;
+    }
+    QByteArray data = tagsFile.read(size - tagsFileRead);
+    int lineStart = 0;
+    forever {
+        int newline = data.indexOf('\n', lineStart);
+        if (newline < 0)
+            break;
+        QByteArray tagId = data.mid(lineStart, newline - lineStart);
+        if (!tagKeys.contains(tagId))
+            tagKeys.insert(tagId, tagIds.size());
+        tagIds.append(tagId);
+        lineStart = newline + 1;
+    }
+    tagsFileRead += lineStart;
+    return 0;
+}
+
+
+
+// startAppending
+// Get ready for the first append() by this CLapLog.  Return 0 on success.
+//
+int CLapLog::startAppending(void) {
+    if (appending)
+        return 0;
+
+    // A tagId cut short by a crash gets its newline, the line has a key nothing uses
+
+    if (loadTagIds() != 0)
+        return 1;
+    if (tagsFile.size() > tagsFileRead) {
+        if (!tagsFile.seek(tagsFile.size()) || tagsFile.write("\n", 1) != 1 || loadTagIds() != 0) {
+            errorTextVal = "Could not write " + tagsFile.fileName() + ": " + tagsFile.errorString();
+            return 2;
+        }
+    }
+
+    if (mapSegments() != 0 || (segments.isEmpty() && createSegment() != 0))
+        return 3;
+    if (reconcile() != 0)
+        return 4;
+
+    // Laps uncounted by reconcile() can leave empty segments after the last one with laps
+
+    writeSegment = segments.size() - 1;
+    while (writeSegment > 0 && segments[writeSegment]->publishedCount() == 0)
+        writeSegment--;
+    writePosition = segments[writeSegment]->publishedCount();
+    firstStagedSegment = writeSegment;
+    appending = true;
+    return 0;
+}
+
+
+
+// tagKey
+// The key for tagId, adding it to the tags file if it is new.  Return -1 on error.
+//
+int CLapLog::tagKey(const QByteArray &tagId) {
+    int key = tagKeys.value(tagId, -1);
+    if (key >= 0)
+        return key;
+
+    if (tagId.isEmpty() || tagId.contains('\n')) {
+        errorTextVal = "Lap log can't store tagId " + QString(tagId);
+        return -1;
+    }
+    QByteArray line = tagId + '\n';
+    if (!tagsFile.seek(tagsFile.size()) || tagsFile.write(line) != line.size() || loadTagIds() != 0) {
+        errorTextVal = "Could not write " + tagsFile.fileName() + ": " + tagsFile.errorString();
+        return -1;
+    }
+    return tagKeys.value(tagId, -1);
+}
+
+
+
+// append
+// Write the laps after the last ones, not counted until commit().  Return 0 on success.
+//
+int CLapLog::append(const QList<CLapRecord> &laps) {
+    if (!isOpen)
+        return 1;
+    if (startAppending() != 0) {
+        qDebug() << errorTextVal;
+        return 2;
+    }
+
+    for (int i=0; i<laps.size(); i++) {
+        const CLapRecord &lap = laps[i];
+        int key = tagKey(lap.tagId);
+        if (key < 0) {
+            qDebug() << errorTextVal;
+            return 3;
+        }
+        if (writePosition >= segments[writeSegment]->header->capacity) {
+            if (writeSegment + 1 >= segments.size() && createSegment() != 0)
+                return 4;
+            writeSegment++;
+            writePosition = 0;
+        }
+        CLapLogSegment *segment = segments[writeSegment];
+        segment->timeStampUSec[writePosition] = lap.timeStampUSec;
+        segment->tagKey[writePosition] = key;
+        segment->sessionId[writePosition] = lap.sessionId;
+        segment->lapmsec[writePosition] = lap.lapmsec;
+        segment->lapmm[writePosition] = qRound(lap.lapm * 1000.);
+        segment->readerId[writePosition] = (qint16)lap.readerId;
+        segment->antennaId[writePosition] = (qint16)lap.antennaId;
+        writePosition++;
+    }
+    return 0;
+}
+
+
+
+// commit
+// Count the laps appended since the last commit.  They are synced to the disk before
+// they are counted and the counts after, so a crash loses laps rather than leaving
+// counted laps that were never written.  The new lap count goes in the mark database
+// before any lap is counted, in its transaction if one is open.  Return 0 on success.
+//
+int CLapLog::commit(void) {
+    if (!appending)
+        return 0;
+
+    long long stagedCount = 0;
+    for (int n=firstStagedSegment; n<=writeSegment; n++) {
+        if (segments[n]->sync() != 0) {
+            errorTextVal = "Could not sync " + segments[n]->file.fileName();
+            qDebug() << errorTextVal;
+            return 1;
+        }
+        stagedCount += (n < writeSegment ? segments[n]->header->capacity : writePosition) - segments[n]->publishedCount();
+    }
+
+    if (markDb.isValid()) {
+        QSqlQuery query(markDb);
+        query.prepare("INSERT OR REPLACE INTO lapLogMarks (directory, lapCount) VALUES (?, ?)");
+        query.addBindValue(QDir(directory).absolutePath());
+        query.addBindValue(lapCount() + stagedCount);
+        if (!query.exec()) {
+            errorTextVal = "Could not record lap log count: " + query.lastError().text();
+            qDebug() << errorTextVal;
+            return 3;
+        }
+    }
+
+    for (int n=firstStagedSegment; n<=writeSegment; n++) {
+        CLapLogSegment *segment = segments[n];
+        int from = segment->publishedCount();
+        int to = n < writeSegment ? segment->header->capacity : writePosition;
+        if (to <= from)
+            continue;
+        qint64 minTimeStampUSec = segment->timeStampUSec[from];
+        qint64 maxTimeStampUSec = minTimeStampUSec;
+        for (int i=from+1; i<to; i++) {
+            minTimeStampUSec = qMin(minTimeStampUSec, segment->timeStampUSec[i]);
+            maxTimeStampUSec = qMax(maxTimeStampUSec, segment->timeStampUSec[i]);
+        }
+        if (from > 0) {
+            minTimeStampUSec = qMin(minTimeStampUSec, segment->header->minTimeStampUSec);
+            maxTimeStampUSec = qMax(maxTimeStampUSec, segment->header->maxTimeStampUSec);
+        }
+        segment->header->minTimeStampUSec = minTimeStampUSec;
+        segment->header->maxTimeStampUSec = maxTimeStampUSec;
+        segment->publish(to);
+        if (segment->sync() != 0) {
+            errorTextVal = "Could not sync " + segment->file.fileName();
+            qDebug() << errorTextVal;
+            return 2;
+        }
+    }
+    firstStagedSegment = writeSegment;
+    return 0;
+}
+
+
+
+// rollback
+// Drop the laps appended since the last commit
+//
+void CLapLog::rollback(void) {
+    if (!appending)
+        return;
+    writeSegment = firstStagedSegment;
+    writePosition = segments[writeSegment]->publishedCount();
+}
+
+
+
+// reconcile
+// Uncount the laps past the count in the mark database, recording the count there when
+// there is none yet.  Laps appended and not committed are dropped with them.  Only the
+// one CLapLog that appends may call this.  Return 0 on success.
+//
+int CLapLog::reconcile(void) {
+    if (!isOpen)
+        return 1;
+    if (!markDb.isValid())
+        return 0;
+
+    QSqlQuery query(markDb);
+    query.prepare("SELECT lapCount FROM lapLogMarks WHERE directory = ?");
+    query.addBindValue(QDir(directory).absolutePath());
+    if (!query.exec()) {
+        errorTextVal = "Could not read lap log count: " + query.lastError().text();
+        qDebug() << errorTextVal;
+        return 2;
+    }
+    bool haveMark = query.next();
+    long long mark = haveMark ? query.value(0).toLongLong() : 0;
+    query.finish();
+
+    long long count = lapCount();
+    if (count < 0)
+        return 3;
+    if (!haveMark) {
+        query.prepare("INSERT INTO lapLogMarks (directory, lapCount) VALUES (?, ?)");
+        query.addBindValue(QDir(directory).absolutePath());
+        query.addBindValue(count);
+        if (!query.exec()) {
+            errorTextVal = "Could not record lap log count: " + query.lastError().text();
+            qDebug() << errorTextVal;
+            return 4;
+        }
+        return 0;
+    }
+    if (count < mark)
+        qDebug() << "Lap log" << directory << "has" << count << "laps, the database expects" << mark;
+    if (count <= mark)
+        return 0;
+    qDebug() << "Lap log" << directory << "dropping" << count - mark << "laps the database never committed";
+    return truncate(mark) != 0 ? 5 : 0;
+}
+
+
+
+// truncate
+// Uncount the laps after the first count and anything appended since the last commit.
+// Readers may have seen the laps uncounted.  Return 0 on success.
+//
+int CLapLog::truncate(long long count) {
+    long long kept = 0;
+    for (int n=0; n<segments.size(); n++) {
+        CLapLogSegment *segment = segments[n];
+        int published = segment->publishedCount();
+        int keep = (int)qMin((long long)published, qMax(0LL, count - kept));
+        kept += keep;
+        if (keep == published)
+            continue;
+
+        // The count first, a reader only uses the time range of a full segment
+
+        segment->publish(keep);
+        if (keep > 0) {
+            qint64 minTimeStampUSec = segment->timeStampUSec[0];
+            qint64 maxTimeStampUSec = minTimeStampUSec;
+            for (int i=1; i<keep; i++) {
+                minTimeStampUSec = qMin(minTimeStampUSec, segment->timeStampUSec[i]);
+                maxTimeStampUSec = qMax(maxTimeStampUSec, segment->timeStampUSec[i]);
+            }
+            segment->header->minTimeStampUSec = minTimeStampUSec;
+            segment->header->maxTimeStampUSec = maxTimeStampUSec;
+        }
+        if (segment->sync() != 0) {
+            errorTextVal = "Could not sync " + segment->file.fileName();
+            qDebug() << errorTextVal;
+            return 1;
+        }
+    }
+    appending = false;
+    return 0;
+}
+
+
+
+// scan
+// Each segment's columns are compared in one flat loop the compiler can vectorize,
+// then the laps that match are copied out.  Full segments outside the time range
+// are skipped on their header.
+//
+int CLapLog::scan(const QByteArray &tagId, long long timeStampUSecStart, long long timeStampUSecEnd, CLapColumns *laps) {
+    laps->clear();
+    if (!isOpen)
+        return 1;
+    if (mapSegments() != 0) {
+        qDebug() << errorTextVal;
+        return 2;
+    }
+
+    int key = -1;
+    if (!tagId.isEmpty()) {
+        key = tagKeys.value(tagId, -1);
+        if (key < 0 && (loadTagIds() != 0 || (key = tagKeys.value(tagId, -1)) < 0))
+            return 0;       // no laps by this rider
+        laps->addTagId(tagId);
+    }
+
+    QVector<uchar> match;
+    int maxKey = -1;
+    for (int n=0; n<segments.size(); n++) {
+        CLapLogSegment *segment = segments[n];
+        int count = segment->publishedCount();
+        if (count == 0)
+            continue;
+
+        // A full segment's header is only written again after truncate() uncounts laps, a partial one's time range may be changing
+
+        if (count == segment->header->capacity &&
+            (segment->header->maxTimeStampUSec < timeStampUSecStart || segment->header->minTimeStampUSec >= timeStampUSecEnd))
+            continue;
+
+        match.resize(count);
+        uchar *m = match.data();
+        const qint64 *t = segment->timeStampUSec;
+        const qint32 *k = segment->tagKey;
+        if (key >= 0) {
+            for (int i=0; i<count; i++)
+                m[i] = (k[i] == key) & (t[i] >= timeStampUSecStart) & (t[i] < timeStampUSecEnd);
+        }
+        else {
+            for (int i=0; i<count; i++)
+                m[i] = (t[i] >= timeStampUSecStart) & (t[i] < timeStampUSecEnd);
+        }
+
+        for (int i=0; i<count; i++) {
+            if (!m[i])
+                continue;
+            laps->tagIndex.append(key >= 0 ? 0 : k[i]);
+            if (k[i] > maxKey)
+                maxKey = k[i];
+            laps->timeStampUSec.append(t[i]);
+            laps->sessionId.append(segment->sessionId[i]);
+            laps->readerId.append(segment->readerId[i]);
+            laps->antennaId.append(segment->antennaId[i]);
+            laps->lapmsec.append(segment->lapmsec[i]);
+            laps->lapm.append(segment->lapmm[i] / 1000.f);
+        }
+    }
+
+    // tagIds are written before the laps that use them are counted, so reading them after the counts gets them all
+
+    if (key < 0) {
+        if (loadTagIds() != 0 || maxKey >= tagIds.size()) {
+            if (errorTextVal.isEmpty())
+                errorTextVal = "Lap log has laps for tag keys not in " + tagsFile.fileName();
+            qDebug() << errorTextVal;
+            laps->clear();
+            return 3;
+        }
+        laps->tagIds = tagIds;
+        laps->tagKeys = tagKeys;
+    }
+
+    // Laps are in the order they were appended, which is time order unless readers' clocks
+    // disagree.  Every rider's laps are grouped by tagId first with a counting sort, which
+    // keeps their order, then put in time order where they aren't already.
+
+    QVector<int> order;
+    QVector<int> groupStart(1, 0);
+    if (key < 0) {
+        QVector<int> byTagId(tagIds.size());
+        for (int i=0; i<byTagId.size(); i++)
+            byTagId[i] = i;
+        std::sort(byTagId.begin(), byTagId.end(), [this](int a, int b) { return tagIds[a] < tagIds[b]; });
+        QVector<int> position(tagIds.size() + 1, 0);
+        for (int i=0; i<laps->size(); i++)
+            position[laps->tagIndex[i] + 1]++;
+        QVector<int> start(tagIds.size(), 0);
+        int next = 0;
+        for (int i=0; i<byTagId.size(); i++) {
+            start[byTagId[i]] = next;
+            next += position[byTagId[i] + 1];
+            groupStart.append(next);
+        }
+        order.resize(laps->size());
+        for (int i=0; i<laps->size(); i++)
+            order[start[laps->tagIndex[i]]++] = i;
+    }
+    else {
+        groupStart.append(laps->size());
+    }
+
+    const QVector<qint64> &timeStampUSec = laps->timeStampUSec;
+    bool reordered = !order.isEmpty();
+    for (int g=1; g<groupStart.size(); g++) {
+        int from = groupStart[g-1];
+        int to = groupStart[g];
+        bool sorted = true;
+        for (int i=from+1; i<to && sorted; i++)
+            sorted = order.isEmpty() ? timeStampUSec[i] >= timeStampUSec[i-1] : timeStampUSec[order[i]] >= timeStampUSec[order[i-1]];
+        if (sorted)
+            continue;
+        if (order.isEmpty()) {
+            order.resize(laps->size());
+            for (int i=0; i<order.size(); i++)
+                order[i] = i;
+        }
+        std::stable_sort(order.begin() + from, order.begin() + to, [&timeStampUSec](int a, int b) { return timeStampUSec[a] < timeStampUSec[b]; });
+        reordered = true;
+    }
+    if (reordered) {
+        permute(&laps->tagIndex, order);
+        permute(&laps->timeStampUSec, order);
+        permute(&laps->sessionId, order);
+        permute(&laps->readerId, order);
+        permute(&laps->antennaId, order);
+        permute(&laps->lapmsec, order);
+        permute(&laps->lapm, order);
+    }
+
+    errorTextVal.clear();
+    return 0;
+}
+
+
+
+long long CLapLog::lapCount(void) {
+    if (!isOpen || mapSegments() != 0)
+        return -1;
+
+    long long count = 0;
+    for (int n=0; n<segments.size(); n++)
+        count += segments[n]->publishedCount();
+    return count;
+}
+
+
+
+// timeStampRange
+// From the headers of full segments, whose time range doesn't change again, and the
+// columns of the one being written
+//
+int CLapLog::timeStampRange(long long *first, long long *last) {
+    *first = 0;
+    *last = -1;
+    if (!isOpen)
+        return 1;
+    if (mapSegments() != 0) {
+        qDebug() << errorTextVal;
+        return 2;
+    }
+
+    bool haveLaps = false;
+    for (int n=0; n<segments.size(); n++) {
+        CLapLogSegment *segment = segments[n];
+        int count = segment->publishedCount();
+        qint64 minTimeStampUSec;
+        qint64 maxTimeStampUSec;
+        if (count == 0)
+            continue;
+        if (count == segment->header->capacity) {
+            minTimeStampUSec = segment->header->minTimeStampUSec;
+            maxTimeStampUSec = segment->header->maxTimeStampUSec;
+        }
+        else {
+            minTimeStampUSec = maxTimeStampUSec = segment->timeStampUSec[0];
+            for (int i=1; i<count; i++) {
+                minTimeStampUSec = qMin(minTimeStampUSec, segment->timeStampUSec[i]);
+                maxTimeStampUSec = qMax(maxTimeStampUSec, segment->timeStampUSec[i]);
+            }
+        }
+        if (!haveLaps || minTimeStampUSec < *first)
+            *first = minTimeStampUSec;
+        if (!haveLaps || maxTimeStampUSec > *last)
+            *last = maxTimeStampUSec;
+        haveLaps = true;
+    }
+    return 0;
+}
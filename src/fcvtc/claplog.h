@@ -0,0 +1,73 @@
+// claplog.h
+//
+
+#ifndef CLAPLOG_H
+#define CLAPLOG_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+#include <QFile>
+
+#include "clapstore.h"
+
+
+class CLapLogSegment;
+
+
+// CLapLog keeps laps in a directory of append-only segment files, each
+// memory-mapped and holding up to segmentCapacity laps a column at a time:
+// timestamp, tag key, session, lap msec, lap mm, reader and antenna, all
+// fixed width.  A tag key is the line number of the tagId in the directory's
+// tags file.  Each segment's header has its lap count and the first and last
+// timestamps in it, so a scan skips full segments outside its time range and
+// runs a flat compare over the columns of the rest.
+//
+// A lap is counted in the header only after its columns are written, so any
+// number of CLapLogs, in any thread, can scan while one appends.  Files are
+// in host byte order.
+//
+// With a mark database, commit() also records the log's lap count there, in the
+// lapLogMarks row for the directory, and reconcile() uncounts laps past it.
+
+class CLapLog : public CLapStore
+{
+public:
+    explicit CLapLog(const QString &directory, int segmentCapacity=defaultSegmentCapacity);
+    virtual ~CLapLog(void);
+    virtual int open(void);
+    virtual void close(void);
+    virtual int append(const QList<CLapRecord> &laps);
+    virtual int commit(void);
+    virtual void rollback(void);
+    virtual int reconcile(void);
+    virtual int scan(const QByteArray &tagId, long long timeStampUSecStart, long long timeStampUSecEnd, CLapColumns *laps);
+    virtual long long lapCount(void);
+    virtual int timeStampRange(long long *first, long long *last);
+    void setMarkDatabase(QSqlDatabase db);
+    static const int defaultSegmentCapacity = 1 << 16;
+private:
+    QString directory;
+    int segmentCapacity;
+    QSqlDatabase markDb;            // where commit() records the lap count, none when not valid
+    bool isOpen;
+    QList<CLapLogSegment *> segments;
+    QFile tagsFile;
+    qint64 tagsFileRead;            // bytes of the tags file read into tagIds, whole lines only
+    QList<QByteArray> tagIds;       // by tag key
+    QHash<QByteArray, int> tagKeys;
+    bool appending;                 // this CLapLog has appended, it is the one writer
+    int firstStagedSegment;         // laps appended but not committed start in this segment
+    int writeSegment;               // where the next lap goes
+    int writePosition;
+    QString segmentFileName(int number);
+    int mapSegments(void);
+    int createSegment(void);
+    int loadTagIds(void);
+    int startAppending(void);
+    int tagKey(const QByteArray &tagId);
+    int truncate(long long count);
+};
+
+#endif // CLAPLOG_H
@@ -0,0 +1,309 @@
+// clapstore.cpp
+
+
+#include "clapstore.h"
+#include "claplog.h"
+#include "clapwriter.h"
+
+
+
+void CLapColumns::clear(void) {
+    tagIds.clear();
+    tagKeys.clear();
+    tagIndex.clear();
+    timeStampUSec.clear();
+    sessionId.clear();
+    readerId.clear();
+    antennaId.clear();
+    lapmsec.clear();
+    lapm.clear();
+}
+
+
+
+int CLapColumns::size(void) const {
+    return timeStampUSec.size();
+}
+
+
+
+// addTagId
+// Index of tagId in tagIds, adding it if it isn't there
+//
+int CLapColumns::addTagId(const QByteArray &tagId) {
+    int i = tagKeys.value(tagId, -1);
+    if (i >= 0)
+        return i;
+    tagKeys.insert(tagId, tagIds.size());
+    tagIds.append(tagId);
+    return tagIds.size() - 1;
+}
+
+
+
+CLapRecord CLapColumns::record(int i) const {
+    CLapRecord lap;
+    lap.tagId = tagIds[tagIndex[i]];
+    lap.timeStampUSec = timeStampUSec[i];
+    lap.sessionId = sessionId[i];
+    lap.readerId = readerId[i];
+    lap.antennaId = antennaId[i];
+    lap.lapmsec = lapmsec[i];
+    lap.lapm = lapm[i];
+    return lap;
+}
+
+
+
+// compare
+// Describe in differences each way other differs from these laps.  lapm is
+// compared to the mm, the precision the lap log keeps.  Return the number of
+// differences.
+//
+int CLapColumns::compare(const CLapColumns &other, QStringList *differences) const {
+    if (size() != other.size()) {
+        differences->append(QString("%1 laps, other has %2").arg(size()).arg(other.size()));
+        return 1;
+    }
+
+    int differenceCount = 0;
+    for (int i=0; i<size(); i++) {
+        const QByteArray &tagId = tagIds[tagIndex[i]];
+        if (tagId != other.tagIds[other.tagIndex[i]] || timeStampUSec[i] != other.timeStampUSec[i] ||
+            sessionId[i] != other.sessionId[i] || readerId[i] != other.readerId[i] ||
+            antennaId[i] != other.antennaId[i] || lapmsec[i] != other.lapmsec[i] ||
+            qAbs(lapm[i] - other.lapm[i]) > 0.0005 + 1e-6 * qAbs(lapm[i])) {
+            if (differenceCount < 20)
+                differences->append(QString("lap %1: %2 at %3 %4 msec %5 m, other has %6 at %7 %8 msec %9 m").arg(i)
+                                    .arg(QString(tagId)).arg(timeStampUSec[i]).arg(lapmsec[i]).arg(lapm[i])
+                                    .arg(QString(other.tagIds[other.tagIndex[i]])).arg(other.timeStampUSec[i])
+                                    .arg(other.lapmsec[i]).arg(other.lapm[i]));
+            differenceCount++;
+        }
+    }
+    if (differenceCount > 20)
+        differences->append(QString("and %1 more laps differ").arg(differenceCount - 20));
+    return differenceCount;
+}
+
+
+
+CLapStore::~CLapStore(void) {
+}
+
+
+
+QString CLapStore::errorText(void) {
+    return errorTextVal;
+}
+
+
+
+// create
+// The lap log in lapLogDirectory, keeping its mark in db, or the laps table in db when
+// lapLogDirectory is empty.  Not yet opened.
+//
+CLapStore *CLapStore::create(const QString &lapLogDirectory, QSqlDatabase db) {
+    if (lapLogDirectory.isEmpty())
+        return new CSqliteLapStore(db);
+    CLapLog *lapLog = new CLapLog(lapLogDirectory);
+    lapLog->setMarkDatabase(db);
+    return lapLog;
+}
+
+
+
+// copy
+// Append every lap in from to to, a month at a time so only a month's laps are
+// in memory, and commit.  Return 0 on success.
+//
+int CLapStore::copy(CLapStore *from, CLapStore *to) {
+    long long first;
+    long long last;
+    if (from->timeStampRange(&first, &last) != 0) {
+        to->errorTextVal = from->errorText();
+        return 1;
+    }
+
+    CLapColumns laps;
+    for (long long start = CLapRollup::monthOf(first); start <= last; start = CLapRollup::nextMonthOf(start)) {
+        if (from->scan("", start, CLapRollup::nextMonthOf(start), &laps) != 0) {
+            to->errorTextVal = from->errorText();
+            return 2;
+        }
+        QList<CLapRecord> records;
+        records.reserve(laps.size());
+        for (int i=0; i<laps.size(); i++)
+            records.append(laps.record(i));
+        if (to->append(records) != 0 || to->commit() != 0) {
+            to->rollback();
+            return 3;
+        }
+    }
+    return 0;
+}
+
+
+
+CSqliteLapStore::CSqliteLapStore(QSqlDatabase db)
+    : db(db), insertLap(db), selectTagLaps(db), selectAllLaps(db) {
+    prepared = false;
+}
+
+
+
+CSqliteLapStore::~CSqliteLapStore(void) {
+    close();
+}
+
+
+
+int CSqliteLapStore::open(void) {
+    errorTextVal.clear();
+    return db.isOpen() ? 0 : 1;
+}
+
+
+
+int CSqliteLapStore::prepare(void) {
+    if (prepared)
+        return 0;
+    if (!insertLap.prepare("INSERT INTO laps (tagId, timeStampUSec, sessionId, readerId, antennaId, lapmsec, lapm) "
+                           "VALUES (:tagId, :timeStampUSec, :sessionId, :readerId, :antennaId, :lapmsec, :lapm)") ||
+        !selectTagLaps.prepare("SELECT tagId, timeStampUSec, sessionId, readerId, antennaId, lapmsec, lapm FROM laps "
+                               "WHERE tagId = :tagId AND timeStampUSec >= :start AND timeStampUSec < :end ORDER BY timeStampUSec, id") ||
+        !selectAllLaps.prepare("SELECT tagId, timeStampUSec, sessionId, readerId, antennaId, lapmsec, lapm FROM laps "
+                               "WHERE timeStampUSec >= :start AND timeStampUSec < :end ORDER BY tagId, timeStampUSec, id")) {
+        errorTextVal = "Could not prepare laps table statements: " + db.lastError().text();
+        qDebug() << errorTextVal;
+        return 1;
+    }
+    selectTagLaps.setForwardOnly(true);
+    selectAllLaps.setForwardOnly(true);
+    prepared = true;
+    return 0;
+}
+
+
+
+void CSqliteLapStore::close(void) {
+    insertLap.finish();
+    selectTagLaps.finish();
+    selectAllLaps.finish();
+    prepared = false;
+}
+
+
+
+// append
+// Insert the laps in the connection's current transaction.  Return 0 on success.
+//
+int CSqliteLapStore::append(const QList<CLapRecord> &laps) {
+    if (prepare() != 0)
+        return 2;
+    for (int i=0; i<laps.size(); i++) {
+        const CLapRecord &lap = laps[i];
+        insertLap.bindValue(":tagId", lap.tagId);
+        insertLap.bindValue(":timeStampUSec", lap.timeStampUSec);
+        insertLap.bindValue(":sessionId", lap.sessionId);
+        insertLap.bindValue(":readerId", lap.readerId);
+        insertLap.bindValue(":antennaId", lap.antennaId);
+        insertLap.bindValue(":lapmsec", lap.lapmsec);
+        insertLap.bindValue(":lapm", lap.lapm);
+        if (!insertLap.exec()) {
+            errorTextVal = "Could not add to laps table: " + insertLap.lastError().text();
+            qDebug() << errorTextVal;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+
+
+int CSqliteLapStore::commit(void) {
+    return 0;
+}
+
+
+
+void CSqliteLapStore::rollback(void) {
+}
+
+
+
+int CSqliteLapStore::reconcile(void) {
+    return 0;
+}
+
+
+
+int CSqliteLapStore::scan(const QByteArray &tagId, long long timeStampUSecStart, long long timeStampUSecEnd, CLapColumns *laps) {
+    laps->clear();
+    if (prepare() != 0)
+        return 2;
+    QSqlQuery &query = tagId.isEmpty() ? selectAllLaps : selectTagLaps;
+    if (!tagId.isEmpty())
+        query.bindValue(":tagId", tagId);
+    query.bindValue(":start", timeStampUSecStart);
+    query.bindValue(":end", timeStampUSecEnd);
+    if (!query.exec()) {
+        errorTextVal = query.lastError().text();
+        qDebug() << errorTextVal;
+        return 1;
+    }
+
+    // Laps come grouped by rider, only look the tagId up when it changes
+
+    QByteArray previousTagId;
+    int index = -1;
+    while (query.next()) {
+        QByteArray lapTagId = query.value(0).toByteArray();
+        if (index < 0 || lapTagId != previousTagId) {
+            index = laps->addTagId(lapTagId);
+            previousTagId = lapTagId;
+        }
+        laps->tagIndex.append(index);
+        laps->timeStampUSec.append(query.value(1).toLongLong());
+        laps->sessionId.append(query.value(2).toInt());
+        laps->readerId.append(query.value(3).toInt());
+        laps->antennaId.append(query.value(4).toInt());
+        laps->lapmsec.append(query.value(5).toInt());
+        laps->lapm.append(query.value(6).toFloat());
+    }
+    query.finish();
+    errorTextVal.clear();
+    return 0;
+}
+
+
+
+long long CSqliteLapStore::lapCount(void) {
+    QSqlQuery query(db);
+    if (!query.exec("SELECT COUNT(*) FROM laps") || !query.next()) {
+        errorTextVal = query.lastError().text();
+        qDebug() << errorTextVal;
+        return -1;
+    }
+    return query.value(0).toLongLong();
+}
+
+
+
+int CSqliteLapStore::timeStampRange(long long *first, long long *last) {
+    QSqlQuery query(db);
+    if (!query.exec("SELECT MIN(timeStampUSec), MAX(timeStampUSec) FROM laps") || !query.next()) {
+        errorTextVal = query.lastError().text();
+        qDebug() << errorTextVal;
+        return 1;
+    }
+    if (query.value(0).isNull()) {
+        *first = 0;
+        *last = -1;
+    }
+    else {
+        *first = query.value(0).toLongLong();
+        *last = query.value(1).toLongLong();
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+// clapstore.h
+//
+
+#ifndef CLAPSTORE_H
+#define CLAPSTORE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include <QtSql/QtSql>
+
+
+// One lap as written to the lap store
+
+class CLapRecord {
+public:
+    QByteArray tagId;
+    long long timeStampUSec;    // reader's timestamp for the crossing, usec since the epoch
+    int sessionId;              // CDbase's row in the sessions table
+    int readerId;
+    int antennaId;
+    int lapmsec;
+    float lapm;
+};
+
+
+// Laps read back from a lap store, a column per field.  Lap i's rider
+// is tagIds[tagIndex[i]].  tagKeys indexes tagIds, add riders with
+// addTagId() or set both.
+
+class CLapColumns {
+public:
+    void clear(void);
+    int size(void) const;
+    int addTagId(const QByteArray &tagId);
+    CLapRecord record(int i) const;
+    int compare(const CLapColumns &other, QStringList *differences) const;
+    QList<QByteArray> tagIds;
+    QHash<QByteArray, int> tagKeys;     // index in tagIds by tagId
+    QVector<int> tagIndex;
+    QVector<qint64> timeStampUSec;
+    QVector<int> sessionId;
+    QVector<int> readerId;
+    QVector<int> antennaId;
+    QVector<int> lapmsec;
+    QVector<float> lapm;
+};
+
+
+// CLapStore is where laps are kept.  CSqliteLapStore, the laps table, is the
+// default; CLapLog keeps them in memory-mapped files for fast scans.  Names,
+// sessions and the lapsDay and lapsMonth rollups stay in SQLite either way.
+//
+// append() stages laps, commit() makes them visible to scan() and rollback()
+// drops them.  The SQLite store's laps go in the connection's own transaction,
+// so for it commit() and rollback() have nothing to do, the caller commits or
+// rolls back the connection.  Only one store at a time may append.
+//
+// When laps and the rollups that count them are written together the store is
+// committed first, then the connection.  A lap log records its new lap count in
+// the connection's transaction as it commits, and reconcile() drops the laps
+// past the count last committed there, those of a commit whose transaction was
+// rolled back or never made it to the disk.  The appending store calls it before
+// its first append; call it after rolling back a transaction once the store has
+// committed.
+//
+// scan() gives the laps of tagId (every rider when tagId is empty) from
+// timeStampUSecStart up to but not including timeStampUSecEnd, in time
+// order, or in tagId then time order for every rider.  Return 0 on success.
+// timeStampRange() gives the first and last lap times, first > last when
+// there are no laps.
+
+class CLapStore
+{
+public:
+    virtual ~CLapStore(void);
+    virtual int open(void) = 0;
+    virtual void close(void) = 0;
+    virtual int append(const QList<CLapRecord> &laps) = 0;
+    virtual int commit(void) = 0;
+    virtual void rollback(void) = 0;
+    virtual int reconcile(void) = 0;
+    virtual int scan(const QByteArray &tagId, long long timeStampUSecStart, long long timeStampUSecEnd, CLapColumns *laps) = 0;
+    virtual long long lapCount(void) = 0;
+    virtual int timeStampRange(long long *first, long long *last) = 0;
+    QString errorText(void);
+    static CLapStore *create(const QString &lapLogDirectory, QSqlDatabase db);
+    static int copy(CLapStore *from, CLapStore *to);
+    static const long long timeStampUSecMin = -(1LL << 62);
+    static const long long timeStampUSecMax = 1LL << 62;
+protected:
+    QString errorTextVal;
+};
+
+
+// The laps table through db, whichever thread's connection that is.  Statements
+// are prepared on first use, so one can be made before the schema is migrated.
+
+class CSqliteLapStore : public CLapStore
+{
+public:
+    explicit CSqliteLapStore(QSqlDatabase db);
+    virtual ~CSqliteLapStore(void);
+    virtual int open(void);
+    virtual void close(void);
+    virtual int append(const QList<CLapRecord> &laps);
+    virtual int commit(void);
+    virtual void rollback(void);
+    virtual int reconcile(void);
+    virtual int scan(const QByteArray &tagId, long long timeStampUSecStart, long long timeStampUSecEnd, CLapColumns *laps);
+    virtual long long lapCount(void);
+    virtual int timeStampRange(long long *first, long long *last);
+private:
+    QSqlDatabase db;
+    bool prepared;
+    int prepare(void);
+    QSqlQuery insertLap;
+    QSqlQuery selectTagLaps;
+    QSqlQuery selectAllLaps;
+};
+
+#endif // CLAPSTORE_H
@@ -0,0 +1,502 @@
+// clapwriter.cpp
+
+
+#include "clapwriter.h"
+
+
+
+// The statements the writer thread prepares once and reuses for every batch
+
+class CLapWriterQueries {
+public:
+    CLapWriterQueries(QSqlDatabase &db);
+    void finish(void);
+    QSqlQuery selectLastTimeStamp;
+    QSqlQuery updateDay;
+    QSqlQuery insertDay;
+    QSqlQuery updateMonth;
+    QSqlQuery insertMonth;
+};
+
+
+
+// Rollup updates.  All SET expressions see the old row, so bestLapm is
+// compared against the old bestLapmsec.
+
+static QString rollupUpdateSql(const QString &table) {
+    return "UPDATE " + table + " SET lapCount = lapCount + 1, lapmsec = lapmsec + ?, lapm = lapm + ?, "
+           "bestLapm = CASE WHEN ? < bestLapmsec THEN ? ELSE bestLapm END, bestLapmsec = MIN(bestLapmsec, ?), "
+           "workoutCount = workoutCount + ?, lastTimeStampUSec = MAX(lastTimeStampUSec, ?) WHERE tagId = ? AND period = ?";
+}
+
+static QString rollupInsertSql(const QString &table) {
+    return "INSERT INTO " + table + " (tagId, period, lapCount, lapmsec, lapm, bestLapmsec, bestLapm, "
+           "workoutCount, continuedWorkout, firstTimeStampUSec, lastTimeStampUSec) VALUES (?, ?, 1, ?, ?, ?, ?, ?, ?, ?, ?)";
+}
+
+
+
+CLapWriterQueries::CLapWriterQueries(QSqlDatabase &db)
+    : selectLastTimeStamp(db), updateDay(db), insertDay(db), updateMonth(db), insertMonth(db) {
+    selectLastTimeStamp.prepare("SELECT MAX(lastTimeStampUSec) FROM lapsMonth WHERE tagId = ?");
+    updateDay.prepare(rollupUpdateSql("lapsDay"));
+    insertDay.prepare(rollupInsertSql("lapsDay"));
+    updateMonth.prepare(rollupUpdateSql("lapsMonth"));
+    insertMonth.prepare(rollupInsertSql("lapsMonth"));
+}
+
+
+
+void CLapWriterQueries::finish(void) {
+    selectLastTimeStamp.finish();
+    updateDay.finish();
+    insertDay.finish();
+    updateMonth.finish();
+    insertMonth.finish();
+}
+
+
+
+CLapRollup::CLapRollup(void) {
+    lapCount = 0;
+    lapmsec = 0;
+    lapm = 0.;
+    bestLapmsec = 0;
+    bestLapm = 0.;
+    workoutCount = 0;
+    continuedWorkout = 0;
+    firstTimeStampUSec = 0;
+    lastTimeStampUSec = 0;
+}
+
+
+
+// addLap
+// Count a lap into the rollup.  Laps must come in time order.
+//
+void CLapRollup::addLap(long long timeStampUSec, int lapmsec, float lapm, bool newWorkout) {
+    if (lapCount == 0) {
+        bestLapmsec = lapmsec;
+        bestLapm = lapm;
+        continuedWorkout = newWorkout ? 0 : 1;
+        firstTimeStampUSec = timeStampUSec;
+    }
+    else if (lapmsec < bestLapmsec) {
+        bestLapmsec = lapmsec;
+        bestLapm = lapm;
+    }
+    lapCount++;
+    this->lapmsec += lapmsec;
+    this->lapm += lapm;
+    if (newWorkout)
+        workoutCount++;
+    lastTimeStampUSec = timeStampUSec;
+}
+
+
+
+// addRollup
+// Add the rollup of a later period, as when months are added up for a year.
+//
+void CLapRollup::addRollup(const CLapRollup &later) {
+    if (later.lapCount == 0)
+        return;
+
+    if (lapCount == 0) {
+        bestLapmsec = later.bestLapmsec;
+        bestLapm = later.bestLapm;
+        continuedWorkout = later.continuedWorkout;
+        firstTimeStampUSec = later.firstTimeStampUSec;
+    }
+    else if (later.bestLapmsec < bestLapmsec) {
+        bestLapmsec = later.bestLapmsec;
+        bestLapm = later.bestLapm;
+    }
+    lapCount += later.lapCount;
+    lapmsec += later.lapmsec;
+    lapm += later.lapm;
+    workoutCount += later.workoutCount;
+    lastTimeStampUSec = later.lastTimeStampUSec;
+}
+
+
+
+// toStats
+// Stats for the period alone, where a workout carried on from before still counts
+//
+void CLapRollup::toStats(CStats *stats) const {
+    stats->lapCount = lapCount;
+    stats->workoutCount = workoutCount + continuedWorkout;
+    stats->bestLapSec = lapCount ? bestLapmsec : -1;
+    stats->bestLapM = lapCount ? bestLapm : 0.;
+    stats->totalSec = lapmsec / 1000.;
+    stats->totalM = lapm;
+}
+
+
+
+// dayOf
+// Start of the local day holding timeStampUSec, in usec since the epoch
+//
+long long CLapRollup::dayOf(long long timeStampUSec) {
+    QDateTime t = QDateTime::fromMSecsSinceEpoch(timeStampUSec / 1000);
+    return QDateTime(t.date(), QTime(0, 0)).toMSecsSinceEpoch() * 1000;
+}
+
+
+
+// monthOf
+// Start of the local month holding timeStampUSec, in usec since the epoch
+//
+long long CLapRollup::monthOf(long long timeStampUSec) {
+    QDate d = QDateTime::fromMSecsSinceEpoch(timeStampUSec / 1000).date();
+    return QDateTime(QDate(d.year(), d.month(), 1), QTime(0, 0)).toMSecsSinceEpoch() * 1000;
+}
+
+
+
+// nextMonthOf
+// Start of the local month after the one holding timeStampUSec
+//
+long long CLapRollup::nextMonthOf(long long timeStampUSec) {
+    QDate d = QDateTime::fromMSecsSinceEpoch(timeStampUSec / 1000).date();
+    return QDateTime(QDate(d.year(), d.month(), 1).addMonths(1), QTime(0, 0)).toMSecsSinceEpoch() * 1000;
+}
+
+
+
+// isNewWorkout
+// True when a lap at timeStampUSec starts a workout, the same test getStatsForPeriod makes
+//
+bool CLapRollup::isNewWorkout(bool havePrevious, long long previousTimeStampUSec, long long timeStampUSec) {
+    if (!havePrevious)
+        return true;
+    return timeStampUSec - previousTimeStampUSec > workoutSeparationUSec;
+}
+
+
+
+CLapWriterStats::CLapWriterStats(void) {
+    queueDepth = 0;
+    maxQueueDepth = 0;
+    lapCount = 0;
+    commitCount = 0;
+    failedCommitCount = 0;
+    failedCommitsInARow = 0;
+    writerFailed = false;
+    lostLapCount = 0;
+    lastCommitMsec = 0;
+    maxCommitMsec = 0;
+    totalCommitMsec = 0;
+}
+
+
+
+CLapWriter::CLapWriter(QString databaseName, QString lapLogDirectory, int maxBatchCount, int maxBatchMsec) {
+    this->databaseName = databaseName;
+    this->lapLogDirectory = lapLogDirectory;
+    this->maxBatchCount = maxBatchCount;
+    this->maxBatchMsec = maxBatchMsec;
+    connectionName = "lapWriter";
+    stopRequested = false;
+    writerFailed = false;
+    thread = NULL;
+}
+
+
+
+CLapWriter::~CLapWriter(void) {
+}
+
+
+
+// addLap
+// Queue a lap for the writer thread.  Called from the GUI thread, never waits for the disk.
+//
+int CLapWriter::addLap(const CLapRecord &lap) {
+    QMutexLocker locker(&queueMutex);
+
+    if (writerFailed || stopRequested || queue.size() >= maxQueueCount) {
+        stats.lostLapCount++;
+        return 1;
+    }
+
+    if (queue.isEmpty())
+        firstQueuedTimer.start();
+    queue.append(lap);
+    stats.queueDepth = queue.size();
+    if (stats.queueDepth > stats.maxQueueDepth)
+        stats.maxQueueDepth = stats.queueDepth;
+    queueCondition.wakeOne();
+    return 0;
+}
+
+
+
+// stop
+// Ask the writer to commit what is queued and finish.  Wait on thread after calling this.
+//
+void CLapWriter::stop(void) {
+    QMutexLocker locker(&queueMutex);
+    stopRequested = true;
+    queueCondition.wakeAll();
+}
+
+
+
+CLapWriterStats CLapWriter::getStats(void) {
+    QMutexLocker locker(&queueMutex);
+    return stats;
+}
+
+
+
+// onStarted
+// Runs in the writer thread until stop() is called and the queue is empty
+//
+void CLapWriter::onStarted(void) {
+    {
+        // The connection is made, used and closed in this thread only
+
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(databaseName);
+        CLapStore *lapStore = NULL;
+        if (!db.open()) {
+            qDebug() << "Lap writer could not open database:" << db.lastError().text();
+            refuseLaps();
+        }
+        else if ((lapStore = CLapStore::create(lapLogDirectory, db))->open() != 0) {
+            qDebug() << "Lap writer could not open lap store:" << lapStore->errorText();
+            refuseLaps();
+        }
+        else {
+            // WAL lets the GUI thread read while a batch is being written and
+            // makes each commit one append to the log rather than a journal
+            // write and a database write
+
+            QSqlQuery pragma(db);
+            if (!pragma.exec("PRAGMA journal_mode=WAL") || !pragma.next() || pragma.value(0).toString() != "wal")
+                qDebug() << "Lap writer could not set WAL mode, continuing with" << pragma.value(0).toString();
+            pragma.finish();
+
+            CLapWriterQueries queries(db);
+
+            forever {
+                QList<CLapRecord> batch;
+
+                queueMutex.lock();
+                while (queue.isEmpty() && !stopRequested)
+                    queueCondition.wait(&queueMutex);
+
+                // Give the batch until maxBatchMsec after its first lap to fill
+
+                while (!stopRequested && queue.size() < maxBatchCount) {
+                    qint64 remainingMsec = maxBatchMsec - firstQueuedTimer.elapsed();
+                    if (remainingMsec <= 0)
+                        break;
+                    queueCondition.wait(&queueMutex, (unsigned long)remainingMsec);
+                }
+
+                if (queue.isEmpty()) {
+                    queueMutex.unlock();
+                    break;      // stop requested and nothing left
+                }
+
+                // Laps left over start their window from when the oldest was queued,
+                // so firstQueuedTimer is not restarted and they go out next time round
+
+                batch = queue.mid(0, maxBatchCount);
+                queue.erase(queue.begin(), queue.begin() + batch.size());
+                stats.queueDepth = queue.size();
+                queueMutex.unlock();
+
+                if (commitBatch(db, queries, lapStore, batch) != 0) {
+                    // Put the laps back and try again after a pause, unless shutting down
+                    // or the commits have kept failing
+
+                    queueMutex.lock();
+                    for (int i=batch.size()-1; i>=0; i--)
+                        queue.prepend(batch[i]);
+                    stats.queueDepth = queue.size();
+                    stats.failedCommitsInARow++;
+                    bool stopping = stopRequested;
+                    int failures = stats.failedCommitsInARow;
+                    queueMutex.unlock();
+                    if (stopping || failures >= maxFailedCommits) {
+                        if (stopping)
+                            qDebug() << "Lap writer stopping after a failed commit";
+                        else
+                            qDebug() << "Lap writer giving up after" << failures << "failed commits in a row";
+                        refuseLaps();
+                        break;
+                    }
+                    QThread::msleep(maxBatchMsec);
+                }
+            }
+            queries.finish();
+        }
+        delete lapStore;
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    if (thread)
+        thread->quit();
+}
+
+
+
+// refuseLaps
+// The writer can't write, drop what is queued and refuse what comes
+//
+void CLapWriter::refuseLaps(void) {
+    QMutexLocker locker(&queueMutex);
+    writerFailed = true;
+    stats.writerFailed = true;
+    if (!queue.isEmpty())
+        qDebug() << queue.size() << "laps not saved";
+    stats.lostLapCount += queue.size();
+    queue.clear();
+    stats.queueDepth = 0;
+}
+
+
+
+// commitBatch
+// Write the laps in one transaction.  Return 0 on success.
+//
+int CLapWriter::commitBatch(QSqlDatabase &db, CLapWriterQueries &queries, CLapStore *lapStore, const QList<CLapRecord> &batch) {
+    QElapsedTimer commitTimer;
+    commitTimer.start();
+
+    if (!db.transaction()) {
+        qDebug() << "Lap writer could not begin transaction:" << db.lastError().text();
+        QMutexLocker locker(&queueMutex);
+        stats.failedCommitCount++;
+        return 1;
+    }
+
+    if (lapStore->append(batch) != 0) {
+        db.rollback();
+        lapStore->rollback();
+        lastTimeStampByTag.clear();
+        QMutexLocker locker(&queueMutex);
+        stats.failedCommitCount++;
+        return 2;
+    }
+
+    for (int i=0; i<batch.size(); i++) {
+        const CLapRecord &lap = batch[i];
+
+        // Rollups.  Whether the lap starts a workout depends on the rider's
+        // previous lap, cached after the first lookup.
+
+        bool havePrevious = lastTimeStampByTag.contains(lap.tagId);
+        if (!havePrevious) {
+            queries.selectLastTimeStamp.addBindValue(lap.tagId);
+            if (queries.selectLastTimeStamp.exec() && queries.selectLastTimeStamp.next() && !queries.selectLastTimeStamp.value(0).isNull()) {
+                lastTimeStampByTag[lap.tagId] = queries.selectLastTimeStamp.value(0).toLongLong();
+                havePrevious = true;
+            }
+            queries.selectLastTimeStamp.finish();
+        }
+        bool newWorkout = CLapRollup::isNewWorkout(havePrevious, lastTimeStampByTag.value(lap.tagId), lap.timeStampUSec);
+
+        if (addToRollup(queries.updateDay, queries.insertDay, lap, CLapRollup::dayOf(lap.timeStampUSec), newWorkout) != 0 ||
+            addToRollup(queries.updateMonth, queries.insertMonth, lap, CLapRollup::monthOf(lap.timeStampUSec), newWorkout) != 0) {
+            db.rollback();
+            lapStore->rollback();
+            lastTimeStampByTag.clear();
+            QMutexLocker locker(&queueMutex);
+            stats.failedCommitCount++;
+            return 4;
+        }
+        if (!havePrevious || lap.timeStampUSec > lastTimeStampByTag.value(lap.tagId))
+            lastTimeStampByTag[lap.tagId] = lap.timeStampUSec;
+    }
+
+    // The lap store first.  A lap log records its new lap count in this transaction,
+    // so when the transaction doesn't commit reconcile() drops the laps it counted,
+    // here or, after a crash, before the next append.
+
+    if (lapStore->commit() != 0) {
+        qDebug() << "Lap writer could not commit to lap store:" << lapStore->errorText();
+        db.rollback();
+        lapStore->rollback();
+        lapStore->reconcile();
+        lastTimeStampByTag.clear();
+        QMutexLocker locker(&queueMutex);
+        stats.failedCommitCount++;
+        return 5;
+    }
+
+    if (!db.commit()) {
+        qDebug() << "Lap writer could not commit:" << db.lastError().text();
+        db.rollback();
+        lapStore->rollback();
+        if (lapStore->reconcile() != 0)
+            qDebug() << "Lap writer could not drop the lap store's uncommitted laps:" << lapStore->errorText();
+        lastTimeStampByTag.clear();
+        QMutexLocker locker(&queueMutex);
+        stats.failedCommitCount++;
+        return 3;
+    }
+
+    int commitMsec = (int)commitTimer.elapsed();
+    {
+        QMutexLocker locker(&queueMutex);
+        stats.lapCount += batch.size();
+        stats.commitCount++;
+        stats.failedCommitsInARow = 0;
+        stats.lastCommitMsec = commitMsec;
+        if (commitMsec > stats.maxCommitMsec)
+            stats.maxCommitMsec = commitMsec;
+        stats.totalCommitMsec += commitMsec;
+    }
+
+    QList<QByteArray> tagIds;
+    for (int i=0; i<batch.size(); i++)
+        if (!tagIds.contains(batch[i].tagId))
+            tagIds.append(batch[i].tagId);
+    emit lapsCommitted(tagIds);
+    return 0;
+}
+
+
+
+// addToRollup
+// Count the lap into its lapsDay or lapsMonth row, making the row if it is the first.  Return 0 on success.
+//
+int CLapWriter::addToRollup(QSqlQuery &update, QSqlQuery &insert, const CLapRecord &lap, long long period, bool newWorkout) {
+    update.addBindValue(lap.lapmsec);
+    update.addBindValue(lap.lapm);
+    update.addBindValue(lap.lapmsec);
+    update.addBindValue(lap.lapm);
+    update.addBindValue(lap.lapmsec);
+    update.addBindValue(newWorkout ? 1 : 0);
+    update.addBindValue(lap.timeStampUSec);
+    update.addBindValue(lap.tagId);
+    update.addBindValue(period);
+    if (!update.exec()) {
+        qDebug() << "Could not update rollup:" << update.lastError().text();
+        return 1;
+    }
+    if (update.numRowsAffected() > 0)
+        return 0;
+
+    insert.addBindValue(lap.tagId);
+    insert.addBindValue(period);
+    insert.addBindValue(lap.lapmsec);
+    insert.addBindValue(lap.lapm);
+    insert.addBindValue(lap.lapmsec);
+    insert.addBindValue(lap.lapm);
+    insert.addBindValue(newWorkout ? 1 : 0);
+    insert.addBindValue(newWorkout ? 0 : 1);
+    insert.addBindValue(lap.timeStampUSec);
+    insert.addBindValue(lap.timeStampUSec);
+    if (!insert.exec()) {
+        qDebug() << "Could not add rollup:" << insert.lastError().text();
+        return 2;
+    }
+    return 0;
+}
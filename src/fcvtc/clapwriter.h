@@ -0,0 +1,127 @@
+// clapwriter.h
+//
+
+#ifndef CLAPWRITER_H
+#define CLAPWRITER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QtSql/QtSql>
+
+#include "crider.h"
+#include "clapstore.h"
+
+
+// One row of the lapsDay or lapsMonth rollup tables: the laps of one tagId
+// in one day or month.  period is the start of the day or month in local
+// time, in usec since the epoch.  continuedWorkout is 1 when the first lap
+// in the period carried on a workout from the period before, stats for the
+// period alone count that as a workout too.
+
+class CLapRollup {
+public:
+    CLapRollup(void);
+    void addLap(long long timeStampUSec, int lapmsec, float lapm, bool newWorkout);
+    void addRollup(const CLapRollup &later);
+    void toStats(CStats *stats) const;
+    static long long dayOf(long long timeStampUSec);
+    static long long monthOf(long long timeStampUSec);
+    static long long nextMonthOf(long long timeStampUSec);
+    static bool isNewWorkout(bool havePrevious, long long previousTimeStampUSec, long long timeStampUSec);
+    static const long long workoutSeparationUSec = 12LL * 3600 * 1000000;
+    int lapCount;
+    long long lapmsec;
+    double lapm;
+    int bestLapmsec;
+    float bestLapm;
+    int workoutCount;
+    int continuedWorkout;
+    long long firstTimeStampUSec;
+    long long lastTimeStampUSec;
+};
+
+
+class CLapWriterQueries;
+
+
+// Counters kept by CLapWriter, copied out by CLapWriter::getStats()
+
+class CLapWriterStats {
+public:
+    CLapWriterStats(void);
+    int queueDepth;             // laps waiting now
+    int maxQueueDepth;          // most laps ever waiting at once
+    long long lapCount;         // laps committed
+    long long commitCount;      // transactions committed
+    long long failedCommitCount;
+    int failedCommitsInARow;    // since the last good commit
+    bool writerFailed;          // gave up, laps are refused
+    long long lostLapCount;     // laps refused or dropped, never saved
+    int lastCommitMsec;         // time for the last commit, from begin to commit
+    int maxCommitMsec;
+    long long totalCommitMsec;  // for the average, totalCommitMsec / commitCount
+};
+
+
+// CLapWriter writes laps to the lap store from its own thread with
+// its own connection to the database, so the GUI thread never waits
+// for the disk. Laps are queued by addLap() and committed in batches
+// of up to maxBatchCount laps, or whatever has arrived maxBatchMsec
+// after the first lap of the batch was queued. The database is put in
+// WAL mode so the GUI thread's reads don't block on the writer.  The
+// lapsDay and lapsMonth rollups are updated in the same transaction as
+// the laps they count; a lap log's laps are committed just before it,
+// with the log's lap count recorded in it.
+//
+// A batch that fails to commit is put back and tried again after
+// maxBatchMsec.  After maxFailedCommits failures in a row the writer
+// gives up: what is queued is dropped and later laps are refused, as
+// when the database can't be opened.  addLap() also refuses laps once
+// maxQueueCount are waiting, so a stalled writer can't use up memory.
+//
+// stop() commits everything still queued before onStarted() returns
+// and the thread finishes. Errors go to qDebug() like CDbase's do.
+
+class CLapWriter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CLapWriter(QString databaseName, QString lapLogDirectory="", int maxBatchCount=64, int maxBatchMsec=250);
+    virtual ~CLapWriter(void);
+    int addLap(const CLapRecord &lap);
+    void stop(void);
+    CLapWriterStats getStats(void);
+    QThread *thread;
+    static const int maxQueueCount = 100000;    // laps waiting at most, more are refused
+    static const int maxFailedCommits = 40;     // failed commits in a row before giving up, about 10s at the default maxBatchMsec
+private:
+    QString databaseName;
+    QString lapLogDirectory;    // empty for the laps table
+    QString connectionName;
+    int maxBatchCount;
+    int maxBatchMsec;
+    QMutex queueMutex;
+    QWaitCondition queueCondition;
+    QList<CLapRecord> queue;
+    QElapsedTimer firstQueuedTimer;     // started when a lap arrives at an empty queue
+    bool stopRequested;
+    bool writerFailed;          // could not open the database, laps are refused
+    CLapWriterStats stats;
+    QHash<QByteArray, long long> lastTimeStampByTag;      // writer thread only, rider's latest lap
+    void refuseLaps(void);
+    int commitBatch(QSqlDatabase &db, CLapWriterQueries &queries, CLapStore *lapStore, const QList<CLapRecord> &batch);
+    int addToRollup(QSqlQuery &update, QSqlQuery &insert, const CLapRecord &lap, long long period, bool newWorkout);
+signals:
+    void lapsCommitted(QList<QByteArray> tagIds);   // from the writer thread, the riders in a batch just committed
+public slots:
+    void onStarted(void);
+};
+
+#endif // CLAPWRITER_H
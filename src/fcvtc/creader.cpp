@@ -43,9 +43,53 @@ CReader::CReader(QString hostName, int readerId, CReader::antennaPositionType an
     waitingForFirstTag = true;
     timeStampCorrectionUSec = 0;
     connectionToReader = NULL;
-    typeRegistry = NULL;
+    typeRegistry = LLRP::getTheSharedTypeRegistry();
     qRegisterMetaType<CTagInfo>();      // required to emit signal with CTagInfo
     thread = NULL;
+    buildFrameTemplates();
+}
+
+
+
+// buildFrameTemplates()
+// Encode the fixed commands sent on every connection once. Each send is then
+// a copy of the frame with the MessageID (and ROSpecID, if any) patched in.
+// A template that fails to compile stays empty and transact() reports it.
+//
+void CReader::buildFrameTemplates(void) {
+    LLRP::CMessage *pCmd;
+
+    LLRP::CDELETE_ROSPEC *pDeleteCmd = new LLRP::CDELETE_ROSPEC();
+    pDeleteCmd->setROSpecID(0);
+    deleteROSpecTemplate.addSlot(&LLRP::CDELETE_ROSPEC::s_fdROSpecID);
+    if (LLRP::RC_OK != deleteROSpecTemplate.compile(pDeleteCmd))
+        qDebug("DELETE_ROSPEC template: %s", deleteROSpecTemplate.m_ErrorDetails.m_pWhatStr);
+    delete pDeleteCmd;
+
+    pCmd = composeAddROSpec();
+    if (LLRP::RC_OK != addROSpecTemplate.compile(pCmd))
+        qDebug("ADD_ROSPEC template: %s", addROSpecTemplate.m_ErrorDetails.m_pWhatStr);
+    delete pCmd;
+
+    LLRP::CENABLE_ROSPEC *pEnableCmd = new LLRP::CENABLE_ROSPEC();
+    pEnableCmd->setROSpecID(123);
+    enableROSpecTemplate.addSlot(&LLRP::CENABLE_ROSPEC::s_fdROSpecID);
+    if (LLRP::RC_OK != enableROSpecTemplate.compile(pEnableCmd))
+        qDebug("ENABLE_ROSPEC template: %s", enableROSpecTemplate.m_ErrorDetails.m_pWhatStr);
+    delete pEnableCmd;
+
+    LLRP::CSTART_ROSPEC *pStartCmd = new LLRP::CSTART_ROSPEC();
+    pStartCmd->setROSpecID(123);
+    startROSpecTemplate.addSlot(&LLRP::CSTART_ROSPEC::s_fdROSpecID);
+    if (LLRP::RC_OK != startROSpecTemplate.compile(pStartCmd))
+        qDebug("START_ROSPEC template: %s", startROSpecTemplate.m_ErrorDetails.m_pWhatStr);
+    delete pStartCmd;
+
+    LLRP::CGET_READER_CAPABILITIES *pCapCmd = new LLRP::CGET_READER_CAPABILITIES();
+    pCapCmd->setRequestedData(LLRP::GetReaderCapabilitiesRequestedData_All);
+    if (LLRP::RC_OK != getReaderCapabilitiesTemplate.compile(pCapCmd))
+        qDebug("GET_READER_CAPABILITIES template: %s", getReaderCapabilitiesTemplate.m_ErrorDetails.m_pWhatStr);
+    delete pCapCmd;
 }
 
 
@@ -71,13 +115,6 @@ CReader::~CReader(void) {
             delete connectionToReader;
             connectionToReader = NULL;
         }
-
-        // Done with the registry
-
-        if (typeRegistry) {
-            delete typeRegistry;
-            typeRegistry = NULL;
-        }
     }
     catch (const std::exception &e) {
         // Log exception when logging is implemented
@@ -157,10 +194,6 @@ void CReader::onStarted(void) {
             delete connectionToReader;
             connectionToReader = NULL;
         }
-        if (typeRegistry) {
-            delete typeRegistry;
-            typeRegistry = NULL;
-        }
     }
 }
 
@@ -170,19 +203,10 @@ int CReader::connectToReader(void) {
     QString s;
     int rc;
 
-    /*
-     * Allocate the type registry. This is needed
-     * by the connection to decode.
-     */
-
-    typeRegistry = LLRP::getTheTypeRegistry();
-    if (!typeRegistry) {
-        emit newLogMessage(s.sprintf("ERROR: getTheTypeRegistry failed"));
-        return 1;
-    }
-
     /*
      * Construct a connection (LLRP::CConnection).
+     * It decodes with the shared type registry, which
+     * is built once per process, not per connection.
      * Using a 32kb max frame size for send/recv.
      * The connection object is ready for business
      * but not actually connected to the reader yet.
@@ -190,12 +214,18 @@ int CReader::connectToReader(void) {
 
     connectionToReader = new LLRP::CConnection(typeRegistry, 32u*1024u);
     if (!connectionToReader) {
-        delete typeRegistry;
-        typeRegistry = NULL;
         emit newLogMessage(s.sprintf("ERROR: new CConnection failed"));
         return 2;
     }
 
+    /*
+     * The readers are the club's own Impinj units, their
+     * reports are well formed, so skip the strict checks
+     * on each received frame. Bounds are still checked.
+     */
+
+    connectionToReader->setDecodeStrictness(LLRP::CFrameDecoder::DECODE_TRUSTED);
+
     /*
      * Open connection to the reader
      */
@@ -205,8 +235,6 @@ int CReader::connectToReader(void) {
     rc = connectionToReader->openConnectionToReader(hostName.toLatin1().data());
     if (rc) {
         emit newLogMessage(s.sprintf("ERROR: openConnectionToReader(id=%d):: %s, error code %d", readerId, connectionToReader->getConnectError(), rc));
-        delete typeRegistry;
-        typeRegistry = NULL;
         delete connectionToReader;
         connectionToReader = NULL;
         return 3;
@@ -527,30 +555,22 @@ int CReader::resetConfigurationToFactoryDefaults(void) {
  *****************************************************************************/
 
 int CReader::deleteAllROSpecs(void) {
-    LLRP::CDELETE_ROSPEC *            pCmd;
+    LLRP::llrp_u64_t                  slotValues[1];
     LLRP::CMessage *                  pRspMsg;
     LLRP::CDELETE_ROSPEC_RESPONSE *   pRsp;
     QString s;
 
     /*
-     * Compose the command message
+     * The command message is the DELETE_ROSPEC template
      */
 
-    pCmd = new LLRP::CDELETE_ROSPEC();
-    pCmd->setMessageID(102);
-    pCmd->setROSpecID(0);               /* All */
+    slotValues[0] = 0;                  /* ROSpecID: All */
 
     /*
      * Send the message, expect the response of certain type
      */
 
-    pRspMsg = transact(pCmd);
-
-    /*
-     * Done with the command message
-     */
-
-    delete pCmd;
+    pRspMsg = transact(&deleteROSpecTemplate, 102, slotValues);
 
     /*
      * transact() returns NULL if something went wrong.
@@ -598,6 +618,87 @@ int CReader::deleteAllROSpecs(void) {
 
 
 
+// composeAddROSpec()
+// Build the ADD_ROSPEC message described at addROSpec(). The caller owns
+// the message and the parameters in it.
+//
+LLRP::CADD_ROSPEC *CReader::composeAddROSpec(void) {
+    LLRP::CROSpecStartTrigger *pROSpecStartTrigger = new LLRP::CROSpecStartTrigger();
+    pROSpecStartTrigger->setROSpecStartTriggerType(LLRP::ROSpecStartTriggerType_Null);
+//    pROSpecStartTrigger->setROSpecStartTriggerType(LLRP::ROSpecStartTriggerType_Immediate);
+
+    LLRP::CROSpecStopTrigger *pROSpecStopTrigger = new LLRP::CROSpecStopTrigger();
+    pROSpecStopTrigger->setROSpecStopTriggerType(LLRP::ROSpecStopTriggerType_Null);
+//    pROSpecStopTrigger->setROSpecStopTriggerType(LLRP::ROSpecStopTriggerType_Duration);
+    pROSpecStopTrigger->setDurationTriggerValue(0);     /* n/a */
+
+    LLRP::CROBoundarySpec *pROBoundarySpec = new LLRP::CROBoundarySpec();
+    pROBoundarySpec->setROSpecStartTrigger(pROSpecStartTrigger);
+    pROBoundarySpec->setROSpecStopTrigger(pROSpecStopTrigger);
+
+
+    LLRP::CAISpecStopTrigger *pAISpecStopTrigger = new LLRP::CAISpecStopTrigger();
+//    pAISpecStopTrigger->setAISpecStopTriggerType(LLRP::AISpecStopTriggerType_Duration);
+    pAISpecStopTrigger->setAISpecStopTriggerType(LLRP::AISpecStopTriggerType_Null);
+//    pAISpecStopTrigger->setDurationTrigger(1000);//1000
+
+    LLRP::CInventoryParameterSpec *pInventoryParameterSpec = new LLRP::CInventoryParameterSpec();
+    pInventoryParameterSpec->setInventoryParameterSpecID(1234);
+    pInventoryParameterSpec->setProtocolID(LLRP::AirProtocols_EPCGlobalClass1Gen2);
+
+    LLRP::llrp_u16v_t AntennaIDs = LLRP::llrp_u16v_t(1);
+    AntennaIDs.m_pValue[0] = 0;         /* All */
+
+    LLRP::CAISpec *pAISpec = new LLRP::CAISpec();
+    pAISpec->setAntennaIDs(AntennaIDs);
+    pAISpec->setAISpecStopTrigger(pAISpecStopTrigger);
+    pAISpec->addInventoryParameterSpec(pInventoryParameterSpec);
+
+    LLRP::CTagReportContentSelector *pTagReportContentSelector = new LLRP::CTagReportContentSelector();
+    pTagReportContentSelector->setEnableROSpecID(FALSE);
+    pTagReportContentSelector->setEnableSpecIndex(FALSE);
+    pTagReportContentSelector->setEnableInventoryParameterSpecID(FALSE);
+    pTagReportContentSelector->setEnableAntennaID(TRUE);
+    pTagReportContentSelector->setEnableChannelIndex(FALSE);
+    pTagReportContentSelector->setEnablePeakRSSI(FALSE);
+    pTagReportContentSelector->setEnableFirstSeenTimestamp(TRUE);
+    pTagReportContentSelector->setEnableLastSeenTimestamp(TRUE);
+    pTagReportContentSelector->setEnableTagSeenCount(TRUE);
+    pTagReportContentSelector->setEnableAccessSpecID(TRUE);
+
+    LLRP::CROReportSpec *pROReportSpec = new LLRP::CROReportSpec();
+    //pROReportSpec->setROReportTrigger(LLRP::ROReportTriggerType_None);
+    pROReportSpec->setROReportTrigger(LLRP::ROReportTriggerType_Upon_N_Tags_Or_End_Of_ROSpec);
+    pROReportSpec->setN(1);         /* Unlimited */
+    pROReportSpec->setTagReportContentSelector(pTagReportContentSelector);
+
+    LLRP::CROSpec *pROSpec = new LLRP::CROSpec();
+    pROSpec->setROSpecID(123);
+    pROSpec->setPriority(0);
+    pROSpec->setCurrentState(LLRP::ROSpecState_Disabled);
+    pROSpec->setROBoundarySpec(pROBoundarySpec);
+    pROSpec->addSpecParameter(pAISpec);
+    pROSpec->setROReportSpec(pROReportSpec);
+
+    LLRP::CADD_ROSPEC *pCmd;
+
+    /*
+     * Compose the command message.
+     * N.B.: After the message is composed, all the parameters
+     *       constructed, immediately above, are considered "owned"
+     *       by the command message. When it is destructed so
+     *       too will the parameters be.
+     */
+
+    pCmd = new LLRP::CADD_ROSPEC();
+    pCmd->setMessageID(201);
+    pCmd->setROSpec(pROSpec);
+
+    return pCmd;
+}
+
+
+
 /**
  *****************************************************************************
  **
@@ -671,92 +772,15 @@ int CReader::deleteAllROSpecs(void) {
 
 int CReader::addROSpec(void) {
     QString s;
-
-    LLRP::CROSpecStartTrigger *pROSpecStartTrigger = new LLRP::CROSpecStartTrigger();
-    pROSpecStartTrigger->setROSpecStartTriggerType(LLRP::ROSpecStartTriggerType_Null);
-//    pROSpecStartTrigger->setROSpecStartTriggerType(LLRP::ROSpecStartTriggerType_Immediate);
-
-    LLRP::CROSpecStopTrigger *pROSpecStopTrigger = new LLRP::CROSpecStopTrigger();
-    pROSpecStopTrigger->setROSpecStopTriggerType(LLRP::ROSpecStopTriggerType_Null);
-//    pROSpecStopTrigger->setROSpecStopTriggerType(LLRP::ROSpecStopTriggerType_Duration);
-    pROSpecStopTrigger->setDurationTriggerValue(0);     /* n/a */
-
-    LLRP::CROBoundarySpec *pROBoundarySpec = new LLRP::CROBoundarySpec();
-    pROBoundarySpec->setROSpecStartTrigger(pROSpecStartTrigger);
-    pROBoundarySpec->setROSpecStopTrigger(pROSpecStopTrigger);
-
-
-    LLRP::CAISpecStopTrigger *pAISpecStopTrigger = new LLRP::CAISpecStopTrigger();
-//    pAISpecStopTrigger->setAISpecStopTriggerType(LLRP::AISpecStopTriggerType_Duration);
-    pAISpecStopTrigger->setAISpecStopTriggerType(LLRP::AISpecStopTriggerType_Null);
-//    pAISpecStopTrigger->setDurationTrigger(1000);//1000
-
-    LLRP::CInventoryParameterSpec *pInventoryParameterSpec = new LLRP::CInventoryParameterSpec();
-    pInventoryParameterSpec->setInventoryParameterSpecID(1234);
-    pInventoryParameterSpec->setProtocolID(LLRP::AirProtocols_EPCGlobalClass1Gen2);
-
-    LLRP::llrp_u16v_t AntennaIDs = LLRP::llrp_u16v_t(1);
-    AntennaIDs.m_pValue[0] = 0;         /* All */
-
-    LLRP::CAISpec *pAISpec = new LLRP::CAISpec();
-    pAISpec->setAntennaIDs(AntennaIDs);
-    pAISpec->setAISpecStopTrigger(pAISpecStopTrigger);
-    pAISpec->addInventoryParameterSpec(pInventoryParameterSpec);
-
-    LLRP::CTagReportContentSelector *pTagReportContentSelector = new LLRP::CTagReportContentSelector();
-    pTagReportContentSelector->setEnableROSpecID(FALSE);
-    pTagReportContentSelector->setEnableSpecIndex(FALSE);
-    pTagReportContentSelector->setEnableInventoryParameterSpecID(FALSE);
-    pTagReportContentSelector->setEnableAntennaID(TRUE);
-    pTagReportContentSelector->setEnableChannelIndex(FALSE);
-    pTagReportContentSelector->setEnablePeakRSSI(FALSE);
-    pTagReportContentSelector->setEnableFirstSeenTimestamp(TRUE);
-    pTagReportContentSelector->setEnableLastSeenTimestamp(TRUE);
-    pTagReportContentSelector->setEnableTagSeenCount(TRUE);
-    pTagReportContentSelector->setEnableAccessSpecID(TRUE);
-
-    LLRP::CROReportSpec *pROReportSpec = new LLRP::CROReportSpec();
-    //pROReportSpec->setROReportTrigger(LLRP::ROReportTriggerType_None);
-    pROReportSpec->setROReportTrigger(LLRP::ROReportTriggerType_Upon_N_Tags_Or_End_Of_ROSpec);
-    pROReportSpec->setN(1);         /* Unlimited */
-    pROReportSpec->setTagReportContentSelector(pTagReportContentSelector);
-
-    LLRP::CROSpec *pROSpec = new LLRP::CROSpec();
-    pROSpec->setROSpecID(123);
-    pROSpec->setPriority(0);
-    pROSpec->setCurrentState(LLRP::ROSpecState_Disabled);
-    pROSpec->setROBoundarySpec(pROBoundarySpec);
-    pROSpec->addSpecParameter(pAISpec);
-    pROSpec->setROReportSpec(pROReportSpec);
-
-    LLRP::CADD_ROSPEC *pCmd;
     LLRP::CMessage *pRspMsg;
     LLRP::CADD_ROSPEC_RESPONSE *pRsp;
 
     /*
-     * Compose the command message.
-     * N.B.: After the message is composed, all the parameters
-     *       constructed, immediately above, are considered "owned"
-     *       by the command message. When it is destructed so
-     *       too will the parameters be.
-     */
-
-    pCmd = new LLRP::CADD_ROSPEC();
-    pCmd->setMessageID(201);
-    pCmd->setROSpec(pROSpec);
-
-    /*
-     * Send the message, expect the response of certain type
+     * The command message is the ADD_ROSPEC template, see
+     * composeAddROSpec(). Send it, expect the response of certain type
      */
 
-    pRspMsg = transact(pCmd);
-
-    /*
-     * Done with the command message.
-     * N.B.: And the parameters
-     */
-
-    delete pCmd;
+    pRspMsg = transact(&addROSpecTemplate, 201, NULL);
 
     /*
      * transact() returns NULL if something went wrong.
@@ -821,30 +845,22 @@ int CReader::addROSpec(void) {
  *****************************************************************************/
 
 int CReader::enableROSpec (void) {
-    LLRP::CENABLE_ROSPEC *            pCmd;
+    LLRP::llrp_u64_t                  slotValues[1];
     LLRP::CMessage *                  pRspMsg;
     LLRP::CENABLE_ROSPEC_RESPONSE *   pRsp;
     QString s;
 
     /*
-     * Compose the command message
+     * The command message is the ENABLE_ROSPEC template
      */
 
-    pCmd = new LLRP::CENABLE_ROSPEC();
-    pCmd->setMessageID(202);
-    pCmd->setROSpecID(123);
+    slotValues[0] = 123;                /* ROSpecID */
 
     /*
      * Send the message, expect the response of certain type
      */
 
-    pRspMsg = transact(pCmd);
-
-    /*
-     * Done with the command message
-     */
-
-    delete pCmd;
+    pRspMsg = transact(&enableROSpecTemplate, 202, slotValues);
 
     /*
      * transact() returns NULL if something went wrong.
@@ -909,30 +925,22 @@ int CReader::enableROSpec (void) {
  *****************************************************************************/
 
 int CReader::startROSpec (void) {
-    LLRP::CSTART_ROSPEC *pCmd;
-    LLRP::CMessage *pRspMsg;
-    LLRP::CSTART_ROSPEC_RESPONSE *pRsp;
+    LLRP::llrp_u64_t                  slotValues[1];
+    LLRP::CMessage *                  pRspMsg;
+    LLRP::CSTART_ROSPEC_RESPONSE *   pRsp;
     QString s;
 
     /*
-     * Compose the command message
+     * The command message is the START_ROSPEC template
      */
 
-    pCmd = new LLRP::CSTART_ROSPEC();
-    pCmd->setMessageID(202);
-    pCmd->setROSpecID(123);
+    slotValues[0] = 123;                /* ROSpecID */
 
     /*
      * Send the message, expect the response of certain type
      */
 
-    pRspMsg = transact(pCmd);
-
-    /*
-     * Done with the command message
-     */
-
-    delete pCmd;
+    pRspMsg = transact(&startROSpecTemplate, 202, slotValues);
 
     /*
      * transact() returns NULL if something went wrong.
@@ -997,9 +1005,7 @@ int CReader::startROSpec (void) {
  *****************************************************************************/
 
 int CReader::processReports(void) {
-    QString s;
     LLRP::CMessage *pMessage = NULL;
-    const LLRP::CTypeDescriptor *pType = NULL;
 
     // Wait for a message. The report should occur within 1 seconds when tags are in antenna zone.
     // If not, timeout and clear currentTagsList.  Don't make the timeout too short, because
@@ -1014,44 +1020,50 @@ int CReader::processReports(void) {
     }
 
     // What happens depends on what kind of message
-    // received. Use the type label (m_pType) to
-    // discriminate message types.
+    // received. dispatch() switches on the type number
+    // and calls the matching on...() handler below.
 
-    pType = pMessage->m_pType;
+    dispatch(pMessage);
 
-    // Is it a tag report? If so, process.
+    delete pMessage;
+    return 0;
+}
 
-    if (&LLRP::CRO_ACCESS_REPORT::s_typeDescriptor == pType) {
-        LLRP::CRO_ACCESS_REPORT *pNtf;
-        pNtf = (LLRP::CRO_ACCESS_REPORT *)pMessage;
-        processTagList(pNtf);
-    }
 
-    // Is it a reader event? This example only recognizes
-    // AntennaEvents.
 
-    else if (&LLRP::CREADER_EVENT_NOTIFICATION::s_typeDescriptor == pType) {
-        LLRP::CREADER_EVENT_NOTIFICATION *pNtf;
-        LLRP::CReaderEventNotificationData *pNtfData;
+// Tag report, process.
+//
+int CReader::onRO_ACCESS_REPORT(LLRP::CRO_ACCESS_REPORT *pNtf) {
+    processTagList(pNtf);
+    return 0;
+}
 
-        pNtf = (LLRP::CREADER_EVENT_NOTIFICATION *)pMessage;
 
-        pNtfData = pNtf->getReaderEventNotificationData();
-        if (NULL != pNtfData) {
-            handleReaderEventNotification(pNtfData);
-        }
-        else {
-            emit newLogMessage(s.sprintf("WARNING: READER_EVENT_NOTIFICATION without data"));
-        }
-    }
 
-    // Hmmm. Something unexpected. Just tattle and keep going.
+// Reader event. Only AntennaEvents are recognized.
+//
+int CReader::onREADER_EVENT_NOTIFICATION(LLRP::CREADER_EVENT_NOTIFICATION *pNtf) {
+    QString s;
+    LLRP::CReaderEventNotificationData *pNtfData;
 
+    pNtfData = pNtf->getReaderEventNotificationData();
+    if (NULL != pNtfData) {
+        handleReaderEventNotification(pNtfData);
+    }
     else {
-        emit newLogMessage(s.sprintf("WARNING: Ignored unexpected message during monitor: %s", pType->m_pName));
+        emit newLogMessage(s.sprintf("WARNING: READER_EVENT_NOTIFICATION without data"));
     }
+    return 0;
+}
 
-    delete pMessage;
+
+
+// Hmmm. Something unexpected. Just tattle and keep going.
+//
+int CReader::onOtherMessage(LLRP::CMessage *pMessage) {
+    QString s;
+
+    emit newLogMessage(s.sprintf("WARNING: Ignored unexpected message during monitor: %s", pMessage->m_pType->m_pName));
     return 0;
 }
 
@@ -1483,6 +1495,44 @@ LLRP::CMessage *CReader::transact(LLRP::CMessage *pSendMsg) {
 
 
 
+// transact()
+// Same as above, for a command sent from a frame template built by
+// buildFrameTemplates().
+//
+LLRP::CMessage *CReader::transact(const LLRP::CFrameTemplate *pTemplate, unsigned msgId, const LLRP::llrp_u64_t *slotValues) {
+    LLRP::CMessage *pRspMsg;
+    const char *typeName = pTemplate->getType() ? pTemplate->getType()->m_pName : "(template)";
+    QString s;
+
+    pRspMsg = connectionToReader->transact(pTemplate, msgId, slotValues, 3000);
+
+    if (NULL == pRspMsg) {
+        const LLRP::CErrorDetails *   pError = connectionToReader->getTransactError();
+
+        emit newLogMessage(s.sprintf("ERROR: %s transact failed, %s", typeName, pError->m_pWhatStr ? pError->m_pWhatStr : "no reason given"));
+
+        if (NULL != pError->m_pRefType) {
+            emit newLogMessage(s.sprintf("ERROR: ... reference type %s", pError->m_pRefType->m_pName));
+        }
+
+        if (NULL != pError->m_pRefField) {
+            emit newLogMessage(s.sprintf("ERROR: ... reference field %s", pError->m_pRefField->m_pName));
+        }
+
+        return NULL;
+    }
+
+    if (&LLRP::CERROR_MESSAGE::s_typeDescriptor == pRspMsg->m_pType) {
+        emit newLogMessage(s.sprintf("ERROR: Received ERROR_MESSAGE instead of %s", pTemplate->getType()->m_pResponseType->m_pName));
+        delete pRspMsg;
+        pRspMsg = NULL;
+    }
+
+    return pRspMsg;
+}
+
+
+
 /**
  *****************************************************************************
  **
@@ -1630,23 +1680,24 @@ int CReader::sendMessage (LLRP::CMessage *pSendMsg) {
  *****************************************************************************/
 
 void CReader::printXMLMessage (LLRP::CMessage *pMessage) {
-    char aBuf[100*1024];
+    LLRP::CXMLTextStringSink sink;
     QString s;
 
     /*
-     * Convert the message to an XML string.
-     * This fills the buffer with either the XML string
-     * or an error message. The return value could
-     * be checked.
+     * Convert the message to XML text. The sink grows
+     * as needed so large reports are not cut off.
      */
 
-    pMessage->toXMLString(aBuf, sizeof aBuf);
+    if (LLRP::RC_OK != LLRP::toXMLText(pMessage, &sink)) {
+        emit newLogMessage(s.sprintf("ERROR: %s XML text failed", pMessage->m_pType->m_pName));
+        return;
+    }
 
     /*
-     * Print the XML Text to the standard output.
+     * Send the XML Text to the log.
      */
 
-    emit newLogMessage(s.sprintf("%s", aBuf));
+    emit newLogMessage(QString::fromStdString(sink.m_Text));
 }
 
 
@@ -1657,7 +1708,6 @@ void CReader::printXMLMessage (LLRP::CMessage *pMessage) {
 // Populate transmitPowerList member
 //
 int CReader::getTransmitPowerCapabilities(void) {
-    LLRP::CGET_READER_CAPABILITIES *pCmd;
     LLRP::CMessage *pRspMsg;
     LLRP::CGET_READER_CAPABILITIES_RESPONSE *pRsp;
     LLRP::CRegulatoryCapabilities *pReg;
@@ -1669,19 +1719,9 @@ int CReader::getTransmitPowerCapabilities(void) {
     transmitPowerList.clear();
 
     /*
-    * Compose the command message
-    */
-    pCmd = new LLRP::CGET_READER_CAPABILITIES();
-    pCmd->setMessageID(messageId++);//m_messageID++);
-    pCmd->setRequestedData(LLRP::GetReaderCapabilitiesRequestedData_All);
-    /*
-    * Send the message, expect a certain type of response
+    * Send the GET_READER_CAPABILITIES template, expect a certain type of response
     */
-    pRspMsg = transact(pCmd);
-    /*
-    * Done with the command message
-    */
-    delete pCmd;
+    pRspMsg = transact(&getReaderCapabilitiesTemplate, messageId++, NULL);
     /*
     * transact() returns NULL if something went wrong.
     */
@@ -52,9 +52,10 @@ public:
 Q_DECLARE_METATYPE(CTagInfo)
 
 
-class CReader : public QObject //QThread
+class CReader : public QObject, private LLRP::CCoreMessageDispatcher<CReader> //QThread
 {
     Q_OBJECT
+    friend class LLRP::CCoreMessageDispatcher<CReader>;
 public:
     enum antennaPositionType {track, desk};
     explicit CReader(QString hostName, int readerId, antennaPositionType antennaPosition);
@@ -88,14 +89,27 @@ private:
     int checkLLRPStatus(LLRP::CLLRPStatus *pLLRPStatus, char *pWhatStr);
     int sendMessage(LLRP::CMessage *pSendMsg);
     void processTagList(LLRP::CRO_ACCESS_REPORT *pRO_ACCESS_REPORT);
+    // Handlers called by dispatch() for the messages processReports() receives
+    int onRO_ACCESS_REPORT(LLRP::CRO_ACCESS_REPORT *pNtf);
+    int onREADER_EVENT_NOTIFICATION(LLRP::CREADER_EVENT_NOTIFICATION *pNtf);
+    int onOtherMessage(LLRP::CMessage *pMessage);
     int getTransmitPowerCapabilities(void);
     QList<int> transmitPowerList;
     bool simulateReaderMode;
     unsigned long long maxAllowableTimeInListUSec;
     LLRP::CConnection *connectionToReader;
-    LLRP::CTypeRegistry *typeRegistry;
+    const LLRP::CTypeRegistry *typeRegistry;   // shared by all readers, never deleted
     LLRP::CMessage *recvMessage(int nMaxMS);
     LLRP::CMessage *transact (LLRP::CMessage *sendMsg);
+    LLRP::CMessage *transact (const LLRP::CFrameTemplate *pTemplate, unsigned msgId, const LLRP::llrp_u64_t *slotValues);
+    // Command frames encoded once per reader, then sent as copy and patch
+    LLRP::CFrameTemplate deleteROSpecTemplate;
+    LLRP::CFrameTemplate addROSpecTemplate;
+    LLRP::CFrameTemplate enableROSpecTemplate;
+    LLRP::CFrameTemplate startROSpecTemplate;
+    LLRP::CFrameTemplate getReaderCapabilitiesTemplate;
+    void buildFrameTemplates(void);
+    LLRP::CADD_ROSPEC *composeAddROSpec(void);
 signals:
     void connected(void);
     void newTag(CTagInfo);
@@ -25,6 +25,14 @@ void CStats::clear(void) {
 
 
 
+CRiderLap::CRiderLap(long long timeStampUSec, float lapSec, float lapM) {
+    this->timeStampUSec = timeStampUSec;
+    this->lapSec = lapSec;
+    this->lapM = lapM;
+}
+
+
+
 CRider::CRider(void) {
     clear();
 }
@@ -45,6 +53,22 @@ void CRider::clear(void) {
     totalM = 0.;
     bestLapSec = 0.;
     bestLapM = 0.;
+    statsPending = false;
+    lapsWhileStatsPending.clear();
+}
+
+
+
+// addLapToStats
+// Count a lap into thisMonth and allTime
+//
+void CRider::addLapToStats(float lapSec, float lapM) {
+    thisMonth.lapCount++;
+    thisMonth.totalSec += lapSec;
+    thisMonth.totalM += lapM;
+
+    allTime.lapCount++;
+    allTime.totalM += lapM;
 }
 
 
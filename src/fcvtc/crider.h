@@ -3,6 +3,7 @@
 
 
 #include <QString>
+#include <QList>
 
 // CRider is a structure used to keep all information available for each rider
 
@@ -21,11 +22,23 @@ public:
 };
 
 
+// A lap counted while the rider's stats were still loading, added to them when they arrive
+
+class CRiderLap {
+public:
+    CRiderLap(long long timeStampUSec=0, float lapSec=0., float lapM=0.);
+    long long timeStampUSec;
+    float lapSec;
+    float lapM;
+};
+
+
 class CRider {//: public CStats {
 public:
     CRider(void);
     ~CRider(void);
     void clear();
+    void addLapToStats(float lapSec, float lapM);
     QString tagId;          // from reader
     QString name;           // from dBase if available
     unsigned long long previousTimeStampUSec;   // timestamp from reader, updated with each lap
@@ -39,6 +52,8 @@ public:
     CStats thisMonth;
     CStats lastMonth;
     CStats allTime;
+    bool statsPending;      // thisMonth etc not loaded yet, the stats prefetcher will send them
+    QList<CRiderLap> lapsWhileStatsPending;     // counted into thisMonth etc when they are loaded
 };
 
 
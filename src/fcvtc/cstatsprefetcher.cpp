@@ -0,0 +1,195 @@
+// cstatsprefetcher.cpp
+
+
+#include "cstatsprefetcher.h"
+#include "cdbase.h"
+
+
+
+CRiderStats::CRiderStats(void) {
+    lastTimeStampUSec = 0;
+}
+
+
+
+CStatsPrefetcher::CStatsPrefetcher(QString databaseName) {
+    this->databaseName = databaseName;
+    connectionName = "statsPrefetcher";
+    generation = 0;
+    stopRequested = false;
+    hitCount = 0;
+    missCount = 0;
+    loadCount = 0;
+    thread = NULL;
+}
+
+
+
+CStatsPrefetcher::~CStatsPrefetcher(void) {
+}
+
+
+
+// request
+// Queue a rider to be loaded, or loaded again.  Never waits for the disk.
+//
+void CStatsPrefetcher::request(const QByteArray &tagId) {
+    QMutexLocker locker(&mutex);
+
+    if (stopRequested || tagId.isEmpty())
+        return;
+
+    if (!queue.contains(tagId))
+        queue.append(tagId);
+    condition.wakeOne();
+}
+
+
+
+// getStats
+// The rider's stats if they have been loaded.  Return false if not, call request() to have them loaded.
+//
+bool CStatsPrefetcher::getStats(const QByteArray &tagId, CRiderStats *stats) {
+    QMutexLocker locker(&mutex);
+
+    QHash<QByteArray, CRiderStats>::const_iterator cached = cache.constFind(tagId);
+    if (cached == cache.constEnd()) {
+        missCount++;
+        return false;
+    }
+    hitCount++;
+    *stats = cached.value();
+    return true;
+}
+
+
+
+// invalidate
+// Drop every rider's cached stats and load them again, for when the rollups are rebuilt.  Until
+// a rider's are loaded getStats() returns false for them.
+//
+void CStatsPrefetcher::invalidate(void) {
+    QMutexLocker locker(&mutex);
+
+    if (stopRequested)
+        return;
+
+    QList<QByteArray> tagIds = cache.keys();
+    cache.clear();
+    generation++;
+    for (int i=0; i<tagIds.size(); i++)
+        if (!queue.contains(tagIds[i]))
+            queue.append(tagIds[i]);
+    condition.wakeOne();
+}
+
+
+
+// stop
+// Ask the prefetcher to finish.  Wait on thread after calling this.
+//
+void CStatsPrefetcher::stop(void) {
+    QMutexLocker locker(&mutex);
+    stopRequested = true;
+    queue.clear();
+    condition.wakeAll();
+}
+
+
+
+// onLapsCommitted
+// Connected directly to CLapWriter::lapsCommitted(), so it runs in the writer thread
+//
+void CStatsPrefetcher::onLapsCommitted(QList<QByteArray> tagIds) {
+    for (int i=0; i<tagIds.size(); i++)
+        request(tagIds[i]);
+}
+
+
+
+// onStarted
+// Runs in the prefetcher thread until stop() is called
+//
+void CStatsPrefetcher::onStarted(void) {
+    {
+        // The connection is made, used and closed in this thread only
+
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(databaseName);
+        if (!db.open()) {
+            qDebug() << "Stats prefetcher could not open database:" << db.lastError().text();
+        }
+        else {
+            queueRecentRiders(db);
+
+            QSqlQuery query(db);
+            query.setForwardOnly(true);
+            query.prepare(CDbase::riderMonthsSql);
+
+            forever {
+                mutex.lock();
+                while (queue.isEmpty() && !stopRequested)
+                    condition.wait(&mutex);
+                if (stopRequested) {
+                    mutex.unlock();
+                    break;
+                }
+                QByteArray tagId = queue.takeFirst();
+                int loadGeneration = generation;
+                mutex.unlock();
+
+                query.bindValue(":tagId", tagId);
+                if (!query.exec()) {
+                    qDebug() << "Stats prefetcher could not read stats:" << query.lastError().text();
+                    continue;
+                }
+                CRiderStats stats;
+                CDbase::statsFromMonths(query, &stats.thisMonth, &stats.lastMonth, &stats.allTime, &stats.lastTimeStampUSec);
+                query.finish();
+
+                // Rollups rebuilt while this rider was read are read again
+
+                mutex.lock();
+                bool current = loadGeneration == generation;
+                if (current) {
+                    cache.insert(tagId, stats);
+                    loadCount++;
+                }
+                else if (!queue.contains(tagId))
+                    queue.append(tagId);
+                mutex.unlock();
+                if (current)
+                    emit statsReady(tagId);
+            }
+            query.finish();
+            qDebug("Stats prefetcher: %lld loads, %lld hits %lld misses", loadCount, hitCount, missCount);
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+
+    if (thread)
+        thread->quit();
+}
+
+
+
+// queueRecentRiders
+// Queue every rider with laps this month or last month.  Return 0 on success.
+//
+int CStatsPrefetcher::queueRecentRiders(QSqlDatabase &db) {
+    long long lastMonth = CLapRollup::monthOf(CLapRollup::monthOf(QDateTime::currentMSecsSinceEpoch() * 1000) - 1);
+
+    QSqlQuery query(db);
+    query.setForwardOnly(true);
+    query.prepare("SELECT DISTINCT tagId FROM lapsMonth WHERE period >= :lastMonth");
+    query.bindValue(":lastMonth", lastMonth);
+    if (!query.exec()) {
+        qDebug() << "Stats prefetcher could not list recent riders:" << query.lastError().text();
+        return 1;
+    }
+    while (query.next())
+        request(query.value(0).toByteArray());
+    query.finish();
+    return 0;
+}
@@ -0,0 +1,74 @@
+// cstatsprefetcher.h
+//
+
+#ifndef CSTATSPREFETCHER_H
+#define CSTATSPREFETCHER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThread>
+#include <QtSql/QtSql>
+
+#include "crider.h"
+
+
+// The stats CDbase::getStats() gives for a rider
+
+class CRiderStats {
+public:
+    CRiderStats(void);
+    CStats thisMonth;
+    CStats lastMonth;
+    CStats allTime;
+    long long lastTimeStampUSec;    // the latest lap counted, 0 if none
+};
+
+
+// CStatsPrefetcher loads riders' stats from the lapsMonth rollup on its
+// own thread and connection, so the GUI thread can have them from memory
+// when a rider first crosses the line.  Riders with laps this month or
+// last month are loaded when it starts, others when request() is called,
+// as it is for each tag the desk reader sees.  statsReady() is emitted
+// each time a rider's stats are loaded.
+//
+// Cached stats are refreshed when the lap writer commits a rider's laps,
+// through onLapsCommitted(), so they are at most one writer batch behind
+// the laps table.  Every rider is loaded again after invalidate().
+
+class CStatsPrefetcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CStatsPrefetcher(QString databaseName);
+    virtual ~CStatsPrefetcher(void);
+    void request(const QByteArray &tagId);
+    bool getStats(const QByteArray &tagId, CRiderStats *stats);
+    void invalidate(void);
+    void stop(void);
+    QThread *thread;
+private:
+    QString databaseName;
+    QString connectionName;
+    QMutex mutex;
+    QWaitCondition condition;
+    QList<QByteArray> queue;                // riders to load, in the order asked for
+    QHash<QByteArray, CRiderStats> cache;
+    int generation;                         // bumped by invalidate(), a load from before it is dropped
+    bool stopRequested;
+    long long hitCount;
+    long long missCount;
+    long long loadCount;
+    int queueRecentRiders(QSqlDatabase &db);
+signals:
+    void statsReady(QByteArray tagId);
+public slots:
+    void onStarted(void);
+    void onLapsCommitted(QList<QByteArray> tagIds);
+};
+
+#endif // CSTATSPREFETCHER_H
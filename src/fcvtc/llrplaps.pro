@@ -13,7 +13,21 @@ TEMPLATE = app
 
 LTKLIBDIR = ../LTK/LTKCPP/Library
 
+# LTKCPP is built with just the LLRP types fcvtc uses, see
+# LTKCPP_SELECT_TYPES in the Makefile in $$LTKLIBDIR; the messages
+# and parameters these need are added. Other types decode as
+# COpaqueMessage/COpaqueParameter. The GET_READER_CONFIG and
+# GET_READER_CAPABILITIES responses still need most parameters.
+# It is built in $$LTKLIBDIR/$$LTKSELECTDIR, see LTKCPP_OUTDIR,
+# so the full libltkcpp.a the LTKCPP tests use is left alone.
+LTK_SELECT_TYPES = ADD_ROSPEC DELETE_ROSPEC ENABLE_ROSPEC START_ROSPEC \
+    GET_READER_CAPABILITIES GET_READER_CONFIG SET_READER_CONFIG \
+    RO_ACCESS_REPORT READER_EVENT_NOTIFICATION ERROR_MESSAGE
+
+LTKSELECTDIR = select_llrplaps
+
 INCLUDEPATH += $$LTKLIBDIR
+DEFINES += LTKCPP_OUT_H=\\\"$$LTKSELECTDIR/out_ltkcpp.h\\\"
 
 
 win32:!win32-g++ {
@@ -42,8 +56,17 @@ linux-g++ {
   message(Building for linux-g++)
   QMAKE_CXXFLAGS += -Wno-write-strings
 #  QMAKE_RPATHDIR = $$LIBDIR
-  LIBS += $$LTKLIBDIR/libltkcpp.a
+  LIBS += $$LTKLIBDIR/$$LTKSELECTDIR/libltkcpp.a
   LIBS += /usr/lib64/libxml2.so.2
+
+  # make runs in $$LTKLIBDIR every build and only regenerates the
+  # code when the selection has changed
+  ltkcpp.target = $$LTKLIBDIR/$$LTKSELECTDIR/libltkcpp.a
+  ltkcpp.commands = $(MAKE) -C $$PWD/$$LTKLIBDIR $$LTKSELECTDIR/libltkcpp.a \
+    LTKCPP_OUTDIR=$$LTKSELECTDIR LTKCPP_SELECT_TYPES=\"$$LTK_SELECT_TYPES\"
+  ltkcpp.depends = FORCE
+  QMAKE_EXTRA_TARGETS += ltkcpp
+  PRE_TARGETDEPS += $$LTKLIBDIR/$$LTKSELECTDIR/libltkcpp.a
 }
 
 #message(QMAKE_REL_RPATH_BASE: $$QMAKE_REL_RPATH_BASE)
@@ -64,12 +87,22 @@ SOURCES += main.cpp\
         mainwindow.cpp \
     creader.cpp \
     cdbase.cpp \
-    crider.cpp
+    crider.cpp \
+    clapwriter.cpp \
+    cstatsprefetcher.cpp \
+    clapstore.cpp \
+    claplog.cpp \
+    cbulkfile.cpp
 
 HEADERS  += mainwindow.h \
     creader.h \
     main.h \
     cdbase.h \
-    crider.h
+    crider.h \
+    clapwriter.h \
+    cstatsprefetcher.h \
+    clapstore.h \
+    claplog.h \
+    cbulkfile.h
 
 FORMS    += mainwindow.ui
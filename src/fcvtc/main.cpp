@@ -1,9 +1,226 @@
 #include "mainwindow.h"
 #include <QApplication>
+#include <QCoreApplication>
+#include <stdio.h>
+#include <string.h>
+#include <QElapsedTimer>
+#include "cdbase.h"
+#include "clapstore.h"
+#include "claplog.h"
+
+
+// Database maintenance without the GUI:
+//   fcvtc --rebuild-rollups DBFILE [LOGDIR]   recompute lapsDay and lapsMonth from the laps
+//   fcvtc --check-rollups DBFILE [LOGDIR]     report rollup rows and rider stats that don't match the laps
+// LOGDIR is the lap log when laps are kept in one, the laps table has only the laps from before it.
+// Exit code is 0 when the rollups are (now) right.
+//
+static int rollupTool(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+    CDbase dbase;
+    dbase.setBackgroundThreads(false);
+
+    if (argc == 4)
+        dbase.setLapLogDirectory(argv[3]);
+    if (dbase.open(argv[2], "", "") != 0) {
+        fprintf(stderr, "Error opening database %s: %s\n", argv[2], dbase.errorText().toLatin1().data());
+        return 2;
+    }
+
+    int rc = 0;
+    if (strcmp(argv[1], "--rebuild-rollups") == 0) {
+        if (dbase.rebuildRollups() != 0) {
+            fprintf(stderr, "Error rebuilding rollups: %s\n", dbase.errorText().toLatin1().data());
+            rc = 3;
+        }
+    }
+    else {
+        QStringList problems;
+        int problemCount = dbase.checkRollups(&problems);
+        if (problemCount < 0) {
+            fprintf(stderr, "Error checking rollups: %s\n", dbase.errorText().toLatin1().data());
+            rc = 3;
+        }
+        else {
+            for (int i=0; i<problems.size(); i++)
+                printf("%s\n", problems[i].toLatin1().data());
+            printf("%d rollup rows or rider stats differ from the laps\n", problemCount);
+            rc = problemCount ? 4 : 0;
+        }
+    }
+    dbase.close();
+    return rc;
+}
+
+
+// compareScans
+// Scan both lap stores for the same laps, adding the time each took to usec and what differs
+// to differences.  Return the number of differences, -1 on error.
+//
+static int compareScans(CLapStore **stores, const QByteArray &tagId, long long start, long long end, const QString &what,
+                        qint64 *usec, QStringList *differences, CLapColumns *laps) {
+    for (int s=0; s<2; s++) {
+        QElapsedTimer timer;
+        timer.start();
+        if (stores[s]->scan(tagId, start, end, &laps[s]) != 0) {
+            fprintf(stderr, "Error scanning %s: %s\n", what.toLatin1().data(), stores[s]->errorText().toLatin1().data());
+            return -1;
+        }
+        usec[s] += timer.nsecsElapsed() / 1000;
+    }
+
+    QStringList scanDifferences;
+    int differenceCount = laps[0].compare(laps[1], &scanDifferences);
+    if (differenceCount) {
+        differences->append(what + ":");
+        *differences += scanDifferences;
+    }
+    return differenceCount;
+}
+
+
+// Lap log check and scan benchmark:
+//   fcvtc --check-lap-log DBFILE LOGDIR   fill an empty lap log in LOGDIR from the laps table, then
+//                                         scan every lap and each rider's laps from both and compare
+// Exit code is 0 when the lap log has the same laps as the laps table.
+//
+static int lapLogTool(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+    CDbase dbase;
+    dbase.setBackgroundThreads(false);
+
+    if (dbase.open(argv[2], "", "") != 0) {
+        fprintf(stderr, "Error opening database %s: %s\n", argv[2], dbase.errorText().toLatin1().data());
+        return 2;
+    }
+
+    int rc = 0;
+    {
+        CSqliteLapStore lapsTable(QSqlDatabase::database());
+        CLapLog lapLog(argv[3]);
+        lapLog.setMarkDatabase(QSqlDatabase::database());
+        CLapStore *stores[2] = { &lapsTable, &lapLog };
+        if (lapsTable.open() != 0 || lapLog.open() != 0) {
+            fprintf(stderr, "Error opening lap log %s: %s\n", argv[3], lapLog.errorText().toLatin1().data());
+            rc = 2;
+        }
+        else if (lapLog.lapCount() == 0) {
+            QElapsedTimer timer;
+            timer.start();
+            if (CLapStore::copy(&lapsTable, &lapLog) != 0) {
+                fprintf(stderr, "Error copying laps to lap log: %s\n", lapLog.errorText().toLatin1().data());
+                rc = 3;
+            }
+            else
+                printf("Copied %lld laps to the lap log in %lld msec\n", lapLog.lapCount(), timer.elapsed());
+        }
+
+        // Every lap, then each rider's laps for all time and for the last month they rode
+
+        if (rc == 0) {
+            QStringList differences;
+            int differenceCount = 0;
+            qint64 allUsec[2] = { 0, 0 };
+            qint64 riderUsec[2] = { 0, 0 };
+            qint64 monthUsec[2] = { 0, 0 };
+            CLapColumns all[2];
+            int n = compareScans(stores, "", CLapStore::timeStampUSecMin, CLapStore::timeStampUSecMax, "every lap", allUsec, &differences, all);
+            if (n < 0)
+                rc = 3;
+            differenceCount += qMax(n, 0);
+
+            long long riderLapCount = 0;
+            long long monthLapCount = 0;
+            for (int t=0; t<all[0].tagIds.size() && rc == 0; t++) {
+                const QByteArray &tagId = all[0].tagIds[t];
+                CLapColumns laps[2];
+                n = compareScans(stores, tagId, CLapStore::timeStampUSecMin, CLapStore::timeStampUSecMax,
+                                 "rider " + QString(tagId), riderUsec, &differences, laps);
+                if (n < 0 || laps[0].size() == 0) {
+                    rc = n < 0 ? 3 : rc;
+                    continue;
+                }
+                differenceCount += n;
+                riderLapCount += laps[0].size();
+
+                long long month = CLapRollup::monthOf(laps[0].timeStampUSec.last());
+                n = compareScans(stores, tagId, month, CLapRollup::nextMonthOf(month),
+                                 "rider " + QString(tagId) + " last month", monthUsec, &differences, laps);
+                if (n < 0)
+                    rc = 3;
+                differenceCount += qMax(n, 0);
+                monthLapCount += laps[0].size();
+            }
+
+            if (rc == 0) {
+                int riderCount = all[0].tagIds.size();
+                printf("%-30s %12s %12s %12s\n", "scan, msec", "laps", "laps table", "lap log");
+                printf("%-30s %12d %12.1f %12.1f\n", "every lap", all[0].size(), allUsec[0] / 1000., allUsec[1] / 1000.);
+                printf("%-30s %12lld %12.1f %12.1f\n", qPrintable(QString("%1 riders, all time").arg(riderCount)),
+                       riderLapCount, riderUsec[0] / 1000., riderUsec[1] / 1000.);
+                printf("%-30s %12lld %12.1f %12.1f\n", qPrintable(QString("%1 riders, last month").arg(riderCount)),
+                       monthLapCount, monthUsec[0] / 1000., monthUsec[1] / 1000.);
+                for (int i=0; i<differences.size(); i++)
+                    printf("%s\n", differences[i].toLatin1().data());
+                printf("%d laps differ between the laps table and the lap log\n", differenceCount);
+                rc = differenceCount ? 4 : 0;
+            }
+        }
+    }
+    dbase.close();
+    return rc;
+}
+
+
+// Bulk import and export:
+//   fcvtc --import-names DBFILE FILE            add riders from FILE, renaming riders already there
+//   fcvtc --export-names DBFILE FILE            write every rider to FILE
+//   fcvtc --import-laps DBFILE FILE [LOGDIR]    add laps from FILE, then rebuild the rollups
+//   fcvtc --export-laps DBFILE FILE [LOGDIR]    write every lap to FILE
+// FILE is CSV when its name ends in .csv and fcvtc's binary format otherwise, imports read either.
+// LOGDIR is the lap log when laps are kept in one.  Progress and rows/s go to the debug output.
+//
+static int bulkTool(int argc, char *argv[]) {
+    QCoreApplication a(argc, argv);
+    CDbase dbase;
+    dbase.setBackgroundThreads(false);
+
+    if (argc == 5)
+        dbase.setLapLogDirectory(argv[4]);
+    if (dbase.open(argv[2], "", "") != 0) {
+        fprintf(stderr, "Error opening database %s: %s\n", argv[2], dbase.errorText().toLatin1().data());
+        return 2;
+    }
+
+    long long rowCount = 0;
+    int rc;
+    if (strcmp(argv[1], "--import-names") == 0)
+        rc = dbase.importNames(argv[3], &rowCount);
+    else if (strcmp(argv[1], "--export-names") == 0)
+        rc = dbase.exportNames(argv[3], &rowCount);
+    else if (strcmp(argv[1], "--import-laps") == 0)
+        rc = dbase.importLaps(argv[3], &rowCount);
+    else
+        rc = dbase.exportLaps(argv[3], &rowCount);
+    printf("%s %s: %lld rows\n", argv[1] + 2, argv[3], rowCount);
+    if (rc != 0)
+        fprintf(stderr, "Error: %s\n", dbase.errorText().toLatin1().data());
+    dbase.close();
+    return rc ? 3 : 0;
+}
 
 
 int main(int argc, char *argv[])
 {
+    if ((argc == 3 || argc == 4) && (strcmp(argv[1], "--rebuild-rollups") == 0 || strcmp(argv[1], "--check-rollups") == 0))
+        return rollupTool(argc, argv);
+    if (argc == 4 && strcmp(argv[1], "--check-lap-log") == 0)
+        return lapLogTool(argc, argv);
+    if ((argc == 4 || argc == 5) && (strcmp(argv[1], "--import-laps") == 0 || strcmp(argv[1], "--export-laps") == 0))
+        return bulkTool(argc, argv);
+    if (argc == 4 && (strcmp(argv[1], "--import-names") == 0 || strcmp(argv[1], "--export-names") == 0))
+        return bulkTool(argc, argv);
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
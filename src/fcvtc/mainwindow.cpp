@@ -272,11 +272,15 @@ MainWindow::MainWindow(QWidget *parent) :
     readerThread->start();
 
 
-    // Initialize and load names table
+    // Initialize and load names table.  Laps are kept in a lap log rather than the
+    // database when the lapLogDirectory setting names one.
 
+    dbase.setLapLogDirectory(settings.value("lapLogDirectory").toString());
     int rc = dbase.open("test", "abc", "def");
     if (rc != 0)
         guiCritical("Error opening database file: " + dbase.errorText() + ".\n\nWe will continue but rider names are not available and results are not being recorded.");
+    if (dbase.getStatsPrefetcher())
+        connect(dbase.getStatsPrefetcher(), SIGNAL(statsReady(QByteArray)), this, SLOT(onRiderStatsReady(QByteArray)));
 
     ui->namesTableWidget->setColumnWidth(0, 200);
     ui->namesTableWidget->setColumnWidth(1, 200);
@@ -623,9 +627,12 @@ void MainWindow::onNewTrackTag(CTagInfo tagInfo) {
             rider->previousTimeStampUSec = tagInfo.timeStampUSec;
 
 
-            // Get stats for this rider
+            // Get stats for this rider.  They are normally prefetched, if not they follow in onRiderStatsReady.
 
-            dbase.getStats(tagInfo.tagId, rider);
+            if (!dbase.getPrefetchedStats(tagInfo.tagId, rider)) {
+                rider->statsPending = true;
+                dbase.prefetchStats(tagInfo.tagId);
+            }
 
             // Add to active riders list
 
@@ -662,12 +669,12 @@ void MainWindow::onNewTrackTag(CTagInfo tagInfo) {
                 rider->totalSec += rider->lapSec;
                 rider->totalM += rider->lapM;
 
-                rider->thisMonth.lapCount++;
-                rider->thisMonth.totalSec += rider->lapSec;
-                rider->thisMonth.totalM += rider->lapM;
+                // Until the rider's stats are loaded the lap is kept to be added to them then
 
-                rider->allTime.lapCount++;
-                rider->allTime.totalM += rider->lapM;
+                if (rider->statsPending)
+                    rider->lapsWhileStatsPending.append(CRiderLap((long long)tagInfo.timeStampUSec, rider->lapSec, rider->lapM));
+                else
+                    rider->addLapToStats(rider->lapSec, rider->lapM);
             }
             rider->previousTimeStampUSec = tagInfo.timeStampUSec;
         }
@@ -810,24 +817,10 @@ void MainWindow::onNewTrackTag(CTagInfo tagInfo) {
             t->item(r, AT_COMMENT)->setTextAlignment(Qt::AlignLeft);
 
 
-            // Set initial this month values
-
-            if (rider->thisMonth.lapCount > 0) {
-                t->item(r, AT_DISTANCETHISMONTH)->setData(Qt::DisplayRole, rider->thisMonth.totalM / 1000.);
-                t->item(r, AT_AVERAGESPEEDTHISMONTH)->setData(Qt::DisplayRole, lapSpeed(rider->thisMonth.totalSec, rider->thisMonth.totalM));
-            }
-
-            // Set initial last month values
-
-            if (rider->lastMonth.lapCount > 0) {
-                t->item(r, AT_DISTANCELASTMONTH)->setData(Qt::DisplayRole, rider->lastMonth.totalM / 1000.);
-                t->item(r, AT_AVERAGESPEEDLASTMONTH)->setData(Qt::DisplayRole, lapSpeed(rider->lastMonth.totalSec, rider->lastMonth.totalM));
-            }
-
-            // Set initial all time values
-
-            t->item(r, AT_DISTANCEALLTIME)->setData(Qt::DisplayRole, rider->allTime.totalM / 1000.);
+            // Set initial this month, last month and all time values
 
+            if (!rider->statsPending)
+                showActiveRiderStats(r, rider);
         }
 
         // Otherwise get activeRidersTableIndex corresponding to this rider already in table
@@ -890,7 +883,7 @@ void MainWindow::onNewTrackTag(CTagInfo tagInfo) {
             // Distance
 
             t->item(r, AT_DISTANCE)->setData(Qt::DisplayRole, rider->totalM / 1000.);
-            if (rider->thisMonth.lapCount > 0) {
+            if (!rider->statsPending && rider->thisMonth.lapCount > 0) {
                 t->item(r, AT_DISTANCETHISMONTH)->setData(Qt::DisplayRole, rider->thisMonth.totalM / 1000.);
                 t->item(r, AT_AVERAGESPEEDTHISMONTH)->setData(Qt::DisplayRole, lapSpeed(rider->thisMonth.totalSec, rider->thisMonth.totalM));
             }
@@ -904,7 +897,8 @@ void MainWindow::onNewTrackTag(CTagInfo tagInfo) {
 
             // All time distance
 
-            t->item(r, AT_DISTANCEALLTIME)->setData(Qt::DisplayRole, rider->allTime.totalM / 1000.);
+            if (!rider->statsPending)
+                t->item(r, AT_DISTANCEALLTIME)->setData(Qt::DisplayRole, rider->allTime.totalM / 1000.);
 
         }
 
@@ -912,7 +906,7 @@ void MainWindow::onNewTrackTag(CTagInfo tagInfo) {
         // Add lap to database
 
         int lapmsec = (int)(rider->lapSec * 1000.);
-        dbase.addLap(rider->tagId.toLatin1(), QDateTime::currentDateTime().date().year(), QDateTime::currentDateTime().date().month(), QDateTime::currentDateTime().date().day(), QTime::currentTime().hour(), QTime::currentTime().minute(), QTime::currentTime().second(), lapmsec, rider->lapM);
+        dbase.addLap(rider->tagId.toLatin1(), tagInfo.readerId, tagInfo.antennaId, (long long)tagInfo.timeStampUSec, lapmsec, rider->lapM);
 
 
         // Loop through entries in activeRiders table and flag riders on break
@@ -1088,43 +1082,100 @@ void MainWindow::onNewDeskTag(CTagInfo tagInfo) {
             ui->deskFirstNameLineEdit->clear();
             ui->deskLastNameLineEdit->clear();
         }
+
+        // Rider is signing in, have their stats ready for when they get on the track
+
+        dbase.prefetchStats(tagInfo.tagId);
     }
     ui->deskReadPushButton->setChecked(false);
 }
 
 
 
+// showActiveRiderStats
+// Put rider's this month, last month and all time values in row r of activeRidersTable
+//
+void MainWindow::showActiveRiderStats(int r, const CRider *rider) {
+    QTableWidget *t = ui->activeRidersTableWidget;
+
+    if (rider->thisMonth.lapCount > 0) {
+        t->item(r, AT_DISTANCETHISMONTH)->setData(Qt::DisplayRole, rider->thisMonth.totalM / 1000.);
+        t->item(r, AT_AVERAGESPEEDTHISMONTH)->setData(Qt::DisplayRole, lapSpeed(rider->thisMonth.totalSec, rider->thisMonth.totalM));
+    }
+
+    if (rider->lastMonth.lapCount > 0) {
+        t->item(r, AT_DISTANCELASTMONTH)->setData(Qt::DisplayRole, rider->lastMonth.totalM / 1000.);
+        t->item(r, AT_AVERAGESPEEDLASTMONTH)->setData(Qt::DisplayRole, lapSpeed(rider->lastMonth.totalSec, rider->lastMonth.totalM));
+    }
+
+    t->item(r, AT_DISTANCEALLTIME)->setData(Qt::DisplayRole, rider->allTime.totalM / 1000.);
+}
+
+
+
+// onRiderStatsReady
+// The stats prefetcher has loaded a rider's stats.  Fill them in for an active rider who crossed the line first.
+//
+void MainWindow::onRiderStatsReady(QByteArray tagId) {
+    activeRidersTableMutex.lock();
+    for (int i=0; i<activeRidersList.size(); i++) {
+        CRider *rider = &activeRidersList[i];
+        if (tagId != rider->tagId || !rider->statsPending)
+            continue;
+
+        // Loaded into a scratch rider, then the laps since the first crossing are added.  Laps
+        // committed before the stats were loaded are counted in them already and are skipped.
+
+        CRider loaded;
+        long long loadedTimeStampUSec = 0;
+        if (!dbase.getPrefetchedStats(tagId, &loaded, &loadedTimeStampUSec))
+            break;
+        for (int j=0; j<rider->lapsWhileStatsPending.size(); j++) {
+            const CRiderLap &lap = rider->lapsWhileStatsPending[j];
+            if (lap.timeStampUSec > loadedTimeStampUSec)
+                loaded.addLapToStats(lap.lapSec, lap.lapM);
+        }
+        rider->thisMonth = loaded.thisMonth;
+        rider->lastMonth = loaded.lastMonth;
+        rider->allTime = loaded.allTime;
+        rider->lapsWhileStatsPending.clear();
+        rider->statsPending = false;
+
+        bool sortingEnabled = ui->activeRidersTableWidget->isSortingEnabled();
+        ui->activeRidersTableWidget->setSortingEnabled(false);
+        for (int r=0; r<ui->activeRidersTableWidget->rowCount(); r++) {
+            if (ui->activeRidersTableWidget->item(r, AT_NAME)->text() == rider->name) {
+                showActiveRiderStats(r, rider);
+                break;
+            }
+        }
+        ui->activeRidersTableWidget->setSortingEnabled(sortingEnabled);
+        break;
+    }
+    activeRidersTableMutex.unlock();
+}
+
+
+
 void MainWindow::loadNamesTable(void) {
     int nameCount = dbase.namesRowCount();
 
     ui->namesTableWidget->clear();
-    ui->namesTableWidget->setRowCount(nameCount);
+    ui->namesTableWidget->setRowCount(nameCount < 0 ? 0 : nameCount);
 
-    ui->namesTableWidget->setSortingEnabled(false);
-    QSqlQuery query;
-    query.prepare("select * from names");
-    if (!query.exec()) {
-        return;
-    }
+    // Rows come from the rider directory dbase keeps in memory
 
-    int idTagId = query.record().indexOf("tagId");
-    int idFirst = query.record().indexOf("firstName");
-    int idLast = query.record().indexOf("lastName");
+    ui->namesTableWidget->setSortingEnabled(false);
+    const QHash<QByteArray, CDbaseName> &names = dbase.getNames();
     int row = 0;
-    while (query.next()) {
-        QString tagId;
-        QString firstName;
-        QString lastName;
-        tagId = query.value(idTagId).toString();
-        firstName = query.value(idFirst).toString();
-        lastName = query.value(idLast).toString();
-
+    QHash<QByteArray, CDbaseName>::const_iterator name;
+    for (name = names.constBegin(); name != names.constEnd(); ++name) {
         ui->namesTableWidget->setItem(row, 0, new QTableWidgetItem());
-        ui->namesTableWidget->item(row, 0)->setText(tagId);
+        ui->namesTableWidget->item(row, 0)->setText(name->tagId);
         ui->namesTableWidget->setItem(row, 1, new QTableWidgetItem());
-        ui->namesTableWidget->item(row, 1)->setText(firstName);
+        ui->namesTableWidget->item(row, 1)->setText(name->firstName);
         ui->namesTableWidget->setItem(row, 2, new QTableWidgetItem());
-        ui->namesTableWidget->item(row, 2)->setText(lastName);
+        ui->namesTableWidget->item(row, 2)->setText(name->lastName);
         row++;
     }
     ui->namesTableWidget->setSortingEnabled(true);
@@ -58,6 +58,7 @@ private:
     void guiInformation(QString);
     QMessageBox::StandardButtons guiQuestion(QString s, QMessageBox::StandardButtons b=QMessageBox::Ok);
     float lapSpeed(float lapSec, float lapM);
+    void showActiveRiderStats(int r, const CRider *rider);
     QList<float> trackLengthM;      // length of track (1 lap) at height of each antenna
     QSettings settings;
 public slots:
@@ -73,6 +74,7 @@ private slots:
     void onPurgeActiveRidersList(void);
     void onNewTrackTag(CTagInfo);
     void onNewDeskTag(CTagInfo);
+    void onRiderStatsReady(QByteArray tagId);
     void onNewLogMessage(QString);
     void onLapsTableHorizontalHeaderSectionClicked(int);
     void onActiveRidersTableHorizontalHeaderSectionClicked(int);
@@ -0,0 +1,237 @@
+// clapstoretest.cpp
+//
+// Runs the same checks on an empty laps table and an empty lap log:
+//   clapstoretest DIR   the laps table in DIR/test.sqlite, the lap log in DIR/laplog,
+//                       DIR must not exist yet
+// Exit code is 0 when both pass.  Build with qmake clapstoretest.pro.
+
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include "cdbase.h"
+#include "clapstore.h"
+#include "claplog.h"
+
+
+
+// Laps for testStore(), a batch's a month after the previous batch's.  Rider i % 3 has
+// lap i, every 7th is out of time order, and no rider has two laps at one time.
+
+static QList<CLapRecord> testLaps(int batch, int count) {
+    QList<CLapRecord> laps;
+    long long start = 1700000000000000LL + batch * 31LL * 24 * 3600 * 1000000;
+    for (int i=0; i<count; i++) {
+        CLapRecord lap;
+        lap.tagId = "E200" + QByteArray::number(i % 3);
+        lap.timeStampUSec = start + i * 37000000LL - (i % 7 == 3 ? 50000000LL : 0);
+        lap.sessionId = batch + 1;
+        lap.readerId = i % 2;
+        lap.antennaId = i % 4 + 1;
+        lap.lapmsec = 30000 + 17 * i;
+        lap.lapm = 250.125f + i;
+        laps.append(lap);
+    }
+    return laps;
+}
+
+// The rider of testStore()'s laps that are never committed
+
+static const char testUncommittedTagId[] = "E2009";
+
+
+
+// checkTestScan
+// Compare what store scans to the laps of laps it should find, adding what differs to failures
+//
+static void checkTestScan(CLapStore *store, const QList<CLapRecord> &laps, const QByteArray &tagId,
+                          long long start, long long end, const QString &what, QStringList *failures) {
+    QList<int> order;
+    for (int i=0; i<laps.size(); i++)
+        if ((tagId.isEmpty() || laps[i].tagId == tagId) && laps[i].timeStampUSec >= start && laps[i].timeStampUSec < end)
+            order.append(i);
+    std::stable_sort(order.begin(), order.end(), [&laps](int a, int b) {
+        return laps[a].tagId != laps[b].tagId ? laps[a].tagId < laps[b].tagId : laps[a].timeStampUSec < laps[b].timeStampUSec;
+    });
+
+    CLapColumns expected;
+    for (int i=0; i<order.size(); i++) {
+        const CLapRecord &lap = laps[order[i]];
+        expected.tagIndex.append(expected.addTagId(lap.tagId));
+        expected.timeStampUSec.append(lap.timeStampUSec);
+        expected.sessionId.append(lap.sessionId);
+        expected.readerId.append(lap.readerId);
+        expected.antennaId.append(lap.antennaId);
+        expected.lapmsec.append(lap.lapmsec);
+        expected.lapm.append(lap.lapm);
+    }
+
+    CLapColumns found;
+    QStringList differences;
+    if (store->scan(tagId, start, end, &found) != 0)
+        failures->append(what + ": scan failed, " + store->errorText());
+    else if (expected.compare(found, &differences) != 0)
+        failures->append(what + ": " + differences.join("; "));
+}
+
+
+
+// checkTestLaps
+// Check that store has just laps, adding what doesn't match to failures
+//
+static void checkTestLaps(CLapStore *store, const QList<CLapRecord> &laps, const QString &what, QStringList *failures) {
+    if (store->lapCount() != laps.size())
+        failures->append(what + QString(": %1 laps, expected %2").arg(store->lapCount()).arg(laps.size()));
+
+    long long first = 0;
+    long long last = -1;
+    for (int i=0; i<laps.size(); i++) {
+        if (i == 0 || laps[i].timeStampUSec < first)
+            first = laps[i].timeStampUSec;
+        if (i == 0 || laps[i].timeStampUSec > last)
+            last = laps[i].timeStampUSec;
+    }
+    long long foundFirst;
+    long long foundLast;
+    if (store->timeStampRange(&foundFirst, &foundLast) != 0)
+        failures->append(what + ": timeStampRange failed, " + store->errorText());
+    else if (laps.isEmpty() ? foundFirst <= foundLast : foundFirst != first || foundLast != last)
+        failures->append(what + QString(": laps from %1 to %2, expected %3 to %4").arg(foundFirst).arg(foundLast).arg(first).arg(last));
+
+    // Every lap, each rider's, and a time range that starts on one lap and ends on another
+
+    QList<QByteArray> tagIds;
+    tagIds << "E2000" << "E2001" << "E2002" << testUncommittedTagId << "nobody";
+    checkTestScan(store, laps, "", CLapStore::timeStampUSecMin, CLapStore::timeStampUSecMax, what + ", every lap", failures);
+    for (int t=0; t<tagIds.size(); t++)
+        checkTestScan(store, laps, tagIds[t], CLapStore::timeStampUSecMin, CLapStore::timeStampUSecMax,
+                      what + ", rider " + QString(tagIds[t]), failures);
+    if (laps.size() >= 10) {
+        long long start = laps[3].timeStampUSec;
+        long long end = laps[8].timeStampUSec;
+        checkTestScan(store, laps, "", start, end, what + ", laps 3 to 8", failures);
+        checkTestScan(store, laps, laps[3].tagId, start, end, what + ", rider " + QString(laps[3].tagId) + " laps 3 to 8", failures);
+        checkTestScan(store, laps, "", start, start, what + ", no time", failures);
+    }
+}
+
+
+
+// testStore
+// Check store, open and empty, by appending, committing and rolling back laps
+// with db as the lap writer does and scanning them back.  Every kind of store passes
+// the same checks.  Return the number of failures, each described in failures.
+//
+static int testStore(CLapStore *store, QSqlDatabase db, QStringList *failures) {
+    int previousFailureCount = failures->size();
+    if (store->lapCount() != 0) {
+        failures->append("store is not empty");
+        return 1;
+    }
+
+    QList<CLapRecord> committed;
+    checkTestLaps(store, committed, "empty", failures);
+
+    // Batches 0 and 3 are committed, 1 is rolled back before the store commits and
+    // 2 after, when the transaction doesn't commit
+
+    for (int batch=0; batch<4; batch++) {
+        QList<CLapRecord> laps = testLaps(batch, batch == 0 || batch == 3 ? 40 : 10);
+        if (batch == 2)
+            for (int i=0; i<laps.size(); i++)
+                laps[i].tagId = testUncommittedTagId;
+        QString what = QString("batch %1").arg(batch);
+        if (!db.transaction()) {
+            failures->append(what + ": could not begin transaction, " + db.lastError().text());
+            continue;
+        }
+        if (store->append(laps) != 0) {
+            failures->append(what + ": append failed, " + store->errorText());
+            db.rollback();
+            store->rollback();
+        }
+        else if (batch == 1) {
+            store->rollback();
+            db.rollback();
+        }
+        else if (store->commit() != 0) {
+            failures->append(what + ": commit failed, " + store->errorText());
+            db.rollback();
+            store->rollback();
+            store->reconcile();
+        }
+        else if (batch == 2) {
+            db.rollback();
+            if (store->reconcile() != 0)
+                failures->append(what + ": reconcile failed, " + store->errorText());
+        }
+        else if (!db.commit()) {
+            failures->append(what + ": could not commit transaction, " + db.lastError().text());
+            db.rollback();
+            store->reconcile();
+        }
+        else
+            committed += laps;
+        checkTestLaps(store, committed, what, failures);
+    }
+
+    store->close();
+    if (store->open() != 0)
+        failures->append("could not open again, " + store->errorText());
+    else
+        checkTestLaps(store, committed, "opened again", failures);
+    return failures->size() - previousFailureCount;
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s DIR\n", argv[0]);
+        return 1;
+    }
+    QString directory = argv[1];
+    if (QFileInfo::exists(directory) || !QDir().mkpath(directory)) {
+        fprintf(stderr, "Could not make %s, it must not exist yet\n", argv[1]);
+        return 2;
+    }
+
+    // CDbase makes the schema the stores need
+
+    CDbase dbase;
+    dbase.setBackgroundThreads(false);
+    if (dbase.open(directory + "/test.sqlite", "", "") != 0) {
+        fprintf(stderr, "Error opening database %s/test.sqlite: %s\n", argv[1], dbase.errorText().toLatin1().data());
+        return 2;
+    }
+
+    int rc = 0;
+    {
+        // Small segments, so the laps span several
+
+        CSqliteLapStore lapsTable(QSqlDatabase::database());
+        CLapLog lapLog(directory + "/laplog", 16);
+        lapLog.setMarkDatabase(QSqlDatabase::database());
+        CLapStore *stores[2] = { &lapsTable, &lapLog };
+        const char *storeNames[2] = { "laps table", "lap log" };
+        for (int s=0; s<2; s++) {
+            QStringList failures;
+            if (stores[s]->open() != 0)
+                failures.append("could not open, " + stores[s]->errorText());
+            else
+                testStore(stores[s], QSqlDatabase::database(), &failures);
+            for (int i=0; i<failures.size(); i++)
+                printf("%s: %s\n", storeNames[s], failures[i].toLatin1().data());
+            printf("%s: %d failures\n", storeNames[s], failures.size());
+            if (!failures.isEmpty())
+                rc = 4;
+        }
+    }
+    dbase.close();
+    return rc;
+}
@@ -0,0 +1,32 @@
+#-------------------------------------------------
+#
+# clapstoretest, the lap store checks, see clapstoretest.cpp
+#
+#-------------------------------------------------
+
+QT += core sql
+QT -= gui
+
+TARGET = clapstoretest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+INCLUDEPATH += ..
+
+SOURCES += clapstoretest.cpp \
+    ../cdbase.cpp \
+    ../cbulkfile.cpp \
+    ../crider.cpp \
+    ../clapwriter.cpp \
+    ../clapstore.cpp \
+    ../claplog.cpp \
+    ../cstatsprefetcher.cpp
+
+HEADERS += ../cdbase.h \
+    ../cbulkfile.h \
+    ../crider.h \
+    ../clapwriter.h \
+    ../clapstore.h \
+    ../claplog.h \
+    ../cstatsprefetcher.h